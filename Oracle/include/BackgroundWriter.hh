@@ -0,0 +1,152 @@
+/**
+ * @file BackgroundWriter.hh
+ *
+ *
+ * @brief BackgroundWriter class template
+ *
+ * @version 1.0
+ */
+
+#ifndef BACKGROUNDWRITER_H_
+#define BACKGROUNDWRITER_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+/** \class BackgroundWriter
+ *  \brief A bounded queue of items consumed in order by a background thread.
+ *
+ *  The producers hand over their full buffers with push(), which waits while
+ *  the pending items weigh capacity or more (one per item, unless a weight
+ *  function is given), so that the memory used stays bounded when the
+ *  consumer lags behind. The consumer runs in the writer thread only; it is
+ *  called for every item, even after it failed to write one, and keeps
+ *  track of its errors itself. The idle function, if any, is called
+ *  whenever the queue becomes empty, to flush a stream for instance.
+ */
+template <typename Item>
+class BackgroundWriter
+{
+public:
+  using Consumer = std::function<void(Item &)>;
+  using Weight = std::function<size_t(Item const &)>;
+
+private:
+  Consumer consume;
+  std::function<void()> idle;
+  Weight weight;
+  size_t capacity;
+  std::mutex mutex;
+  std::condition_variable itemReady;
+  std::condition_variable itemWritten;
+  /// the items and their weights
+  std::deque<std::pair<Item, size_t>> pending;
+  size_t pendingWeight;
+  bool writing;
+  bool closing;
+  std::thread worker;
+
+public:
+  /**
+   * Starts the writer thread.
+   *
+   * @param[in] consume The function writing an item.
+   * @param[in] capacity The weight of the pending items from which push() waits.
+   * @param[in] idle The function called when the queue becomes empty, or nullptr.
+   * @param[in] weight The weight of an item, or nullptr to count the items.
+   */
+  BackgroundWriter(Consumer consume, size_t capacity, std::function<void()> idle = nullptr, Weight weight = nullptr)
+      : consume(std::move(consume)),
+        idle(std::move(idle)),
+        weight(std::move(weight)),
+        capacity(capacity),
+        pendingWeight(0),
+        writing(false),
+        closing(false),
+        worker(&BackgroundWriter::run, this)
+  {
+  }
+
+  /// writes the pending items and stops the thread
+  ~BackgroundWriter()
+  {
+    close();
+  }
+
+  BackgroundWriter(BackgroundWriter const &) = delete;
+  BackgroundWriter &operator=(BackgroundWriter const &) = delete;
+
+  /// hands an item over to the writer thread
+  void push(Item item)
+  {
+    size_t const itemWeight = weight ? weight(item) : 1;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      itemWritten.wait(lock, [this]() { return pendingWeight < capacity; });
+      pendingWeight += itemWeight;
+      pending.emplace_back(std::move(item), itemWeight);
+    }
+    itemReady.notify_one();
+  }
+
+  /// waits until the items handed over so far are written
+  void drain()
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    itemWritten.wait(lock, [this]() { return pending.empty() && !writing; });
+  }
+
+  /// writes the pending items and stops the thread; no item may be pushed afterwards
+  void close()
+  {
+    if (!worker.joinable()) {
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      closing = true;
+    }
+    itemReady.notify_one();
+    worker.join();
+  }
+
+private:
+  void run()
+  {
+    while (true) {
+      std::pair<Item, size_t> item;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        itemReady.wait(lock, [this]() { return !pending.empty() || closing; });
+        if (pending.empty()) {
+          return;
+        }
+        item = std::move(pending.front());
+        pending.pop_front();
+        writing = true;
+      }
+      consume(item.first);
+      bool empty;
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        pendingWeight -= item.second;
+        empty = pending.empty();
+      }
+      if (empty && idle) {
+        idle();
+      }
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        writing = false;
+      }
+      itemWritten.notify_all();
+    }
+  }
+};
+
+#endif /* BACKGROUNDWRITER_H_ */
@@ -0,0 +1,64 @@
+/**
+ * @file BoundingBox.hh
+ *
+ *
+ * @brief Axis-aligned bounding boxes
+ *
+ * @version 1.0
+ */
+
+#ifndef BOUNDINGBOX_H_
+#define BOUNDINGBOX_H_
+
+#include <algorithm>
+#include <array>
+#include <limits>
+
+/// An axis-aligned box: xmin, xmax, ymin, ymax, zmin, zmax.
+typedef std::array<double, 6> BoundingBox;
+
+/// the box containing all space
+inline BoundingBox infiniteBox()
+{
+  double const inf = std::numeric_limits<double>::infinity();
+  return {{-inf, inf, -inf, inf, -inf, inf}};
+}
+
+/// a box containing no point
+inline BoundingBox emptyBox()
+{
+  double const inf = std::numeric_limits<double>::infinity();
+  return {{inf, -inf, inf, -inf, inf, -inf}};
+}
+
+inline bool isEmpty(BoundingBox const &box)
+{
+  return !(box[0] <= box[1] && box[2] <= box[3] && box[4] <= box[5]);
+}
+
+inline bool inBox(BoundingBox const &box, double x, double y, double z)
+{
+  return x >= box[0] && x <= box[1] && y >= box[2] && y <= box[3] && z >= box[4] && z <= box[5];
+}
+
+inline BoundingBox intersectBoxes(BoundingBox const &a, BoundingBox const &b)
+{
+  return {{std::max(a[0], b[0]), std::min(a[1], b[1]),
+           std::max(a[2], b[2]), std::min(a[3], b[3]),
+           std::max(a[4], b[4]), std::min(a[5], b[5])}};
+}
+
+inline BoundingBox uniteBoxes(BoundingBox const &a, BoundingBox const &b)
+{
+  if (isEmpty(a)) {
+    return b;
+  }
+  if (isEmpty(b)) {
+    return a;
+  }
+  return {{std::min(a[0], b[0]), std::max(a[1], b[1]),
+           std::min(a[2], b[2]), std::max(a[3], b[3]),
+           std::min(a[4], b[4]), std::max(a[5], b[5])}};
+}
+
+#endif /* BOUNDINGBOX_H_ */
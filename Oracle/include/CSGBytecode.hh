@@ -0,0 +1,211 @@
+/**
+ * @file CSGBytecode.hh
+ *
+ *
+ * @brief CSGBytecode class header
+ *
+ * @version 1.0
+ */
+
+#ifndef CSGBYTECODE_H_
+#define CSGBYTECODE_H_
+
+#include "BoundingBox.hh"
+#include "SurfaceTable.hh"
+#include <array>
+#include <cstdint>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+/// The operator combining a volume with its operands.
+enum class CSGOperator { NONE, UNION, INTE };
+
+/** \class CSGBytecode
+ *  \brief Flattened, interpretable form of a CSG geometry.
+ *
+ *  Each volume is compiled into a short program acting on a boolean
+ *  accumulator. The first instruction evaluates the quadric half-spaces of
+ *  the volume, whose sign-adjusted coefficients are stored contiguously in
+ *  structure-of-arrays form, so that the test is a branch-free loop. The
+ *  following instructions combine the accumulator with torus half-spaces and
+ *  with operand volumes; they are skipped as soon as the result is known.
+ *  The results of operand volumes are memoised during a query, so that
+ *  volumes shared by several operators are evaluated once.
+ *
+ *  The bytecode is built volume by volume, in rank order, with
+ *  beginVolume(), addHalfSpace(), addOperand(), endVolume(), and then
+ *  finalize(), which computes the bounding boxes and the grid used by
+ *  whichVolume() to preselect candidate volumes.
+ */
+class CSGBytecode
+{
+public:
+  enum class OpCode : uint8_t {
+    /// acc = all the quadric half-spaces [a, a + b) contain the point
+    LOAD_HALFSPACES,
+    /// acc = acc && the point is on side b (+1/-1) of torus surface a
+    AND_TORUS,
+    /// acc = acc || volume a contains the point
+    OR_VOLUME,
+    /// acc = acc && volume a contains the point
+    AND_VOLUME
+  };
+
+  struct Instruction {
+    OpCode op;
+    int32_t a;
+    int32_t b;
+  };
+
+private:
+  struct Program {
+    long number;
+    bool fictive;
+    CSGOperator op;
+    long begin, end;
+    /// the EQUA part of a union is empty: its surfaces do not bound the volume
+    bool emptyUnionEqua;
+  };
+
+  SurfaceTable surfaces;
+  std::vector<Instruction> code;
+  std::vector<Program> programs;
+
+  // quadric half-spaces, structure of arrays, sign-adjusted (inside <=> value < threshold)
+  std::array<std::vector<double>, SurfaceTable::NB_COEFFICIENTS> halfCoefficients;
+  std::vector<double> halfThresholds;
+  /// surface index and sign of each half-space, for bounds and listings
+  std::vector<long> halfSurfaces;
+  std::vector<int> halfSigns;
+  /// radius of each spherical half-space, or -1
+  std::vector<double> halfSphereRadii;
+
+  // volume being built
+  std::vector<std::pair<long, int>> pendingHalfSpaces;
+  std::vector<long> pendingOperands;
+  CSGOperator pendingOperator;
+
+  // acceleration grid
+  std::vector<BoundingBox> bounds;
+  BoundingBox gridBox;
+  std::array<long, 3> gridDims;
+  std::vector<long> cellOffsets;
+  std::vector<long> cellRanks;
+
+public:
+  /**
+   * Class constructor.
+   *
+   * @param[in] surfaces The surfaces referenced by the volumes.
+   */
+  CSGBytecode(SurfaceTable const &surfaces);
+
+  /**
+   * Starts the program of the volume with the next rank.
+   *
+   * @param[in] number The volume number.
+   * @param[in] fictive Whether whichVolume() should ignore the volume.
+   */
+  void beginVolume(long number, bool fictive);
+
+  /**
+   * Adds a half-space to the volume being built.
+   *
+   * @param[in] surfaceNumber The surface number.
+   * @param[in] sign +1 for PLUS, -1 for MINUS.
+   */
+  void addHalfSpace(long surfaceNumber, int sign);
+
+  /**
+   * Adds an operand to the volume being built. Operands may refer to
+   * volumes which are not built yet.
+   */
+  void addOperand(CSGOperator op, long rank);
+
+  /// emits the program of the volume being built
+  void endVolume();
+
+  /// computes the bounding boxes and the acceleration grid
+  void finalize();
+
+  /**
+   * Tests whether a point is inside a volume, fictive or not.
+   */
+  bool contains(long rank, double x, double y, double z) const;
+
+  /**
+   * Returns the rank of the first non-fictive volume containing a point.
+   *
+   * @param[in] point The coordinates of the point.
+   * @return the rank, or -1 if the point is outside the geometry.
+   */
+  long whichVolume(std::vector<double> const &point) const;
+
+  /**
+   * Estimates the distance from a point to the boundary of a volume, from
+   * the equations of the surfaces bounding the volume and its operands. The
+   * distance is exact for planes and spheres; for the other quadrics and for
+   * tori it is the first-order bound |f| / |grad f|. Surfaces which only
+   * bound operands of an intersection, or inner faces of a union, may give a
+   * shorter distance than the true one.
+   *
+   * @return the distance, or 1e10 if the volume has no bounding surface.
+   */
+  double distanceBound(long rank, double x, double y, double z) const;
+
+  /**
+   * Returns a lower bound of the distance from a point to the boundary of a
+   * volume: the exact distance to planes and spheres, a bound from the
+   * value, the gradient and the curvature of the equation for the other
+   * quadrics. It is 0 if the volume or its operands are bounded by a torus.
+   */
+  double safeDistance(long rank, double x, double y, double z) const;
+
+  /**
+   * Returns the rank which whichVolume() returns for all the points of a box,
+   * when the safe distances from its centre prove that the box crosses no
+   * surface of this volume and of the non-fictive volumes before it.
+   *
+   * @return the rank, or -1 if it is not proven or the box is outside the
+   * geometry.
+   */
+  long whichVolumeOfBox(BoundingBox const &box) const;
+
+  /**
+   * Returns a hash of the definition of each volume: its operator, its
+   * half-spaces with the parameters of their surfaces, and the hashes of
+   * its operands. Volumes with the same hash contain the same points,
+   * whatever their numbers and the rest of the geometry.
+   */
+  std::vector<uint64_t> getSignatures() const;
+
+  /**
+   * Writes a readable listing of the program of a volume.
+   */
+  void disassemble(long rank, std::ostream &stream) const;
+
+  long getNbVolumes() const;
+  long getVolumeNumber(long rank) const;
+  bool isFictive(long rank) const;
+  /// the total number of instructions
+  long getNbInstructions() const;
+  /// a box enclosing the volume (possibly infinite)
+  BoundingBox const &getBoundingBox(long rank) const;
+  SurfaceTable const &getSurfaces() const;
+
+private:
+  struct Workspace;
+  bool run(long rank, double x, double y, double z, Workspace &workspace) const;
+  bool call(long rank, double x, double y, double z, Workspace &workspace) const;
+  bool evaluateHalfSpaces(long begin, long end, double x, double y, double z) const;
+  double halfSpaceDistance(long begin, long end, double x, double y, double z, bool safe) const;
+  double nearestSurface(long rank, double x, double y, double z, bool safe) const;
+  BoundingBox computeBounds(long rank, std::vector<int> &state);
+  void buildGrid();
+  bool cellOfPoint(double x, double y, double z, long &cell) const;
+  uint64_t signature(long rank, std::vector<uint64_t> &signatures, std::vector<bool> &known) const;
+  static Workspace &threadWorkspace();
+};
+
+#endif /* CSGBYTECODE_H_ */
@@ -0,0 +1,69 @@
+/**
+ * @file CellQuota.hh
+ *
+ *
+ * @brief CellQuota class header
+ *
+ * @version 1.0
+ */
+
+#ifndef CELLQUOTA_H_
+#define CELLQUOTA_H_
+
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+
+/** \class CellQuota
+ *  \brief Per-cell quota of successful comparisons.
+ *
+ *  Large MCNP models are dominated by a few huge cells, which receive most of
+ *  the PTRAC points. Once a cell has reached its quota of successful
+ *  comparisons, its points are skipped, so that the time is spent on the
+ *  under-sampled cells.
+ */
+class CellQuota
+{
+  long quota;
+  std::unordered_map<long, long> nbSuccesses;
+  long nbCells;
+  long nbFullCells;
+
+public:
+  /**
+   * Class constructor.
+   *
+   * @param[in] quota The number of successes after which the points of a cell
+   * are skipped.
+   * @param[in] cellIDs The MCNP cells to be covered.
+   */
+  CellQuota(long quota, std::vector<unsigned long> const &cellIDs);
+
+  /**
+   * Tests whether a cell has reached its quota. Cells which were not declared
+   * at construction are never full.
+   */
+  bool isFull(long cellID) const;
+
+  /**
+   * Records a successful comparison in a cell.
+   *
+   * @return true if the cell has just reached its quota.
+   */
+  bool recordSuccess(long cellID);
+
+  /// whether all the declared cells have reached their quota
+  bool allFull() const;
+
+  long getQuota() const;
+
+  /// the declared cells which have not reached their quota, sorted
+  std::vector<long> getUnderSampledCells() const;
+
+  /// writes the number of successes of each cell, for a checkpoint
+  void saveState(std::ostream &stream) const;
+  /// restores a state written by saveState(); throws a std::runtime_error if it is malformed
+  void restoreState(std::istream &stream);
+};
+
+#endif /* CELLQUOTA_H_ */
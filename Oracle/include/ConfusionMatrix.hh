@@ -0,0 +1,96 @@
+/**
+ * @file ConfusionMatrix.hh
+ *
+ *
+ * @brief ConfusionMatrix class header
+ *
+ * @version 1.0
+ */
+
+#ifndef CONFUSIONMATRIX_H_
+#define CONFUSIONMATRIX_H_
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/** \class ConfusionMatrix
+ *  \brief Sparse counts of the compared points per (MCNP cell, T4 volume) pair.
+ *
+ *  The counts are kept in a hash map keyed by the cell and the volume number
+ *  packed in one 64-bit integer, so that recording a point costs one hash
+ *  increment. Each comparison owns its matrix, and runs on a single thread at
+ *  a time, so no locking is needed; the matrices of several runs are added
+ *  with merge().
+ *
+ *  For each MCNP cell, the T4 volume holding most of its points is the
+ *  diagonal entry; the other volumes are the off-diagonal entries, which
+ *  point at a misplaced boundary.
+ */
+class ConfusionMatrix
+{
+public:
+  struct Entry {
+    long cellID;
+    /// the T4 volume number, or -1 outside the geometry
+    long volume;
+    long count;
+    /// the number of points of the cell
+    long cellCount;
+    /// the volume holding most of the points of the cell
+    long mainVolume;
+  };
+
+private:
+  std::unordered_map<uint64_t, long> counts;
+
+public:
+  /**
+   * Counts a point.
+   *
+   * @param[in] cellID The MCNP cell of the point.
+   * @param[in] volume The T4 volume number of the point, or -1 outside the geometry.
+   */
+  void add(long cellID, long volume);
+
+  void merge(ConfusionMatrix const &other);
+
+  long getCount(long cellID, long volume) const;
+  /// the number of non-zero entries
+  long getNbEntries() const;
+
+  /// all the entries, sorted by cell and volume
+  std::vector<Entry> getEntries() const;
+
+  /// the entries outside the main volume of each cell, ranked by decreasing count
+  std::vector<Entry> getOffDiagonal() const;
+
+  /// the number of MCNP cells found in several T4 volumes
+  long getNbSplitCells() const;
+
+  /**
+   * Prints the largest off-diagonal entries.
+   *
+   * @param[in] stream The output stream.
+   * @param[in] maxEntries The number of entries printed.
+   */
+  void report(std::ostream &stream, size_t maxEntries) const;
+
+  /**
+   * Writes the entries to a CSV file, with the header
+   * mcnp_cell,t4_volume,count. Throws a std::runtime_error if the file cannot
+   * be written.
+   *
+   * @param[in] path The path of the CSV file.
+   */
+  void writeCSV(std::string const &path) const;
+
+  /// writes the entries on one line
+  void save(std::ostream &stream) const;
+  /// replaces the entries with the ones written by save(); throws a std::runtime_error if they are malformed
+  void read(std::istream &stream, std::string const &name);
+};
+
+#endif /* CONFUSIONMATRIX_H_ */
@@ -0,0 +1,13 @@
+#ifndef DISTANCEMETHOD_HH
+#define DISTANCEMETHOD_HH
+
+/// How the distance from a point to the boundary of its volume is estimated.
+enum class DistanceMethod
+{
+  /// the shortest of six axis-aligned ray casts
+  RAYS,
+  /// a bound computed from the equations of the bounding surfaces
+  ANALYTIC
+};
+
+#endif // DISTANCEMETHOD_HH
@@ -0,0 +1,132 @@
+/**
+ * @file DistanceSummary.hh
+ *
+ *
+ * @brief RunningMoments, QuantileSketch and DistanceSummary classes header
+ *
+ * @version 1.0
+ */
+
+#ifndef DISTANCESUMMARY_H_
+#define DISTANCESUMMARY_H_
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/** \class RunningMoments
+ *  \brief Count, mean, variance and extrema of a stream of values.
+ *
+ *  The mean and the sum of squared deviations are updated with Welford's
+ *  method, and two summaries are merged with the pairwise formula of Chan et
+ *  al., so that the result does not depend on how the stream was split.
+ */
+class RunningMoments
+{
+  long count;
+  double mean;
+  /// the sum of the squared deviations from the mean
+  double m2;
+  double min;
+  double max;
+
+public:
+  RunningMoments();
+
+  void add(double value);
+  void merge(RunningMoments const &other);
+
+  long getCount() const;
+  /// the mean, or 0 without values
+  double getMean() const;
+  /// the sample standard deviation, or 0 with fewer than two values
+  double getStandardDeviation() const;
+  /// the smallest value, or 0 without values
+  double getMin() const;
+  /// the largest value, or 0 without values
+  double getMax() const;
+
+  void save(std::ostream &stream) const;
+  void read(std::istream &stream);
+};
+
+/** \class QuantileSketch
+ *  \brief Mergeable approximate quantiles of a stream of values (KLL sketch).
+ *
+ *  The values go through a hierarchy of compactors. The compactor of level h
+ *  holds values of weight 2^h; when it is full, it is sorted and every other
+ *  value, starting at a random offset, is promoted to level h+1 with twice
+ *  the weight, the others being discarded. The capacities decrease
+ *  geometrically (by 2/3) from the top level down, so that the sketch holds
+ *  O(k log(n/k)) values, and the rank error of a quantile is about 1.7/k of
+ *  the number of values with high probability (Karnin, Lang and Liberty,
+ *  2016). Until the first compaction, the quantiles are exact. The coin
+ *  flips are drawn from a generator of fixed seed, so that runs are
+ *  reproducible.
+ */
+class QuantileSketch
+{
+  int k;
+  long count;
+  std::vector<std::vector<double>> compactors;
+  uint64_t randomState;
+
+public:
+  /**
+   * Class constructor.
+   *
+   * @param[in] k The capacity of the top compactor, which sets the accuracy.
+   */
+  QuantileSketch(int k = 200);
+
+  void add(double value);
+
+  /// adds the values of another sketch, which must have the same k
+  void merge(QuantileSketch const &other);
+
+  /**
+   * Returns an approximate quantile.
+   *
+   * @param[in] q The probability, in [0, 1].
+   * @return the value, or 0 without values.
+   */
+  double quantile(double q) const;
+
+  long getCount() const;
+  /// the number of values held by the sketch
+  long getSize() const;
+
+  void save(std::ostream &stream) const;
+  /// reads a sketch written by save(); throws a std::runtime_error if it is malformed
+  void read(std::istream &stream);
+
+private:
+  long capacity(size_t level) const;
+  void compress();
+  bool flipCoin();
+};
+
+/** \class DistanceSummary
+ *  \brief Moments and quantiles of the distances to the surfaces of a class
+ *  of points (failed or ignored), in constant memory.
+ */
+class DistanceSummary
+{
+  RunningMoments moments;
+  QuantileSketch sketch;
+
+public:
+  void add(double distance);
+  void merge(DistanceSummary const &other);
+
+  RunningMoments const &getMoments() const;
+  double quantile(double q) const;
+
+  /// writes the summary on one line
+  void save(std::ostream &stream) const;
+  /// reads a summary written by save(); throws a std::runtime_error if it is malformed
+  void read(std::istream &stream, std::string const &name);
+};
+
+#endif /* DISTANCESUMMARY_H_ */
@@ -0,0 +1,111 @@
+/**
+ * @file EventLog.hh
+ *
+ *
+ * @brief EventRecord and EventLog classes header
+ *
+ * @version 1.0
+ */
+
+#ifndef EVENTLOG_H_
+#define EVENTLOG_H_
+
+#include "BackgroundWriter.hh"
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+
+/** \class EventRecord
+ *  \brief One JSON object of the event stream, built field by field.
+ */
+class EventRecord
+{
+  std::string text;
+
+public:
+  /// starts a record with the field "event"
+  explicit EventRecord(std::string const &event);
+
+  EventRecord &add(std::string const &key, long value);
+  EventRecord &add(std::string const &key, int value);
+  EventRecord &add(std::string const &key, unsigned long value);
+  /// writes null for the infinite and NaN values
+  EventRecord &add(std::string const &key, double value);
+  EventRecord &add(std::string const &key, bool value);
+  EventRecord &add(std::string const &key, std::string const &value);
+  EventRecord &add(std::string const &key, char const *value);
+
+  /// the JSON object, on one line
+  std::string str() const;
+
+private:
+  void addKey(std::string const &key);
+};
+
+/** \class EventLog
+ *  \brief Writes a stream of events as newline-delimited JSON.
+ *
+ *  The records are appended to an in-memory buffer, which is handed to a
+ *  background writer thread when it is full, so that the comparison loop
+ *  does not wait for the file; at most a few buffers are pending, after
+ *  which write() waits. write() may be called from several threads.
+ */
+class EventLog
+{
+  std::string path;
+  std::ofstream file;
+  std::mutex mutex;
+  std::string current;
+  bool failed;
+  long nbRecords;
+  /// the size of the file once the pending buffers are written
+  int64_t nbBytes;
+  BackgroundWriter<std::string> writer;
+
+public:
+  /**
+   * Class constructor. Throws a std::runtime_error if the file cannot be
+   * opened.
+   *
+   * @param[in] path The path of the event file.
+   * @param[in] resume Whether to keep the file, to be cut by restoreState().
+   */
+  explicit EventLog(std::string const &path, bool resume = false);
+  ~EventLog();
+
+  EventLog(EventLog const &) = delete;
+  EventLog &operator=(EventLog const &) = delete;
+
+  void write(EventRecord const &record);
+
+  /**
+   * Writes the pending records and closes the file. Throws a
+   * std::runtime_error if the file could not be written.
+   */
+  void close();
+
+  /**
+   * Writes the pending records, then the size of the file and the number of
+   * records, for a checkpoint.
+   */
+  void saveState(std::ostream &stream);
+
+  /**
+   * Restores a state written by saveState(): the records written since the
+   * file was opened are dropped, and the file, opened with resume, is cut
+   * back to its size at the checkpoint. Throws a std::runtime_error if the
+   * state is malformed or if the file is shorter.
+   */
+  void restoreState(std::istream &stream);
+
+  std::string const &getPath() const;
+  long getNbRecords() const;
+
+private:
+  /// writes a full buffer, in the writer thread
+  void writeBuffer(std::string const &buffer);
+};
+
+#endif /* EVENTLOG_H_ */
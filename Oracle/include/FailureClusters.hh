@@ -0,0 +1,143 @@
+/**
+ * @file FailureClusters.hh
+ *
+ *
+ * @brief FailureClusters class header
+ *
+ * @version 1.0
+ */
+
+#ifndef FAILURECLUSTERS_H_
+#define FAILURECLUSTERS_H_
+
+#include <array>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/** \class FailureClusters
+ *  \brief Groups the failed points into clusters, for triage.
+ *
+ *  The failed points are first grouped by key: MCNP cell, MCNP material,
+ *  T4 volume and T4 composition. Within a group, the space is cut into
+ *  cubic voxels, and the voxels holding failed points are joined with their
+ *  26 neighbours holding failed points of the same group (union-find), so
+ *  that a cluster is a connected region of voxels. A cluster keeps its
+ *  number of points, its bounding box, its centroid, the largest distance
+ *  to the surface and a bounded number of representative points, each taken
+ *  in a different voxel. The memory grows with the number of voxels
+ *  holding failed points, not with the number of failed points.
+ */
+class FailureClusters
+{
+public:
+  struct Key {
+    long cellID;
+    long materialID;
+    /// the T4 volume number (not its rank)
+    long volume;
+    std::string compo;
+
+    bool operator<(Key const &other) const;
+  };
+
+  struct Representative {
+    std::array<double, 3> position;
+    int64_t pointID;
+    double dist;
+  };
+
+  struct Cluster {
+    Key key;
+    long nbPoints;
+    long nbVoxels;
+    std::array<double, 3> min;
+    std::array<double, 3> max;
+    /// the sum of the positions, for the centroid
+    std::array<double, 3> sum;
+    double maxDist;
+    std::vector<Representative> representatives;
+
+    std::array<double, 3> getCentroid() const;
+  };
+
+private:
+  typedef std::array<long, 3> Voxel;
+
+  struct VoxelHash {
+    size_t operator()(Voxel const &voxel) const;
+  };
+
+  /// the voxels of one group, the clusters being the trees of a union-find forest
+  struct Group {
+    std::unordered_map<Voxel, long, VoxelHash> voxels;
+    std::vector<long> parent;
+    /// the summary of each cluster, valid at the roots only
+    std::vector<Cluster> clusters;
+
+    long find(long node);
+    void join(long first, long second, size_t maxRepresentatives);
+  };
+
+  double voxelSize;
+  size_t maxRepresentatives;
+  std::map<Key, Group> groups;
+  long nbPoints;
+
+public:
+  /**
+   * Class constructor.
+   *
+   * @param[in] voxelSize The edge of the voxels; failed points further apart
+   *            than about one voxel fall in different clusters.
+   * @param[in] maxRepresentatives The number of points kept per cluster.
+   */
+  FailureClusters(double voxelSize, size_t maxRepresentatives = 4);
+
+  /**
+   * Adds a failed point.
+   *
+   * @param[in] key The cells, material and composition of the point.
+   * @param[in] position The position of the point.
+   * @param[in] pointID The point number as listed by MCNP in the PTRAC file.
+   * @param[in] dist The distance from the nearest surface.
+   */
+  void add(Key const &key, std::array<double, 3> const &position, int64_t pointID, double dist);
+
+  /// the clusters, ranked by decreasing number of points
+  std::vector<Cluster> getClusters() const;
+
+  long getNbPoints() const;
+  long getNbGroups() const;
+  double getVoxelSize() const;
+
+  /**
+   * Prints the largest clusters.
+   *
+   * @param[in] stream The output stream.
+   * @param[in] maxClusters The number of clusters printed.
+   */
+  void report(std::ostream &stream, size_t maxClusters) const;
+
+  /**
+   * Writes all the clusters to rawname.clusters, and their representative
+   * points to rawname.representatives, in the format read by explainT4
+   * (x y z volume, one point per line).
+   *
+   * @param[in] rawname The raw file name of the output files.
+   */
+  void write(std::string const &rawname) const;
+
+  /**
+   * Writes the groups (their voxels, union-find forests and the summaries of
+   * the clusters at the roots), for a checkpoint.
+   */
+  void saveState(std::ostream &stream) const;
+  /// restores a state written by saveState(); throws a std::runtime_error if it is malformed
+  void restoreState(std::istream &stream);
+};
+
+#endif /* FAILURECLUSTERS_H_ */
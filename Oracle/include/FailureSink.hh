@@ -0,0 +1,154 @@
+/**
+ * @file FailureSink.hh
+ *
+ *
+ * @brief FailureSink and FailureReader classes header
+ *
+ * @version 1.0
+ */
+
+#ifndef FAILURESINK_H_
+#define FAILURESINK_H_
+
+#include "BackgroundWriter.hh"
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/**
+* A structure to represent the points where the weak equivalence test failed.
+*
+*/
+struct failedPoint {
+  std::array<double, 3> position;
+  double mcnpParticleID;
+  double mcnpCellID;
+  double mcnpMaterialID;
+  double dist;
+  double rank;
+};
+
+/// the largest point ID held exactly by the double fields of failedPoint
+constexpr int64_t maxExactPointID = int64_t(1) << 53;
+
+/** \class FailureSink
+ *  \brief Streams the failed points to a binary file as they are found.
+ *
+ *  The points are gathered in blocks of columns (x, y, z as float64; the
+ *  history as int64; the cell, material and rank as int32; the distance as
+ *  float32) and
+ *  the full blocks are written by a background thread. At most a few blocks
+ *  are in memory at any time: add() waits for the writer when it lags
+ *  behind, so that the memory use does not depend on the number of failed
+ *  points.
+ *
+ *  The file starts with the line "ORACLEFAILURES 2", followed by the blocks,
+ *  each one made of its number of points n (int64) and of the eight columns
+ *  of n values, in the byte order of the machine.
+ */
+class FailureSink
+{
+  struct Block {
+    std::vector<double> x, y, z;
+    std::vector<int64_t> pointID;
+    std::vector<int32_t> cellID, materialID, rank;
+    std::vector<float> dist;
+
+    void reserve(size_t size);
+    size_t size() const;
+  };
+
+  std::string path;
+  std::ofstream file;
+  size_t blockSize;
+  Block current;
+  bool failed;
+  long nbPoints;
+  /// the size of the file once the pending blocks are written
+  int64_t nbBytes;
+  BackgroundWriter<Block> writer;
+
+public:
+  /**
+   * Creates the file and starts the writer thread. Throws a
+   * std::runtime_error if the file cannot be created.
+   *
+   * @param[in] path The path of the binary file.
+   * @param[in] blockSize The number of points per block.
+   * @param[in] resume Whether to keep the file, to be cut by restoreState().
+   */
+  FailureSink(std::string const &path, size_t blockSize = 65536, bool resume = false);
+
+  /// closes the sink, ignoring the write errors
+  ~FailureSink();
+
+  FailureSink(FailureSink const &) = delete;
+  FailureSink &operator=(FailureSink const &) = delete;
+
+  /// appends a failed point
+  void add(failedPoint const &point);
+
+  /**
+   * Writes the last block and waits for the writer thread. Throws a
+   * std::runtime_error if the file could not be written.
+   */
+  void close();
+
+  /**
+   * Writes the pending points, then the size of the file and the number of
+   * points, for a checkpoint.
+   */
+  void saveState(std::ostream &stream);
+
+  /**
+   * Restores a state written by saveState(): the file, opened with resume,
+   * is cut back to its size at the checkpoint. Throws a std::runtime_error if
+   * the state is malformed or if the file is shorter.
+   */
+  void restoreState(std::istream &stream);
+
+  std::string const &getPath() const;
+  /// the number of points added so far
+  long getNbPoints() const;
+
+private:
+  /// writes a full block, in the writer thread
+  void writeBlock(Block const &block);
+};
+
+/** \class FailureReader
+ *  \brief Reads back, one block at a time, a file written by FailureSink.
+ */
+class FailureReader
+{
+  std::ifstream file;
+  std::string path;
+  std::vector<failedPoint> block;
+  size_t next;
+  /// the files of version 1 hold the history as int32
+  int version;
+
+public:
+  /**
+   * Opens a file written by FailureSink. Throws a std::runtime_error if the
+   * file cannot be read or is not a failure file.
+   */
+  FailureReader(std::string const &path);
+
+  /**
+   * Reads the next failed point.
+   *
+   * @param[out] point The point.
+   * @return false at the end of the file.
+   */
+  bool read(failedPoint &point);
+
+private:
+  /// reads the next block; returns false at the end of the file
+  bool readBlock();
+};
+
+#endif /* FAILURESINK_H_ */
@@ -0,0 +1,71 @@
+/**
+ * @file GapSource.hh
+ *
+ *
+ * @brief GapSource class header
+ *
+ * @version 1.0
+ */
+
+#ifndef GAPSOURCE_H_
+#define GAPSOURCE_H_
+
+#include "BoundingBox.hh"
+#include <array>
+#include <cstdint>
+#include <ostream>
+#include <random>
+#include <string>
+#include <vector>
+
+class T4Geometry;
+
+/** \class GapSource
+ *  \brief Source points in the T4 volumes that a comparison never hit.
+ *
+ *  Points are sampled uniformly in a box enclosing a volume and kept if the
+ *  T4 geometry locates them in the volume (rejection sampling). They are
+ *  written as an MCNP source distribution, so that a short MCNP run produces
+ *  a PTRAC file aimed at the coverage gaps.
+ */
+class GapSource
+{
+  T4Geometry &t4Geom;
+  std::mt19937_64 generator;
+  long maxTries;
+
+public:
+  /**
+   * Class constructor.
+   *
+   * @param[in] t4Geom The T4 geometry.
+   * @param[in] seed The seed of the random generator.
+   * @param[in] maxTries The maximum number of points tried per point kept.
+   */
+  GapSource(T4Geometry &t4Geom, uint64_t seed, long maxTries = 100000);
+
+  /**
+   * Samples points inside a volume.
+   *
+   * @param[in] rank The volume rank.
+   * @param[in] box A finite box enclosing the volume.
+   * @param[in] nbPoints The number of points to sample.
+   * @return the points; fewer than nbPoints if the volume is too small a
+   * fraction of the box.
+   */
+  std::vector<std::array<double, 3>> sample(long rank, BoundingBox const &box, long nbPoints);
+
+  /**
+   * Writes source points as MCNP SDEF, SI and SP cards, with equal
+   * probabilities. Each card fits in 80 columns. Throws a
+   * std::invalid_argument if there is no point.
+   *
+   * @param[in] stream The output stream.
+   * @param[in] points The source points.
+   * @param[in] comments Comment lines written before the cards.
+   */
+  static void writeSDEF(std::ostream &stream, std::vector<std::array<double, 3>> const &points,
+                        std::vector<std::string> const &comments);
+};
+
+#endif /* GAPSOURCE_H_ */
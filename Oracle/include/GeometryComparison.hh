@@ -0,0 +1,208 @@
+/**
+ * @file GeometryComparison.hh
+ *
+ *
+ * @brief GeometryComparison class header
+ *
+ * @version 1.0
+ */
+
+#ifndef GEOMETRYCOMPARISON_H_
+#define GEOMETRYCOMPARISON_H_
+
+#include "CellQuota.hh"
+#include "EventLog.hh"
+#include "FailureClusters.hh"
+#include "HeatMap.hh"
+#include "MCNPGeometry.hh"
+#include "PointCloudWriter.hh"
+#include "ResultStore.hh"
+#include "SequentialTest.hh"
+#include "Statistics.hh"
+#include "T4Geometry.hh"
+#include "options_compare.hh"
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+/** \class GeometryComparison
+ *  \brief Comparison of one T4 geometry with the MCNP points.
+ *
+ *  The class holds everything that depends on the T4 geometry being tested:
+ *  the geometry itself, its material equivalences, its Statistics and the
+ *  stopping rules (sequential test, cell quota), and the per-point results
+ *  saved or reused for incremental runs. Several instances may share
+ *  the same stream of PTRAC records; distinct instances may compare points
+ *  in different threads as long as they use the native backend.
+ */
+class GeometryComparison
+{
+  OptionsCompare const &options;
+  MCNPGeometry const &mcnpGeom;
+  /// the --events stream, shared by the comparisons, or nullptr
+  EventLog *events;
+  std::string t4Filename;
+  /// the hash of the T4 file, computed for the first checkpoint
+  std::string t4Hash;
+  /// the geometry read by the comparison, or nullptr if it was given one
+  std::unique_ptr<T4Geometry> ownT4Geom;
+  T4Geometry &t4Geom;
+  std::unique_ptr<T4Geometry> crossCheckGeom;
+  Statistics stats;
+  std::unique_ptr<SequentialTest> sequentialTest;
+  std::unique_ptr<CellQuota> cellQuota;
+  std::unique_ptr<FailureClusters> failureClusters;
+  std::unique_ptr<HeatMap> heatMap;
+  std::unique_ptr<PointCloudWriter> failedPointCloud;
+  std::unique_ptr<PointCloudWriter> sampledPointCloud;
+  std::unique_ptr<ResultStore> previousResults;
+  std::unique_ptr<GeometryDiff> geometryDiff;
+  std::unique_ptr<ResultStore> results;
+  std::unordered_map<std::string, long> compoIndex;
+  bool reuseDistances;
+  unsigned long nbReused;
+  unsigned long nbLocated;
+  unsigned long nbCrossCheckMismatches;
+  unsigned long nbBytecodeMismatches;
+  long nbInteriorPoints;
+  unsigned long nbPoints;
+  /// the number of records passed to compare(), compareTrack() or skip()
+  long nbRecords;
+  unsigned long nbSegments;
+  double trackLength;
+  double failedLength;
+  bool done;
+
+public:
+  /**
+   * Reads a T4 geometry and sets it up as required by the options.
+   *
+   * @param[in] t4Filename The T4 input file.
+   * @param[in] options The options of the comparison.
+   * @param[in] mcnpGeom The MCNP geometry, with its input file parsed.
+   * @param[in] events The stream receiving the failures and the material
+   * associations, or nullptr.
+   * @param[in] geometry The geometry of t4Filename, already read with the
+   * backend of the options, or nullptr to read it. The comparison sets it up
+   * (material equivalences, bytecode, voxel cache) and uses it until it is
+   * destroyed.
+   * @throw std::runtime_error if the T4 file cannot be read, or if geometry was
+   * read with another backend.
+   */
+  GeometryComparison(std::string const &t4Filename, OptionsCompare const &options,
+                     MCNPGeometry const &mcnpGeom, EventLog *events = nullptr, T4Geometry *geometry = nullptr);
+
+  /**
+   * Compares the materials of the two geometries at a PTRAC point and
+   * records the outcome. Does nothing once the comparison is done.
+   *
+   * With --reuse-results, the T4 rank (and the distance to the boundary,
+   * when it is needed) is taken from the previous run if no changed volume
+   * can contain the point; the verdict is then derived exactly as if the
+   * point had been located again. The records must be the same, in the same
+   * order, as in the previous run.
+   */
+  void compare(PTRACRecord const &record);
+
+  /**
+   * Walks the straight segments between the successive events of a history
+   * through the T4 geometry, from boundary to boundary, and compares the
+   * composition of each T4 volume crossed with the material of the MCNP
+   * cell the particle is in: the cell of the event starting the segment,
+   * which is the cell entered for a surface crossing. Each stretch of the
+   * segment in one T4 volume is recorded in the statistics as one point,
+   * at its midpoint; a failed stretch no longer than twice --delta is
+   * ignored. The segments starting at a termination event and the ones
+   * leading to a bank event are not flights, and are left out. Does nothing
+   * once the comparison is done.
+   *
+   * The PTRAC file must record the surface crossings, otherwise a segment
+   * may go through several MCNP cells.
+   */
+  void compareTrack(std::vector<PTRACRecord> const &history);
+
+  /**
+   * Counts a point which was not compared, for instance because of the time
+   * budget.
+   */
+  void skip();
+
+  /// whether a stopping rule (sequential test or cell quota) has fired
+  bool isDone() const;
+
+  /**
+   * Prints the counters specific to this geometry (cross-checks, bytecode,
+   * cell quota, reused results) and the largest failure clusters, stores the
+   * outcome of the sequential test in the statistics, saves the per-point
+   * results, the clusters and the heat map and closes the streams of points.
+   * Called once, at the end of the comparison.
+   *
+   * @param[in] resumable Whether the run was interrupted after a checkpoint:
+   * the temporary files of the point files are then kept for --resume.
+   */
+  void finish(bool resumable = false);
+
+  /**
+   * Writes the state of the comparison (counters, statistics, material
+   * equivalences, stopping rules, per-point results, failure clusters, heat
+   * map, and the sizes of the point files and of the failures file), for a
+   * checkpoint.
+   */
+  void saveState(std::ostream &stream);
+
+  /**
+   * Restores a state written by saveState() for the same T4 file; the point
+   * files and the failures file, opened with --resume, are cut back to their
+   * size at the checkpoint. Throws a std::runtime_error if the state is
+   * malformed or if the T4 file changed.
+   */
+  void restoreState(std::istream &stream);
+
+  /**
+   * The path of the output files of a T4 file, without their extension: the
+   * name of the T4 file without its extension, in --output-dir.
+   */
+  static std::string getOutputRawName(OptionsCompare const &options, std::string const &t4Filename);
+
+  std::string const &getFilename() const;
+  Statistics &getStatistics();
+  T4Geometry &getT4Geometry();
+  /// the number of points whose rank was taken from the previous results
+  unsigned long getNbReused() const;
+  /// the number of points located in the T4 geometry
+  unsigned long getNbLocated() const;
+
+private:
+  /// walks one segment of a track, starting in the MCNP cell of the start event
+  void walkSegment(PTRACRecord const &start, std::vector<double> const &end);
+
+  /// records the verdict on the stretch [begin, end] of a segment, inside the T4 volume rank
+  void compareStretch(PTRACRecord const &start, std::vector<double> const &dir, double begin, double end,
+                      long rank);
+
+  /// adds a failed point to the clusters, if they are enabled
+  void recordCluster(std::vector<double> const &point, long rank, std::string const &compo, long cellID,
+                     long materialID, int64_t pointID, double dist);
+
+  /// writes a failed point to the event stream, if there is one
+  void writeFailureEvent(std::vector<double> const &point, long rank, std::string const &compo, long cellID,
+                         long materialID, std::string const &materialDensityKey, int64_t pointID, double dist);
+
+  /// writes a material association to the event stream, if there is one
+  void writeAssociationEvent(std::string const &materialDensityKey, std::string const &compo, long cellID,
+                             std::vector<double> const *point);
+
+  /// adds a compared point to the heat map and to the point files, if they are enabled
+  void recordPoint(std::vector<double> const &point, int64_t pointID, long cellID, long materialID, long rank,
+                   double dist, ResultStore::Verdict verdict);
+
+  /// applies the stopping rules after a point or a track
+  void updateStoppingRules();
+
+  /// whether the rank found by the previous run still holds
+  bool canReuse(ResultStore::Entry const &previous, std::vector<double> const &point) const;
+};
+
+#endif /* GEOMETRYCOMPARISON_H_ */
@@ -0,0 +1,84 @@
+/**
+ * @file HeatMap.hh
+ *
+ *
+ * @brief HeatMap class header
+ *
+ * @version 1.0
+ */
+
+#ifndef HEATMAP_H_
+#define HEATMAP_H_
+
+#include "BoundingBox.hh"
+#include "ResultStore.hh"
+#include <array>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/** \class HeatMap
+ *  \brief 3D histograms of the compared, failed and ignored points on a
+ *  regular mesh.
+ *
+ *  The counts are accumulated during the comparison, in memory proportional
+ *  to the number of mesh cells, and written to a VTK ImageData file (.vti,
+ *  raw appended binary data), which ParaView and VisIt read as cell data.
+ */
+class HeatMap
+{
+  BoundingBox box;
+  std::array<long, 3> dims;
+  std::array<double, 3> spacing;
+  /// the counts, x varying fastest, then y, then z
+  std::vector<uint32_t> sampled;
+  std::vector<uint32_t> failed;
+  std::vector<uint32_t> ignored;
+  /// the number of points outside the mesh, which are not counted
+  long nbOutsideMesh;
+
+public:
+  /**
+   * Class constructor.
+   *
+   * @param[in] box The bounds of the mesh, which must not be empty or infinite.
+   * @param[in] dims The number of mesh cells along x, y and z.
+   */
+  HeatMap(BoundingBox const &box, std::array<long, 3> const &dims);
+
+  /**
+   * Counts a compared point. The points outside the T4 geometry count as
+   * sampled only.
+   *
+   * @param[in] point The position of the point.
+   * @param[in] verdict The outcome of the comparison at the point.
+   */
+  void add(std::vector<double> const &point, ResultStore::Verdict verdict);
+
+  /// the index of the mesh cell holding a point, or -1 outside the mesh
+  long cellIndex(std::vector<double> const &point) const;
+
+  BoundingBox const &getBox() const;
+  std::array<long, 3> const &getDims() const;
+  std::vector<uint32_t> const &getSampled() const;
+  std::vector<uint32_t> const &getFailed() const;
+  std::vector<uint32_t> const &getIgnored() const;
+  long getNbOutsideMesh() const;
+
+  /// writes the non-zero counts, for a checkpoint
+  void saveState(std::ostream &stream) const;
+  /// restores a state written by saveState(); throws a std::runtime_error if it is malformed
+  void restoreState(std::istream &stream);
+
+  /**
+   * Writes the counts to a VTK ImageData file, as the cell data arrays
+   * "sampled", "failed" and "ignored" (UInt32). Throws a std::runtime_error
+   * if the file cannot be written.
+   *
+   * @param[in] path The path of the .vti file.
+   */
+  void write(std::string const &path) const;
+};
+
+#endif /* HEATMAP_H_ */
@@ -0,0 +1,119 @@
+/**
+ * @file Log.hh
+ *
+ *
+ * @brief Log, LogMessage and LogGroup classes header
+ *
+ * @version 1.0
+ */
+
+#ifndef LOG_H_
+#define LOG_H_
+
+#include <ostream>
+#include <sstream>
+#include <string>
+
+/// the levels of the messages, from the most to the least important
+enum class LogLevel { ERROR = 0, WARNING = 1, INFO = 2, VERBOSE = 3 };
+
+/// the least important level compiled in; the messages beyond it cost nothing
+#ifndef ORACLE_LOG_MAX_LEVEL
+#define ORACLE_LOG_MAX_LEVEL 3
+#endif
+
+/**
+ * Starts a message of the given level (ERROR, WARNING, INFO or VERBOSE),
+ * to be completed with operator<<. The message is only formatted if the
+ * level is compiled in and enabled:
+ *
+ *   ORACLE_LOG(VERBOSE) << "associating " << name;
+ */
+#define ORACLE_LOG(level)                                                                            \
+  if (static_cast<int>(LogLevel::level) > ORACLE_LOG_MAX_LEVEL || !Log::isEnabled(LogLevel::level)) { \
+  } else                                                                                             \
+    LogMessage(LogLevel::level).stream()
+
+/** \class Log
+ *  \brief The output of the messages of the Oracle tools.
+ *
+ *  Each thread appends its messages to its own buffer, without locking;
+ *  the buffer is handed to a single background writer at the end of each
+ *  message, or at the end of the outermost LogGroup, so that a thread only
+ *  takes a lock once per message or per group. The writer prints the
+ *  messages of level ERROR to std::cerr and the others to std::cout, in
+ *  the order in which the buffers were handed over, and flushes the
+ *  streams whenever it has nothing left to write. The messages of a thread
+ *  keep their order; the messages of a LogGroup are never
+ *  interleaved with those of other threads. At most a few megabytes are
+ *  waiting for the writer: beyond, the threads wait for it.
+ */
+class Log
+{
+public:
+  /// the messages less important than level are dropped (default: INFO)
+  static void setLevel(LogLevel level);
+  static LogLevel getLevel();
+  static bool isEnabled(LogLevel level);
+
+  /// appends a message to the buffer of the calling thread
+  static void write(LogLevel level, std::string const &text);
+
+  /**
+   * Waits until the messages handed over so far, and those of the calling
+   * thread outside a LogGroup, are printed and the streams flushed.
+   */
+  static void sync();
+
+  /**
+   * A stream which logs each line written to it as an INFO message, for the
+   * libraries printing to a std::ostream. It may only be used by one thread.
+   */
+  static std::ostream &infoStream();
+
+private:
+  friend class LogGroup;
+  static void openGroup();
+  static void closeGroup();
+};
+
+/** \class LogMessage
+ *  \brief One message, formatted in its stream and logged when destroyed.
+ *
+ *  A newline is added unless the message already ends with one. The
+ *  message is dropped if its level is not enabled.
+ */
+class LogMessage
+{
+  LogLevel level;
+  bool enabled;
+  std::ostringstream text;
+
+public:
+  explicit LogMessage(LogLevel level);
+  ~LogMessage();
+
+  LogMessage(LogMessage const &) = delete;
+  LogMessage &operator=(LogMessage const &) = delete;
+
+  std::ostream &stream();
+};
+
+/** \class LogGroup
+ *  \brief Keeps the messages of the calling thread together while it exists,
+ *  typically those about one point.
+ *
+ *  Groups may be nested; the messages are handed to the writer when the
+ *  outermost group is destroyed.
+ */
+class LogGroup
+{
+public:
+  LogGroup();
+  ~LogGroup();
+
+  LogGroup(LogGroup const &) = delete;
+  LogGroup &operator=(LogGroup const &) = delete;
+};
+
+#endif /* LOG_H_ */
@@ -0,0 +1,136 @@
+/**
+ * @file MCNPCells.hh
+ *
+ *
+ * @brief MCNPCellEvaluator class header
+ *
+ * @version 1.0
+ */
+
+#ifndef MCNPCELLS_H_
+#define MCNPCELLS_H_
+
+#include "BoundingBox.hh"
+#include "SurfaceTable.hh"
+#include <array>
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/** \class MCNPCellEvaluator
+ *  \brief Point location in the cells of an MCNP input file.
+ *
+ *  The constructor reads the cell and surface blocks and the TR cards of the
+ *  data block. Surfaces are stored in a SurfaceTable; macrobodies (RPP, BOX,
+ *  SPH, RCC, RHP/HEX, REC, TRC, ELL, WED, ARB) are split into their facets,
+ *  so that the inside of every surface is an intersection of quadric or torus
+ *  half-spaces. The boolean expression of each cell, including the #
+ *  complements of cells and of parenthesised expressions, is compiled into a
+ *  postfix program evaluated on a small stack of booleans.
+ *
+ *  Universes are supported through the U and FILL cell parameters, with an
+ *  optional transformation of the filling universe. A cell with a TRCL
+ *  parameter gets its own copies of its surfaces, numbered 1000 * cell +
+ *  surface as in MCNP, and its filling universe moves with it. Periodic
+ *  surfaces are read as ordinary surfaces.
+ *
+ *  Lattice cells and the cells using an unknown surface type are skipped:
+ *  they contain no point, and getSkippedCells() tells why. Syntax errors
+ *  raise a std::runtime_error.
+ */
+class MCNPCellEvaluator
+{
+public:
+  enum class OpCode : uint8_t {
+    /// push whether the point is on side b (+1/-1) of surface a
+    HALFSPACE,
+    /// replace the top of the stack by its negation
+    NOT,
+    /// pop two values, push their conjunction
+    AND,
+    /// pop two values, push their disjunction
+    OR
+  };
+
+  struct Instruction {
+    OpCode op;
+    int32_t a;
+    int32_t b;
+  };
+
+  /// maximum depth of the evaluation stack of a cell
+  static constexpr int maxStackDepth = 64;
+
+private:
+  struct Cell {
+    long number;
+    long universe;
+    /// the filling universe, or -1
+    long fill;
+    /// index of the transformation of the filling universe, or -1
+    long fillTransform;
+    long begin, end;
+  };
+
+  SurfaceTable surfaces;
+  std::vector<Instruction> code;
+  std::vector<Cell> cells;
+  std::vector<BoundingBox> bounds;
+  std::vector<SurfaceTransform> fillTransforms;
+  std::unordered_map<long, long> indexOfCell;
+  /// indices of the cells of each universe, in input order
+  std::unordered_map<long, std::vector<long>> cellsOfUniverse;
+  /// the skipped cells and the reason why
+  std::vector<std::pair<long, std::string>> skippedCells;
+
+public:
+  /**
+   * Reads the geometry of an MCNP input file.
+   *
+   * @param[in] inputPath MCNP inp file path.
+   */
+  MCNPCellEvaluator(std::string const &inputPath);
+
+  /**
+   * Reads the geometry of an MCNP input deck from a stream.
+   */
+  MCNPCellEvaluator(std::istream &stream);
+
+  /**
+   * Returns the number of the deepest cell containing a point, following the
+   * FILL parameters from the real world (universe 0).
+   *
+   * @param[in] point The coordinates of the point.
+   * @return the cell number, or -1 if no cell contains the point.
+   */
+  long whichCell(std::vector<double> const &point) const;
+
+  /**
+   * Tests whether a point, given in the coordinates of the universe of the
+   * cell, is inside a cell.
+   */
+  bool contains(long index, double x, double y, double z) const;
+
+  long getNbCells() const;
+  long getCellNumber(long index) const;
+  /// the index of a cell given its number, or -1 if the number is unknown
+  long getCellIndex(long number) const;
+  long getUniverse(long index) const;
+  long getFill(long index) const;
+  /// a box enclosing the cell, in the coordinates of its universe (possibly infinite)
+  BoundingBox const &getBoundingBox(long index) const;
+  /// the program of a cell
+  std::vector<Instruction> getProgram(long index) const;
+  SurfaceTable const &getSurfaces() const;
+  /// the numbers of the cells which could not be read, with the reason why
+  std::vector<std::pair<long, std::string>> const &getSkippedCells() const;
+
+private:
+  void read(std::istream &stream);
+  bool onSide(long surface, int sign, double x, double y, double z) const;
+};
+
+#endif /* MCNPCELLS_H_ */
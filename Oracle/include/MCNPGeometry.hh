@@ -11,22 +11,37 @@
 #ifndef MCNPGEOMETRY_H_
 #define MCNPGEOMETRY_H_
 
+#include "MCNPCells.hh"
 #include "PTRACFormat.hh"
+#include <array>
+#include <cstdint>
+#include <condition_variable>
+#include <deque>
+#include <exception>
 #include <fstream>
 #include <iostream>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <tuple>
 #include <utility>
 #include <vector>
 
 struct PTRACRecord {
-  long pointID, eventID;
+  int64_t pointID;
+  long eventID;
   long cellID, materialID;
   std::vector<double> point;
 };
 
+/// the positions of the event type, cell and material among the integer data of an event
+struct PTRACEventLayout {
+  int event, cell, mat;
+};
+
 struct PTRACRecordIndices {
   int event, cell, mat, px, py, pz;
   long nbDataSrcLong, nbDataSrcDouble;
@@ -50,6 +65,19 @@ public:
      */
   virtual bool readNextPtracData(long maxReadPoint) = 0;
 
+  /**
+     * Returns the state needed to resume reading after the last record read,
+     * for a checkpoint: for a single file, the byte offset in the file (or
+     * -1 at the end of the file) and the number of points read.
+     */
+  virtual std::vector<long> getPosition() = 0;
+
+  /**
+     * Restores a state returned by getPosition() on a reader of the same
+     * files. Throws a std::runtime_error if the state is malformed.
+     */
+  virtual void setPosition(std::vector<long> const &position) = 0;
+
   /**
      * Increments the number of points read so far.
      */
@@ -63,7 +91,10 @@ class MCNPPTRACASCII : public MCNPPTRAC
 {
 protected:
   std::string currentLine;
-  int nbDataCellMaterialLine;
+  /// the layout of the data lines of each event type, by event type / 1000
+  std::map<long, PTRACEventLayout> layouts;
+  /// all the events of the last history read
+  std::vector<PTRACRecord> history;
   std::ifstream ptracFile;
 
 public:
@@ -74,12 +105,24 @@ public:
 
   /**
      * If the maximum number of read points has not been reached: reads the next
-     * particle, event, volume, material, position in PTRAC file.
+     * history. The record is its source event; all its events are kept in
+     * getHistory().
      *
      * @returns true if successful, false otherwise.
      */
   bool readNextPtracData(long maxReadPoint);
 
+  std::vector<long> getPosition();
+  void setPosition(std::vector<long> const &position);
+
+  /**
+     * Returns the events of the last history read, in the order of the PTRAC
+     * file, starting with the source event. The eventID of each record is the
+     * type of the event (1000 source, 2000-2999 bank, 3000 surface crossing,
+     * 4000 collision, 5000 termination).
+     */
+  std::vector<PTRACRecord> const &getHistory() const;
+
 protected:
   /**
      * Reads the header lines. Sets the current line at the last header line of PTRAC file.
@@ -89,40 +132,33 @@ protected:
   void goThroughHeaderPTRAC(int nHeaderLines);
 
   /**
-     * Gets the number of data expected on 2nd line of each particle event data block.
-     * If the PTRAC has the correct format, this information is found in the 5th
-     * header line.
+     * Finds the positions of the event type, cell ID and material ID in the
+     * data lines of each event type. The 5th header line gives the number of
+     * variables of the NPS line, then the numbers of integer and real
+     * variables of the source, bank, surface, collision and termination
+     * events; the 6th and 7th header lines list their IDs. The cell ID and
+     * the material ID are respectively identified as 17 and 18 by the PTRAC
+     * writer. The program exits if the source events do not contain them.
      *
      * @param[in] line5 The string containing the data of the 5th header line.
-     * @return the number of integer data stored on the 2nd of each particle event
-     * data block.
-     */
-  int getDataFromLine5Ptrac(const std::string &line5);
-
-  /**
-     * Checks that the 2nd line of each particle event data block does contain the
-     * cell ID and the material ID. These information are respectively identified as
-     * 17 and 18 by the PTRAC writer. The program exits if it is not the case.
-     *
-     * @param[in] line6 The string containing the data of the 6th header line.
-     * @param[in] nbData The number of data expected on 2nd line of each particle
-     * event data block (given by getDataFromLine5Ptrac function).
+     * @param[in] variableIDs The 6th and 7th header lines.
      */
-  void checkDataFromLine6Ptrac(const std::string &line6, int nbData);
+  void parseEventLayouts(const std::string &line5, const std::string &variableIDs);
 
   /**
      * Reads the point ID number and the event ID number.
      *
      * @return A pair containing the point ID and event ID.
      */
-  std::pair<int, int> readPointEvent();
+  std::pair<int64_t, long> readPointEvent();
 
   /**
-     * Reads the cell ID number and the material ID number.
+     * Reads the integer data line of an event.
      *
-     * @return a pair containing the volume ID and material ID.
+     * @param[in] eventType The type of the event.
+     * @return the type of the next event, the cell ID and the material ID.
      */
-  std::pair<int, int> readCellMaterial();
+  std::tuple<long, long, long> readEventData(long eventType);
 
   /**
      * Reads the point coordinates (x,y,z).
@@ -159,6 +195,9 @@ public:
      */
   bool readNextPtracData(long maxReadPoint);
 
+  std::vector<long> getPosition();
+  void setPosition(std::vector<long> const &position);
+
 protected:
   /**
    * Reads the header
@@ -175,6 +214,136 @@ protected:
   void parsePTRACRecord();
 };
 
+/** \class MCNPPTRACMulti
+ *  \brief Reads several PTRAC files as a single one.
+ *
+ *  Each file is read by its own reader, in its own thread, in chunks of
+ *  records queued for the comparison loop. The chunks are consumed in turn
+ *  from each file, so that the sequence of records does not depend on the
+ *  timing of the threads. The point ID of the records of file k (out of n)
+ *  becomes pointID * n + k, which is unique across the files; a
+ *  std::runtime_error is raised if it exceeds maxExactPointID, the largest
+ *  ID kept exactly in the failed points.
+ *
+ *  The position of the reader, for checkpoints, is made of the position of
+ *  each file after the chunks consumed so far and, for the chunk being
+ *  consumed, of its start and the number of records already taken.
+ */
+class MCNPPTRACMulti : public MCNPPTRAC
+{
+public:
+  /// number of records per chunk
+  static constexpr size_t chunkSize = 1024;
+  /// maximum number of chunks queued per file
+  static constexpr size_t maxQueuedChunks = 8;
+
+protected:
+  struct Chunk {
+    std::vector<PTRACRecord> records;
+    /// the positions of the reader before and after the records
+    std::vector<long> start, end;
+  };
+
+  struct Channel {
+    std::unique_ptr<MCNPPTRAC> reader;
+    std::deque<Chunk> chunks;
+    bool finished;
+    /// the position of the reader after the chunks consumed so far
+    std::vector<long> next;
+  };
+
+  std::vector<Channel> channels;
+  std::vector<std::thread> threads;
+  std::mutex mutex;
+  std::condition_variable produced;
+  std::condition_variable consumed;
+  bool stopping;
+  std::exception_ptr error;
+  /// channels which may still produce records, in turn order
+  std::vector<size_t> active;
+  size_t turn;
+  Chunk current;
+  /// the channel of the current chunk
+  size_t currentChannel;
+  size_t currentPos;
+
+public:
+  /**
+     * Starts reading the files.
+     *
+     * @param[in] readers One reader per PTRAC file.
+     */
+  MCNPPTRACMulti(std::vector<std::unique_ptr<MCNPPTRAC>> readers);
+
+  /**
+     * Stops the reader threads.
+     */
+  ~MCNPPTRACMulti();
+
+  /**
+     * If the maximum number of read points, counted over all the files, has
+     * not been reached: gets the next record.
+     *
+     * @returns true if successful, false otherwise.
+     */
+  bool readNextPtracData(long maxReadPoint);
+
+  std::vector<long> getPosition();
+
+  /**
+     * Restores a position returned by getPosition(). The reader threads are
+     * stopped, each file is repositioned, and the threads are started again.
+     */
+  void setPosition(std::vector<long> const &position);
+
+  size_t getNbFiles() const;
+
+protected:
+  void produce(size_t index);
+  void startThreads();
+  void stopThreads();
+};
+
+class MCNPGeometry;
+
+/** \class MCNPSampledPoints
+ *  \brief Quasi-random points located with the built-in MCNP cell evaluator.
+ *
+ *  The points follow a Halton sequence (bases 2, 3 and 5) in a box; they
+ *  replace the PTRAC records when no MCNP run is available. Points which are
+ *  not in any MCNP cell are skipped.
+ */
+class MCNPSampledPoints : public MCNPPTRAC
+{
+protected:
+  MCNPGeometry const &geometry;
+  std::array<double, 6> box;
+  unsigned long index;
+  unsigned long nbUndefined;
+
+public:
+  /**
+     * @param[in] geometry The MCNP geometry, with its cells parsed.
+     * @param[in] box The sampled box: xmin, xmax, ymin, ymax, zmin, zmax.
+     */
+  MCNPSampledPoints(MCNPGeometry const &geometry, std::array<double, 6> const &box);
+
+  /**
+     * If the maximum number of read points has not been reached: samples the
+     * next point and locates it in the MCNP geometry.
+     *
+     * @returns true if successful, false otherwise.
+     */
+  bool readNextPtracData(long maxReadPoint);
+
+  /// the index in the sequence, the number of points read and of undefined points
+  std::vector<long> getPosition();
+  void setPosition(std::vector<long> const &position);
+
+  /// the number of sampled points which were not in any MCNP cell
+  unsigned long getNbUndefined() const;
+};
+
 /** \class MCNPGeometry.
  *  \brief Class for dealing with MCNP geometry.
  *
@@ -191,6 +360,7 @@ class MCNPGeometry
 
   std::ifstream inputFile;
   std::string currentLine;
+  std::unique_ptr<MCNPCellEvaluator> cells;
 
 public:
   /**
@@ -218,6 +388,24 @@ public:
    */
   void parseINP();
 
+  /**
+   * Parses the surface and cell cards of the INP file and builds the cell
+   * evaluator used by whichCell(). Throws std::runtime_error on invalid input;
+   * the unsupported cells are reported and skipped.
+   */
+  void parseCells();
+
+  /**
+   * Locates a point in the MCNP cells. parseCells() must have been called.
+   *
+   * @param[in] point The coordinates of the point.
+   * @return the number of the deepest cell containing the point, or -1.
+   */
+  long whichCell(std::vector<double> const &point) const;
+
+  /// the cell evaluator, or nullptr if parseCells() was not called
+  MCNPCellEvaluator const *getCells() const;
+
   /**
    * Attempts to add a new association cell ID -> material density.
    *
@@ -233,6 +421,17 @@ public:
    */
   std::string getCellDensity(unsigned long cellID) const;
 
+  /// the numbers of the cells read by parseINP(), sorted
+  std::vector<unsigned long> getCellIDs() const;
+
+  /**
+   * Gives the material of a cell.
+   *
+   * @param[in] cellID the cell ID
+   * @return the material number (0 for void cells).
+   */
+  unsigned long getCellMaterial(unsigned long cellID) const;
+
   /**
    * Determines whether we have read the whole block data in the input file.
    * Caution : blank line separator is identified as string of length 1...
@@ -0,0 +1,144 @@
+/**
+ * @file NativeT4Geometry.hh
+ *
+ *
+ * @brief NativeT4Geometry class header
+ *
+ * @version 1.0
+ */
+
+#ifndef NATIVET4GEOMETRY_H_
+#define NATIVET4GEOMETRY_H_
+
+#include "BoundingBox.hh"
+#include "CSGBytecode.hh"
+#include "SurfaceTable.hh"
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+/** \class NativeT4Geometry
+ *  \brief Self-contained reader and evaluator for the T4 GEOMETRY subset
+ *  produced by t4_geom_convert.
+ *
+ *  The supported input consists of TRANSFORM ... MATRIX and SURF cards, VOLU
+ *  cards of the form EQUA [PLUS n ...] [MINUS n ...] [UNION n ... | INTE n ...]
+ *  [FICTIVE] ENDV, and the GEOMCOMP block. Volume ranks follow the order of
+ *  the VOLU cards, as in the T4 library.
+ *
+ *  Once read, the volumes are compiled to a CSGBytecode, which answers the
+ *  point-in-volume queries.
+ */
+class NativeT4Geometry
+{
+public:
+  typedef CSGOperator Operator;
+
+private:
+  struct Volume {
+    long number;
+    bool fictive;
+    Operator op;
+    /// ranges in the flat half-space and operand arrays
+    long halfBegin, halfEnd;
+    long operandBegin, operandEnd;
+  };
+
+  std::string filename;
+  SurfaceTable surfaces;
+  std::vector<Volume> volumes;
+  std::map<long, long> rankOfNumber;
+
+  // half-spaces: surface index and sign (+1 for PLUS, -1 for MINUS)
+  std::vector<long> halfSurfaces;
+  std::vector<int> halfSigns;
+
+  std::vector<long> operands;
+
+  std::vector<std::string> compoOfRank;
+  std::vector<std::string> compoNames;
+
+  std::unique_ptr<CSGBytecode> bytecode;
+
+public:
+  /**
+   * Class constructor. Reads the geometry from a T4 input file.
+   *
+   * @param[in] filename The T4 input file.
+   */
+  NativeT4Geometry(std::string const &filename);
+
+  /**
+   * Reads only the SURF and TRANSFORM cards of the GEOMETRY block of a T4
+   * input file, skipping the volumes and the other cards.
+   *
+   * @param[in] filename The T4 input file.
+   * @return the surfaces, in the order of the file.
+   */
+  static SurfaceTable readSurfaces(std::string const &filename);
+
+  /**
+   * Returns the rank of the non-fictive volume containing a point.
+   *
+   * @param[in] point The coordinates of the point.
+   * @return the rank, or -1 if the point is outside the geometry.
+   */
+  long whichVolume(std::vector<double> const &point) const;
+
+  /**
+   * Tests whether a point is inside a volume, fictive or not.
+   */
+  bool contains(long rank, double x, double y, double z) const;
+
+  /**
+   * Returns the distance to the first surface of the volume crossed by a ray.
+   *
+   * @param[in] rank The volume rank.
+   * @param[in] point The ray origin.
+   * @param[in] dir The ray direction (unit vector).
+   * @return the distance and the number of the crossed surface, or
+   * (1e+10, -1) if no surface is crossed.
+   */
+  std::pair<double, long> nextSurfaceInDirection(long rank, std::vector<double> const &point,
+                                                 std::vector<double> const &dir) const;
+
+  /**
+   * Returns the indices (in getSurfaces()) of all the surfaces involved in
+   * the definition of a volume, including its operands.
+   */
+  std::vector<long> getVolumeSurfaces(long rank) const;
+
+  /**
+   * Returns the name of the composition filling a volume, or "No compo".
+   */
+  std::string const &getCompoName(long rank) const;
+
+  /// the composition names, in the order of the GEOMCOMP block
+  std::vector<std::string> const &getCompoNames() const;
+
+  /// the number of volumes, fictive ones included
+  long getNbVolumes() const;
+  long getVolumeNumber(long rank) const;
+  /// the rank of a volume given its number, or -1
+  long getRank(long number) const;
+  bool isFictive(long rank) const;
+  Operator getOperator(long rank) const;
+  std::vector<long> getOperands(long rank) const;
+  /// the signed surface numbers of the EQUA part (positive for PLUS)
+  std::vector<long> getHalfSpaces(long rank) const;
+  /// a box enclosing the volume (possibly infinite)
+  BoundingBox const &getBoundingBox(long rank) const;
+  SurfaceTable const &getSurfaces() const;
+  CSGBytecode const &getBytecode() const;
+  std::string const &getFilename() const;
+
+private:
+  void read();
+  void readGeometryBlock(std::vector<std::string> const &tokens, size_t &pos);
+  void readGeomCompBlock(std::vector<std::string> const &tokens, size_t &pos);
+  void compile();
+};
+
+#endif /* NATIVET4GEOMETRY_H_ */
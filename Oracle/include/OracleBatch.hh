@@ -0,0 +1,91 @@
+/**
+ * @file OracleBatch.hh
+ *
+ *
+ * @brief OracleBatch class header
+ *
+ * @version 1.0
+ */
+
+#ifndef ORACLEBATCH_H_
+#define ORACLEBATCH_H_
+
+#include "EventLog.hh"
+#include "options_compare.hh"
+#include <string>
+#include <vector>
+
+/** \class OracleBatch
+ *  \brief Several oracle runs, read from a manifest and run in one process.
+ *
+ *  Each line of the manifest holds the arguments of one oracle run:
+ *
+ *    [options] jdd.t4 jdd.inp ptrac [ptrac2 ...]
+ *
+ *  The words are separated by blanks; double quotes keep the blanks of a
+ *  word. Empty lines and lines starting with '#' are ignored. The options of
+ *  all the cases are read before any case is run; a line whose options are
+ *  invalid is reported as an "error" of its case, and the other cases run.
+ *  The files named after the T4 file go to a directory of their own for each
+ *  case, so that concurrent cases on the same T4 file do not overwrite them.
+ *
+ *  The cases are run by a pool of threads. The T4 libraries hold a single
+ *  geometry in global variables: the cases using them (--backend t4) are run
+ *  one at a time, while the native cases run concurrently.
+ */
+class OracleBatch
+{
+public:
+  struct Case {
+    /// the line of the case in the manifest, which identifies it in the results
+    long line;
+    OptionsCompare options;
+    /// the error in the line of the case, or empty if its options are valid
+    std::string error;
+  };
+
+  /**
+   * Reads the manifest and the options of its cases.
+   *
+   * @param[in] manifestPath The manifest file.
+   * @param[in] outputDir The directory holding the output directory of each
+   * case, outputDir/case<line>, unless the case gives --output-dir; if empty,
+   * the cases write their files to the current directory.
+   * @throw std::runtime_error if the manifest cannot be read.
+   */
+  explicit OracleBatch(std::string const &manifestPath, std::string const &outputDir = "");
+
+  /**
+   * Splits a line of the manifest into words.
+   *
+   * @throw std::runtime_error if a quote is not closed.
+   */
+  static std::vector<std::string> splitArguments(std::string const &line);
+
+  std::vector<Case> const &getCases() const;
+
+  /**
+   * Runs the cases and writes one record per case to the results: the
+   * "summary" event of each T4 file of the case (see
+   * Statistics::getSummaryEvent()) with its "case" line and "status" ("ok" or
+   * "interrupted"), an "error" event if the case could not be run or its line
+   * is invalid (then without the file names), or a
+   * "skipped" event if the batch was interrupted before it started.
+   *
+   * @param[in] nbThreads The number of cases run concurrently.
+   * @param[in] results The stream of the results.
+   * @param[in] report Whether the reports of the cases are logged.
+   * @return The number of cases which could not be run.
+   */
+  long run(int nbThreads, EventLog &results, bool report);
+
+private:
+  std::string manifestPath;
+  std::string outputDir;
+  std::vector<Case> cases;
+
+  /// runs one case and writes its records; returns false if it could not be run
+  bool runCase(Case const &batchCase, EventLog &results, bool report);
+};
+
+#endif /* ORACLEBATCH_H_ */
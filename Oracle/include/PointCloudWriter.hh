@@ -0,0 +1,94 @@
+/**
+ * @file PointCloudWriter.hh
+ *
+ *
+ * @brief PointCloudWriter class header
+ *
+ * @version 1.0
+ */
+
+#ifndef POINTCLOUDWRITER_H_
+#define POINTCLOUDWRITER_H_
+
+#include "ResultStore.hh"
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+/** \class PointCloudWriter
+ *  \brief Writes compared points to a VTK PolyData file (.vtp), for ParaView.
+ *
+ *  The file holds one vertex per point, with the point data arrays pointID
+ *  (Int64), cellID, materialID and rank (Int32), distance (Float32) and verdict
+ *  (UInt8: 0 success, 1 failure, 2 ignored, 3 outside, as
+ *  ResultStore::Verdict), in raw appended binary data. The arrays of the
+ *  appended data follow each other, and their sizes, which go in the XML
+ *  header, are only known at the end: until close(), each array is written
+ *  to a temporary file next to the output file, through the buffer of its
+ *  stream, so that the memory used does not depend on the number of points.
+ */
+class PointCloudWriter
+{
+  std::string path;
+  /// the temporary files of the columns, in the order of the appended data
+  std::vector<std::string> columnPaths;
+  std::vector<std::unique_ptr<std::ofstream>> columns;
+  long nbPoints;
+
+public:
+  /**
+   * Class constructor. Throws a std::runtime_error if the temporary files
+   * cannot be created.
+   *
+   * @param[in] path The path of the .vtp file.
+   * @param[in] resume Whether to keep the temporary files, to be cut by restoreState().
+   */
+  explicit PointCloudWriter(std::string const &path, bool resume = false);
+  ~PointCloudWriter();
+
+  PointCloudWriter(PointCloudWriter const &) = delete;
+  PointCloudWriter &operator=(PointCloudWriter const &) = delete;
+
+  /**
+   * Adds a point.
+   *
+   * @param[in] position The position of the point.
+   * @param[in] pointID The point number as listed by MCNP in the PTRAC file.
+   * @param[in] cellID The MCNP cell of the point.
+   * @param[in] materialID The MCNP material of the point.
+   * @param[in] rank The T4 volume rank, or -1 outside the geometry.
+   * @param[in] dist The distance from the nearest surface, or -1 if it was not computed.
+   * @param[in] verdict The outcome of the comparison at the point.
+   */
+  void add(std::array<double, 3> const &position, int64_t pointID, long cellID, long materialID, long rank,
+           double dist, ResultStore::Verdict verdict);
+
+  /**
+   * Writes the .vtp file and removes the temporary files. Throws a
+   * std::runtime_error if a file could not be written. Does nothing the
+   * second time.
+   *
+   * @param[in] keepColumns Whether to keep the temporary files, so that a
+   * run interrupted after a checkpoint can be resumed.
+   */
+  void close(bool keepColumns = false);
+
+  /// flushes the temporary files and writes the number of points, for a checkpoint
+  void saveState(std::ostream &stream);
+
+  /**
+   * Restores a state written by saveState(): the temporary files, opened with
+   * resume, are cut back to their size at the checkpoint. Throws a
+   * std::runtime_error if the state is malformed or if a file is shorter.
+   */
+  void restoreState(std::istream &stream);
+
+  std::string const &getPath() const;
+  long getNbPoints() const;
+};
+
+#endif /* POINTCLOUDWRITER_H_ */
@@ -0,0 +1,143 @@
+/**
+ * @file ResultStore.hh
+ *
+ *
+ * @brief ResultStore and GeometryDiff classes header
+ *
+ * @version 1.0
+ */
+
+#ifndef RESULTSTORE_H_
+#define RESULTSTORE_H_
+
+#include "DistanceMethod.hh"
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/** \class ResultStore
+ *  \brief Per-point results of a comparison, kept for a later run.
+ *
+ *  For each compared point, the store keeps its position in the stream of
+ *  PTRAC records, its history ID, the T4 rank and composition found there,
+ *  the verdict and, when it was computed, the distance to the boundary of the
+ *  volume. The signatures of the T4 volumes (see CSGBytecode::getSignatures())
+ *  are stored alongside, so that a later run on a modified T4 file can tell
+ *  which points have to be located again.
+ */
+class ResultStore
+{
+public:
+  enum class Verdict { SUCCESS, FAILURE, IGNORED, OUTSIDE };
+
+  struct Entry {
+    /// the position of the record in the PTRAC stream, from 1
+    long index;
+    int64_t pointID;
+    /// the T4 rank, or -1 outside the geometry
+    long rank;
+    /// the index of the composition in getCompoNames(), or -1
+    long compo;
+    Verdict verdict;
+    /// the distance to the boundary of the volume, or -1 if it was not computed
+    double distance;
+  };
+
+private:
+  std::vector<uint64_t> signatures;
+  std::vector<std::string> compoNames;
+  DistanceMethod distanceMethod;
+  std::vector<Entry> entries;
+  /// the next entry examined by find()
+  size_t cursor;
+
+public:
+  /**
+   * Class constructor.
+   *
+   * @param[in] signatures The signatures of the T4 volumes, by rank.
+   * @param[in] compoNames The names of the T4 compositions.
+   * @param[in] distanceMethod The method used to compute the distances.
+   */
+  ResultStore(std::vector<uint64_t> const &signatures, std::vector<std::string> const &compoNames,
+              DistanceMethod distanceMethod);
+
+  /**
+   * Reads a store written by save(). Throws a std::runtime_error if the file
+   * cannot be read or is malformed.
+   */
+  ResultStore(std::string const &path);
+
+  /**
+   * Reads a store written by save() from a stream.
+   *
+   * @param[in] stream The stream.
+   * @param[in] name The name of the stream, for the error messages.
+   */
+  ResultStore(std::istream &stream, std::string const &name);
+
+  /**
+   * Appends the result of a point. The points must be added in increasing
+   * index order.
+   */
+  void add(Entry const &entry);
+
+  /**
+   * Returns the entry of the record with the given index, or nullptr if the
+   * point was not compared. The indices must be looked up in increasing
+   * order.
+   */
+  Entry const *find(long index);
+
+  /**
+   * Writes the store to a file. Throws a std::runtime_error on failure.
+   */
+  void save(std::string const &path) const;
+
+  /// writes the store to a stream, in the format of save()
+  void save(std::ostream &stream) const;
+
+  std::vector<uint64_t> const &getSignatures() const;
+  std::vector<std::string> const &getCompoNames() const;
+  DistanceMethod getDistanceMethod() const;
+  long getNbEntries() const;
+
+private:
+  void read(std::istream &stream, std::string const &name);
+};
+
+/** \class GeometryDiff
+ *  \brief The volumes of a T4 geometry which differ from an earlier version.
+ *
+ *  Volumes are matched by rank. A volume is unchanged if its signature is
+ *  the same in both versions; since the signature covers the operands, an
+ *  unchanged volume contains exactly the same points. The rank of a point
+ *  is the first non-fictive volume containing it, so a point located in an
+ *  unchanged volume by the earlier version keeps its rank unless one of the
+ *  changed volumes of lower rank now contains it.
+ */
+class GeometryDiff
+{
+  std::vector<bool> unchanged;
+  std::vector<long> changedRanks;
+
+public:
+  /**
+   * Class constructor.
+   *
+   * @param[in] previous The signatures of the earlier version, by rank.
+   * @param[in] current The signatures of the current version, by rank.
+   * @param[in] fictive Whether each volume of the current version is fictive.
+   */
+  GeometryDiff(std::vector<uint64_t> const &previous, std::vector<uint64_t> const &current,
+               std::vector<bool> const &fictive);
+
+  /// whether a rank of the earlier version is unchanged in the current one
+  bool isUnchanged(long rank) const;
+
+  /// the non-fictive ranks of the current version which changed, sorted
+  std::vector<long> const &getChangedRanks() const;
+};
+
+#endif /* RESULTSTORE_H_ */
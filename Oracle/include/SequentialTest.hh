@@ -0,0 +1,98 @@
+/**
+ * @file SequentialTest.hh
+ *
+ *
+ * @brief SequentialTest class header
+ *
+ * @version 1.0
+ */
+
+#ifndef SEQUENTIALTEST_H_
+#define SEQUENTIALTEST_H_
+
+#include <iostream>
+
+/**
+ * Returns the one-sided Clopper-Pearson lower bound on a binomial
+ * probability, at confidence 1 - alpha.
+ *
+ * @param[in] nbFailures The number of failures k.
+ * @param[in] nbTrials The number of trials n >= k.
+ * @param[in] alpha The error probability.
+ */
+double clopperPearsonLower(long nbFailures, long nbTrials, double alpha);
+
+/**
+ * Returns the one-sided Clopper-Pearson upper bound on a binomial
+ * probability, at confidence 1 - alpha.
+ */
+double clopperPearsonUpper(long nbFailures, long nbTrials, double alpha);
+
+/** \class SequentialTest
+ *  \brief Sequential test of the failure probability of a comparison.
+ *
+ *  The Clopper-Pearson bounds on the failure probability are computed at
+ *  looks spaced geometrically (by a factor 1.2) in the number of tested
+ *  points. The geometry is accepted as soon as the upper bound falls below
+ *  the maximum failure probability, and rejected as soon as the lower bound
+ *  exceeds it. The error probability spent at look j is
+ *  6 alpha / (pi^2 (j+1)^2), so that the total probability of a wrong
+ *  verdict, over all the looks, is at most alpha = 1 - confidence.
+ */
+class SequentialTest
+{
+public:
+  enum class Verdict { CONTINUE, ACCEPTED, REJECTED };
+
+private:
+  double maxFailureProbability;
+  double confidence;
+  double nextLook;
+  int nbLooks;
+  long nbTrials;
+  long nbFailures;
+  double lowerBound;
+  double upperBound;
+  Verdict verdict;
+
+public:
+  /**
+   * Class constructor.
+   *
+   * @param[in] maxFailureProbability The failure probability separating good
+   * and broken geometries.
+   * @param[in] confidence The confidence of the verdict, in (0, 1).
+   * @param[in] firstLook The number of tested points at the first look.
+   */
+  SequentialTest(double maxFailureProbability, double confidence, long firstLook = 1000);
+
+  /**
+   * Updates the test with the current counts. The bounds are only computed
+   * when a look is due, so that the call is cheap.
+   *
+   * @param[in] nbTrials The number of tested points so far.
+   * @param[in] nbFailures The number of failed points so far.
+   * @return the verdict; it does not change after the test has stopped.
+   */
+  Verdict update(long nbTrials, long nbFailures);
+
+  Verdict getVerdict() const;
+  /// the number of tested points at the last look
+  long getNbTrials() const;
+  /// the number of failed points at the last look
+  long getNbFailures() const;
+  /// the lower bound on the failure probability at the last look
+  double getLowerBound() const;
+  /// the upper bound on the failure probability at the last look
+  double getUpperBound() const;
+  double getMaxFailureProbability() const;
+  double getConfidence() const;
+  int getNbLooks() const;
+
+  /// writes the state of the test, for a checkpoint
+  void saveState(std::ostream &stream) const;
+  /// restores a state written by saveState(); throws a std::runtime_error if it is malformed
+  void restoreState(std::istream &stream);
+};
+
+#endif /* SEQUENTIALTEST_H_ */
@@ -11,24 +11,20 @@
 #ifndef STASTISTICS_H_
 #define STASTISTICS_H_
 
+#include "ConfusionMatrix.hh"
+#include "DistanceSummary.hh"
+#include "EventLog.hh"
+#include "FailureSink.hh"
+#include "SequentialTest.hh"
 #include <array>
+#include <cstdint>
+#include <functional>
 #include <iostream>
+#include <memory>
 #include <set>
+#include <string>
 #include <vector>
 
-/**
-* A structure to represent the points where the weak equivalence test failed.
-*
-*/
-struct failedPoint {
-  std::array<double, 3> position;
-  double mcnpParticleID;
-  double mcnpCellID;
-  double mcnpMaterialID;
-  double dist;
-  double rank;
-};
-
 /** \class Statistics.
 *  \brief Class for dealing with comparison statistics.
 *
@@ -41,9 +37,18 @@ class Statistics
   int nbFailure;
   int nbIgnored;
   int nbOutside;
+  long nbSkipped;
   long nbT4Volumes;
   std::set<long> coveredRanks;
   std::vector<failedPoint> failures;
+  /// where the failed points go instead of failures, with --stream-failures
+  std::unique_ptr<FailureSink> failureSink;
+  /// the distances to the surfaces of the failed and ignored points
+  DistanceSummary failureDistances;
+  DistanceSummary ignoredDistances;
+  /// the number of compared points per MCNP cell and T4 volume
+  ConfusionMatrix confusionMatrix;
+  std::unique_ptr<SequentialTest> sequentialTest;
 
 public:
   /**
@@ -74,6 +79,14 @@ public:
   */
   void incrementIgnore();
 
+  /**
+  * Increments the number of ignored points and records the distance of the
+  * point to the nearest surface.
+  *
+  * @param[in] dist The distance from the nearest surface.
+  */
+  void incrementIgnore(double dist);
+
   /**
   * Increments the number of points found outside the geometry (rank=-1).
   *
@@ -81,6 +94,20 @@ public:
   */
   void incrementOutside();
 
+  /**
+  * Increments the number of points skipped without comparison, because they
+  * lie deep inside a volume (--shell) or in a cell which has reached its
+  * quota (--cell-quota).
+  *
+  *
+  */
+  void incrementSkipped();
+
+  /**
+  * Gets the number of skipped points.
+  */
+  long getNbSkipped();
+
   /**
   * Gets the total number of investigated points.
   *
@@ -89,6 +116,33 @@ public:
   */
   int getTotalPts();
 
+  /**
+  * Gets the number of points tested inside the T4 geometry.
+  *
+  * @returns the sum of successful, failed and ignored points.
+  */
+  int getNbTested();
+
+  /**
+  * Gets the number of failed points.
+  */
+  int getNbFailure();
+
+  int getNbSuccess();
+  int getNbIgnored();
+  int getNbOutside();
+  /// the number of distinct T4 volumes hit
+  long getNbCovered();
+  long getNbT4Volumes();
+
+  /**
+  * Stores the outcome of the sequential test which stopped the comparison,
+  * for report().
+  *
+  * @param[in] test The sequential test.
+  */
+  void recordSequentialTest(SequentialTest const &test);
+
   /**
   * Insert the rank being explored to set of covered ranked (if it is part of the set,
   * set.insert() does nothing).
@@ -104,6 +158,14 @@ public:
   */
   void setNbT4Volumes(long nbVolumes);
 
+  /**
+  * Counts a compared point in the confusion matrix.
+  *
+  * @param[in] cellID The MCNP cell of the point.
+  * @param[in] volume The T4 volume number of the point, or -1 outside the geometry.
+  */
+  void recordLocation(long cellID, long volume);
+
   /**
   * Add a new failed test info to the list of failed weak equivalence tests.
   *
@@ -114,7 +176,86 @@ public:
   * @param[in] materialID The material number where the point is located according to MCNP.
   * @param[in] dist The distance from the nearest surface
   */
-  void recordFailure(std::vector<double> position, long rank, int pointID, int cellID, int materialID, double dist);
+  void recordFailure(std::vector<double> position, long rank, int64_t pointID, int cellID, int materialID, double dist);
+
+  /**
+  * Streams the failed points recorded from now on to a binary file instead
+  * of keeping them in memory (see FailureSink). getFailures(), save() and
+  * writeOutForVisu() then leave them out.
+  *
+  * @param[in] path The path of the binary file.
+  * @param[in] resume Whether to keep the file, for a run resumed from a checkpoint.
+  */
+  void streamFailures(std::string const &path, bool resume = false);
+
+  /// the stream of failed points, or nullptr
+  FailureSink *getFailureSink();
+
+  /**
+  * Writes the last failed points to the binary file, if any. Throws a
+  * std::runtime_error if the file could not be written.
+  */
+  void closeFailureSink();
+
+  /**
+  * Gets the ranks of the T4 volumes which were never hit.
+  *
+  * @return the ranks, sorted.
+  */
+  std::vector<long> getUncoveredRanks() const;
+
+  /**
+  * Writes the counts, the covered ranks and the failed points to a file, so
+  * that they can be merged with the results of a later run.
+  *
+  * @param[in] path The path of the statistics file.
+  */
+  void save(std::string const &path) const;
+
+  /**
+  * Writes the statistics to a stream, in the format of save().
+  */
+  void save(std::ostream &stream) const;
+
+  /**
+  * Adds the statistics saved in a file by save() to the current ones.
+  * Throws a std::runtime_error if the file cannot be read, or if it was
+  * written for a geometry with a different number of volumes.
+  *
+  * @param[in] path The path of the statistics file.
+  */
+  void merge(std::string const &path);
+
+  /**
+  * Adds the statistics written to a stream by save().
+  *
+  * @param[in] stream The stream.
+  * @param[in] name The name of the stream, for the error messages.
+  */
+  void merge(std::istream &stream, std::string const &name);
+
+  /**
+  * Replaces the statistics by the ones written to a stream by save(), for a
+  * checkpoint. The stream of failed points, if any, is kept.
+  *
+  * @param[in] stream The stream.
+  * @param[in] name The name of the stream, for the error messages.
+  */
+  void restore(std::istream &stream, std::string const &name);
+
+  /// the distances of the failed points to the nearest surface
+  DistanceSummary const &getFailureDistances() const;
+  /// the distances of the ignored points to the nearest surface
+  DistanceSummary const &getIgnoredDistances() const;
+  ConfusionMatrix const &getConfusionMatrix() const;
+
+  /**
+  * Builds the "summary" record of the --events stream, with all the counts
+  * and the distance summaries.
+  *
+  * @param[in] t4Filename The T4 file the statistics belong to.
+  */
+  EventRecord getSummaryEvent(std::string const &t4Filename);
 
   /**
   * Get the list of failed tests.
@@ -123,6 +264,14 @@ public:
   */
   std::vector<failedPoint> getFailures();
 
+  /**
+  * Moves the list of failed tests out of the statistics, which keep their
+  * counters but no longer list the failed points.
+  *
+  * @return failures
+  */
+  std::vector<failedPoint> takeFailures();
+
   /**
   * Reports in the terminal the comparison statistics
   *
@@ -143,18 +292,27 @@ public:
   * Writes out the position of the points which fail the weak equivalence test
   * AND are too close to the next surface.
   *
-  * @param[in] fname The input file name on which will be based the output file name.
+  * @param[in] rawname The path of the output files, without their extension.
+  */
+  void writeOutForVisu(std::string &rawname);
+
+  /**
+  * Writes the failed points files for the T4 visualiser, reading the points
+  * one at a time.
+  *
+  * @param[in] rawname The raw file name of the output files.
+  * @param[in] next Gives the next failed point; returns false after the last one.
   */
-  void writeOutForVisu(std::string &fname);
+  static void writeFailedPoints(std::string &rawname, std::function<bool(failedPoint &)> const &next);
 
   /**
   * Returns the raw file name, i.e. without file extension.
   *
   * @return The raw file name.
   */
-  std::string getRawFileName(std::string &fname);
+  static std::string getRawFileName(std::string &fname);
 
-  void writePointsFile(std::string &rawname);
+  static void writePointsFile(std::string &rawname);
 };
 
 #endif /* STATISTICS_H_ */
@@ -0,0 +1,194 @@
+/**
+ * @file SurfaceTable.hh
+ *
+ *
+ * @brief SurfaceTable class header
+ *
+ * @version 1.0
+ */
+
+#ifndef SURFACETABLE_H_
+#define SURFACETABLE_H_
+
+#include "BoundingBox.hh"
+#include <array>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * The surface types of the TRIPOLI-4 GEOMETRY block produced by
+ * t4_geom_convert.
+ */
+enum class SurfaceType
+{
+  PLANEX,
+  PLANEY,
+  PLANEZ,
+  PLANE,
+  SPHERE,
+  CYLX,
+  CYLY,
+  CYLZ,
+  CYL,
+  CONEX,
+  CONEY,
+  CONEZ,
+  CONE,
+  QUAD,
+  TORUSX,
+  TORUSY,
+  TORUSZ
+};
+
+/**
+ * Converts a T4 surface keyword to a SurfaceType.
+ *
+ * @param[in] keyword The surface keyword, e.g. PLANEZ.
+ * @param[out] type The corresponding surface type.
+ * @returns true if the keyword is known, false otherwise.
+ */
+bool surfaceTypeFromKeyword(std::string const &keyword, SurfaceType &type);
+
+/**
+ * Returns the number of parameters expected after the keyword of the given
+ * surface type.
+ */
+int nbSurfaceParameters(SurfaceType type);
+
+/**
+ * A coordinate transformation: local = rotation^T * (global - translation).
+ * The rotation matrix is stored in row-major order.
+ */
+struct SurfaceTransform {
+  std::array<double, 3> translation;
+  std::array<double, 9> rotation;
+};
+
+/** \class SurfaceTable
+ *  \brief Flat storage for the surfaces of a geometry.
+ *
+ *  All surfaces except tori are stored as general quadrics in global
+ *  coordinates,
+ *
+ *    f(x,y,z) = xx*x^2 + yy*y^2 + zz*z^2 + xy*x*y + yz*y*z + zx*z*x
+ *               + x*x + y*y + z*z + c,
+ *
+ *  with one array per coefficient (structure of arrays). Elliptic tori are
+ *  stored separately, together with the transformation to their local frame.
+ *  The sign convention is the T4 one: f > 0 on the PLUS side of the surface.
+ */
+class SurfaceTable
+{
+public:
+  /// index of a quadric coefficient in the arrays returned by getQuadric()
+  enum Coefficient { XX, YY, ZZ, XY, YZ, ZX, X, Y, Z, C, NB_COEFFICIENTS };
+
+private:
+  std::vector<long> numbers;
+  std::vector<SurfaceType> types;
+  /// index in the quadric arrays if >= 0, -(index in the torus arrays) - 1 otherwise
+  std::vector<long> slots;
+  std::unordered_map<long, long> indexOfNumber;
+
+  std::array<std::vector<double>, NB_COEFFICIENTS> quadrics;
+
+  std::vector<std::array<double, 3>> torusCentres;
+  std::vector<std::array<double, 3>> torusRadii;
+  std::vector<std::array<double, 9>> torusRotations;
+  std::vector<std::array<double, 3>> torusTranslations;
+  std::vector<int> torusAxes;
+
+public:
+  /**
+   * Adds a surface to the table.
+   *
+   * @param[in] number The surface number in the input file.
+   * @param[in] type The surface type.
+   * @param[in] params The surface parameters, as in the input file.
+   * @param[in] transform The transformation applied to the surface, or nullptr.
+   * @return the index of the new surface.
+   */
+  long addSurface(long number, SurfaceType type, std::vector<double> const &params,
+                  SurfaceTransform const *transform);
+
+  /**
+   * Adds a general quadric, given in global coordinates.
+   *
+   * @return the index of the new surface.
+   */
+  long addQuadric(long number, SurfaceType type, std::array<double, NB_COEFFICIENTS> const &coefficients);
+
+  /// the number of surfaces in the table
+  long size() const;
+
+  /// the index of a surface given its number, or -1 if the number is unknown
+  long indexOf(long number) const;
+
+  long getNumber(long index) const;
+  SurfaceType getType(long index) const;
+  bool isTorus(long index) const;
+
+  /// the quadric coefficients of a surface which is not a torus
+  std::array<double, NB_COEFFICIENTS> getQuadric(long index) const;
+
+  /**
+   * Returns the parameters defining a surface: its quadric coefficients, or
+   * the centre, radii and frame of a torus. Two surfaces with the same type
+   * and parameters are identical.
+   */
+  std::vector<double> getParameters(long index) const;
+
+  /**
+   * Evaluates the surface function at a point.
+   */
+  double evaluate(long index, double x, double y, double z) const;
+
+  /**
+   * Evaluates the gradient of the surface function at a point.
+   */
+  std::array<double, 3> gradient(long index, double x, double y, double z) const;
+
+  /**
+   * Evaluates all the quadric functions at a point, in a single vectorisable
+   * loop. values must point to an array of getNbQuadrics() elements.
+   */
+  void evaluateQuadrics(double x, double y, double z, double *values) const;
+  long getNbQuadrics() const;
+
+  /**
+   * Finds the smallest non-negative distance along a ray where the surface
+   * function changes sign.
+   *
+   * @param[in] index The surface index.
+   * @param[in] point The ray origin.
+   * @param[in] dir The ray direction (unit vector).
+   * @param[in] maxDist The largest distance of interest.
+   * @return the distance, or a negative value if the ray does not cross the
+   * surface within maxDist.
+   */
+  double intersectRay(long index, std::array<double, 3> const &point,
+                      std::array<double, 3> const &dir, double maxDist) const;
+
+  /**
+   * Returns the centre and the radius of a sphere enclosing a torus.
+   */
+  std::pair<std::array<double, 3>, double> torusBoundingSphere(long index) const;
+
+  /**
+   * Returns a box enclosing one side of a surface. The box is finite along
+   * the axes bounded by the half-space: the inside of ellipsoids, elliptic
+   * cylinders and tori, and the sides of planes perpendicular to an axis.
+   *
+   * @param[in] index The surface index.
+   * @param[in] sign +1 for the PLUS side, -1 for the MINUS side.
+   */
+  BoundingBox halfSpaceBounds(long index, int sign) const;
+
+private:
+  double evaluateTorus(long slot, double x, double y, double z) const;
+  std::array<double, 3> toTorusFrame(long slot, double x, double y, double z) const;
+};
+
+#endif /* SURFACETABLE_H_ */
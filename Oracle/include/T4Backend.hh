@@ -0,0 +1,16 @@
+#ifndef T4BACKEND_HH
+#define T4BACKEND_HH
+
+enum class T4Backend
+{
+  T4LIB,
+  NATIVE
+};
+
+#ifdef ORACLE_WITH_T4
+constexpr T4Backend defaultT4Backend = T4Backend::T4LIB;
+#else
+constexpr T4Backend defaultT4Backend = T4Backend::NATIVE;
+#endif
+
+#endif // T4BACKEND_HH
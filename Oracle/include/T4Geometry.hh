@@ -10,29 +10,49 @@
 #ifndef T4GEOMETRY_H_
 #define T4GEOMETRY_H_
 
+#ifdef ORACLE_WITH_T4
 #include "anyvolumes.hh"
 #include "compos.hh"
 #include "composfromgeom.hh"
 #include "t4convert.hh"
 #include "volumes.hh"
+#endif
+#include "CSGBytecode.hh"
+#include "DistanceMethod.hh"
+#include "NativeT4Geometry.hh"
+#include "T4Backend.hh"
+#include "VoxelCache.hh"
+#include <array>
 #include <fstream>
 #include <iostream>
+#include <map>
+#include <memory>
 #include <sstream>
+#include <utility>
 #include <vector>
 
 /** \class T4Geometry
  *  \brief Class for dealing with Tripoli-4 geometry
  *
  *  This class reads the T4 input file, retrieves the composition at a given
- *  point and calls the weak equivalence test.
+ *  point and calls the weak equivalence test. The geometry is evaluated
+ *  either by the T4 libraries or by NativeT4Geometry, depending on the
+ *  backend chosen at construction.
  */
 class T4Geometry
 {
   static const std::vector<std::vector<double>> directions;
+#ifdef ORACLE_WITH_T4
   Volumes *volumes;
   Compos *compos;
+#endif
+  std::unique_ptr<NativeT4Geometry> native;
+  std::unique_ptr<CSGBytecode> bytecode;
+  T4Backend backend;
+  DistanceMethod distanceMethod;
   std::string t4Filename;
   std::map<std::string, std::string> equivalenceMap;
+  std::unique_ptr<VoxelCache> voxelCache;
 
 public:
   T4Geometry();
@@ -41,9 +61,9 @@ public:
    *  Class constructor.
    *
    * @param[in] t4Filename The Tripoli-4 geometry file to be compared.
-   * is ignored.
+   * @param[in] backend The geometry evaluator.
    */
-  T4Geometry(const std::string &t4Filename);
+  T4Geometry(const std::string &t4Filename, T4Backend backend = defaultT4Backend);
 
   /**
    *  Class destructor.
@@ -60,8 +80,51 @@ public:
   void readT4input();
 
   std::string getFilename();
+
+  /**
+   * Returns a hash of the content of the T4 input file, as a hexadecimal
+   * string.
+   */
+  std::string getFileHash();
+
+  T4Backend getBackend() const;
+
+#ifdef ORACLE_WITH_T4
   Volumes *const &getVolumes();
   Compos *const &getCompos();
+#endif
+
+  /**
+   * Returns the native geometry evaluator, or nullptr if the T4 libraries are
+   * used.
+   */
+  NativeT4Geometry const *getNative() const;
+
+  /// the number of volumes in the geometry
+  long getNbVolumes();
+
+  /**
+   * Returns the name of the composition filling a volume.
+   * @param[in] rank The volume rank.
+   * @return the composition name, or "No compo".
+   */
+  std::string getCompoName(long rank);
+
+  /// the number of a volume in the T4 input file, from its rank
+  long getVolumeNumber(long rank);
+
+  /// the names of the compositions used in the geometry
+  std::vector<std::string> getCompoNames();
+
+  /**
+   * Returns the distance to the boundary of a volume along a direction.
+   * @param[in] rank The volume rank.
+   * @param[in] point The starting point.
+   * @param[in] dir The direction (unit vector).
+   * @return the distance and the number of the crossed surface.
+   */
+  std::pair<double, long> nextSurfaceInDirection(long rank, const std::vector<double> &point,
+                                                 const std::vector<double> &dir);
 
   /**
    * Check if the input material as already been mapped to T4 composition.
@@ -77,6 +140,12 @@ public:
    */
   void addEquivalence(const std::string &matDens, const std::string &compo);
 
+  /// the associations MCNP materialID-density -> T4 composition made so far
+  std::map<std::string, std::string> const &getEquivalences() const;
+
+  /// forgets the associations made so far, before a new comparison
+  void clearEquivalences();
+
   /**
    * Checks if the weak equivalence tests is passed, i.e. if MCNP and T4 see
    * the same material at the considered point.
@@ -88,12 +157,92 @@ public:
 
   /**
    * Returns an estimate of the distance from the considered point to the
-   * nearest surface.
+   * nearest surface, with the method chosen by setDistanceMethod().
    * @param[in] point the coordinates of the considered point.
    * @param[in] long the volume number where the considered point is.
    * @return an estimate of the distance
    */
   double distanceFromSurface(const std::vector<double> &point, long rank);
+
+  /**
+   * Selects how distanceFromSurface() estimates distances. The analytic
+   * estimate (see CSGBytecode::distanceBound()) needs a bytecode: with the
+   * T4 libraries, compileBytecode() must be called first, otherwise the
+   * ray casts are used.
+   */
+  void setDistanceMethod(DistanceMethod method);
+  DistanceMethod getDistanceMethod() const;
+
+  /**
+   * Returns a quick estimate of the distance from a point to the nearest
+   * surface of a volume, whatever the distance method: the analytic bound
+   * when a bytecode exists, the ray casts otherwise.
+   */
+  double quickDistanceFromSurface(const std::vector<double> &point, long rank);
+
+  /**
+   * Returns the distance from a point to the boundary of its labelled voxel
+   * (see VoxelCache::depth()), or -1 if there is no voxel cache or the
+   * voxel is mixed.
+   */
+  double voxelDepth(const std::vector<double> &point) const;
+
+  /**
+   * Sets up a voxel cache for point location. The cache is read from
+   * cachePath if it matches the T4 file and the grid parameters, otherwise it
+   * is built and written to cachePath. The voxels are labelled with the
+   * bytecode: without it, std::runtime_error is thrown.
+   * @param[in] box The grid bounds: xmin, xmax, ymin, ymax, zmin, zmax.
+   * @param[in] dims The number of voxels along x, y and z.
+   * @param[in] refineLevels The number of adaptive refinement levels.
+   * @param[in] nThreads The number of threads used to build the grid.
+   * @param[in] cachePath The cache file path; the cache is not saved if empty.
+   */
+  void setupVoxelCache(std::array<double, 6> const &box, std::array<long, 3> const &dims,
+                       int refineLevels, int nThreads, std::string const &cachePath);
+
+  /**
+   * Returns the rank of the volume containing the point, using the voxel
+   * cache if available.
+   * @param[in] point the coordinates of the considered point.
+   * @return the volume rank, or -1 if the point is outside the geometry.
+   */
+  long whichVolume(const std::vector<double> &point);
+
+  /**
+   * Returns the rank of the volume containing the point, bypassing the voxel
+   * cache.
+   */
+  long whichVolumeUncached(const std::vector<double> &point);
+
+  /**
+   * Returns the rank of the volume containing the point, as found by the
+   * geometry library itself, bypassing the voxel cache and the bytecode.
+   */
+  long whichVolumeReference(const std::vector<double> &point);
+
+  /**
+   * Compiles the volumes of the T4 geometry library to a CSGBytecode, which
+   * is then used to locate points. The volume definitions are read from the
+   * library data structures and the surface coefficients from the input
+   * file. The native backend always uses a bytecode.
+   */
+  void compileBytecode();
+
+  /**
+   * Returns the bytecode used to locate points, or nullptr if there is none.
+   */
+  CSGBytecode const *getBytecode() const;
+
+private:
+#ifdef ORACLE_WITH_T4
+  /**
+   * Checks that the surfaces read from the SURF cards are those of the
+   * library: the same numbers, and the same sides at fixed probe points.
+   * Throws std::runtime_error otherwise.
+   */
+  void checkLibrarySurfaces(SurfaceTable const &surfaces) const;
+#endif
 };
 
 #endif /* T4GEOMETRY_H_ */
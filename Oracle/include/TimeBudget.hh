@@ -0,0 +1,96 @@
+/**
+ * @file TimeBudget.hh
+ *
+ *
+ * @brief TimeBudget class header
+ *
+ * @version 1.0
+ */
+
+#ifndef TIMEBUDGET_H_
+#define TIMEBUDGET_H_
+
+#include <chrono>
+#include <cstdint>
+
+/** \class TimeBudget
+ *  \brief Spreads a wall-clock budget over all the points of a comparison.
+ *
+ *  Each point read is compared with a probability (the keep fraction), drawn
+ *  from a seeded hash of its index, so that the compared points are spread
+ *  over the whole PTRAC file instead of its first histories. The time spent
+ *  on compared and on skipped points is measured, and the keep fraction is
+ *  regularly adjusted so that the remaining points fit in the remaining time.
+ */
+class TimeBudget
+{
+public:
+  /// number of points between two updates of the keep fraction
+  static constexpr long updateInterval = 256;
+
+private:
+  typedef std::chrono::steady_clock Clock;
+
+  double budget;
+  long nbPoints;
+  uint64_t seed;
+  Clock::time_point start;
+  Clock::time_point last;
+  bool lastSelected;
+  double selectedTime;
+  double skippedTime;
+  long nbSelected;
+  long nbSkipped;
+  long nbCalls;
+  double keepFraction;
+  bool exhausted;
+
+public:
+  /**
+   * Class constructor; the clock starts now.
+   *
+   * @param[in] seconds The wall-clock budget.
+   * @param[in] nbPoints The maximum number of points to be read.
+   * @param[in] seed The seed of the point selection.
+   */
+  TimeBudget(double seconds, long nbPoints, uint64_t seed);
+
+  /**
+   * Decides whether a point should be compared. Must be called once for each
+   * point read, after reading it.
+   *
+   * @param[in] index The index of the point among the points read.
+   * @return true if the point should be compared; always false once the
+   * budget is spent.
+   */
+  bool select(unsigned long index);
+
+  /// whether the budget is spent
+  bool isExhausted() const;
+
+  double getBudget() const;
+  /// the number of points for which select() returned true
+  long getNbSelected() const;
+  double getKeepFraction() const;
+
+  /**
+   * Returns the fraction of the remaining points which can be compared in the
+   * remaining time. If there is not even time to read all of them, every
+   * point read is compared.
+   *
+   * @param[in] remainingTime The remaining time.
+   * @param[in] remainingPoints The number of points left to read.
+   * @param[in] skipCost The time spent on a skipped point (reading it).
+   * @param[in] compareCost The time spent on a compared point.
+   */
+  static double computeKeepFraction(double remainingTime, long remainingPoints, double skipCost,
+                                    double compareCost);
+
+  /**
+   * Tests whether a point belongs to the seeded sample of the given fraction
+   * of the points.
+   */
+  static bool sampled(uint64_t seed, unsigned long index, double fraction);
+};
+
+#endif /* TIMEBUDGET_H_ */
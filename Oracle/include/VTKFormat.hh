@@ -0,0 +1,22 @@
+/**
+ * @file VTKFormat.hh
+ *
+ *
+ * @brief Helpers for the VTK XML files with raw appended data
+ *
+ * @version 1.0
+ */
+
+#ifndef VTKFORMAT_H_
+#define VTKFORMAT_H_
+
+#include <cstdint>
+
+/// the byte_order attribute of the VTK files written on this machine
+inline char const *vtkByteOrder()
+{
+  uint16_t const one = 1;
+  return *reinterpret_cast<unsigned char const *>(&one) == 1 ? "LittleEndian" : "BigEndian";
+}
+
+#endif /* VTKFORMAT_H_ */
@@ -0,0 +1,116 @@
+/**
+ * @file VoxelCache.hh
+ *
+ *
+ * @brief VoxelCache class header
+ *
+ * @version 1.0
+ */
+
+#ifndef VOXELCACHE_H_
+#define VOXELCACHE_H_
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class CSGBytecode;
+class T4Geometry;
+
+/** \class VoxelCache
+ *  \brief Voxel grid caching the T4 volume rank of the model interior.
+ *
+ *  The grid covers a user-defined box. Each voxel is either labelled with the
+ *  rank of the volume that contains it, or marked as mixed. A voxel is only
+ *  labelled when the safe distances of the bytecode prove that it crosses no
+ *  surface (see CSGBytecode::whichVolumeOfBox()). Mixed voxels may
+ *  be refined adaptively (octree-like) up to a given number of levels. Point
+ *  queries in labelled voxels are answered without calling the T4 geometry.
+ */
+class VoxelCache
+{
+public:
+  /// Value returned by lookup() when the voxel does not have a unique rank.
+  static constexpr long mixed = -2;
+
+private:
+  std::array<double, 6> box;
+  std::array<long, 3> dims;
+  std::array<double, 3> step;
+  int refineLevels;
+  /// top-level voxels first, followed by the children of refined voxels
+  std::vector<int32_t> nodes;
+
+public:
+  /**
+   * Class constructor.
+   *
+   * @param[in] box The grid bounds: xmin, xmax, ymin, ymax, zmin, zmax.
+   * @param[in] dims The number of top-level voxels along x, y and z.
+   * @param[in] refineLevels The number of times a mixed voxel may be split in 8.
+   */
+  VoxelCache(std::array<double, 6> const &box, std::array<long, 3> const &dims, int refineLevels);
+
+  /**
+   * Labels all the voxels of the grid. They are all mixed if the geometry
+   * has no bytecode.
+   *
+   * @param[in] t4Geom The geometry to be cached.
+   * @param[in] nThreads The number of threads used to label the voxels.
+   */
+  void build(T4Geometry &t4Geom, int nThreads);
+
+  /**
+   * Looks up the rank of the volume containing a point.
+   *
+   * @param[in] point The coordinates of the point.
+   * @return the volume rank, or VoxelCache::mixed if the point lies in a mixed
+   * voxel or outside the grid.
+   */
+  long lookup(std::vector<double> const &point) const;
+
+  /**
+   * Returns the distance from a point to the boundary of the labelled voxel
+   * containing it, which is a lower bound on its distance to the surfaces of
+   * the geometry.
+   *
+   * @param[in] point The coordinates of the point.
+   * @return the distance, or -1 if the point lies in a mixed voxel or outside
+   * the grid.
+   */
+  double depth(std::vector<double> const &point) const;
+
+  /**
+   * Writes the grid to a binary file.
+   *
+   * @param[in] path The path of the cache file.
+   * @param[in] t4Hash The hash of the T4 file the grid was built from.
+   * @return false if the file could not be written.
+   */
+  bool save(std::string const &path, std::string const &t4Hash) const;
+
+  /**
+   * Reads the grid from a binary file written by save().
+   *
+   * @param[in] path The path of the cache file.
+   * @param[in] t4Hash The hash of the current T4 file.
+   * @param[in] nbVolumes The number of volumes of the current T4 file.
+   * @return true if the file exists, matches the T4 file and the grid
+   * parameters and holds a valid grid (children inside the file, labels
+   * smaller than nbVolumes), false otherwise.
+   */
+  bool load(std::string const &path, std::string const &t4Hash, long nbVolumes);
+
+  long getNbVoxels() const;
+  long getNbLabelled() const;
+  /// the number of top-level voxels and of children of refined voxels
+  long getNbNodes() const;
+
+private:
+  int32_t classifyVoxel(CSGBytecode const &bytecode, std::array<double, 3> const &lo,
+                        std::array<double, 3> const &hi, int level,
+                        std::vector<int32_t> &children) const;
+};
+
+#endif /* VOXELCACHE_H_ */
@@ -0,0 +1,62 @@
+/**
+ * @file compare_geoms.hh
+ *
+ *
+ * @brief The comparison run by the oracle, shared with oracle-batch
+ *
+ * @version 1.0
+ */
+
+#ifndef COMPARE_GEOMS_H_
+#define COMPARE_GEOMS_H_
+
+#include "EventLog.hh"
+#include "Statistics.hh"
+#include "T4Geometry.hh"
+#include "options_compare.hh"
+#include <csignal>
+#include <string>
+#include <vector>
+
+/// the signal which interrupted the comparisons, or 0
+extern volatile std::sig_atomic_t interruptSignal;
+
+/**
+ * Asks the comparison loops to stop; a second signal kills the program.
+ */
+void onInterrupt(int signal);
+
+/**
+ * The T4 files of a run: the main one, then those given with --t4.
+ */
+std::vector<std::string> getT4Filenames(OptionsCompare const &options);
+
+/**
+ * Compares the T4 geometries of the options with the MCNP points.
+ *
+ * @param[in] options The options of the run.
+ * @param[in] events The --events stream, or nullptr.
+ * @param[in] t4Geom The geometry of the main T4 file, already read, or
+ * nullptr to read it (see GeometryComparison).
+ * @return The statistics of each T4 file, in the order of getT4Filenames().
+ * @throw std::runtime_error if an input file cannot be read.
+ */
+std::vector<Statistics> compare_geoms(OptionsCompare const &options, EventLog *events,
+                                      T4Geometry *t4Geom = nullptr);
+
+/**
+ * Runs the whole comparison of the oracle executable: compare_geoms(), then
+ * the statistics, confusion matrix, failed points and events files asked for
+ * by the options.
+ *
+ * @param[in] options The options of the run.
+ * @param[in] report Whether the reports of the statistics are logged.
+ * @param[in] t4Geom The geometry of the main T4 file, already read, or
+ * nullptr to read it.
+ * @return The statistics of each T4 file, in the order of getT4Filenames().
+ * @throw std::runtime_error if an input file cannot be read or an output
+ * file cannot be written.
+ */
+std::vector<Statistics> run_oracle(OptionsCompare const &options, bool report, T4Geometry *t4Geom = nullptr);
+
+#endif /* COMPARE_GEOMS_H_ */
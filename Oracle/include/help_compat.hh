@@ -0,0 +1,31 @@
+/**
+ * @file help_compat.hh
+ *
+ *
+ * @brief Command-line help helpers, taken from the T4 libraries when they are
+ * available.
+ *
+ * @version 1.0
+ */
+
+#ifndef HELP_COMPAT_H_
+#define HELP_COMPAT_H_
+
+#ifdef ORACLE_WITH_T4
+#include "help.hh"
+#else
+#include <string>
+
+/**
+ * Prints an option and its description, aligned as in the T4 help messages.
+ */
+void edit_help_option(std::string const &option, std::string const &description);
+
+/**
+ * Converts a string to an integer, exiting with an error message if the
+ * string is not an integer.
+ */
+long int_of_string(std::string const &value);
+#endif
+
+#endif /* HELP_COMPAT_H_ */
@@ -1,13 +1,25 @@
 #ifndef OPTIONS_COMPARE_H
 #define OPTIONS_COMPARE_H
 
+#include <array>
+#include <stdexcept>
 #include <string>
 #include <vector>
 #include <memory>
+#include "DistanceMethod.hh"
 #include "PTRACFormat.hh"
+#include "T4Backend.hh"
 
 void help();
 
+/** \brief an error in the options of the comparison, thrown by OptionsCompare::get_opts()
+*/
+class OptionsError : public std::runtime_error
+{
+public:
+  using std::runtime_error::runtime_error;
+};
+
 /** \brief class to manage the options of the comparison utility
 */
 class OptionsCompare
@@ -18,10 +30,48 @@ public:
   int verbosity;
   std::unique_ptr<long> npoints;
   double delta;
+  DistanceMethod distanceMethod;
   bool guessMaterialAssocs;
   PTRACFormat ptracFormat;
+  std::unique_ptr<std::array<long, 3>> voxelGrid;
+  std::unique_ptr<std::array<double, 6>> voxelBox;
+  int voxelRefine;
+  int voxelThreads;
+  std::string voxelCachePath;
+  T4Backend backend;
+  bool crossCheck;
+  bool bytecode;
+  std::unique_ptr<std::array<double, 6>> sampleBox;
+  bool checkCells;
+  bool tracks;
+  std::unique_ptr<std::array<double, 2>> sequential;
+  std::unique_ptr<double> shell;
+  long shellInterior;
+  std::unique_ptr<long> cellQuota;
+  std::unique_ptr<double> timeBudget;
+  unsigned long seed;
+  std::string saveStats;
+  bool streamFailures;
+  std::unique_ptr<double> clusterSize;
+  long clusterRepresentatives;
+  std::unique_ptr<std::array<long, 3>> heatMapGrid;
+  std::unique_ptr<std::array<double, 6>> heatMapBox;
+  bool vtpFailures;
+  bool vtpAll;
+  std::vector<std::string> mergeStats;
+  std::string saveConfusion;
+  std::string events;
+  /// the directory of the files named after the T4 file, or empty for the current directory
+  std::string outputDir;
+  std::string saveResults;
+  std::string reuseResults;
+  std::string checkpoint;
+  double checkpointInterval;
+  bool resume;
+  std::vector<std::string> otherT4Files;
 
   OptionsCompare();
+  /// reads the command line; throws an OptionsError if it is invalid
   void get_opts(int, char **);
 
 private:
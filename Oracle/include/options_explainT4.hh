@@ -14,6 +14,7 @@ public:
   std::vector<std::string> filenames;
   bool help;
   int verbosity;
+  bool bytecode;
 
   OptionsExplainT4();
   void get_opts(int, char **);
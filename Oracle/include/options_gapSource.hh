@@ -0,0 +1,33 @@
+#ifndef OPTIONS_GAPSOURCE_H
+#define OPTIONS_GAPSOURCE_H
+
+#include <array>
+#include <memory>
+#include <string>
+#include <vector>
+#include "T4Backend.hh"
+
+void help();
+
+/** \brief class to manage the options of the coverage-gap source generator
+*/
+class OptionsGapSource
+{
+public:
+  std::vector<std::string> filenames;
+  bool help;
+  int verbosity;
+  long nbPointsPerVolume;
+  unsigned long seed;
+  std::unique_ptr<std::array<double, 6>> box;
+  std::string output;
+  T4Backend backend;
+
+  OptionsGapSource();
+  void get_opts(int, char **);
+
+private:
+  void check_argv(int, int);
+};
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef OPTIONS_ORACLEBATCH_H
+#define OPTIONS_ORACLEBATCH_H
+
+#include <string>
+#include <vector>
+
+/// the help of oracle-batch; help() is the help of the oracle options of each case
+void helpBatch();
+
+/** \brief class to manage the options of the batch comparison utility
+*/
+class OptionsOracleBatch
+{
+public:
+  std::vector<std::string> filenames;
+  bool help;
+  int verbosity;
+  int jobs;
+  std::string results;
+  std::string outputDir;
+
+  OptionsOracleBatch();
+  void get_opts(int, char **);
+
+private:
+  void check_argv(int, int);
+};
+
+#endif
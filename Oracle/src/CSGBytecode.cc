@@ -0,0 +1,636 @@
+/**
+ * @file CSGBytecode.cc
+ *
+ *
+ * @brief CSGBytecode class
+ *
+ * @version 1.0
+ */
+
+#include "CSGBytecode.hh"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+/// target average number of grid cells per non-fictive volume
+constexpr long gridCellsPerVolume = 4;
+constexpr long maxGridDim = 256;
+
+/// distance returned by distanceBound() when a volume has no bounding surface
+constexpr double noSurfaceDist = 1.0e+10;
+
+char const *opCodeName(CSGBytecode::OpCode op)
+{
+  switch (op) {
+  case CSGBytecode::OpCode::LOAD_HALFSPACES:
+    return "LOAD_HALFSPACES";
+  case CSGBytecode::OpCode::AND_TORUS:
+    return "AND_TORUS";
+  case CSGBytecode::OpCode::OR_VOLUME:
+    return "OR_VOLUME";
+  case CSGBytecode::OpCode::AND_VOLUME:
+    return "AND_VOLUME";
+  }
+  return "?";
+}
+
+/// 64-bit FNV-1a of the bytes of the values added
+class Fnv1a
+{
+  uint64_t hash = 14695981039346656037ULL;
+
+public:
+  template <typename T>
+  void add(T const &value)
+  {
+    unsigned char const *bytes = reinterpret_cast<unsigned char const *>(&value);
+    for (size_t i = 0; i < sizeof(T); ++i) {
+      hash ^= bytes[i];
+      hash *= 1099511628211ULL;
+    }
+  }
+
+  uint64_t get() const
+  {
+    return hash;
+  }
+};
+} // namespace
+
+/**
+ * Per-thread memoisation of the operand volumes evaluated during a query:
+ * the result for a volume is valid if its stamp equals the generation of
+ * the current query.
+ */
+struct CSGBytecode::Workspace {
+  std::vector<uint32_t> stamps;
+  std::vector<char> results;
+  uint32_t generation = 0;
+
+  void startQuery(long nbVolumes)
+  {
+    if (long(stamps.size()) < nbVolumes) {
+      stamps.resize(nbVolumes, 0);
+      results.resize(nbVolumes, 0);
+    }
+    if (++generation == 0) {
+      std::fill(stamps.begin(), stamps.end(), 0);
+      generation = 1;
+    }
+  }
+};
+
+CSGBytecode::CSGBytecode(SurfaceTable const &surfaces) : surfaces(surfaces),
+                                                         pendingOperator(CSGOperator::NONE),
+                                                         gridBox(emptyBox()),
+                                                         gridDims{{0, 0, 0}}
+{
+}
+
+void CSGBytecode::beginVolume(long number, bool fictive)
+{
+  programs.push_back(Program{number, fictive, CSGOperator::NONE, long(code.size()), long(code.size()), false});
+  pendingHalfSpaces.clear();
+  pendingOperands.clear();
+  pendingOperator = CSGOperator::NONE;
+}
+
+void CSGBytecode::addHalfSpace(long surfaceNumber, int sign)
+{
+  long const index = surfaces.indexOf(surfaceNumber);
+  if (index < 0) {
+    throw std::invalid_argument("unknown surface " + std::to_string(surfaceNumber)
+                                + " in volume " + std::to_string(programs.back().number));
+  }
+  pendingHalfSpaces.emplace_back(index, sign);
+}
+
+void CSGBytecode::addOperand(CSGOperator op, long rank)
+{
+  if (pendingOperator != CSGOperator::NONE && pendingOperator != op) {
+    throw std::invalid_argument("volume " + std::to_string(programs.back().number)
+                                + " mixes UNION and INTE operands");
+  }
+  pendingOperator = op;
+  pendingOperands.push_back(rank);
+}
+
+void CSGBytecode::endVolume()
+{
+  Program &program = programs.back();
+  program.op = pendingOperator;
+
+  // PLUS: f >= 0 <=> -f < denorm_min; MINUS: f < 0
+  long const halfBegin = halfThresholds.size();
+  for (auto const &halfSpace : pendingHalfSpaces) {
+    if (surfaces.isTorus(halfSpace.first)) {
+      continue;
+    }
+    auto const coefficients = surfaces.getQuadric(halfSpace.first);
+    for (int i = 0; i < SurfaceTable::NB_COEFFICIENTS; ++i) {
+      halfCoefficients[i].push_back(halfSpace.second > 0 ? -coefficients[i] : coefficients[i]);
+    }
+    halfThresholds.push_back(halfSpace.second > 0 ? std::numeric_limits<double>::denorm_min() : 0.);
+    halfSurfaces.push_back(halfSpace.first);
+    halfSigns.push_back(halfSpace.second);
+    // a(x^2 + y^2 + z^2) + b.p + c is a sphere of radius^2 |b|^2 / 4a^2 - c / a
+    double radius = -1.;
+    double const a = coefficients[SurfaceTable::XX];
+    if (a != 0. && coefficients[SurfaceTable::YY] == a && coefficients[SurfaceTable::ZZ] == a
+        && coefficients[SurfaceTable::XY] == 0. && coefficients[SurfaceTable::YZ] == 0.
+        && coefficients[SurfaceTable::ZX] == 0.) {
+      double const b2 = coefficients[SurfaceTable::X] * coefficients[SurfaceTable::X]
+                        + coefficients[SurfaceTable::Y] * coefficients[SurfaceTable::Y]
+                        + coefficients[SurfaceTable::Z] * coefficients[SurfaceTable::Z];
+      double const radius2 = b2 / (4. * a * a) - coefficients[SurfaceTable::C] / a;
+      if (radius2 > 0.) {
+        radius = std::sqrt(radius2);
+      }
+    }
+    halfSphereRadii.push_back(radius);
+  }
+  long const halfEnd = halfThresholds.size();
+  code.push_back(Instruction{OpCode::LOAD_HALFSPACES, int32_t(halfBegin), int32_t(halfEnd - halfBegin)});
+
+  for (auto const &halfSpace : pendingHalfSpaces) {
+    if (surfaces.isTorus(halfSpace.first)) {
+      code.push_back(Instruction{OpCode::AND_TORUS, int32_t(halfSpace.first), int32_t(halfSpace.second)});
+    }
+  }
+
+  OpCode const operandCode = pendingOperator == CSGOperator::UNION ? OpCode::OR_VOLUME : OpCode::AND_VOLUME;
+  for (long rank : pendingOperands) {
+    code.push_back(Instruction{operandCode, int32_t(rank), 0});
+  }
+  program.end = code.size();
+}
+
+void CSGBytecode::finalize()
+{
+  for (auto const &instruction : code) {
+    if ((instruction.op == OpCode::OR_VOLUME || instruction.op == OpCode::AND_VOLUME)
+        && (instruction.a < 0 || instruction.a >= getNbVolumes())) {
+      throw std::invalid_argument("operand rank " + std::to_string(instruction.a) + " out of range");
+    }
+  }
+  bounds.assign(programs.size(), BoundingBox{});
+  std::vector<int> state(programs.size(), 0);
+  for (long rank = 0; rank < getNbVolumes(); ++rank) {
+    computeBounds(rank, state);
+  }
+  buildGrid();
+}
+
+bool CSGBytecode::evaluateHalfSpaces(long begin, long end, double x, double y, double z) const
+{
+  double const xx = x * x, yy = y * y, zz = z * z;
+  double const xy = x * y, yz = y * z, zx = z * x;
+  double const *cxx = halfCoefficients[SurfaceTable::XX].data(), *cyy = halfCoefficients[SurfaceTable::YY].data();
+  double const *czz = halfCoefficients[SurfaceTable::ZZ].data(), *cxy = halfCoefficients[SurfaceTable::XY].data();
+  double const *cyz = halfCoefficients[SurfaceTable::YZ].data(), *czx = halfCoefficients[SurfaceTable::ZX].data();
+  double const *cx = halfCoefficients[SurfaceTable::X].data(), *cy = halfCoefficients[SurfaceTable::Y].data();
+  double const *cz = halfCoefficients[SurfaceTable::Z].data(), *cc = halfCoefficients[SurfaceTable::C].data();
+  double const *thresholds = halfThresholds.data();
+  int outside = 0;
+  for (long i = begin; i < end; ++i) {
+    double const value = cxx[i] * xx + cyy[i] * yy + czz[i] * zz
+                         + cxy[i] * xy + cyz[i] * yz + czx[i] * zx
+                         + cx[i] * x + cy[i] * y + cz[i] * z + cc[i];
+    outside |= !(value < thresholds[i]);
+  }
+  return !outside;
+}
+
+double CSGBytecode::halfSpaceDistance(long begin, long end, double x, double y, double z, bool safe) const
+{
+  double const xx = x * x, yy = y * y, zz = z * z;
+  double const xy = x * y, yz = y * z, zx = z * x;
+  double const *cxx = halfCoefficients[SurfaceTable::XX].data(), *cyy = halfCoefficients[SurfaceTable::YY].data();
+  double const *czz = halfCoefficients[SurfaceTable::ZZ].data(), *cxy = halfCoefficients[SurfaceTable::XY].data();
+  double const *cyz = halfCoefficients[SurfaceTable::YZ].data(), *czx = halfCoefficients[SurfaceTable::ZX].data();
+  double const *cx = halfCoefficients[SurfaceTable::X].data(), *cy = halfCoefficients[SurfaceTable::Y].data();
+  double const *cz = halfCoefficients[SurfaceTable::Z].data(), *cc = halfCoefficients[SurfaceTable::C].data();
+  double const *radii = halfSphereRadii.data();
+  double nearest = noSurfaceDist;
+  for (long i = begin; i < end; ++i) {
+    double const value = cxx[i] * xx + cyy[i] * yy + czz[i] * zz
+                         + cxy[i] * xy + cyz[i] * yz + czx[i] * zx
+                         + cx[i] * x + cy[i] * y + cz[i] * z + cc[i];
+    double const gx = 2. * cxx[i] * x + cxy[i] * y + czx[i] * z + cx[i];
+    double const gy = 2. * cyy[i] * y + cxy[i] * x + cyz[i] * z + cy[i];
+    double const gz = 2. * czz[i] * z + cyz[i] * y + czx[i] * x + cz[i];
+    double const gradient = std::sqrt(gx * gx + gy * gy + gz * gz);
+    double gradientBound = std::fabs(value) / gradient;
+    if (safe) {
+      // |f(p + d)| >= |f(p)| - |grad f| |d| - c |d|^2, where the Frobenius
+      // norm c of the quadratic part bounds its largest eigenvalue: the
+      // surface is farther than the positive root of the right-hand side
+      double const curvature = std::sqrt(cxx[i] * cxx[i] + cyy[i] * cyy[i] + czz[i] * czz[i]
+                                         + 0.5 * (cxy[i] * cxy[i] + cyz[i] * cyz[i] + czx[i] * czx[i]));
+      if (value == 0.) {
+        gradientBound = 0.;
+      } else if (curvature > 0.) {
+        gradientBound = 2. * std::fabs(value)
+                        / (gradient + std::sqrt(gradient * gradient + 4. * curvature * std::fabs(value)));
+      }
+    }
+    // for a sphere, value / a = |p - centre|^2 - radius^2
+    double const r = radii[i];
+    double const sphereDistance = std::fabs(std::sqrt(std::max(0., value / cxx[i] + r * r)) - r);
+    double const distance = r > 0. ? sphereDistance : gradientBound;
+    // a NaN bound (null gradient on the surface) is ignored
+    nearest = distance < nearest ? distance : nearest;
+  }
+  return nearest;
+}
+
+double CSGBytecode::distanceBound(long rank, double x, double y, double z) const
+{
+  return nearestSurface(rank, x, y, z, false);
+}
+
+double CSGBytecode::safeDistance(long rank, double x, double y, double z) const
+{
+  return nearestSurface(rank, x, y, z, true);
+}
+
+long CSGBytecode::whichVolumeOfBox(BoundingBox const &box) const
+{
+  double const x = 0.5 * (box[0] + box[1]), y = 0.5 * (box[2] + box[3]), z = 0.5 * (box[4] + box[5]);
+  double const halfDiagonal = 0.5 * std::sqrt((box[1] - box[0]) * (box[1] - box[0]) + (box[3] - box[2]) * (box[3] - box[2])
+                                              + (box[5] - box[4]) * (box[5] - box[4]));
+  // the ball around the centre which contains the box is inside the volume
+  // of the centre...
+  long const rank = whichVolume({x, y, z});
+  if (rank < 0 || !(safeDistance(rank, x, y, z) > halfDiagonal)) {
+    return -1;
+  }
+  // ... and outside the volumes tested before it, which do not contain the centre
+  for (long other = 0; other < rank; ++other) {
+    if (programs[other].fictive || isEmpty(intersectBoxes(bounds[other], box))) {
+      continue;
+    }
+    if (!(safeDistance(other, x, y, z) > halfDiagonal)) {
+      return -1;
+    }
+  }
+  return rank;
+}
+
+double CSGBytecode::nearestSurface(long rank, double x, double y, double z, bool safe) const
+{
+  Program const &program = programs[rank];
+  double nearest = noSurfaceDist;
+  for (long pc = program.begin; pc < program.end; ++pc) {
+    Instruction const &instruction = code[pc];
+    switch (instruction.op) {
+    case OpCode::LOAD_HALFSPACES:
+      if (!program.emptyUnionEqua) {
+        nearest = std::min(nearest, halfSpaceDistance(instruction.a, instruction.a + instruction.b, x, y, z, safe));
+      }
+      break;
+    case OpCode::AND_TORUS:
+      if (!program.emptyUnionEqua) {
+        if (safe) {
+          // no bound is known for the quartic surfaces
+          return 0.;
+        }
+        std::array<double, 3> const g = surfaces.gradient(instruction.a, x, y, z);
+        double const distance = std::fabs(surfaces.evaluate(instruction.a, x, y, z))
+                                / std::sqrt(g[0] * g[0] + g[1] * g[1] + g[2] * g[2]);
+        nearest = distance < nearest ? distance : nearest;
+      }
+      break;
+    case OpCode::OR_VOLUME:
+    case OpCode::AND_VOLUME:
+      nearest = std::min(nearest, nearestSurface(instruction.a, x, y, z, safe));
+      break;
+    }
+  }
+  return nearest;
+}
+
+bool CSGBytecode::run(long rank, double x, double y, double z, Workspace &workspace) const
+{
+  Program const &program = programs[rank];
+  bool acc = true;
+  for (long pc = program.begin; pc < program.end; ++pc) {
+    Instruction const &instruction = code[pc];
+    switch (instruction.op) {
+    case OpCode::LOAD_HALFSPACES:
+      acc = evaluateHalfSpaces(instruction.a, instruction.a + instruction.b, x, y, z);
+      break;
+    case OpCode::AND_TORUS:
+      acc = acc && ((instruction.b > 0) == (surfaces.evaluate(instruction.a, x, y, z) >= 0.));
+      break;
+    case OpCode::OR_VOLUME:
+      acc = acc || call(instruction.a, x, y, z, workspace);
+      break;
+    case OpCode::AND_VOLUME:
+      acc = acc && call(instruction.a, x, y, z, workspace);
+      break;
+    }
+  }
+  return acc;
+}
+
+bool CSGBytecode::call(long rank, double x, double y, double z, Workspace &workspace) const
+{
+  if (workspace.stamps[rank] == workspace.generation) {
+    return workspace.results[rank];
+  }
+  bool const result = inBox(bounds[rank], x, y, z) && run(rank, x, y, z, workspace);
+  workspace.stamps[rank] = workspace.generation;
+  workspace.results[rank] = result;
+  return result;
+}
+
+CSGBytecode::Workspace &CSGBytecode::threadWorkspace()
+{
+  static thread_local Workspace workspace;
+  return workspace;
+}
+
+bool CSGBytecode::contains(long rank, double x, double y, double z) const
+{
+  Workspace &workspace = threadWorkspace();
+  workspace.startQuery(getNbVolumes());
+  return call(rank, x, y, z, workspace);
+}
+
+long CSGBytecode::whichVolume(std::vector<double> const &point) const
+{
+  double const x = point[0], y = point[1], z = point[2];
+  Workspace &workspace = threadWorkspace();
+  workspace.startQuery(getNbVolumes());
+  long cell;
+  if (cellOfPoint(x, y, z, cell)) {
+    for (long i = cellOffsets[cell]; i < cellOffsets[cell + 1]; ++i) {
+      if (call(cellRanks[i], x, y, z, workspace)) {
+        return cellRanks[i];
+      }
+    }
+    return -1;
+  }
+  for (long rank = 0; rank < getNbVolumes(); ++rank) {
+    if (!programs[rank].fictive && call(rank, x, y, z, workspace)) {
+      return rank;
+    }
+  }
+  return -1;
+}
+
+BoundingBox CSGBytecode::computeBounds(long rank, std::vector<int> &state)
+{
+  if (state[rank] == 2) {
+    return bounds[rank];
+  }
+  if (state[rank] == 1) {
+    throw std::invalid_argument("circular definition of volume " + std::to_string(programs[rank].number));
+  }
+  state[rank] = 1;
+  Program &program = programs[rank];
+  BoundingBox box = infiniteBox();
+  for (long pc = program.begin; pc < program.end; ++pc) {
+    Instruction const &instruction = code[pc];
+    switch (instruction.op) {
+    case OpCode::LOAD_HALFSPACES:
+      for (long i = instruction.a; i < instruction.a + instruction.b; ++i) {
+        box = intersectBoxes(box, surfaces.halfSpaceBounds(halfSurfaces[i], halfSigns[i]));
+      }
+      break;
+    case OpCode::AND_TORUS:
+      box = intersectBoxes(box, surfaces.halfSpaceBounds(instruction.a, instruction.b));
+      break;
+    case OpCode::OR_VOLUME:
+      // the operands follow the EQUA part, whose box is complete at this point
+      if (pc > program.begin && code[pc - 1].op != OpCode::OR_VOLUME) {
+        program.emptyUnionEqua = isEmpty(box);
+      }
+      box = uniteBoxes(box, computeBounds(instruction.a, state));
+      break;
+    case OpCode::AND_VOLUME:
+      box = intersectBoxes(box, computeBounds(instruction.a, state));
+      break;
+    }
+  }
+  state[rank] = 2;
+  bounds[rank] = box;
+  return box;
+}
+
+void CSGBytecode::buildGrid()
+{
+  // the grid spans the finite bounds of the non-fictive volumes
+  gridBox = emptyBox();
+  long nbLocatable = 0;
+  for (long rank = 0; rank < getNbVolumes(); ++rank) {
+    if (programs[rank].fictive) {
+      continue;
+    }
+    ++nbLocatable;
+    for (int i = 0; i < 6; ++i) {
+      double const bound = bounds[rank][i];
+      if (std::isfinite(bound)) {
+        gridBox[2 * (i / 2)] = std::min(gridBox[2 * (i / 2)], bound);
+        gridBox[2 * (i / 2) + 1] = std::max(gridBox[2 * (i / 2) + 1], bound);
+      }
+    }
+  }
+  if (isEmpty(gridBox)) {
+    // no finite bound along some axis: no grid, whichVolume() scans all volumes
+    gridDims = {{0, 0, 0}};
+    return;
+  }
+
+  std::array<double, 3> extent;
+  double volume = 1.;
+  int nbExtended = 0;
+  for (int i = 0; i < 3; ++i) {
+    extent[i] = gridBox[2 * i + 1] - gridBox[2 * i];
+    if (extent[i] > 0.) {
+      volume *= extent[i];
+      ++nbExtended;
+    }
+  }
+  double const targetCells = double(std::max(nbLocatable, 1L) * gridCellsPerVolume);
+  double const cellSize = nbExtended > 0 ? std::pow(volume / targetCells, 1. / nbExtended) : 1.;
+  for (int i = 0; i < 3; ++i) {
+    gridDims[i] = extent[i] > 0. ? std::max(1L, std::min(maxGridDim, long(std::ceil(extent[i] / cellSize)))) : 1;
+  }
+
+  auto cellRange = [&](BoundingBox const &box, int axis, long &first, long &last) {
+    double const lo = std::max(box[2 * axis], gridBox[2 * axis]);
+    double const hi = std::min(box[2 * axis + 1], gridBox[2 * axis + 1]);
+    if (hi < lo) {
+      return false;
+    }
+    double const step = extent[axis] > 0. ? extent[axis] / gridDims[axis] : 1.;
+    first = std::min(gridDims[axis] - 1, long((lo - gridBox[2 * axis]) / step));
+    last = std::min(gridDims[axis] - 1, long((hi - gridBox[2 * axis]) / step));
+    return true;
+  };
+
+  // two passes: count the entries of each cell, then fill them in rank order
+  long const nbCells = gridDims[0] * gridDims[1] * gridDims[2];
+  cellOffsets.assign(nbCells + 1, 0);
+  for (int pass = 0; pass < 2; ++pass) {
+    std::vector<long> fill;
+    if (pass == 1) {
+      for (long cell = 0; cell < nbCells; ++cell) {
+        cellOffsets[cell + 1] += cellOffsets[cell];
+      }
+      cellRanks.resize(cellOffsets[nbCells]);
+      fill.assign(cellOffsets.begin(), cellOffsets.end() - 1);
+    }
+    for (long rank = 0; rank < getNbVolumes(); ++rank) {
+      if (programs[rank].fictive) {
+        continue;
+      }
+      std::array<long, 3> first, last;
+      bool overlaps = true;
+      for (int axis = 0; axis < 3; ++axis) {
+        overlaps = overlaps && cellRange(bounds[rank], axis, first[axis], last[axis]);
+      }
+      if (!overlaps) {
+        continue;
+      }
+      for (long k = first[2]; k <= last[2]; ++k) {
+        for (long j = first[1]; j <= last[1]; ++j) {
+          for (long i = first[0]; i <= last[0]; ++i) {
+            long const cell = i + gridDims[0] * (j + gridDims[1] * k);
+            if (pass == 0) {
+              ++cellOffsets[cell + 1];
+            } else {
+              cellRanks[fill[cell]++] = rank;
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+bool CSGBytecode::cellOfPoint(double x, double y, double z, long &cell) const
+{
+  if (gridDims[0] == 0 || !inBox(gridBox, x, y, z)) {
+    return false;
+  }
+  std::array<double, 3> const point = {{x, y, z}};
+  std::array<long, 3> index;
+  for (int i = 0; i < 3; ++i) {
+    double const extent = gridBox[2 * i + 1] - gridBox[2 * i];
+    index[i] = extent > 0. ? std::min(gridDims[i] - 1, long((point[i] - gridBox[2 * i]) / extent * gridDims[i])) : 0;
+  }
+  cell = index[0] + gridDims[0] * (index[1] + gridDims[1] * index[2]);
+  return true;
+}
+
+std::vector<uint64_t> CSGBytecode::getSignatures() const
+{
+  std::vector<uint64_t> signatures(programs.size(), 0);
+  std::vector<bool> known(programs.size(), false);
+  for (long rank = 0; rank < getNbVolumes(); ++rank) {
+    signature(rank, signatures, known);
+  }
+  return signatures;
+}
+
+uint64_t CSGBytecode::signature(long rank, std::vector<uint64_t> &signatures, std::vector<bool> &known) const
+{
+  if (known[rank]) {
+    return signatures[rank];
+  }
+  Program const &program = programs[rank];
+  Fnv1a hash;
+  hash.add(program.fictive);
+  hash.add(program.op);
+  auto addSurface = [&](long surface, int sign) {
+    hash.add(surfaces.getType(surface));
+    for (double parameter : surfaces.getParameters(surface)) {
+      hash.add(parameter);
+    }
+    hash.add(sign);
+  };
+  for (long pc = program.begin; pc < program.end; ++pc) {
+    Instruction const &instruction = code[pc];
+    hash.add(instruction.op);
+    switch (instruction.op) {
+    case OpCode::LOAD_HALFSPACES:
+      for (long i = instruction.a; i < instruction.a + instruction.b; ++i) {
+        addSurface(halfSurfaces[i], halfSigns[i]);
+      }
+      break;
+    case OpCode::AND_TORUS:
+      addSurface(instruction.a, instruction.b);
+      break;
+    case OpCode::OR_VOLUME:
+    case OpCode::AND_VOLUME:
+      // finalize() has ruled out circular definitions
+      hash.add(signature(instruction.a, signatures, known));
+      break;
+    }
+  }
+  signatures[rank] = hash.get();
+  known[rank] = true;
+  return signatures[rank];
+}
+
+void CSGBytecode::disassemble(long rank, std::ostream &stream) const
+{
+  Program const &program = programs[rank];
+  stream << "volume " << program.number << " (rank " << rank << (program.fictive ? ", fictive" : "") << "):\n";
+  for (long pc = program.begin; pc < program.end; ++pc) {
+    Instruction const &instruction = code[pc];
+    stream << "  " << pc << "  " << opCodeName(instruction.op);
+    switch (instruction.op) {
+    case OpCode::LOAD_HALFSPACES:
+      for (long i = instruction.a; i < instruction.a + instruction.b; ++i) {
+        stream << ' ' << (halfSigns[i] > 0 ? '+' : '-') << surfaces.getNumber(halfSurfaces[i]);
+      }
+      break;
+    case OpCode::AND_TORUS:
+      stream << ' ' << (instruction.b > 0 ? '+' : '-') << surfaces.getNumber(instruction.a);
+      break;
+    case OpCode::OR_VOLUME:
+    case OpCode::AND_VOLUME:
+      stream << " volume " << programs[instruction.a].number;
+      break;
+    }
+    stream << '\n';
+  }
+}
+
+long CSGBytecode::getNbVolumes() const
+{
+  return programs.size();
+}
+
+long CSGBytecode::getVolumeNumber(long rank) const
+{
+  return programs[rank].number;
+}
+
+bool CSGBytecode::isFictive(long rank) const
+{
+  return programs[rank].fictive;
+}
+
+long CSGBytecode::getNbInstructions() const
+{
+  return code.size();
+}
+
+BoundingBox const &CSGBytecode::getBoundingBox(long rank) const
+{
+  return bounds[rank];
+}
+
+SurfaceTable const &CSGBytecode::getSurfaces() const
+{
+  return surfaces;
+}
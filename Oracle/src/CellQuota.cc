@@ -0,0 +1,96 @@
+/**
+ * @file CellQuota.cc
+ *
+ *
+ * @brief CellQuota class
+ *
+ * @version 1.0
+ */
+
+#include "CellQuota.hh"
+#include <algorithm>
+#include <stdexcept>
+
+CellQuota::CellQuota(long quota, std::vector<unsigned long> const &cellIDs) : quota(quota),
+                                                                              nbCells(0),
+                                                                              nbFullCells(0)
+{
+  if (quota <= 0) {
+    throw std::invalid_argument("the cell quota must be positive");
+  }
+  for (unsigned long cellID : cellIDs) {
+    nbSuccesses.emplace(long(cellID), 0);
+  }
+  nbCells = nbSuccesses.size();
+}
+
+bool CellQuota::isFull(long cellID) const
+{
+  auto const found = nbSuccesses.find(cellID);
+  return found != nbSuccesses.end() && found->second >= quota;
+}
+
+bool CellQuota::recordSuccess(long cellID)
+{
+  auto const found = nbSuccesses.find(cellID);
+  if (found == nbSuccesses.end()) {
+    return false;
+  }
+  if (++found->second == quota) {
+    ++nbFullCells;
+    return true;
+  }
+  return false;
+}
+
+bool CellQuota::allFull() const
+{
+  return nbFullCells == nbCells;
+}
+
+long CellQuota::getQuota() const
+{
+  return quota;
+}
+
+std::vector<long> CellQuota::getUnderSampledCells() const
+{
+  std::vector<long> result;
+  for (auto const &cell : nbSuccesses) {
+    if (cell.second < quota) {
+      result.push_back(cell.first);
+    }
+  }
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+void CellQuota::saveState(std::ostream &stream) const
+{
+  stream << nbSuccesses.size() << "\n";
+  for (auto const &cell : nbSuccesses) {
+    stream << cell.first << " " << cell.second << "\n";
+  }
+}
+
+void CellQuota::restoreState(std::istream &stream)
+{
+  size_t nbEntries = 0;
+  stream >> nbEntries;
+  if (!stream || long(nbEntries) != nbCells) {
+    throw std::runtime_error("malformed cell quota state");
+  }
+  nbFullCells = 0;
+  for (size_t i = 0; i < nbEntries; ++i) {
+    long cellID = 0, successes = 0;
+    stream >> cellID >> successes;
+    auto const found = nbSuccesses.find(cellID);
+    if (!stream || found == nbSuccesses.end()) {
+      throw std::runtime_error("malformed cell quota state");
+    }
+    found->second = successes;
+    if (successes >= quota) {
+      ++nbFullCells;
+    }
+  }
+}
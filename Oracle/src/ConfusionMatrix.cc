@@ -0,0 +1,173 @@
+/**
+ * @file ConfusionMatrix.cc
+ *
+ *
+ * @brief ConfusionMatrix class
+ *
+ * @version 1.0
+ */
+
+#include "ConfusionMatrix.hh"
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+using namespace std;
+
+namespace
+{
+/// packs a cell and a volume number (32 bits each, -1 included) in a key
+uint64_t packKey(long cellID, long volume)
+{
+  return (uint64_t(uint32_t(cellID)) << 32) | uint32_t(volume);
+}
+
+long cellOfKey(uint64_t key)
+{
+  return int32_t(uint32_t(key >> 32));
+}
+
+long volumeOfKey(uint64_t key)
+{
+  return int32_t(uint32_t(key));
+}
+
+string volumeName(long volume)
+{
+  return volume < 0 ? "outside" : "T4 volume " + to_string(volume);
+}
+} // namespace
+
+void ConfusionMatrix::add(long cellID, long volume)
+{
+  ++counts[packKey(cellID, volume)];
+}
+
+void ConfusionMatrix::merge(ConfusionMatrix const &other)
+{
+  for (auto const &item : other.counts) {
+    counts[item.first] += item.second;
+  }
+}
+
+long ConfusionMatrix::getCount(long cellID, long volume) const
+{
+  auto const found = counts.find(packKey(cellID, volume));
+  return found == counts.end() ? 0 : found->second;
+}
+
+long ConfusionMatrix::getNbEntries() const
+{
+  return counts.size();
+}
+
+vector<ConfusionMatrix::Entry> ConfusionMatrix::getEntries() const
+{
+  vector<Entry> entries;
+  entries.reserve(counts.size());
+  for (auto const &item : counts) {
+    entries.push_back({cellOfKey(item.first), volumeOfKey(item.first), item.second, 0, 0});
+  }
+  sort(entries.begin(), entries.end(), [](Entry const &a, Entry const &b) {
+    return a.cellID != b.cellID ? a.cellID < b.cellID : a.volume < b.volume;
+  });
+  // the entries of a cell are contiguous
+  for (size_t begin = 0; begin < entries.size();) {
+    size_t end = begin;
+    long cellCount = 0;
+    size_t main = begin;
+    while (end < entries.size() && entries[end].cellID == entries[begin].cellID) {
+      cellCount += entries[end].count;
+      if (entries[end].count > entries[main].count) {
+        main = end;
+      }
+      ++end;
+    }
+    for (size_t i = begin; i < end; ++i) {
+      entries[i].cellCount = cellCount;
+      entries[i].mainVolume = entries[main].volume;
+    }
+    begin = end;
+  }
+  return entries;
+}
+
+vector<ConfusionMatrix::Entry> ConfusionMatrix::getOffDiagonal() const
+{
+  vector<Entry> offDiagonal;
+  for (auto const &entry : getEntries()) {
+    if (entry.volume != entry.mainVolume) {
+      offDiagonal.push_back(entry);
+    }
+  }
+  stable_sort(offDiagonal.begin(), offDiagonal.end(),
+              [](Entry const &a, Entry const &b) { return a.count > b.count; });
+  return offDiagonal;
+}
+
+long ConfusionMatrix::getNbSplitCells() const
+{
+  vector<long> cells;
+  for (auto const &entry : getOffDiagonal()) {
+    cells.push_back(entry.cellID);
+  }
+  sort(cells.begin(), cells.end());
+  return unique(cells.begin(), cells.end()) - cells.begin();
+}
+
+void ConfusionMatrix::report(ostream &stream, size_t maxEntries) const
+{
+  vector<Entry> const offDiagonal = getOffDiagonal();
+  stream << "Number of MCNP cells found in several T4 volumes: " << getNbSplitCells() << endl;
+  for (size_t i = 0; i < offDiagonal.size() && i < maxEntries; ++i) {
+    Entry const &entry = offDiagonal[i];
+    stream << "  MCNP cell " << entry.cellID << " -> " << volumeName(entry.volume) << ": " << entry.count
+           << " points (" << 100. * entry.count / entry.cellCount << "% of the cell; main: "
+           << volumeName(entry.mainVolume) << ")" << endl;
+  }
+  if (offDiagonal.size() > maxEntries) {
+    stream << "  ... " << offDiagonal.size() - maxEntries << " smaller entries" << endl;
+  }
+}
+
+void ConfusionMatrix::writeCSV(string const &path) const
+{
+  ofstream file(path);
+  if (!file) {
+    throw runtime_error("cannot write the confusion matrix to " + path);
+  }
+  file << "mcnp_cell,t4_volume,count\n";
+  for (auto const &entry : getEntries()) {
+    file << entry.cellID << "," << entry.volume << "," << entry.count << "\n";
+  }
+  if (!file) {
+    throw runtime_error("cannot write the confusion matrix to " + path);
+  }
+}
+
+void ConfusionMatrix::save(ostream &stream) const
+{
+  stream << counts.size();
+  for (auto const &entry : getEntries()) {
+    stream << " " << entry.cellID << " " << entry.volume << " " << entry.count;
+  }
+  stream << "\n";
+}
+
+void ConfusionMatrix::read(istream &stream, string const &name)
+{
+  size_t nbEntries = 0;
+  stream >> nbEntries;
+  counts.clear();
+  for (size_t i = 0; i < nbEntries; ++i) {
+    long cellID = 0, volume = 0, count = 0;
+    stream >> cellID >> volume >> count;
+    if (!stream || count <= 0) {
+      throw runtime_error("malformed confusion matrix in " + name);
+    }
+    counts[packKey(cellID, volume)] += count;
+  }
+  if (!stream) {
+    throw runtime_error("malformed confusion matrix in " + name);
+  }
+}
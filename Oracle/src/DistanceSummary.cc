@@ -0,0 +1,284 @@
+/**
+ * @file DistanceSummary.cc
+ *
+ *
+ * @brief RunningMoments, QuantileSketch and DistanceSummary classes
+ *
+ * @version 1.0
+ */
+
+#include "DistanceSummary.hh"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <stdexcept>
+#include <utility>
+
+using namespace std;
+
+namespace
+{
+/// seed of the coin flips of the quantile sketches
+constexpr uint64_t sketchSeed = 0x9e3779b97f4a7c15ULL;
+
+/// ratio between the capacities of successive compactors
+constexpr double capacityRatio = 2. / 3.;
+} // namespace
+
+RunningMoments::RunningMoments() : count(0),
+                                   mean(0.),
+                                   m2(0.),
+                                   min(0.),
+                                   max(0.)
+{
+}
+
+void RunningMoments::add(double value)
+{
+  ++count;
+  double const delta = value - mean;
+  mean += delta / count;
+  m2 += delta * (value - mean);
+  if (count == 1) {
+    min = max = value;
+  } else {
+    min = std::min(min, value);
+    max = std::max(max, value);
+  }
+}
+
+void RunningMoments::merge(RunningMoments const &other)
+{
+  if (other.count == 0) {
+    return;
+  }
+  if (count == 0) {
+    *this = other;
+    return;
+  }
+  long const total = count + other.count;
+  double const delta = other.mean - mean;
+  mean += delta * other.count / total;
+  m2 += other.m2 + delta * delta * (double(count) * other.count / total);
+  count = total;
+  min = std::min(min, other.min);
+  max = std::max(max, other.max);
+}
+
+long RunningMoments::getCount() const
+{
+  return count;
+}
+
+double RunningMoments::getMean() const
+{
+  return mean;
+}
+
+double RunningMoments::getStandardDeviation() const
+{
+  return count > 1 ? sqrt(m2 / (count - 1)) : 0.;
+}
+
+double RunningMoments::getMin() const
+{
+  return min;
+}
+
+double RunningMoments::getMax() const
+{
+  return max;
+}
+
+void RunningMoments::save(ostream &stream) const
+{
+  stream << setprecision(17) << count << " " << mean << " " << m2 << " " << min << " " << max;
+}
+
+void RunningMoments::read(istream &stream)
+{
+  stream >> count >> mean >> m2 >> min >> max;
+}
+
+QuantileSketch::QuantileSketch(int k) : k(std::max(2, k)),
+                                        count(0),
+                                        compactors(1),
+                                        randomState(sketchSeed)
+{
+}
+
+void QuantileSketch::add(double value)
+{
+  compactors[0].push_back(value);
+  ++count;
+  if (long(compactors[0].size()) >= capacity(0)) {
+    compress();
+  }
+}
+
+void QuantileSketch::merge(QuantileSketch const &other)
+{
+  if (other.compactors.size() > compactors.size()) {
+    compactors.resize(other.compactors.size());
+  }
+  for (size_t level = 0; level < other.compactors.size(); ++level) {
+    compactors[level].insert(compactors[level].end(), other.compactors[level].begin(), other.compactors[level].end());
+  }
+  count += other.count;
+  compress();
+}
+
+double QuantileSketch::quantile(double q) const
+{
+  vector<pair<double, double>> weighted;
+  double totalWeight = 0.;
+  for (size_t level = 0; level < compactors.size(); ++level) {
+    double const weight = ldexp(1., int(level));
+    for (double value : compactors[level]) {
+      weighted.emplace_back(value, weight);
+      totalWeight += weight;
+    }
+  }
+  if (weighted.empty()) {
+    return 0.;
+  }
+  sort(weighted.begin(), weighted.end());
+  double const target = std::min(std::max(q, 0.), 1.) * totalWeight;
+  double cumulated = 0.;
+  for (auto const &item : weighted) {
+    cumulated += item.second;
+    if (cumulated >= target) {
+      return item.first;
+    }
+  }
+  return weighted.back().first;
+}
+
+long QuantileSketch::getCount() const
+{
+  return count;
+}
+
+long QuantileSketch::getSize() const
+{
+  long size = 0;
+  for (auto const &compactor : compactors) {
+    size += compactor.size();
+  }
+  return size;
+}
+
+void QuantileSketch::save(ostream &stream) const
+{
+  stream << k << " " << count << " " << randomState << " " << compactors.size();
+  stream << setprecision(17);
+  for (auto const &compactor : compactors) {
+    stream << " " << compactor.size();
+    for (double value : compactor) {
+      stream << " " << value;
+    }
+  }
+}
+
+void QuantileSketch::read(istream &stream)
+{
+  size_t nbLevels = 0;
+  stream >> k >> count >> randomState >> nbLevels;
+  if (!stream || k < 2 || nbLevels == 0 || nbLevels > 64) {
+    throw runtime_error("malformed quantile sketch");
+  }
+  compactors.assign(nbLevels, vector<double>());
+  for (auto &compactor : compactors) {
+    size_t size = 0;
+    stream >> size;
+    if (!stream || size > size_t(count)) {
+      throw runtime_error("malformed quantile sketch");
+    }
+    compactor.resize(size);
+    for (double &value : compactor) {
+      stream >> value;
+    }
+  }
+  if (!stream) {
+    throw runtime_error("malformed quantile sketch");
+  }
+}
+
+long QuantileSketch::capacity(size_t level) const
+{
+  int const depth = int(compactors.size()) - int(level) - 1;
+  return std::max(2l, long(ceil(k * pow(capacityRatio, depth))));
+}
+
+void QuantileSketch::compress()
+{
+  for (size_t level = 0; level < compactors.size(); ++level) {
+    if (long(compactors[level].size()) < capacity(level)) {
+      continue;
+    }
+    if (level + 1 == compactors.size()) {
+      compactors.emplace_back();
+    }
+    vector<double> &compactor = compactors[level];
+    sort(compactor.begin(), compactor.end());
+    // an odd value out stays at this level
+    size_t const nbCompacted = compactor.size() - compactor.size() % 2;
+    vector<double> &above = compactors[level + 1];
+    for (size_t i = flipCoin() ? 1 : 0; i < nbCompacted; i += 2) {
+      above.push_back(compactor[i]);
+    }
+    compactor.erase(compactor.begin(), compactor.begin() + nbCompacted);
+  }
+}
+
+bool QuantileSketch::flipCoin()
+{
+  // xorshift64*
+  randomState ^= randomState >> 12;
+  randomState ^= randomState << 25;
+  randomState ^= randomState >> 27;
+  return ((randomState * 0x2545f4914f6cdd1dULL) >> 63) != 0;
+}
+
+void DistanceSummary::add(double distance)
+{
+  moments.add(distance);
+  sketch.add(distance);
+}
+
+void DistanceSummary::merge(DistanceSummary const &other)
+{
+  moments.merge(other.moments);
+  sketch.merge(other.sketch);
+}
+
+RunningMoments const &DistanceSummary::getMoments() const
+{
+  return moments;
+}
+
+double DistanceSummary::quantile(double q) const
+{
+  return sketch.quantile(q);
+}
+
+void DistanceSummary::save(ostream &stream) const
+{
+  moments.save(stream);
+  stream << " ";
+  sketch.save(stream);
+  stream << "\n";
+}
+
+void DistanceSummary::read(istream &stream, string const &name)
+{
+  moments.read(stream);
+  try {
+    sketch.read(stream);
+  } catch (runtime_error const &) {
+    throw runtime_error("malformed distance summary in " + name);
+  }
+  if (moments.getCount() != sketch.getCount()) {
+    throw runtime_error("malformed distance summary in " + name);
+  }
+}
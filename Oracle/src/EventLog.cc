@@ -0,0 +1,228 @@
+/**
+ * @file EventLog.cc
+ *
+ *
+ * @brief EventRecord and EventLog classes
+ *
+ * @version 1.0
+ */
+
+#include "EventLog.hh"
+#include <cmath>
+#include <cstdio>
+#include <stdexcept>
+#include <unistd.h>
+
+using namespace std;
+
+namespace
+{
+/// the size from which the buffer of records is handed to the writer
+constexpr size_t bufferSize = 1 << 16;
+
+/// number of full buffers handed to the writer from which write() waits
+constexpr size_t maxPendingBuffers = 4;
+
+string quote(string const &value)
+{
+  string quoted = "\"";
+  for (char c : value) {
+    switch (c) {
+    case '"':
+      quoted += "\\\"";
+      break;
+    case '\\':
+      quoted += "\\\\";
+      break;
+    case '\n':
+      quoted += "\\n";
+      break;
+    case '\t':
+      quoted += "\\t";
+      break;
+    default:
+      if (static_cast<unsigned char>(c) < 0x20) {
+        char escaped[8];
+        snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned char>(c));
+        quoted += escaped;
+      } else {
+        quoted += c;
+      }
+    }
+  }
+  return quoted + "\"";
+}
+} // namespace
+
+EventRecord::EventRecord(string const &event) : text("{\"event\":" + quote(event))
+{
+}
+
+void EventRecord::addKey(string const &key)
+{
+  text += "," + quote(key) + ":";
+}
+
+EventRecord &EventRecord::add(string const &key, long value)
+{
+  addKey(key);
+  text += to_string(value);
+  return *this;
+}
+
+EventRecord &EventRecord::add(string const &key, int value)
+{
+  return add(key, long(value));
+}
+
+EventRecord &EventRecord::add(string const &key, unsigned long value)
+{
+  addKey(key);
+  text += to_string(value);
+  return *this;
+}
+
+EventRecord &EventRecord::add(string const &key, double value)
+{
+  addKey(key);
+  if (std::isfinite(value)) {
+    char formatted[32];
+    snprintf(formatted, sizeof(formatted), "%.17g", value);
+    text += formatted;
+  } else {
+    text += "null";
+  }
+  return *this;
+}
+
+EventRecord &EventRecord::add(string const &key, bool value)
+{
+  addKey(key);
+  text += value ? "true" : "false";
+  return *this;
+}
+
+EventRecord &EventRecord::add(string const &key, string const &value)
+{
+  addKey(key);
+  text += quote(value);
+  return *this;
+}
+
+EventRecord &EventRecord::add(string const &key, char const *value)
+{
+  return add(key, string(value));
+}
+
+string EventRecord::str() const
+{
+  return text + "}";
+}
+
+EventLog::EventLog(string const &path, bool resume) : path(path),
+                                                      file(path, resume ? ios_base::app : ios_base::out),
+                                                      failed(false),
+                                                      nbRecords(0),
+                                                      nbBytes(0),
+                                                      writer([this](string &buffer) { writeBuffer(buffer); }, maxPendingBuffers)
+{
+  if (!file) {
+    throw runtime_error("cannot write the events to " + path);
+  }
+  current.reserve(bufferSize);
+}
+
+EventLog::~EventLog()
+{
+  try {
+    close();
+  } catch (runtime_error const &) {
+  }
+}
+
+void EventLog::write(EventRecord const &record)
+{
+  string const line = record.str();
+  lock_guard<std::mutex> lock(mutex);
+  current += line;
+  current += '\n';
+  ++nbRecords;
+  if (current.size() >= bufferSize) {
+    // pushed under the lock, so that the buffers keep the order of the records
+    writer.push(std::move(current));
+    current = string();
+    current.reserve(bufferSize);
+  }
+}
+
+void EventLog::close()
+{
+  if (!file.is_open()) {
+    return;
+  }
+  {
+    lock_guard<std::mutex> lock(mutex);
+    if (!current.empty()) {
+      writer.push(std::move(current));
+      current = string();
+    }
+  }
+  writer.close();
+  file.close();
+  if (failed || file.fail()) {
+    throw runtime_error("cannot write the events to " + path);
+  }
+}
+
+void EventLog::saveState(ostream &stream)
+{
+  lock_guard<std::mutex> lock(mutex);
+  if (!current.empty()) {
+    writer.push(std::move(current));
+    current = string();
+    current.reserve(bufferSize);
+  }
+  writer.drain();
+  stream << "events " << nbBytes << " " << nbRecords << "\n";
+}
+
+void EventLog::restoreState(istream &stream)
+{
+  string word;
+  int64_t savedBytes = 0;
+  long savedRecords = 0;
+  stream >> word >> savedBytes >> savedRecords;
+  if (!stream || word != "events" || savedBytes < 0 || savedRecords < 0) {
+    throw runtime_error("malformed events state");
+  }
+  lock_guard<std::mutex> lock(mutex);
+  current.clear();
+  writer.drain();
+  file.flush();
+  ifstream saved(path, ios_base::binary | ios_base::ate);
+  if (!saved || int64_t(saved.tellg()) < savedBytes || ::truncate(path.c_str(), savedBytes) != 0) {
+    throw runtime_error(path + " is shorter than at the checkpoint");
+  }
+  nbBytes = savedBytes;
+  nbRecords = savedRecords;
+}
+
+string const &EventLog::getPath() const
+{
+  return path;
+}
+
+long EventLog::getNbRecords() const
+{
+  return nbRecords;
+}
+
+void EventLog::writeBuffer(string const &buffer)
+{
+  if (!failed) {
+    file.write(buffer.data(), buffer.size());
+    file.flush();
+    failed = !file;
+    nbBytes += buffer.size();
+  }
+}
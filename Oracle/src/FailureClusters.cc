@@ -0,0 +1,288 @@
+/**
+ * @file FailureClusters.cc
+ *
+ *
+ * @brief FailureClusters class
+ *
+ * @version 1.0
+ */
+
+#include "FailureClusters.hh"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <stdexcept>
+#include <tuple>
+
+using namespace std;
+
+bool FailureClusters::Key::operator<(Key const &other) const
+{
+  return tie(cellID, materialID, volume, compo) < tie(other.cellID, other.materialID, other.volume, other.compo);
+}
+
+array<double, 3> FailureClusters::Cluster::getCentroid() const
+{
+  return {sum[0] / nbPoints, sum[1] / nbPoints, sum[2] / nbPoints};
+}
+
+size_t FailureClusters::VoxelHash::operator()(Voxel const &voxel) const
+{
+  size_t seed = 0;
+  for (long index : voxel) {
+    seed ^= hash<long>()(index) + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2);
+  }
+  return seed;
+}
+
+long FailureClusters::Group::find(long node)
+{
+  // path halving
+  while (parent[node] != node) {
+    parent[node] = parent[parent[node]];
+    node = parent[node];
+  }
+  return node;
+}
+
+void FailureClusters::Group::join(long first, long second, size_t maxRepresentatives)
+{
+  long root = find(first);
+  long other = find(second);
+  if (root == other) {
+    return;
+  }
+  if (clusters[root].nbPoints < clusters[other].nbPoints) {
+    swap(root, other);
+  }
+  parent[other] = root;
+  Cluster &cluster = clusters[root];
+  Cluster &merged = clusters[other];
+  cluster.nbPoints += merged.nbPoints;
+  cluster.nbVoxels += merged.nbVoxels;
+  for (int i = 0; i < 3; ++i) {
+    cluster.min[i] = std::min(cluster.min[i], merged.min[i]);
+    cluster.max[i] = std::max(cluster.max[i], merged.max[i]);
+    cluster.sum[i] += merged.sum[i];
+  }
+  cluster.maxDist = std::max(cluster.maxDist, merged.maxDist);
+  for (auto const &representative : merged.representatives) {
+    if (cluster.representatives.size() >= maxRepresentatives) {
+      break;
+    }
+    cluster.representatives.push_back(representative);
+  }
+  vector<Representative>().swap(merged.representatives);
+}
+
+FailureClusters::FailureClusters(double voxelSize, size_t maxRepresentatives) : voxelSize(voxelSize),
+                                                                                maxRepresentatives(maxRepresentatives),
+                                                                                nbPoints(0)
+{
+  if (!(voxelSize > 0.)) {
+    throw invalid_argument("the voxel size of the failure clusters must be positive");
+  }
+}
+
+void FailureClusters::add(Key const &key, array<double, 3> const &position, int64_t pointID, double dist)
+{
+  ++nbPoints;
+  Group &group = groups[key];
+  Voxel const voxel = {long(floor(position[0] / voxelSize)),
+                       long(floor(position[1] / voxelSize)),
+                       long(floor(position[2] / voxelSize))};
+  auto const found = group.voxels.find(voxel);
+  if (found != group.voxels.end()) {
+    Cluster &cluster = group.clusters[group.find(found->second)];
+    ++cluster.nbPoints;
+    for (int i = 0; i < 3; ++i) {
+      cluster.min[i] = std::min(cluster.min[i], position[i]);
+      cluster.max[i] = std::max(cluster.max[i], position[i]);
+      cluster.sum[i] += position[i];
+    }
+    cluster.maxDist = std::max(cluster.maxDist, dist);
+    return;
+  }
+
+  // a new voxel: a cluster of its own, joined with the neighbouring ones
+  long const node = group.parent.size();
+  group.voxels.emplace(voxel, node);
+  group.parent.push_back(node);
+  Cluster cluster{Key(), 1, 1, position, position, position, dist, {}};
+  if (maxRepresentatives > 0) {
+    cluster.representatives.push_back({position, pointID, dist});
+  }
+  group.clusters.push_back(std::move(cluster));
+  for (long dx = -1; dx <= 1; ++dx) {
+    for (long dy = -1; dy <= 1; ++dy) {
+      for (long dz = -1; dz <= 1; ++dz) {
+        auto const neighbour = group.voxels.find({voxel[0] + dx, voxel[1] + dy, voxel[2] + dz});
+        if (neighbour != group.voxels.end() && neighbour->second != node) {
+          group.join(node, neighbour->second, maxRepresentatives);
+        }
+      }
+    }
+  }
+}
+
+vector<FailureClusters::Cluster> FailureClusters::getClusters() const
+{
+  vector<Cluster> result;
+  for (auto const &item : groups) {
+    Group const &group = item.second;
+    for (size_t node = 0; node < group.parent.size(); ++node) {
+      if (group.parent[node] == long(node)) {
+        result.push_back(group.clusters[node]);
+        result.back().key = item.first;
+      }
+    }
+  }
+  // the groups are visited in key order: the ranking is reproducible
+  stable_sort(result.begin(), result.end(),
+              [](Cluster const &a, Cluster const &b) { return a.nbPoints > b.nbPoints; });
+  return result;
+}
+
+long FailureClusters::getNbPoints() const
+{
+  return nbPoints;
+}
+
+long FailureClusters::getNbGroups() const
+{
+  return groups.size();
+}
+
+double FailureClusters::getVoxelSize() const
+{
+  return voxelSize;
+}
+
+namespace
+{
+void printCluster(ostream &stream, size_t index, FailureClusters::Cluster const &cluster)
+{
+  array<double, 3> const centroid = cluster.getCentroid();
+  stream << "  cluster " << index << ": " << cluster.nbPoints << " points in " << cluster.nbVoxels
+         << " voxels; MCNP cell " << cluster.key.cellID << ", material " << cluster.key.materialID
+         << "; T4 volume " << cluster.key.volume << ", composition " << cluster.key.compo << "\n"
+         << "    bounding box: [" << cluster.min[0] << ", " << cluster.max[0] << "] x [" << cluster.min[1] << ", "
+         << cluster.max[1] << "] x [" << cluster.min[2] << ", " << cluster.max[2] << "]; centroid: (" << centroid[0]
+         << ", " << centroid[1] << ", " << centroid[2] << "); max distance: " << cluster.maxDist << "\n";
+}
+} // namespace
+
+void FailureClusters::report(ostream &stream, size_t maxClusters) const
+{
+  vector<Cluster> const clusters = getClusters();
+  stream << "Failure clusters (voxel size " << voxelSize << "): " << clusters.size() << " clusters of " << nbPoints
+         << " failed points, in " << groups.size() << " groups\n";
+  for (size_t i = 0; i < clusters.size() && i < maxClusters; ++i) {
+    printCluster(stream, i + 1, clusters[i]);
+  }
+  if (clusters.size() > maxClusters) {
+    stream << "  ... " << clusters.size() - maxClusters << " smaller clusters\n";
+  }
+}
+
+void FailureClusters::write(string const &rawname) const
+{
+  vector<Cluster> const clusters = getClusters();
+  ofstream clustersFile(rawname + ".clusters");
+  ofstream representativesFile(rawname + ".representatives");
+  if (!clustersFile || !representativesFile) {
+    throw runtime_error("cannot write the failure clusters of " + rawname);
+  }
+  clustersFile << "Failure clusters (voxel size " << voxelSize << "): " << clusters.size() << " clusters of "
+               << nbPoints << " failed points, in " << groups.size() << " groups\n";
+  representativesFile << setprecision(17);
+  for (size_t i = 0; i < clusters.size(); ++i) {
+    printCluster(clustersFile, i + 1, clusters[i]);
+    for (auto const &representative : clusters[i].representatives) {
+      clustersFile << "    representative: point " << representative.pointID << " at ("
+                   << representative.position[0] << ", " << representative.position[1] << ", "
+                   << representative.position[2] << "), distance " << representative.dist << "\n";
+      representativesFile << representative.position[0] << " " << representative.position[1] << " "
+                          << representative.position[2] << " " << clusters[i].key.volume << "\n";
+    }
+  }
+  if (!clustersFile || !representativesFile) {
+    throw runtime_error("cannot write the failure clusters of " + rawname);
+  }
+}
+
+void FailureClusters::saveState(ostream &stream) const
+{
+  stream << setprecision(17) << nbPoints << " " << groups.size() << "\n";
+  for (auto const &item : groups) {
+    Key const &key = item.first;
+    Group const &group = item.second;
+    stream << key.cellID << " " << key.materialID << " " << key.volume << " " << key.compo << " "
+           << group.parent.size() << "\n";
+    vector<Voxel const *> voxels(group.parent.size());
+    for (auto const &voxel : group.voxels) {
+      voxels[voxel.second] = &voxel.first;
+    }
+    for (size_t node = 0; node < group.parent.size(); ++node) {
+      Voxel const &voxel = *voxels[node];
+      stream << voxel[0] << " " << voxel[1] << " " << voxel[2] << " " << group.parent[node];
+      if (group.parent[node] == long(node)) {
+        Cluster const &cluster = group.clusters[node];
+        stream << " " << cluster.nbPoints << " " << cluster.nbVoxels;
+        for (auto const *bound : {&cluster.min, &cluster.max, &cluster.sum}) {
+          stream << " " << (*bound)[0] << " " << (*bound)[1] << " " << (*bound)[2];
+        }
+        stream << " " << cluster.maxDist << " " << cluster.representatives.size();
+        for (auto const &representative : cluster.representatives) {
+          stream << " " << representative.position[0] << " " << representative.position[1] << " "
+                 << representative.position[2] << " " << representative.pointID << " " << representative.dist;
+        }
+      }
+      stream << "\n";
+    }
+  }
+}
+
+void FailureClusters::restoreState(istream &stream)
+{
+  size_t nbGroups = 0;
+  stream >> nbPoints >> nbGroups;
+  groups.clear();
+  for (size_t i = 0; i < nbGroups && stream; ++i) {
+    Key key;
+    size_t nbNodes = 0;
+    stream >> key.cellID >> key.materialID >> key.volume >> key.compo >> nbNodes;
+    Group &group = groups[key];
+    group.parent.resize(nbNodes);
+    group.clusters.resize(nbNodes);
+    for (size_t node = 0; node < nbNodes && stream; ++node) {
+      Voxel voxel;
+      stream >> voxel[0] >> voxel[1] >> voxel[2] >> group.parent[node];
+      if (!stream || group.parent[node] < 0 || size_t(group.parent[node]) >= nbNodes) {
+        throw runtime_error("malformed failure clusters state");
+      }
+      group.voxels.emplace(voxel, node);
+      if (group.parent[node] == long(node)) {
+        Cluster &cluster = group.clusters[node];
+        size_t nbRepresentatives = 0;
+        stream >> cluster.nbPoints >> cluster.nbVoxels;
+        for (auto *bound : {&cluster.min, &cluster.max, &cluster.sum}) {
+          stream >> (*bound)[0] >> (*bound)[1] >> (*bound)[2];
+        }
+        stream >> cluster.maxDist >> nbRepresentatives;
+        if (!stream || nbRepresentatives > maxRepresentatives) {
+          throw runtime_error("malformed failure clusters state");
+        }
+        cluster.representatives.resize(nbRepresentatives);
+        for (auto &representative : cluster.representatives) {
+          stream >> representative.position[0] >> representative.position[1] >> representative.position[2]
+              >> representative.pointID >> representative.dist;
+        }
+      }
+    }
+  }
+  if (!stream) {
+    throw runtime_error("malformed failure clusters state");
+  }
+}
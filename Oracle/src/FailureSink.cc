@@ -0,0 +1,243 @@
+/**
+ * @file FailureSink.cc
+ *
+ *
+ * @brief FailureSink and FailureReader classes
+ *
+ * @version 1.0
+ */
+
+#include "FailureSink.hh"
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+#include <unistd.h>
+
+using namespace std;
+
+namespace
+{
+char const *const failuresMagic = "ORACLEFAILURES";
+int const failuresVersion = 2;
+
+/// number of full blocks handed to the writer from which add() waits
+constexpr size_t maxPendingBlocks = 2;
+
+template <typename T>
+void writeColumn(ofstream &file, vector<T> const &column)
+{
+  file.write(reinterpret_cast<char const *>(column.data()), column.size() * sizeof(T));
+}
+
+template <typename T>
+void readColumn(ifstream &file, vector<T> &column, size_t size)
+{
+  column.resize(size);
+  file.read(reinterpret_cast<char *>(column.data()), size * sizeof(T));
+}
+} // namespace
+
+void FailureSink::Block::reserve(size_t size)
+{
+  x.reserve(size);
+  y.reserve(size);
+  z.reserve(size);
+  pointID.reserve(size);
+  cellID.reserve(size);
+  materialID.reserve(size);
+  rank.reserve(size);
+  dist.reserve(size);
+}
+
+size_t FailureSink::Block::size() const
+{
+  return x.size();
+}
+
+FailureSink::FailureSink(string const &path, size_t blockSize, bool resume) : path(path),
+                                                                             file(path, resume ? ios_base::binary | ios_base::app : ios_base::binary),
+                                                                             blockSize(max(size_t(1), blockSize)),
+                                                                             failed(false),
+                                                                             nbPoints(0),
+                                                                             nbBytes(0),
+                                                                             writer([this](Block &block) { writeBlock(block); }, maxPendingBlocks)
+{
+  if (!file) {
+    throw runtime_error("cannot write the failed points to " + path);
+  }
+  if (!resume) {
+    ostringstream header;
+    header << failuresMagic << " " << failuresVersion << "\n";
+    file << header.str();
+    nbBytes = header.str().size();
+  }
+  current.reserve(this->blockSize);
+}
+
+FailureSink::~FailureSink()
+{
+  try {
+    close();
+  } catch (runtime_error const &) {
+  }
+}
+
+void FailureSink::add(failedPoint const &point)
+{
+  current.x.push_back(point.position[0]);
+  current.y.push_back(point.position[1]);
+  current.z.push_back(point.position[2]);
+  current.pointID.push_back(int64_t(point.mcnpParticleID));
+  current.cellID.push_back(int32_t(point.mcnpCellID));
+  current.materialID.push_back(int32_t(point.mcnpMaterialID));
+  current.rank.push_back(int32_t(point.rank));
+  current.dist.push_back(float(point.dist));
+  ++nbPoints;
+  if (current.size() < blockSize) {
+    return;
+  }
+  writer.push(std::move(current));
+  current = Block();
+  current.reserve(blockSize);
+}
+
+void FailureSink::close()
+{
+  if (!file.is_open()) {
+    return;
+  }
+  if (current.size() > 0) {
+    writer.push(std::move(current));
+    current = Block();
+  }
+  writer.close();
+  file.close();
+  if (failed || file.fail()) {
+    throw runtime_error("cannot write the failed points to " + path);
+  }
+}
+
+void FailureSink::saveState(ostream &stream)
+{
+  if (current.size() > 0) {
+    writer.push(std::move(current));
+    current = Block();
+    current.reserve(blockSize);
+  }
+  writer.drain();
+  stream << "failures " << nbBytes << " " << nbPoints << "\n";
+}
+
+void FailureSink::restoreState(istream &stream)
+{
+  string word;
+  int64_t savedBytes = 0;
+  long savedPoints = 0;
+  stream >> word >> savedBytes >> savedPoints;
+  if (!stream || word != "failures" || savedBytes <= 0 || savedPoints < 0) {
+    throw runtime_error("malformed failed points state");
+  }
+  writer.drain();
+  current = Block();
+  current.reserve(blockSize);
+  file.flush();
+  ifstream saved(path, ios_base::binary | ios_base::ate);
+  if (!saved || int64_t(saved.tellg()) < savedBytes || ::truncate(path.c_str(), savedBytes) != 0) {
+    throw runtime_error(path + " is shorter than at the checkpoint");
+  }
+  nbBytes = savedBytes;
+  nbPoints = savedPoints;
+}
+
+string const &FailureSink::getPath() const
+{
+  return path;
+}
+
+long FailureSink::getNbPoints() const
+{
+  return nbPoints;
+}
+
+void FailureSink::writeBlock(Block const &block)
+{
+  if (failed) {
+    return;
+  }
+  int64_t const size = block.size();
+  file.write(reinterpret_cast<char const *>(&size), sizeof(size));
+  writeColumn(file, block.x);
+  writeColumn(file, block.y);
+  writeColumn(file, block.z);
+  writeColumn(file, block.pointID);
+  writeColumn(file, block.cellID);
+  writeColumn(file, block.materialID);
+  writeColumn(file, block.rank);
+  writeColumn(file, block.dist);
+  failed = !file;
+  nbBytes += sizeof(size) + size * (3 * sizeof(double) + sizeof(int64_t) + 3 * sizeof(int32_t) + sizeof(float));
+}
+
+FailureReader::FailureReader(string const &path) : file(path, ios_base::binary),
+                                                   path(path),
+                                                   next(0),
+                                                   version(0)
+{
+  if (!file) {
+    throw runtime_error("cannot read the failed points file " + path);
+  }
+  string word;
+  file >> word >> version;
+  if (word != failuresMagic || version < 1 || version > failuresVersion || file.get() != '\n') {
+    throw runtime_error(path + " is not a failed points file");
+  }
+}
+
+bool FailureReader::read(failedPoint &point)
+{
+  if (next >= block.size() && !readBlock()) {
+    return false;
+  }
+  point = block[next++];
+  return true;
+}
+
+bool FailureReader::readBlock()
+{
+  int64_t size = 0;
+  file.read(reinterpret_cast<char *>(&size), sizeof(size));
+  if (file.gcount() == 0 && file.eof()) {
+    return false;
+  }
+  if (!file || size <= 0) {
+    throw runtime_error("malformed failed points file " + path);
+  }
+  vector<double> x, y, z;
+  vector<int64_t> pointID;
+  vector<int32_t> cellID, materialID, rank;
+  vector<float> dist;
+  readColumn(file, x, size);
+  readColumn(file, y, size);
+  readColumn(file, z, size);
+  if (version == 1) {
+    vector<int32_t> narrowID;
+    readColumn(file, narrowID, size);
+    pointID.assign(narrowID.begin(), narrowID.end());
+  } else {
+    readColumn(file, pointID, size);
+  }
+  readColumn(file, cellID, size);
+  readColumn(file, materialID, size);
+  readColumn(file, rank, size);
+  readColumn(file, dist, size);
+  if (!file) {
+    throw runtime_error("malformed failed points file " + path);
+  }
+  block.resize(size);
+  for (int64_t i = 0; i < size; ++i) {
+    block[i] = {{x[i], y[i], z[i]}, double(pointID[i]), double(cellID[i]), double(materialID[i]), double(dist[i]),
+                double(rank[i])};
+  }
+  next = 0;
+  return true;
+}
@@ -0,0 +1,81 @@
+/**
+ * @file GapSource.cc
+ *
+ *
+ * @brief GapSource class
+ *
+ * @version 1.0
+ */
+
+#include "GapSource.hh"
+#include "T4Geometry.hh"
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+namespace
+{
+/// number of probabilities per SP continuation line
+constexpr int nbProbabilitiesPerLine = 16;
+} // namespace
+
+GapSource::GapSource(T4Geometry &t4Geom, uint64_t seed, long maxTries) : t4Geom(t4Geom),
+                                                                         generator(seed),
+                                                                         maxTries(maxTries)
+{
+}
+
+std::vector<std::array<double, 3>> GapSource::sample(long rank, BoundingBox const &box, long nbPoints)
+{
+  for (double bound : box) {
+    if (!std::isfinite(bound)) {
+      throw std::invalid_argument("cannot sample points in an infinite box");
+    }
+  }
+  std::vector<std::array<double, 3>> points;
+  if (isEmpty(box)) {
+    return points;
+  }
+  std::uniform_real_distribution<double> x(box[0], box[1]), y(box[2], box[3]), z(box[4], box[5]);
+  std::vector<double> point(3);
+  long tries = 0;
+  while (long(points.size()) < nbPoints && tries < maxTries * nbPoints) {
+    ++tries;
+    point[0] = x(generator);
+    point[1] = y(generator);
+    point[2] = z(generator);
+    if (t4Geom.whichVolume(point) == rank) {
+      points.push_back({{point[0], point[1], point[2]}});
+    }
+  }
+  return points;
+}
+
+void GapSource::writeSDEF(std::ostream &stream, std::vector<std::array<double, 3>> const &points,
+                          std::vector<std::string> const &comments)
+{
+  if (points.empty()) {
+    throw std::invalid_argument("no source point to write");
+  }
+  for (auto const &comment : comments) {
+    stream << "c " << comment << "\n";
+  }
+  stream << "sdef pos=d1\n";
+  stream << "si1 l";
+  std::ostringstream line;
+  line << std::setprecision(10);
+  for (size_t i = 0; i < points.size(); ++i) {
+    line.str("");
+    line << points[i][0] << " " << points[i][1] << " " << points[i][2];
+    stream << (i == 0 ? " " : "     ") << line.str() << "\n";
+  }
+  stream << "sp1";
+  for (size_t i = 0; i < points.size(); ++i) {
+    if (i > 0 && i % nbProbabilitiesPerLine == 0) {
+      stream << "\n    ";
+    }
+    stream << " 1";
+  }
+  stream << "\n";
+}
@@ -0,0 +1,742 @@
+/**
+ * @file GeometryComparison.cc
+ *
+ *
+ * @brief GeometryComparison class
+ *
+ * @version 1.0
+ */
+
+#include "GeometryComparison.hh"
+#include "Log.hh"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+
+using namespace std;
+
+namespace
+{
+/// the number of failure clusters printed by finish(); the others go to the clusters file only
+constexpr size_t maxReportedClusters = 10;
+
+/// the box enclosing the bounded, non-fictive T4 volumes
+BoundingBox modelBounds(T4Geometry const &t4Geom)
+{
+  CSGBytecode const *csg = t4Geom.getBytecode();
+  if (!csg) {
+    throw std::runtime_error("the bounds of the heat map require --heat-map-box, or a bytecode (--bytecode or "
+                             "--backend native)");
+  }
+  BoundingBox bounds = emptyBox();
+  for (long rank = 0; rank < csg->getNbVolumes(); ++rank) {
+    BoundingBox const &box = csg->getBoundingBox(rank);
+    if (!csg->isFictive(rank) && !isEmpty(box)
+        && std::all_of(box.begin(), box.end(), [](double bound) { return std::isfinite(bound); })) {
+      bounds = uniteBoxes(bounds, box);
+    }
+  }
+  if (isEmpty(bounds)) {
+    throw std::runtime_error("no T4 volume is bounded: the heat map requires --heat-map-box");
+  }
+  return bounds;
+}
+} // namespace
+
+GeometryComparison::GeometryComparison(string const &t4Filename, OptionsCompare const &options,
+                                       MCNPGeometry const &mcnpGeom, EventLog *events, T4Geometry *geometry) : options(options),
+                                                                                                               mcnpGeom(mcnpGeom),
+                                                                                                               events(events),
+                                                                                                               t4Filename(t4Filename),
+                                                                                                               ownT4Geom(geometry ? nullptr : new T4Geometry(t4Filename, options.backend)),
+                                                                                                               t4Geom(geometry ? *geometry : *ownT4Geom),
+                                                                                                               reuseDistances(false),
+                                                                                                               nbReused(0),
+                                                                                                               nbLocated(0),
+                                                                                                               nbCrossCheckMismatches(0),
+                                                                                                               nbBytecodeMismatches(0),
+                                                                                                               nbInteriorPoints(0),
+                                                                                                               nbPoints(0),
+                                                                                                               nbRecords(0),
+                                                                                                               nbSegments(0),
+                                                                                                               trackLength(0.),
+                                                                                                               failedLength(0.),
+                                                                                                               done(false)
+{
+  if (geometry) {
+    if (geometry->getBackend() != options.backend) {
+      throw std::runtime_error("the T4 geometry of " + t4Filename + " was read with another backend");
+    }
+    // the associations guessed by a previous comparison must not leak into this one
+    geometry->clearEquivalences();
+  }
+  if (options.crossCheck) {
+    crossCheckGeom.reset(new T4Geometry(t4Filename, T4Backend::NATIVE));
+  }
+  if (options.bytecode) {
+    t4Geom.compileBytecode();
+  }
+  t4Geom.setDistanceMethod(options.distanceMethod);
+  if (options.voxelGrid) {
+    t4Geom.setupVoxelCache(*options.voxelBox, *options.voxelGrid, options.voxelRefine,
+                           options.voxelThreads, options.voxelCachePath);
+  }
+
+  stats.setNbT4Volumes(t4Geom.getNbVolumes());
+  if (options.streamFailures) {
+    stats.streamFailures(getOutputRawName(options, this->t4Filename) + ".failures", options.resume);
+  }
+
+  if (!options.guessMaterialAssocs) {
+    for (auto const &compo_name : t4Geom.getCompoNames()) {
+      auto pos = compo_name.find_first_of("_");
+      std::string index = compo_name.substr(1, pos - 1);
+      std::string density = compo_name.substr(pos + 1);
+      if (index == "0") {
+        density = "void";
+      } else {
+        density = compo_name.substr(pos + 1);
+      }
+      std::string mcnp_compo_name = index + "_" + density;
+      ORACLE_LOG(VERBOSE) << "associating MCNP material \"" << mcnp_compo_name << "\" --> T4 composition \""
+                          << compo_name << '"';
+      t4Geom.addEquivalence(mcnp_compo_name, compo_name);
+      writeAssociationEvent(mcnp_compo_name, compo_name, -1, nullptr);
+    }
+  }
+
+  if (options.sequential) {
+    sequentialTest.reset(new SequentialTest((*options.sequential)[0], (*options.sequential)[1]));
+  }
+  if (options.cellQuota) {
+    cellQuota.reset(new CellQuota(*options.cellQuota, mcnpGeom.getCellIDs()));
+  }
+  if (options.clusterSize) {
+    failureClusters.reset(new FailureClusters(*options.clusterSize, options.clusterRepresentatives));
+  }
+  if (options.heatMapGrid) {
+    heatMap.reset(new HeatMap(options.heatMapBox ? *options.heatMapBox : modelBounds(t4Geom), *options.heatMapGrid));
+  }
+  if (options.vtpFailures) {
+    failedPointCloud.reset(new PointCloudWriter(getOutputRawName(options, this->t4Filename) + ".failedpoints.vtp",
+                                                options.resume));
+  }
+  if (options.vtpAll) {
+    sampledPointCloud.reset(new PointCloudWriter(getOutputRawName(options, this->t4Filename) + ".sampledpoints.vtp",
+                                                 options.resume));
+  }
+
+  if (!options.saveResults.empty() || !options.reuseResults.empty()) {
+    CSGBytecode const *csg = t4Geom.getBytecode();
+    if (!csg) {
+      throw std::invalid_argument("the per-point results require a bytecode");
+    }
+    std::vector<uint64_t> const signatures = csg->getSignatures();
+    std::vector<std::string> const compoNames = t4Geom.getCompoNames();
+    for (size_t i = 0; i < compoNames.size(); ++i) {
+      compoIndex[compoNames[i]] = i;
+    }
+    if (!options.reuseResults.empty()) {
+      previousResults.reset(new ResultStore(options.reuseResults));
+      std::vector<bool> fictive(signatures.size());
+      for (size_t rank = 0; rank < signatures.size(); ++rank) {
+        fictive[rank] = csg->isFictive(rank);
+      }
+      geometryDiff.reset(new GeometryDiff(previousResults->getSignatures(), signatures, fictive));
+      // the distances only depend on the volume, as long as they are computed the same way
+      reuseDistances = previousResults->getDistanceMethod() == options.distanceMethod;
+      ORACLE_LOG(INFO) << t4Filename << ": " << geometryDiff->getChangedRanks().size()
+                       << " volumes changed or added since " << options.reuseResults;
+    }
+    if (!options.saveResults.empty()) {
+      results.reset(new ResultStore(signatures, compoNames, options.distanceMethod));
+    }
+  }
+}
+
+void GeometryComparison::compare(PTRACRecord const &record)
+{
+  LogGroup group;
+  ++nbRecords;
+  if (done) {
+    return;
+  }
+  ++nbPoints;
+
+  auto const &point = record.point;
+  if (cellQuota && cellQuota->isFull(record.cellID)) {
+    stats.incrementSkipped();
+    return;
+  }
+  ResultStore::Entry const *previous = previousResults ? previousResults->find(nbRecords) : nullptr;
+  if (previous && previous->pointID != record.pointID) {
+    throw std::runtime_error(options.reuseResults + " was not saved from the same PTRAC points");
+  }
+  bool const reused = previous && canReuse(*previous, point);
+  long rank = reused ? previous->rank : -1;
+  bool located = reused;
+  double storedDistance = -1.;
+  if (reused) {
+    if (reuseDistances) {
+      storedDistance = previous->distance;
+    }
+    ++nbReused;
+  }
+  if (options.shell) {
+    // conversion errors show up near the surfaces: skip most of the points
+    // deep inside a volume; the voxel cache recognises them before they are
+    // located, the distance bound of the bytecode after
+    bool interior = t4Geom.voxelDepth(point) > *options.shell;
+    if (!interior) {
+      if (!located) {
+        rank = t4Geom.whichVolume(point);
+        located = true;
+        ++nbLocated;
+      }
+      interior = rank >= 0 && t4Geom.quickDistanceFromSurface(point, rank) > *options.shell;
+    }
+    if (interior && (options.shellInterior == 0 || ++nbInteriorPoints % options.shellInterior != 0)) {
+      stats.incrementSkipped();
+      return;
+    }
+  }
+  if (!located) {
+    rank = t4Geom.whichVolume(point);
+    ++nbLocated;
+  }
+  std::string compo = t4Geom.getCompoName(rank);
+
+  if (crossCheckGeom) {
+    long const nativeRank = crossCheckGeom->whichVolume(point);
+    if (nativeRank != rank) {
+      ++nbCrossCheckMismatches;
+      ORACLE_LOG(VERBOSE) << "Cross-check mismatch at position: (" << point[0] << ", " << point[1] << ", " << point[2]
+                          << "); T4 rank: " << rank << "   native rank: " << nativeRank;
+    }
+  }
+
+  stats.recordLocation(record.cellID, rank >= 0 ? t4Geom.getVolumeNumber(rank) : -1);
+
+  ResultStore::Verdict verdict = ResultStore::Verdict::SUCCESS;
+  double distance = -1.;
+  if (rank < 0) {
+    stats.incrementOutside();
+    verdict = ResultStore::Verdict::OUTSIDE;
+  } else {
+    stats.recordCoveredRank(rank);
+
+    unsigned long cID = record.cellID;
+    std::string materialDensityKey = mcnpGeom.getCellDensity(cID);
+    if (!t4Geom.materialInMap(materialDensityKey) && options.guessMaterialAssocs) {
+      ORACLE_LOG(VERBOSE) << "at point: (" << point[0] << ", " << point[1] << ", " << point[2]
+                          << "); associating MCNP material \"" << materialDensityKey << "\" (cell ID " << cID
+                          << ") --> T4 composition \"" << compo << '"';
+      t4Geom.addEquivalence(materialDensityKey, compo);
+      writeAssociationEvent(materialDensityKey, compo, cID, &point);
+      stats.incrementSuccess();
+      if (cellQuota) {
+        cellQuota->recordSuccess(cID);
+      }
+    } else {
+      if (t4Geom.weakEquivalence(materialDensityKey, compo)) {
+        stats.incrementSuccess();
+        if (cellQuota) {
+          cellQuota->recordSuccess(cID);
+        }
+      } else {
+        double const dist = storedDistance >= 0. ? storedDistance : t4Geom.distanceFromSurface(point, rank);
+        distance = dist;
+        if (dist <= options.delta) {
+          stats.incrementIgnore(dist);
+          verdict = ResultStore::Verdict::IGNORED;
+        } else {
+          if (options.bytecode && t4Geom.whichVolumeReference(point) != rank) {
+            // slow-path check of the bytecode on the failed points
+            ++nbBytecodeMismatches;
+            ORACLE_LOG(WARNING) << "Warning: the bytecode and the T4 library disagree at position: ("
+                                << point[0] << ", " << point[1] << ", " << point[2] << ")";
+          }
+          int64_t const pID = record.pointID;
+          int mID = record.materialID;
+          stats.incrementFailure();
+          stats.recordFailure(point, rank, pID, cID, mID, dist);
+          recordCluster(point, rank, compo, cID, mID, pID, dist);
+          writeFailureEvent(point, rank, compo, cID, mID, materialDensityKey, pID, dist);
+          verdict = ResultStore::Verdict::FAILURE;
+          ORACLE_LOG(VERBOSE) << "Failed tests at position: \n"
+                              << "x = " << point[0] << "\n"
+                              << "y = " << point[1] << "\n"
+                              << "z = " << point[2] << "\n"
+                              << "T4 rank: " << rank << "   T4 compo: " << compo << "\n"
+                              << "MCNP cellID: " << record.cellID << "   MCNP compo: " << materialDensityKey;
+        }
+      }
+    }
+  }
+
+  recordPoint(point, record.pointID, record.cellID, record.materialID, rank, distance, verdict);
+  if (results) {
+    auto const found = compoIndex.find(compo);
+    long const compoID = rank >= 0 && found != compoIndex.end() ? found->second : -1;
+    results->add({nbRecords, record.pointID, rank, compoID, verdict, distance});
+  }
+
+  updateStoppingRules();
+}
+
+namespace
+{
+/// the first event type of the bank events, and the last one
+constexpr long firstBankEvent = 2000;
+constexpr long lastBankEvent = 2999;
+constexpr long terminationEvent = 5000;
+
+/// maximum number of T4 volumes crossed by one segment
+constexpr int maxSegmentStretches = 100000;
+} // namespace
+
+void GeometryComparison::compareTrack(std::vector<PTRACRecord> const &history)
+{
+  LogGroup group;
+  ++nbRecords;
+  if (done) {
+    return;
+  }
+  ++nbPoints;
+
+  for (size_t i = 0; i + 1 < history.size(); ++i) {
+    PTRACRecord const &start = history[i];
+    long const nextEvent = history[i + 1].eventID;
+    if (start.eventID == terminationEvent || (nextEvent >= firstBankEvent && nextEvent <= lastBankEvent)) {
+      continue;
+    }
+    walkSegment(start, history[i + 1].point);
+  }
+
+  updateStoppingRules();
+}
+
+void GeometryComparison::walkSegment(PTRACRecord const &start, std::vector<double> const &end)
+{
+  std::vector<double> dir = {end[0] - start.point[0], end[1] - start.point[1], end[2] - start.point[2]};
+  double const length = std::sqrt(dir[0] * dir[0] + dir[1] * dir[1] + dir[2] * dir[2]);
+  // the same tolerance as the ray casts of the native evaluator
+  double const eps = 1e-10 * (1. + length);
+  if (length <= eps) {
+    return;
+  }
+  if (cellQuota && cellQuota->isFull(start.cellID)) {
+    stats.incrementSkipped();
+    return;
+  }
+  for (auto &component : dir) {
+    component /= length;
+  }
+  ++nbSegments;
+  trackLength += length;
+
+  // from boundary to boundary; the stretches of the same volume are merged,
+  // since the T4 libraries may stop at a surface which does not bound it
+  double stretchBegin = 0.;
+  long stretchRank = -2;
+  double position = 0.;
+  for (int iStretch = 0; position < length - eps && iStretch < maxSegmentStretches; ++iStretch) {
+    double const probe = position + eps;
+    std::vector<double> const point = {start.point[0] + probe * dir[0],
+                                       start.point[1] + probe * dir[1],
+                                       start.point[2] + probe * dir[2]};
+    long const rank = t4Geom.whichVolume(point);
+    if (rank != stretchRank) {
+      if (stretchRank >= 0) {
+        compareStretch(start, dir, stretchBegin, position, stretchRank);
+      }
+      stretchBegin = position;
+      stretchRank = rank;
+    }
+    if (rank < 0) {
+      // there is no surface to walk to outside the geometry
+      stats.incrementOutside();
+      stats.recordLocation(start.cellID, -1);
+      recordPoint(point, start.pointID, start.cellID, start.materialID, -1, -1., ResultStore::Verdict::OUTSIDE);
+      return;
+    }
+    position = std::min(length, probe + t4Geom.nextSurfaceInDirection(rank, point, dir).first);
+  }
+  compareStretch(start, dir, stretchBegin, length, stretchRank);
+}
+
+void GeometryComparison::compareStretch(PTRACRecord const &start, std::vector<double> const &dir, double begin,
+                                        double end, long rank)
+{
+  double const middle = 0.5 * (begin + end);
+  std::vector<double> const point = {start.point[0] + middle * dir[0],
+                                     start.point[1] + middle * dir[1],
+                                     start.point[2] + middle * dir[2]};
+  std::string const compo = t4Geom.getCompoName(rank);
+  stats.recordCoveredRank(rank);
+
+  unsigned long const cID = start.cellID;
+  stats.recordLocation(cID, t4Geom.getVolumeNumber(rank));
+  std::string const materialDensityKey = mcnpGeom.getCellDensity(cID);
+  ResultStore::Verdict verdict = ResultStore::Verdict::SUCCESS;
+  double distance = -1.;
+  if (!t4Geom.materialInMap(materialDensityKey) && options.guessMaterialAssocs) {
+    ORACLE_LOG(VERBOSE) << "on track " << start.pointID << ": associating MCNP material \"" << materialDensityKey
+                        << "\" (cell ID " << cID << ") --> T4 composition \"" << compo << '"';
+    t4Geom.addEquivalence(materialDensityKey, compo);
+    writeAssociationEvent(materialDensityKey, compo, cID, &point);
+    stats.incrementSuccess();
+    if (cellQuota) {
+      cellQuota->recordSuccess(cID);
+    }
+  } else if (t4Geom.weakEquivalence(materialDensityKey, compo)) {
+    stats.incrementSuccess();
+    if (cellQuota) {
+      cellQuota->recordSuccess(cID);
+    }
+  } else if (end - begin <= 2. * options.delta) {
+    distance = 0.5 * (end - begin);
+    stats.incrementIgnore(distance);
+    verdict = ResultStore::Verdict::IGNORED;
+  } else {
+    double const halfLength = 0.5 * (end - begin);
+    distance = halfLength;
+    stats.incrementFailure();
+    verdict = ResultStore::Verdict::FAILURE;
+    stats.recordFailure(point, rank, start.pointID, cID, start.materialID, halfLength);
+    recordCluster(point, rank, compo, cID, start.materialID, start.pointID, halfLength);
+    writeFailureEvent(point, rank, compo, cID, start.materialID, materialDensityKey, start.pointID, halfLength);
+    failedLength += end - begin;
+    ORACLE_LOG(VERBOSE) << "Failed track stretch of length " << end - begin << " around position: \n"
+                        << "x = " << point[0] << "\n"
+                        << "y = " << point[1] << "\n"
+                        << "z = " << point[2] << "\n"
+                        << "T4 rank: " << rank << "   T4 compo: " << compo << "\n"
+                        << "MCNP cellID: " << cID << "   MCNP compo: " << materialDensityKey;
+  }
+  recordPoint(point, start.pointID, cID, start.materialID, rank, distance, verdict);
+}
+
+void GeometryComparison::recordPoint(std::vector<double> const &point, int64_t pointID, long cellID, long materialID,
+                                     long rank, double dist, ResultStore::Verdict verdict)
+{
+  if (heatMap) {
+    heatMap->add(point, verdict);
+  }
+  if (failedPointCloud && verdict == ResultStore::Verdict::FAILURE) {
+    failedPointCloud->add({point[0], point[1], point[2]}, pointID, cellID, materialID, rank, dist, verdict);
+  }
+  if (sampledPointCloud) {
+    sampledPointCloud->add({point[0], point[1], point[2]}, pointID, cellID, materialID, rank, dist, verdict);
+  }
+}
+
+void GeometryComparison::recordCluster(std::vector<double> const &point, long rank, std::string const &compo,
+                                       long cellID, long materialID, int64_t pointID, double dist)
+{
+  if (failureClusters) {
+    failureClusters->add({cellID, materialID, t4Geom.getVolumeNumber(rank), compo}, {point[0], point[1], point[2]},
+                         pointID, dist);
+  }
+}
+
+void GeometryComparison::writeFailureEvent(std::vector<double> const &point, long rank, std::string const &compo,
+                                           long cellID, long materialID, std::string const &materialDensityKey,
+                                           int64_t pointID, double dist)
+{
+  if (events) {
+    events->write(EventRecord("failure")
+                    .add("t4_file", t4Filename)
+                    .add("x", point[0])
+                    .add("y", point[1])
+                    .add("z", point[2])
+                    .add("point_id", pointID)
+                    .add("cell_id", cellID)
+                    .add("material_id", materialID)
+                    .add("mcnp_material", materialDensityKey)
+                    .add("rank", rank)
+                    .add("volume", t4Geom.getVolumeNumber(rank))
+                    .add("composition", compo)
+                    .add("distance", dist));
+  }
+}
+
+void GeometryComparison::writeAssociationEvent(std::string const &materialDensityKey, std::string const &compo,
+                                               long cellID, std::vector<double> const *point)
+{
+  if (!events) {
+    return;
+  }
+  EventRecord record("association");
+  record.add("t4_file", t4Filename)
+    .add("mcnp_material", materialDensityKey)
+    .add("composition", compo)
+    .add("guessed", point != nullptr);
+  if (point) {
+    record.add("cell_id", cellID).add("x", (*point)[0]).add("y", (*point)[1]).add("z", (*point)[2]);
+  }
+  events->write(record);
+}
+
+void GeometryComparison::updateStoppingRules()
+{
+  if (sequentialTest && sequentialTest->update(stats.getNbTested(), stats.getNbFailure()) != SequentialTest::Verdict::CONTINUE) {
+    ORACLE_LOG(INFO) << t4Filename << ": sequential test conclusive after " << nbPoints << " points";
+    done = true;
+  }
+  if (cellQuota && cellQuota->allFull()) {
+    ORACLE_LOG(INFO) << t4Filename << ": all the MCNP cells reached their quota after " << nbPoints << " points";
+    done = true;
+  }
+}
+
+void GeometryComparison::skip()
+{
+  ++nbRecords;
+  if (!done) {
+    stats.incrementSkipped();
+  }
+}
+
+bool GeometryComparison::isDone() const
+{
+  return done;
+}
+
+void GeometryComparison::finish(bool resumable)
+{
+  stats.closeFailureSink();
+  if (sequentialTest) {
+    stats.recordSequentialTest(*sequentialTest);
+  }
+  if (options.bytecode) {
+    ORACLE_LOG(INFO) << "Number of FAILED points located differently by the bytecode and the T4 library: "
+                     << nbBytecodeMismatches;
+  }
+  if (cellQuota) {
+    std::vector<long> const underSampled = cellQuota->getUnderSampledCells();
+    ORACLE_LOG(INFO) << "Number of MCNP cells with fewer than " << cellQuota->getQuota()
+                     << " successful points: " << underSampled.size();
+    for (long cellID : underSampled) {
+      ORACLE_LOG(VERBOSE) << "  under-sampled MCNP cell: " << cellID;
+    }
+  }
+  if (crossCheckGeom) {
+    ORACLE_LOG(INFO) << "Number of points located differently by the T4 library and the native evaluator: "
+                     << nbCrossCheckMismatches;
+  }
+  if (previousResults) {
+    ORACLE_LOG(INFO) << "Number of points whose T4 rank was reused from " << options.reuseResults << ": "
+                     << nbReused << " (located again: " << nbLocated << ")";
+  }
+  if (nbSegments > 0) {
+    ORACLE_LOG(INFO) << "Number of track segments walked: " << nbSegments << " (total length " << trackLength
+                     << ", failed length " << failedLength << ")";
+  }
+  if (failureClusters) {
+    failureClusters->report(LogMessage(LogLevel::INFO).stream(), maxReportedClusters);
+    std::string const rawname = getOutputRawName(options, t4Filename);
+    failureClusters->write(rawname);
+    ORACLE_LOG(INFO) << "Failure clusters written to " << rawname << ".clusters, representative points to "
+                     << rawname << ".representatives";
+  }
+  if (heatMap) {
+    std::string const path = getOutputRawName(options, t4Filename) + ".heatmap.vti";
+    heatMap->write(path);
+    LogMessage message(LogLevel::INFO);
+    message.stream() << "Heat map written to " << path;
+    if (heatMap->getNbOutsideMesh() > 0) {
+      message.stream() << " (" << heatMap->getNbOutsideMesh() << " points outside the mesh)";
+    }
+  }
+  for (PointCloudWriter *cloud : {failedPointCloud.get(), sampledPointCloud.get()}) {
+    if (cloud) {
+      cloud->close(resumable);
+      ORACLE_LOG(INFO) << cloud->getNbPoints() << " points written to " << cloud->getPath();
+    }
+  }
+  if (results) {
+    results->save(options.saveResults);
+    ORACLE_LOG(INFO) << "Per-point results saved to " << options.saveResults;
+  }
+}
+
+void GeometryComparison::saveState(ostream &stream)
+{
+  if (t4Hash.empty()) {
+    t4Hash = t4Geom.getFileHash();
+  }
+  stream << "comparison " << t4Hash << "\n";
+  stream << "counters " << nbCrossCheckMismatches << " " << nbBytecodeMismatches << " " << nbInteriorPoints << " "
+         << nbPoints << " " << nbRecords << " " << done << " " << nbReused << " " << nbLocated << "\n";
+  stream << "tracks " << nbSegments << " " << setprecision(17) << trackLength << " " << failedLength << "\n";
+  auto const &equivalences = t4Geom.getEquivalences();
+  stream << "equivalences " << equivalences.size() << "\n";
+  for (auto const &equivalence : equivalences) {
+    stream << equivalence.first << " " << equivalence.second << "\n";
+  }
+  stream << "sequential " << bool(sequentialTest) << "\n";
+  if (sequentialTest) {
+    sequentialTest->saveState(stream);
+  }
+  stream << "quota " << bool(cellQuota) << "\n";
+  if (cellQuota) {
+    cellQuota->saveState(stream);
+  }
+  stream << "results " << bool(results) << "\n";
+  if (results) {
+    results->save(stream);
+  }
+  stream << "clusters " << bool(failureClusters) << "\n";
+  if (failureClusters) {
+    failureClusters->saveState(stream);
+  }
+  stream << "heatmap " << bool(heatMap) << "\n";
+  if (heatMap) {
+    heatMap->saveState(stream);
+  }
+  for (PointCloudWriter *cloud : {failedPointCloud.get(), sampledPointCloud.get()}) {
+    stream << "vtp " << bool(cloud) << "\n";
+    if (cloud) {
+      cloud->saveState(stream);
+    }
+  }
+  FailureSink *const failureSink = stats.getFailureSink();
+  stream << "stream " << bool(failureSink) << "\n";
+  if (failureSink) {
+    failureSink->saveState(stream);
+  }
+  stats.save(stream);
+}
+
+void GeometryComparison::restoreState(istream &stream)
+{
+  string word, hash;
+  stream >> word >> hash;
+  if (!stream || word != "comparison") {
+    throw runtime_error("malformed checkpoint for " + t4Filename);
+  }
+  if (t4Hash.empty()) {
+    t4Hash = t4Geom.getFileHash();
+  }
+  if (hash != t4Hash) {
+    throw runtime_error(t4Filename + " changed since the checkpoint was written");
+  }
+  stream >> word >> nbCrossCheckMismatches >> nbBytecodeMismatches >> nbInteriorPoints >> nbPoints >> nbRecords
+         >> done >> nbReused >> nbLocated;
+  stream >> word >> nbSegments >> trackLength >> failedLength;
+  size_t nbEquivalences = 0;
+  stream >> word >> nbEquivalences;
+  for (size_t i = 0; i < nbEquivalences && stream; ++i) {
+    string materialDensityKey, compo;
+    stream >> materialDensityKey >> compo;
+    t4Geom.addEquivalence(materialDensityKey, compo);
+  }
+  bool saved = false;
+  stream >> word >> saved;
+  if (!stream || saved != bool(sequentialTest)) {
+    throw runtime_error("the checkpoint was written with different --sequential options");
+  }
+  if (sequentialTest) {
+    sequentialTest->restoreState(stream);
+  }
+  stream >> word >> saved;
+  if (!stream || saved != bool(cellQuota)) {
+    throw runtime_error("the checkpoint was written with different --cell-quota options");
+  }
+  if (cellQuota) {
+    cellQuota->restoreState(stream);
+  }
+  stream >> word >> saved;
+  if (!stream || saved != bool(results)) {
+    throw runtime_error("the checkpoint was written with different --save-results options");
+  }
+  if (results) {
+    results.reset(new ResultStore(stream, "checkpoint"));
+  }
+  stream >> word >> saved;
+  if (!stream || saved != bool(failureClusters)) {
+    throw runtime_error("the checkpoint was written with different --cluster-failures options");
+  }
+  if (failureClusters) {
+    failureClusters->restoreState(stream);
+  }
+  stream >> word >> saved;
+  if (!stream || saved != bool(heatMap)) {
+    throw runtime_error("the checkpoint was written with different --heat-map options");
+  }
+  if (heatMap) {
+    heatMap->restoreState(stream);
+  }
+  for (PointCloudWriter *cloud : {failedPointCloud.get(), sampledPointCloud.get()}) {
+    stream >> word >> saved;
+    if (!stream || saved != bool(cloud)) {
+      throw runtime_error("the checkpoint was written with different --vtp and --vtp-all options");
+    }
+    if (cloud) {
+      cloud->restoreState(stream);
+    }
+  }
+  FailureSink *const failureSink = stats.getFailureSink();
+  stream >> word >> saved;
+  if (!stream || saved != bool(failureSink)) {
+    throw runtime_error("the checkpoint was written with different --stream-failures options");
+  }
+  if (failureSink) {
+    failureSink->restoreState(stream);
+  }
+  stats.restore(stream, "checkpoint");
+}
+
+string GeometryComparison::getOutputRawName(OptionsCompare const &options, string const &t4Filename)
+{
+  string name = t4Filename;
+  string const rawname = Statistics::getRawFileName(name);
+  return options.outputDir.empty() ? rawname : options.outputDir + "/" + rawname;
+}
+
+string const &GeometryComparison::getFilename() const
+{
+  return t4Filename;
+}
+
+Statistics &GeometryComparison::getStatistics()
+{
+  return stats;
+}
+
+T4Geometry &GeometryComparison::getT4Geometry()
+{
+  return t4Geom;
+}
+
+unsigned long GeometryComparison::getNbReused() const
+{
+  return nbReused;
+}
+
+unsigned long GeometryComparison::getNbLocated() const
+{
+  return nbLocated;
+}
+
+bool GeometryComparison::canReuse(ResultStore::Entry const &previous, std::vector<double> const &point) const
+{
+  if (previous.rank >= 0 && !geometryDiff->isUnchanged(previous.rank)) {
+    return false;
+  }
+  // the rank is the first non-fictive volume containing the point: only the
+  // changed volumes before it may take the point over
+  CSGBytecode const *csg = t4Geom.getBytecode();
+  for (long rank : geometryDiff->getChangedRanks()) {
+    if (previous.rank >= 0 && rank > previous.rank) {
+      break;
+    }
+    if (csg->contains(rank, point[0], point[1], point[2])) {
+      return false;
+    }
+  }
+  return true;
+}
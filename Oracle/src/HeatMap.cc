@@ -0,0 +1,183 @@
+/**
+ * @file HeatMap.cc
+ *
+ *
+ * @brief HeatMap class
+ *
+ * @version 1.0
+ */
+
+#include "HeatMap.hh"
+#include "VTKFormat.hh"
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <stdexcept>
+
+using namespace std;
+
+namespace
+{
+void increment(uint32_t &count)
+{
+  // saturate rather than wrap around
+  if (count != numeric_limits<uint32_t>::max()) {
+    ++count;
+  }
+}
+} // namespace
+
+HeatMap::HeatMap(BoundingBox const &box, array<long, 3> const &dims) : box(box),
+                                                                      dims(dims),
+                                                                      nbOutsideMesh(0)
+{
+  for (int i = 0; i < 3; ++i) {
+    if (!(box[2 * i] < box[2 * i + 1]) || std::isinf(box[2 * i]) || std::isinf(box[2 * i + 1])) {
+      throw runtime_error("the box of the heat map must be finite and not empty");
+    }
+    if (dims[i] <= 0) {
+      throw runtime_error("the number of cells of the heat map must be positive");
+    }
+    spacing[i] = (box[2 * i + 1] - box[2 * i]) / dims[i];
+  }
+  size_t const nbCells = dims[0] * dims[1] * dims[2];
+  sampled.assign(nbCells, 0);
+  failed.assign(nbCells, 0);
+  ignored.assign(nbCells, 0);
+}
+
+long HeatMap::cellIndex(vector<double> const &point) const
+{
+  long index[3];
+  for (int i = 0; i < 3; ++i) {
+    if (!(point[i] >= box[2 * i] && point[i] <= box[2 * i + 1])) {
+      return -1;
+    }
+    // the upper bound belongs to the last cell
+    index[i] = min(dims[i] - 1, long((point[i] - box[2 * i]) / spacing[i]));
+  }
+  return index[0] + dims[0] * (index[1] + dims[1] * index[2]);
+}
+
+void HeatMap::add(vector<double> const &point, ResultStore::Verdict verdict)
+{
+  long const index = cellIndex(point);
+  if (index < 0) {
+    ++nbOutsideMesh;
+    return;
+  }
+  increment(sampled[index]);
+  if (verdict == ResultStore::Verdict::FAILURE) {
+    increment(failed[index]);
+  } else if (verdict == ResultStore::Verdict::IGNORED) {
+    increment(ignored[index]);
+  }
+}
+
+void HeatMap::saveState(ostream &stream) const
+{
+  size_t nbCounted = 0;
+  for (uint32_t count : sampled) {
+    nbCounted += count > 0;
+  }
+  stream << sampled.size() << " " << nbCounted << " " << nbOutsideMesh << "\n";
+  // a failed or ignored point is always sampled too
+  for (size_t i = 0; i < sampled.size(); ++i) {
+    if (sampled[i] > 0) {
+      stream << i << " " << sampled[i] << " " << failed[i] << " " << ignored[i] << "\n";
+    }
+  }
+}
+
+void HeatMap::restoreState(istream &stream)
+{
+  size_t nbCells = 0, nbCounted = 0;
+  stream >> nbCells >> nbCounted >> nbOutsideMesh;
+  if (!stream || nbCells != sampled.size()) {
+    throw runtime_error("malformed heat map state");
+  }
+  sampled.assign(nbCells, 0);
+  failed.assign(nbCells, 0);
+  ignored.assign(nbCells, 0);
+  for (size_t i = 0; i < nbCounted; ++i) {
+    size_t index = 0;
+    stream >> index;
+    if (!stream || index >= nbCells) {
+      throw runtime_error("malformed heat map state");
+    }
+    stream >> sampled[index] >> failed[index] >> ignored[index];
+  }
+  if (!stream) {
+    throw runtime_error("malformed heat map state");
+  }
+}
+
+BoundingBox const &HeatMap::getBox() const
+{
+  return box;
+}
+
+array<long, 3> const &HeatMap::getDims() const
+{
+  return dims;
+}
+
+vector<uint32_t> const &HeatMap::getSampled() const
+{
+  return sampled;
+}
+
+vector<uint32_t> const &HeatMap::getFailed() const
+{
+  return failed;
+}
+
+vector<uint32_t> const &HeatMap::getIgnored() const
+{
+  return ignored;
+}
+
+long HeatMap::getNbOutsideMesh() const
+{
+  return nbOutsideMesh;
+}
+
+void HeatMap::write(string const &path) const
+{
+  ofstream file(path, ios_base::binary);
+  if (!file) {
+    throw runtime_error("cannot write the heat map to " + path);
+  }
+  vector<pair<char const *, vector<uint32_t> const *>> const arrays = {
+    {"sampled", &sampled}, {"failed", &failed}, {"ignored", &ignored}};
+  uint64_t const nbBytes = sampled.size() * sizeof(uint32_t);
+
+  file << "<?xml version=\"1.0\"?>\n"
+       << "<VTKFile type=\"ImageData\" version=\"1.0\" byte_order=\""
+       << vtkByteOrder() << "\" header_type=\"UInt64\">\n";
+  file << setprecision(17);
+  string const extent = "0 " + to_string(dims[0]) + " 0 " + to_string(dims[1]) + " 0 " + to_string(dims[2]);
+  file << "  <ImageData WholeExtent=\"" << extent << "\" Origin=\"" << box[0] << " " << box[2] << " " << box[4]
+       << "\" Spacing=\"" << spacing[0] << " " << spacing[1] << " " << spacing[2] << "\">\n"
+       << "    <Piece Extent=\"" << extent << "\">\n"
+       << "      <CellData Scalars=\"failed\">\n";
+  for (size_t i = 0; i < arrays.size(); ++i) {
+    file << "        <DataArray type=\"UInt32\" Name=\"" << arrays[i].first << "\" format=\"appended\" offset=\""
+         << i * (sizeof(uint64_t) + nbBytes) << "\"/>\n";
+  }
+  file << "      </CellData>\n"
+       << "    </Piece>\n"
+       << "  </ImageData>\n"
+       << "  <AppendedData encoding=\"raw\">\n"
+       << "_";
+  for (auto const &item : arrays) {
+    file.write(reinterpret_cast<char const *>(&nbBytes), sizeof(nbBytes));
+    file.write(reinterpret_cast<char const *>(item.second->data()), nbBytes);
+  }
+  file << "\n  </AppendedData>\n"
+       << "</VTKFile>\n";
+  if (!file) {
+    throw runtime_error("cannot write the heat map to " + path);
+  }
+}
@@ -0,0 +1,191 @@
+/**
+ * @file Log.cc
+ *
+ *
+ * @brief Log, LogMessage and LogGroup classes
+ *
+ * @version 1.0
+ */
+
+#include "Log.hh"
+#include "BackgroundWriter.hh"
+#include <atomic>
+#include <iostream>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+/// the number of bytes waiting for the writer beyond which the threads wait for it
+constexpr size_t maxPendingBytes = 1 << 22;
+
+/// consecutive messages of a thread going to the same stream
+struct Chunk {
+  bool error;
+  string text;
+};
+
+/// the buffers handed over by the threads
+struct Batch {
+  vector<Chunk> chunks;
+  size_t size;
+};
+
+BackgroundWriter<Batch> &writer()
+{
+  static BackgroundWriter<Batch> instance(
+      [](Batch &batch) {
+        for (auto const &chunk : batch.chunks) {
+          (chunk.error ? cerr : cout).write(chunk.text.data(), chunk.text.size());
+        }
+      },
+      maxPendingBytes,
+      // flushing once the queue is empty keeps the output interactive without a flush per message
+      []() {
+        cout.flush();
+        cerr.flush();
+      },
+      [](Batch const &batch) { return batch.size; });
+  return instance;
+}
+
+/// the messages of one thread not handed to the writer yet
+struct ThreadBuffer {
+  Batch batch = {{}, 0};
+  /// the number of open LogGroups
+  int depth = 0;
+
+  void append(bool error, string const &text)
+  {
+    if (batch.chunks.empty() || batch.chunks.back().error != error) {
+      batch.chunks.push_back({error, string()});
+    }
+    batch.chunks.back().text += text;
+    batch.size += text.size();
+  }
+
+  void handOver()
+  {
+    if (!batch.chunks.empty()) {
+      writer().push(std::move(batch));
+      batch = {{}, 0};
+    }
+  }
+
+  ~ThreadBuffer()
+  {
+    handOver();
+  }
+};
+
+thread_local ThreadBuffer threadBuffer;
+
+atomic<int> currentLevel(static_cast<int>(LogLevel::INFO));
+
+/// gathers the characters written to Log::infoStream() into lines
+class LineBuffer : public streambuf
+{
+  string line;
+
+protected:
+  int overflow(int c) override
+  {
+    if (c == traits_type::eof()) {
+      return traits_type::not_eof(c);
+    }
+    if (c == '\n') {
+      ORACLE_LOG(INFO) << line;
+      line.clear();
+    } else {
+      line += traits_type::to_char_type(c);
+    }
+    return c;
+  }
+};
+} // namespace
+
+void Log::setLevel(LogLevel level)
+{
+  currentLevel = static_cast<int>(level);
+}
+
+LogLevel Log::getLevel()
+{
+  return static_cast<LogLevel>(currentLevel.load());
+}
+
+bool Log::isEnabled(LogLevel level)
+{
+  return static_cast<int>(level) <= currentLevel.load(memory_order_relaxed);
+}
+
+void Log::write(LogLevel level, string const &text)
+{
+  if (!isEnabled(level)) {
+    return;
+  }
+  threadBuffer.append(level == LogLevel::ERROR, text);
+  if (threadBuffer.depth == 0) {
+    threadBuffer.handOver();
+  }
+}
+
+void Log::sync()
+{
+  if (threadBuffer.depth == 0) {
+    threadBuffer.handOver();
+  }
+  writer().drain();
+}
+
+ostream &Log::infoStream()
+{
+  static LineBuffer buffer;
+  static ostream stream(&buffer);
+  return stream;
+}
+
+void Log::openGroup()
+{
+  ++threadBuffer.depth;
+}
+
+void Log::closeGroup()
+{
+  if (--threadBuffer.depth == 0) {
+    threadBuffer.handOver();
+  }
+}
+
+LogMessage::LogMessage(LogLevel level) : level(level),
+                                         enabled(Log::isEnabled(level))
+{
+}
+
+LogMessage::~LogMessage()
+{
+  if (!enabled) {
+    return;
+  }
+  string message = text.str();
+  if (message.empty() || message.back() != '\n') {
+    message += '\n';
+  }
+  Log::write(level, message);
+}
+
+ostream &LogMessage::stream()
+{
+  return text;
+}
+
+LogGroup::LogGroup()
+{
+  Log::openGroup();
+}
+
+LogGroup::~LogGroup()
+{
+  Log::closeGroup();
+}
@@ -0,0 +1,1380 @@
+/**
+ * @file MCNPCells.cc
+ *
+ *
+ * @brief MCNPCellEvaluator class
+ *
+ * @version 1.0
+ */
+
+#include "MCNPCells.hh"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+
+namespace
+{
+constexpr double pi = 3.14159265358979323846;
+
+/// maximum number of nested FILL levels followed by whichCell()
+constexpr int maxFillDepth = 64;
+
+/// maximum length of a chain of LIKE n BUT cells
+constexpr int maxLikeDepth = 64;
+
+/**
+ * A cell program before the surfaces and the # complements of cells are
+ * resolved.
+ */
+struct RawInstruction {
+  enum Op { SURFACE, CELL, NOT, AND, OR } op;
+  /// surface or cell number
+  long number;
+  /// macrobody facet, or 0 for the whole surface
+  int facet;
+  /// sense of the surface
+  int sign;
+};
+
+struct RawCell {
+  long number;
+  long likeOf;
+  std::vector<RawInstruction> program;
+  long universe;
+  bool hasUniverse;
+  long fill;
+  bool hasFill;
+  /// TR card of the filling universe, or 0
+  long fillTR;
+  std::vector<double> fillEntries;
+  bool fillDegrees;
+  /// FILL given as an array of universes, for a lattice
+  bool fillArray;
+  bool lattice;
+  bool hasTrcl;
+  /// TR card of the TRCL parameter, or 0
+  long trclTR;
+  std::vector<double> trclEntries;
+  bool trclDegrees;
+};
+
+/// The inside (negative sense) of an MCNP surface: an intersection of half-spaces.
+struct MCNPSurface {
+  std::vector<std::pair<long, int>> inside;
+  /// for macrobodies, the facet number of each half-space; empty otherwise
+  std::vector<int> facets;
+};
+
+/// A surface card, kept to build the copies of the surfaces moved by TRCL.
+struct MCNPSurfaceCard {
+  std::string mnemonic;
+  std::vector<double> params;
+  bool hasTransform;
+  SurfaceTransform transform;
+};
+
+/// Raised for the surface types that the evaluator does not know.
+struct UnsupportedSurface : std::runtime_error {
+  using std::runtime_error::runtime_error;
+};
+
+using Vector = std::array<double, 3>;
+
+double dot(Vector const &u, Vector const &v)
+{
+  return u[0] * v[0] + u[1] * v[1] + u[2] * v[2];
+}
+
+Vector cross(Vector const &u, Vector const &v)
+{
+  return {u[1] * v[2] - u[2] * v[1], u[2] * v[0] - u[0] * v[2], u[0] * v[1] - u[1] * v[0]};
+}
+
+Vector scale(Vector const &u, double a)
+{
+  return {a * u[0], a * u[1], a * u[2]};
+}
+
+Vector combine(Vector const &u, double a, Vector const &v, double b)
+{
+  return {a * u[0] + b * v[0], a * u[1] + b * v[1], a * u[2] + b * v[2]};
+}
+
+std::string toLower(std::string word)
+{
+  std::transform(word.begin(), word.end(), word.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+  return word;
+}
+
+std::vector<std::string> splitWords(std::string const &text)
+{
+  std::istringstream iss(text);
+  std::vector<std::string> words;
+  std::string word;
+  while (iss >> word) {
+    words.push_back(word);
+  }
+  return words;
+}
+
+bool isBlank(std::string const &line)
+{
+  return line.find_first_not_of(" \t\r") == std::string::npos;
+}
+
+/// comment cards have a C in columns 1-5, followed by a blank
+bool isCommentLine(std::string const &line)
+{
+  auto const pos = line.find_first_not_of(' ');
+  if (pos == std::string::npos || pos > 4 || (line[pos] != 'c' && line[pos] != 'C')) {
+    return false;
+  }
+  return pos + 1 == line.size() || line[pos + 1] == ' ';
+}
+
+/**
+ * Splits an input deck in cards, for the cell, surface and data blocks.
+ * Comments are dropped, continuation lines (five leading blanks or a
+ * trailing &) are joined, and the cards are converted to lower case.
+ */
+std::array<std::vector<std::string>, 3> readBlocks(std::istream &stream)
+{
+  std::vector<std::string> lines;
+  std::string line;
+  while (std::getline(stream, line)) {
+    std::replace(line.begin(), line.end(), '\t', ' ');
+    line.erase(std::remove(line.begin(), line.end(), '\r'), line.end());
+    lines.push_back(line);
+  }
+
+  size_t i = 0;
+  if (!lines.empty() && toLower(lines[0]).compare(0, 8, "message:") == 0) {
+    while (i < lines.size() && !isBlank(lines[i])) {
+      ++i;
+    }
+    ++i;
+  }
+  // title card
+  ++i;
+
+  std::array<std::vector<std::string>, 3> blocks;
+  int block = 0;
+  bool continued = false;
+  for (; i < lines.size() && block < 3; ++i) {
+    line = lines[i];
+    if (isBlank(line)) {
+      ++block;
+      continued = false;
+      continue;
+    }
+    if (isCommentLine(line)) {
+      continue;
+    }
+    auto const dollar = line.find('$');
+    if (dollar != std::string::npos) {
+      line.erase(dollar);
+      if (isBlank(line)) {
+        continue;
+      }
+    }
+    line = toLower(line);
+    bool const continuation = continued || (line.find_first_not_of(' ') >= 5 && !blocks[block].empty());
+    auto const last = line.find_last_not_of(' ');
+    continued = line[last] == '&';
+    if (continued) {
+      line.erase(last);
+    }
+    if (continuation) {
+      blocks[block].back() += " " + line;
+    } else {
+      blocks[block].push_back(line);
+    }
+  }
+  return blocks;
+}
+
+bool parseLong(std::string const &word, long &value)
+{
+  if (word.empty()) {
+    return false;
+  }
+  char *end;
+  value = std::strtol(word.c_str(), &end, 10);
+  return *end == '\0';
+}
+
+long toLong(std::string const &word, std::string const &context)
+{
+  long value;
+  if (!parseLong(word, value)) {
+    throw std::runtime_error(context + ": invalid integer '" + word + "'");
+  }
+  return value;
+}
+
+double toDouble(std::string const &word, std::string const &context)
+{
+  char *end;
+  double value = std::strtod(word.c_str(), &end);
+  if (end != word.c_str() && *end == '\0') {
+    return value;
+  }
+  // FORTRAN-style exponent without the letter: 1.5-3 for 1.5e-3
+  auto const sign = word.find_last_of("+-");
+  if (sign != std::string::npos && sign > 0 && std::isdigit(static_cast<unsigned char>(word[sign - 1]))) {
+    std::string const fixed = word.substr(0, sign) + "e" + word.substr(sign);
+    value = std::strtod(fixed.c_str(), &end);
+    if (*end == '\0') {
+      return value;
+    }
+  }
+  throw std::runtime_error(context + ": invalid number '" + word + "'");
+}
+
+/**
+ * Builds a transformation from the entries of a TR card (or of a FILL
+ * parameter): displacement, rotation matrix (3, 6 or 9 entries) and M.
+ */
+SurfaceTransform makeTransform(std::vector<double> const &e, bool degrees, std::string const &context)
+{
+  size_t const n = e.size();
+  if (n != 3 && n != 9 && n != 12 && n != 13) {
+    throw std::runtime_error(context + ": unsupported number of transformation entries ("
+                             + std::to_string(n) + ")");
+  }
+  // b[3j + i]: cosine of the angle between the main axis i and the auxiliary axis j
+  std::array<double, 9> b = {1., 0., 0., 0., 1., 0., 0., 0., 1.};
+  if (n >= 9) {
+    size_t const nbCosines = n == 9 ? 6 : 9;
+    for (size_t k = 0; k < nbCosines; ++k) {
+      b[k] = degrees ? std::cos(e[3 + k] * pi / 180.) : e[3 + k];
+    }
+    if (n == 9) {
+      // the third auxiliary axis completes a right-handed frame
+      b[6] = b[1] * b[5] - b[2] * b[4];
+      b[7] = b[2] * b[3] - b[0] * b[5];
+      b[8] = b[0] * b[4] - b[1] * b[3];
+    }
+  }
+  SurfaceTransform transform;
+  // the columns of the rotation are the auxiliary axes
+  for (int i = 0; i < 3; ++i) {
+    for (int j = 0; j < 3; ++j) {
+      transform.rotation[3 * i + j] = b[3 * j + i];
+    }
+  }
+  double const m = n == 13 ? e[12] : 1.;
+  if (m == 1.) {
+    transform.translation = {{e[0], e[1], e[2]}};
+  } else if (m == -1.) {
+    // the displacement is the origin of the main frame in the auxiliary frame
+    for (int i = 0; i < 3; ++i) {
+      transform.translation[i] = 0.;
+      for (int j = 0; j < 3; ++j) {
+        transform.translation[i] -= transform.rotation[3 * i + j] * e[j];
+      }
+    }
+  } else {
+    throw std::runtime_error(context + ": M must be 1 or -1");
+  }
+  return transform;
+}
+
+/// the transformation applying inner, then outer
+SurfaceTransform compose(SurfaceTransform const &outer, SurfaceTransform const &inner)
+{
+  SurfaceTransform transform;
+  for (int i = 0; i < 3; ++i) {
+    transform.translation[i] = outer.translation[i];
+    for (int j = 0; j < 3; ++j) {
+      transform.translation[i] += outer.rotation[3 * i + j] * inner.translation[j];
+      transform.rotation[3 * i + j] = 0.;
+      for (int k = 0; k < 3; ++k) {
+        transform.rotation[3 * i + j] += outer.rotation[3 * i + k] * inner.rotation[3 * k + j];
+      }
+    }
+  }
+  return transform;
+}
+
+/**
+ * Adds an MCNP surface or macrobody to the table.
+ *
+ * @return the half-spaces whose intersection is the negative side of the
+ * surface; for macrobodies, one half-space per facet, in facet order.
+ */
+MCNPSurface addMCNPSurface(SurfaceTable &table, long number, std::string const &mnemonic,
+                           std::vector<double> const &p, SurfaceTransform const *transform)
+{
+  std::string const context = "MCNP surface " + std::to_string(number);
+  auto expect = [&](std::initializer_list<size_t> counts) {
+    if (std::find(counts.begin(), counts.end(), p.size()) == counts.end()) {
+      throw std::runtime_error(context + ": wrong number of parameters for " + mnemonic);
+    }
+  };
+  auto add = [&](SurfaceType type, std::vector<double> const &params, int side) {
+    return std::make_pair(table.addSurface(number, type, params, transform), side);
+  };
+  std::vector<int> facetNumbers;
+  auto addFacet = [&](int facet, SurfaceType type, std::vector<double> const &params, int side) {
+    facetNumbers.push_back(facet);
+    return std::make_pair(table.addSurface(-(10 * number + facet), type, params, transform), side);
+  };
+  auto macrobody = [&](std::vector<std::pair<long, int>> inside) {
+    return MCNPSurface{std::move(inside), facetNumbers};
+  };
+  auto cone = [&](SurfaceType type, SurfaceType sheetType, std::array<double, 3> const &apex, double t2, double sheetPosition, double sheet) {
+    if (!(t2 > 0.)) {
+      throw std::runtime_error(context + ": the cone parameter t^2 must be positive");
+    }
+    double const angle = std::atan(std::sqrt(t2)) * 180. / pi;
+    MCNPSurface surface{{add(type, {apex[0], apex[1], apex[2], angle}, -1)}, {}};
+    if (sheet != 0.) {
+      // one-sheet cone: the inside is also on one side of the apex
+      surface.inside.push_back(addFacet(1, sheetType, {sheetPosition}, sheet > 0. ? 1 : -1));
+    }
+    return surface;
+  };
+  auto plane = [](std::array<double, 3> const &n, std::array<double, 3> const &point) {
+    return std::vector<double>{n[0], n[1], n[2], -(n[0] * point[0] + n[1] * point[1] + n[2] * point[2])};
+  };
+  // a plane facet whose inside contains the point interior
+  auto planeFacet = [&](int facet, Vector const &n, Vector const &point, Vector const &interior) {
+    double const side = dot(n, combine(interior, 1., point, -1.));
+    if (side == 0.) {
+      throw std::runtime_error(context + ": degenerate " + mnemonic);
+    }
+    return addFacet(facet, SurfaceType::PLANE, plane(n, point), side > 0. ? 1 : -1);
+  };
+  // (x-c)^T M (x-c) - 1, with M the sum of the u u^T / |u|^4 over the semi-axes u
+  auto ellipticQuadric = [&](Vector const &c, std::initializer_list<Vector> semiAxes) {
+    std::array<double, 9> m = {0., 0., 0., 0., 0., 0., 0., 0., 0.};
+    for (auto const &u : semiAxes) {
+      double const length2 = dot(u, u);
+      if (!(length2 > 0.)) {
+        throw std::runtime_error(context + ": null semi-axis in " + mnemonic);
+      }
+      for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 3; ++j) {
+          m[3 * i + j] += u[i] * u[j] / (length2 * length2);
+        }
+      }
+    }
+    Vector const mc = {dot({m[0], m[1], m[2]}, c), dot({m[3], m[4], m[5]}, c), dot({m[6], m[7], m[8]}, c)};
+    return std::vector<double>{m[0], m[4], m[8], 2. * m[1], 2. * m[5], 2. * m[2],
+                               -2. * mc[0], -2. * mc[1], -2. * mc[2], dot(c, mc) - 1.};
+  };
+
+  if (mnemonic == "p") {
+    expect({4, 9});
+    if (p.size() == 4) {
+      return {{add(SurfaceType::PLANE, {p[0], p[1], p[2], -p[3]}, -1)}, {}};
+    }
+    // plane through three points
+    std::array<double, 3> const u = {p[3] - p[0], p[4] - p[1], p[5] - p[2]};
+    std::array<double, 3> const v = {p[6] - p[0], p[7] - p[1], p[8] - p[2]};
+    std::array<double, 3> n = {u[1] * v[2] - u[2] * v[1], u[2] * v[0] - u[0] * v[2], u[0] * v[1] - u[1] * v[0]};
+    if (n[0] == 0. && n[1] == 0. && n[2] == 0.) {
+      throw std::runtime_error(context + ": the three points are aligned");
+    }
+    double d = n[0] * p[0] + n[1] * p[1] + n[2] * p[2];
+    // the origin has the negative sense; otherwise (0,0,inf), (0,inf,0) or (inf,0,0) has the positive sense
+    bool const flip = d != 0. ? d < 0. : (n[2] != 0. ? n[2] < 0. : (n[1] != 0. ? n[1] < 0. : n[0] < 0.));
+    if (flip) {
+      n = {-n[0], -n[1], -n[2]};
+      d = -d;
+    }
+    return {{add(SurfaceType::PLANE, {n[0], n[1], n[2], -d}, -1)}, {}};
+  } else if (mnemonic == "px" || mnemonic == "py" || mnemonic == "pz") {
+    expect({1});
+    SurfaceType const type = mnemonic == "px" ? SurfaceType::PLANEX : (mnemonic == "py" ? SurfaceType::PLANEY : SurfaceType::PLANEZ);
+    return {{add(type, {p[0]}, -1)}, {}};
+  } else if (mnemonic == "so") {
+    expect({1});
+    return {{add(SurfaceType::SPHERE, {0., 0., 0., p[0]}, -1)}, {}};
+  } else if (mnemonic == "s") {
+    expect({4});
+    return {{add(SurfaceType::SPHERE, p, -1)}, {}};
+  } else if (mnemonic == "sx" || mnemonic == "sy" || mnemonic == "sz") {
+    expect({2});
+    std::vector<double> params = {0., 0., 0., p[1]};
+    params[mnemonic[1] - 'x'] = p[0];
+    return {{add(SurfaceType::SPHERE, params, -1)}, {}};
+  } else if (mnemonic == "c/x" || mnemonic == "c/y" || mnemonic == "c/z") {
+    expect({3});
+    SurfaceType const type = mnemonic == "c/x" ? SurfaceType::CYLX : (mnemonic == "c/y" ? SurfaceType::CYLY : SurfaceType::CYLZ);
+    return {{add(type, p, -1)}, {}};
+  } else if (mnemonic == "cx" || mnemonic == "cy" || mnemonic == "cz") {
+    expect({1});
+    SurfaceType const type = mnemonic == "cx" ? SurfaceType::CYLX : (mnemonic == "cy" ? SurfaceType::CYLY : SurfaceType::CYLZ);
+    return {{add(type, {0., 0., p[0]}, -1)}, {}};
+  } else if (mnemonic == "k/x" || mnemonic == "k/y" || mnemonic == "k/z") {
+    expect({4, 5});
+    int const axis = mnemonic[2] - 'x';
+    SurfaceType const type = axis == 0 ? SurfaceType::CONEX : (axis == 1 ? SurfaceType::CONEY : SurfaceType::CONEZ);
+    SurfaceType const sheetType = axis == 0 ? SurfaceType::PLANEX : (axis == 1 ? SurfaceType::PLANEY : SurfaceType::PLANEZ);
+    return cone(type, sheetType, {p[0], p[1], p[2]}, p[3], p[axis], p.size() == 5 ? p[4] : 0.);
+  } else if (mnemonic == "kx" || mnemonic == "ky" || mnemonic == "kz") {
+    expect({2, 3});
+    int const axis = mnemonic[1] - 'x';
+    SurfaceType const type = axis == 0 ? SurfaceType::CONEX : (axis == 1 ? SurfaceType::CONEY : SurfaceType::CONEZ);
+    SurfaceType const sheetType = axis == 0 ? SurfaceType::PLANEX : (axis == 1 ? SurfaceType::PLANEY : SurfaceType::PLANEZ);
+    std::array<double, 3> apex = {0., 0., 0.};
+    apex[axis] = p[0];
+    return cone(type, sheetType, apex, p[1], p[0], p.size() == 3 ? p[2] : 0.);
+  } else if (mnemonic == "sq") {
+    expect({10});
+    // A(x-x0)^2 + B(y-y0)^2 + C(z-z0)^2 + 2D(x-x0) + 2E(y-y0) + 2F(z-z0) + G
+    double const x0 = p[7], y0 = p[8], z0 = p[9];
+    double const constant = p[0] * x0 * x0 + p[1] * y0 * y0 + p[2] * z0 * z0
+                            - 2. * (p[3] * x0 + p[4] * y0 + p[5] * z0) + p[6];
+    return {{add(SurfaceType::QUAD, {p[0], p[1], p[2], 0., 0., 0.,
+                                     2. * (p[3] - p[0] * x0), 2. * (p[4] - p[1] * y0), 2. * (p[5] - p[2] * z0),
+                                     constant},
+                 -1)},
+            {}};
+  } else if (mnemonic == "gq") {
+    expect({10});
+    return {{add(SurfaceType::QUAD, p, -1)}, {}};
+  } else if (mnemonic == "tx" || mnemonic == "ty" || mnemonic == "tz") {
+    expect({6});
+    SurfaceType const type = mnemonic == "tx" ? SurfaceType::TORUSX : (mnemonic == "ty" ? SurfaceType::TORUSY : SurfaceType::TORUSZ);
+    return {{add(type, p, -1)}, {}};
+  } else if (mnemonic == "rpp") {
+    expect({6});
+    if (!(p[0] < p[1] && p[2] < p[3] && p[4] < p[5])) {
+      throw std::runtime_error(context + ": RPP bounds must be increasing");
+    }
+    return macrobody({addFacet(1, SurfaceType::PLANEX, {p[1]}, -1), addFacet(2, SurfaceType::PLANEX, {p[0]}, 1),
+                      addFacet(3, SurfaceType::PLANEY, {p[3]}, -1), addFacet(4, SurfaceType::PLANEY, {p[2]}, 1),
+                      addFacet(5, SurfaceType::PLANEZ, {p[5]}, -1), addFacet(6, SurfaceType::PLANEZ, {p[4]}, 1)});
+  } else if (mnemonic == "sph") {
+    expect({4});
+    return macrobody({addFacet(1, SurfaceType::SPHERE, p, -1)});
+  } else if (mnemonic == "rcc") {
+    expect({7});
+    std::array<double, 3> const base = {p[0], p[1], p[2]};
+    std::array<double, 3> const h = {p[3], p[4], p[5]};
+    std::array<double, 3> const top = {p[0] + p[3], p[1] + p[4], p[2] + p[5]};
+    return macrobody({addFacet(1, SurfaceType::CYL, {p[0], p[1], p[2], p[6], p[3], p[4], p[5]}, -1),
+                      addFacet(2, SurfaceType::PLANE, plane(h, top), -1),
+                      addFacet(3, SurfaceType::PLANE, plane(h, base), 1)});
+  } else if (mnemonic == "box") {
+    expect({12});
+    std::array<double, 3> const corner = {p[0], p[1], p[2]};
+    std::vector<std::pair<long, int>> inside;
+    for (int i = 0; i < 3; ++i) {
+      std::array<double, 3> const a = {p[3 + 3 * i], p[4 + 3 * i], p[5 + 3 * i]};
+      std::array<double, 3> const far = {corner[0] + a[0], corner[1] + a[1], corner[2] + a[2]};
+      inside.push_back(addFacet(2 * i + 1, SurfaceType::PLANE, plane(a, far), -1));
+      inside.push_back(addFacet(2 * i + 2, SurfaceType::PLANE, plane(a, corner), 1));
+    }
+    return macrobody(inside);
+  } else if (mnemonic == "rhp" || mnemonic == "hex") {
+    expect({9, 15});
+    Vector const base = {p[0], p[1], p[2]};
+    Vector const h = {p[3], p[4], p[5]};
+    Vector const r = {p[6], p[7], p[8]};
+    Vector s, t;
+    if (p.size() == 15) {
+      s = {p[9], p[10], p[11]};
+      t = {p[12], p[13], p[14]};
+    } else {
+      // regular hexagon: s and t are r rotated by 60 and 120 degrees around h
+      double const height = std::sqrt(dot(h, h));
+      if (height == 0.) {
+        throw std::runtime_error(context + ": null height vector");
+      }
+      Vector const w = scale(cross(h, r), 1. / height);
+      s = combine(r, 0.5, w, 0.5 * std::sqrt(3.));
+      t = combine(r, -0.5, w, 0.5 * std::sqrt(3.));
+    }
+    std::vector<std::pair<long, int>> inside;
+    int facet = 1;
+    for (Vector const &a : {r, s, t}) {
+      inside.push_back(addFacet(facet++, SurfaceType::PLANE, plane(a, combine(base, 1., a, 1.)), -1));
+      inside.push_back(addFacet(facet++, SurfaceType::PLANE, plane(a, combine(base, 1., a, -1.)), 1));
+    }
+    inside.push_back(addFacet(7, SurfaceType::PLANE, plane(h, combine(base, 1., h, 1.)), -1));
+    inside.push_back(addFacet(8, SurfaceType::PLANE, plane(h, base), 1));
+    return macrobody(inside);
+  } else if (mnemonic == "rec") {
+    expect({10, 12});
+    Vector const base = {p[0], p[1], p[2]};
+    Vector const h = {p[3], p[4], p[5]};
+    Vector const major = {p[6], p[7], p[8]};
+    Vector minor;
+    if (p.size() == 12) {
+      minor = {p[9], p[10], p[11]};
+    } else {
+      // the minor axis is perpendicular to the height and to the major axis
+      Vector const normal = cross(h, major);
+      double const length = std::sqrt(dot(normal, normal));
+      if (length == 0.) {
+        throw std::runtime_error(context + ": the major axis is parallel to the height");
+      }
+      minor = scale(normal, p[9] / length);
+    }
+    return macrobody({addFacet(1, SurfaceType::QUAD, ellipticQuadric(base, {major, minor}), -1),
+                      addFacet(2, SurfaceType::PLANE, plane(h, combine(base, 1., h, 1.)), -1),
+                      addFacet(3, SurfaceType::PLANE, plane(h, base), 1)});
+  } else if (mnemonic == "trc") {
+    expect({8});
+    Vector const base = {p[0], p[1], p[2]};
+    Vector const h = {p[3], p[4], p[5]};
+    double const r1 = p[6], r2 = p[7];
+    double const height = std::sqrt(dot(h, h));
+    if (height == 0. || r1 < 0. || r2 < 0. || (r1 == 0. && r2 == 0.)) {
+      throw std::runtime_error(context + ": invalid TRC parameters");
+    }
+    std::pair<long, int> side;
+    if (r1 == r2) {
+      side = addFacet(1, SurfaceType::CYL, {base[0], base[1], base[2], r1, h[0], h[1], h[2]}, -1);
+    } else {
+      // the other sheet of the cone lies beyond the apex, outside the two bases
+      Vector const apex = combine(base, 1., h, r1 / (r1 - r2));
+      double const angle = std::atan(std::fabs(r1 - r2) / height) * 180. / pi;
+      side = addFacet(1, SurfaceType::CONE, {apex[0], apex[1], apex[2], angle, h[0], h[1], h[2]}, -1);
+    }
+    return macrobody({side, addFacet(2, SurfaceType::PLANE, plane(h, combine(base, 1., h, 1.)), -1),
+                      addFacet(3, SurfaceType::PLANE, plane(h, base), 1)});
+  } else if (mnemonic == "ell") {
+    expect({7});
+    Vector const v1 = {p[0], p[1], p[2]};
+    Vector const v2 = {p[3], p[4], p[5]};
+    double const rm = p[6];
+    Vector centre, axis;
+    double major, minor;
+    if (rm > 0.) {
+      // v1 and v2 are the foci, rm the major radius
+      centre = combine(v1, 0.5, v2, 0.5);
+      axis = combine(v2, 1., v1, -1.);
+      double const focal = 0.5 * std::sqrt(dot(axis, axis));
+      major = rm;
+      minor = std::sqrt(rm * rm - focal * focal);
+      if (!(minor > 0.)) {
+        throw std::runtime_error(context + ": the major radius must exceed half the distance between the foci");
+      }
+      if (focal == 0.) {
+        axis = {1., 0., 0.};
+      }
+    } else if (rm < 0.) {
+      // v1 is the centre, v2 the major semi-axis, -rm the minor radius
+      centre = v1;
+      axis = v2;
+      major = std::sqrt(dot(v2, v2));
+      minor = -rm;
+    } else {
+      throw std::runtime_error(context + ": the ELL radius must not be zero");
+    }
+    // two minor semi-axes perpendicular to the major one
+    Vector const any = std::fabs(axis[0]) < std::fabs(axis[1]) ? Vector{1., 0., 0.} : Vector{0., 1., 0.};
+    Vector u = cross(axis, any);
+    u = scale(u, minor / std::sqrt(dot(u, u)));
+    Vector w = cross(axis, u);
+    w = scale(w, minor / std::sqrt(dot(w, w)));
+    double const length = std::sqrt(dot(axis, axis));
+    Vector const a = scale(axis, major / length);
+    return macrobody({addFacet(1, SurfaceType::QUAD, ellipticQuadric(centre, {a, u, w}), -1)});
+  } else if (mnemonic == "wed") {
+    expect({12});
+    Vector const vertex = {p[0], p[1], p[2]};
+    Vector const v1 = {p[3], p[4], p[5]};
+    Vector const v2 = {p[6], p[7], p[8]};
+    Vector const v3 = {p[9], p[10], p[11]};
+    Vector const interior = combine(combine(vertex, 1., combine(v1, 1., v2, 1.), 1. / 3.), 1., v3, 0.5);
+    return macrobody({planeFacet(1, cross(combine(v2, 1., v1, -1.), v3), combine(vertex, 1., v1, 1.), interior),
+                      planeFacet(2, cross(v1, v3), vertex, interior),
+                      planeFacet(3, cross(v2, v3), vertex, interior),
+                      planeFacet(4, cross(v1, v2), combine(vertex, 1., v3, 1.), interior),
+                      planeFacet(5, cross(v1, v2), vertex, interior)});
+  } else if (mnemonic == "arb") {
+    expect({30});
+    auto corner = [&](long k) {
+      if (k < 1 || k > 8) {
+        throw std::runtime_error(context + ": invalid ARB corner " + std::to_string(k));
+      }
+      return Vector{p[3 * (k - 1)], p[3 * (k - 1) + 1], p[3 * (k - 1) + 2]};
+    };
+    // a facet is given by four digits, the numbers of its corners; 0 for an unused facet
+    std::array<long, 6> descriptors;
+    std::array<bool, 8> used = {false, false, false, false, false, false, false, false};
+    Vector interior = {0., 0., 0.};
+    int nbUsed = 0;
+    for (int j = 0; j < 6; ++j) {
+      descriptors[j] = std::lround(p[24 + j]);
+      if (descriptors[j] < 0 || descriptors[j] > 8888) {
+        throw std::runtime_error(context + ": invalid ARB facet " + std::to_string(descriptors[j]));
+      }
+      for (long d = descriptors[j]; d > 0; d /= 10) {
+        long const k = d % 10;
+        if (k > 0 && !used[k - 1]) {
+          used[k - 1] = true;
+          interior = combine(interior, 1., corner(k), 1.);
+          ++nbUsed;
+        }
+      }
+    }
+    if (nbUsed < 4) {
+      throw std::runtime_error(context + ": an ARB needs at least four corners");
+    }
+    interior = scale(interior, 1. / nbUsed);
+    std::vector<std::pair<long, int>> inside;
+    for (int j = 0; j < 6; ++j) {
+      if (descriptors[j] == 0) {
+        continue;
+      }
+      Vector const a = corner(descriptors[j] / 1000), b = corner(descriptors[j] / 100 % 10),
+                   c = corner(descriptors[j] / 10 % 10);
+      inside.push_back(planeFacet(j + 1, cross(combine(b, 1., a, -1.), combine(c, 1., a, -1.)), a, interior));
+    }
+    return macrobody(inside);
+  }
+  throw UnsupportedSurface(context + ": unsupported surface type '" + mnemonic + "'");
+}
+
+/**
+ * Recursive-descent parser of a cell geometry. Intersection (juxtaposition)
+ * has precedence over union (:), and complement (#) over both.
+ */
+class ExpressionParser
+{
+  std::vector<std::string> tokens;
+  size_t pos;
+  std::vector<RawInstruction> &program;
+  std::string const &context;
+
+public:
+  ExpressionParser(std::string const &expression, std::vector<RawInstruction> &program,
+                   std::string const &context) : pos(0), program(program), context(context)
+  {
+    std::string current;
+    for (char c : expression) {
+      if (c == ' ' || c == '(' || c == ')' || c == ':' || c == '#') {
+        if (!current.empty()) {
+          tokens.push_back(current);
+          current.clear();
+        }
+        if (c != ' ') {
+          tokens.push_back(std::string(1, c));
+        }
+      } else {
+        current.push_back(c);
+      }
+    }
+    if (!current.empty()) {
+      tokens.push_back(current);
+    }
+  }
+
+  void parse()
+  {
+    if (tokens.empty()) {
+      throw std::runtime_error(context + ": empty geometry");
+    }
+    parseUnion();
+    if (pos != tokens.size()) {
+      throw std::runtime_error(context + ": unexpected '" + tokens[pos] + "' in geometry");
+    }
+  }
+
+private:
+  bool next(char const *token) const
+  {
+    return pos < tokens.size() && tokens[pos] == token;
+  }
+
+  void expect(char const *token)
+  {
+    if (!next(token)) {
+      throw std::runtime_error(context + ": expected '" + token + "' in geometry");
+    }
+    ++pos;
+  }
+
+  void emit(RawInstruction::Op op, long number = 0, int facet = 0, int sign = 0)
+  {
+    program.push_back(RawInstruction{op, number, facet, sign});
+  }
+
+  void parseUnion()
+  {
+    parseIntersection();
+    while (next(":")) {
+      ++pos;
+      parseIntersection();
+      emit(RawInstruction::OR);
+    }
+  }
+
+  void parseIntersection()
+  {
+    parseFactor();
+    while (pos < tokens.size() && !next(":") && !next(")")) {
+      parseFactor();
+      emit(RawInstruction::AND);
+    }
+  }
+
+  void parseFactor()
+  {
+    if (pos >= tokens.size()) {
+      throw std::runtime_error(context + ": unexpected end of geometry");
+    }
+    std::string const token = tokens[pos++];
+    if (token == "(") {
+      parseUnion();
+      expect(")");
+    } else if (token == "#") {
+      if (next("(")) {
+        ++pos;
+        parseUnion();
+        expect(")");
+      } else {
+        if (pos >= tokens.size()) {
+          throw std::runtime_error(context + ": missing cell number after #");
+        }
+        emit(RawInstruction::CELL, toLong(tokens[pos++], context));
+      }
+      emit(RawInstruction::NOT);
+    } else {
+      parseSurface(token);
+    }
+  }
+
+  void parseSurface(std::string token)
+  {
+    int sign = 1;
+    if (token[0] == '-' || token[0] == '+') {
+      sign = token[0] == '-' ? -1 : 1;
+      token.erase(0, 1);
+    }
+    long facet = 0;
+    auto const dot = token.find('.');
+    if (dot != std::string::npos) {
+      facet = toLong(token.substr(dot + 1), context);
+      token.erase(dot);
+      if (facet < 1 || facet > 9) {
+        throw std::runtime_error(context + ": invalid macrobody facet in geometry");
+      }
+    }
+    long const number = toLong(token, context);
+    if (number <= 0) {
+      throw std::runtime_error(context + ": invalid surface number in geometry");
+    }
+    emit(RawInstruction::SURFACE, number, int(facet), sign);
+  }
+};
+
+/// whether a word of the parameter list of a cell is a keyword
+bool isKeyword(std::string const &word)
+{
+  return std::isalpha(static_cast<unsigned char>(word[0])) || word[0] == '*';
+}
+
+/// reads the U, FILL, LAT and TRCL cell parameters; the others are ignored
+void parseCellParameters(std::vector<std::string> const &words, size_t first, RawCell &cell,
+                         std::string const &context)
+{
+  std::string text;
+  for (size_t w = first; w < words.size(); ++w) {
+    text += " " + words[w];
+  }
+  for (auto &c : text) {
+    if (c == '=') {
+      c = ' ';
+    }
+  }
+  std::string spaced;
+  for (char c : text) {
+    if (c == '(' || c == ')') {
+      spaced += std::string(" ") + c + " ";
+    } else {
+      spaced.push_back(c);
+    }
+  }
+  std::vector<std::string> const tokens = splitWords(spaced);
+
+  for (size_t k = 0; k < tokens.size();) {
+    std::string const key = tokens[k++];
+    std::vector<std::string> values;
+    while (k < tokens.size() && !isKeyword(tokens[k])) {
+      values.push_back(tokens[k++]);
+    }
+    if (key == "lat") {
+      cell.lattice = true;
+    } else if (key == "trcl" || key == "*trcl") {
+      // TRCL n, TRCL (n) or TRCL (entries of a TR card)
+      if (!values.empty() && values[0] == "(") {
+        if (values.size() < 3 || values.back() != ")") {
+          throw std::runtime_error(context + ": invalid TRCL transformation");
+        }
+        values = std::vector<std::string>(values.begin() + 1, values.end() - 1);
+      }
+      if (values.empty()) {
+        throw std::runtime_error(context + ": missing TRCL transformation");
+      }
+      cell.hasTrcl = true;
+      cell.trclTR = 0;
+      cell.trclEntries.clear();
+      cell.trclDegrees = key[0] == '*';
+      if (values.size() == 1) {
+        cell.trclTR = toLong(values[0], context);
+      } else {
+        for (auto const &value : values) {
+          cell.trclEntries.push_back(toDouble(value, context));
+        }
+      }
+    } else if (key == "u") {
+      if (values.empty()) {
+        throw std::runtime_error(context + ": missing universe number");
+      }
+      cell.universe = std::labs(toLong(values[0], context));
+      cell.hasUniverse = true;
+    } else if (key == "fill" || key == "*fill") {
+      if (values.empty()) {
+        throw std::runtime_error(context + ": missing filling universe");
+      }
+      if (values[0].find(':') != std::string::npos) {
+        // FILL i1:i2 j1:j2 k1:k2 followed by one universe per lattice element
+        cell.fillArray = true;
+        continue;
+      }
+      cell.fill = toLong(values[0], context);
+      cell.hasFill = true;
+      cell.fillTR = 0;
+      cell.fillEntries.clear();
+      cell.fillDegrees = key[0] == '*';
+      if (values.size() > 1) {
+        if (values[1] != "(" || values.back() != ")" || values.size() < 4) {
+          throw std::runtime_error(context + ": invalid FILL transformation");
+        }
+        if (values.size() == 4) {
+          cell.fillTR = toLong(values[2], context);
+        } else {
+          for (size_t v = 2; v + 1 < values.size(); ++v) {
+            cell.fillEntries.push_back(toDouble(values[v], context));
+          }
+        }
+      }
+    }
+  }
+}
+
+RawCell parseCell(std::string const &card)
+{
+  std::vector<std::string> const words = splitWords(card);
+  std::string context = "MCNP cell " + words[0];
+  RawCell cell{toLong(words[0], context), -1, {}, 0, false, -1, false, 0, {}, false, false, false, false, 0, {}, false};
+  if (words.size() < 3) {
+    throw std::runtime_error(context + ": incomplete cell card");
+  }
+
+  if (words[1] == "like") {
+    if (words.size() < 4 || words[3] != "but") {
+      throw std::runtime_error(context + ": expected LIKE n BUT");
+    }
+    cell.likeOf = toLong(words[2], context);
+    parseCellParameters(words, 4, cell, context);
+    return cell;
+  }
+
+  size_t w = toLong(words[1], context) == 0 ? 2 : 3;
+  std::string expression;
+  for (; w < words.size() && !isKeyword(words[w]); ++w) {
+    expression += " " + words[w];
+  }
+  ExpressionParser(expression, cell.program, context).parse();
+  parseCellParameters(words, w, cell, context);
+  return cell;
+}
+
+/// whether a card of the data block is a TRn or *TRn card
+bool isTransformCard(std::string const &name, long &number)
+{
+  std::string const bare = name[0] == '*' ? name.substr(1) : name;
+  if (bare.compare(0, 2, "tr") != 0 || bare.size() == 2) {
+    return false;
+  }
+  return parseLong(bare.substr(2), number) && number > 0;
+}
+} // namespace
+
+MCNPCellEvaluator::MCNPCellEvaluator(std::string const &inputPath)
+{
+  std::ifstream file(inputPath);
+  if (!file) {
+    throw std::runtime_error("cannot open the MCNP input file " + inputPath);
+  }
+  read(file);
+}
+
+MCNPCellEvaluator::MCNPCellEvaluator(std::istream &stream)
+{
+  read(stream);
+}
+
+void MCNPCellEvaluator::read(std::istream &stream)
+{
+  auto const blocks = readBlocks(stream);
+
+  // TR cards
+  std::unordered_map<long, SurfaceTransform> transforms;
+  for (auto const &card : blocks[2]) {
+    std::vector<std::string> const words = splitWords(card);
+    long number;
+    if (!isTransformCard(words[0], number)) {
+      continue;
+    }
+    std::string const context = "MCNP card " + words[0];
+    std::vector<double> entries;
+    for (size_t w = 1; w < words.size(); ++w) {
+      entries.push_back(toDouble(words[w], context));
+    }
+    transforms[number] = makeTransform(entries, words[0][0] == '*', context);
+  }
+
+  // surfaces
+  std::unordered_map<long, MCNPSurface> mcnpSurfaces;
+  std::unordered_map<long, MCNPSurfaceCard> surfaceCards;
+  std::unordered_map<long, std::string> unsupportedSurfaces;
+  for (auto const &card : blocks[1]) {
+    std::vector<std::string> const words = splitWords(card);
+    std::string name = words[0];
+    if (name[0] == '*' || name[0] == '+') {
+      // reflecting and white boundaries do not change the geometry
+      name.erase(0, 1);
+    }
+    std::string const context = "MCNP surface " + name;
+    long const number = toLong(name, context);
+    if (number <= 0 || surfaceCards.count(number)) {
+      throw std::runtime_error(context + ": invalid or duplicate surface number");
+    }
+    size_t w = 1;
+    long transformNumber = 0;
+    if (words.size() > 1 && parseLong(words[1], transformNumber)) {
+      if (transformNumber < 0) {
+        // periodic boundary with surface -n: like reflection, it does not change the geometry
+        transformNumber = 0;
+      }
+      ++w;
+    }
+    if (w >= words.size()) {
+      throw std::runtime_error(context + ": missing surface type");
+    }
+    SurfaceTransform const *transform = nullptr;
+    if (transformNumber > 0) {
+      auto const it = transforms.find(transformNumber);
+      if (it == transforms.end()) {
+        throw std::runtime_error(context + ": unknown transformation TR" + std::to_string(transformNumber));
+      }
+      transform = &it->second;
+    }
+    std::string const mnemonic = words[w++];
+    std::vector<double> params;
+    for (; w < words.size(); ++w) {
+      params.push_back(toDouble(words[w], context));
+    }
+    surfaceCards[number] = MCNPSurfaceCard{mnemonic, params, transform != nullptr,
+                                           transform ? *transform : SurfaceTransform()};
+    try {
+      mcnpSurfaces[number] = addMCNPSurface(surfaces, number, mnemonic, params, transform);
+    } catch (UnsupportedSurface const &error) {
+      unsupportedSurfaces[number] = error.what();
+    }
+  }
+
+  // cells
+  std::vector<RawCell> rawCells;
+  for (auto const &card : blocks[0]) {
+    rawCells.push_back(parseCell(card));
+    long const number = rawCells.back().number;
+    if (indexOfCell.count(number)) {
+      throw std::runtime_error("MCNP cell " + std::to_string(number) + ": duplicate cell number");
+    }
+    indexOfCell[number] = rawCells.size() - 1;
+  }
+  if (rawCells.empty()) {
+    throw std::runtime_error("no cell found in the MCNP input file");
+  }
+
+  auto cellIndex = [&](long number, std::string const &context) {
+    auto const it = indexOfCell.find(number);
+    if (it == indexOfCell.end()) {
+      throw std::runtime_error(context + ": unknown cell " + std::to_string(number));
+    }
+    return it->second;
+  };
+
+  // LIKE n BUT: the geometry and the unchanged parameters come from cell n
+  for (auto &cell : rawCells) {
+    std::string const context = "MCNP cell " + std::to_string(cell.number);
+    long like = cell.likeOf;
+    for (int depth = 0; like >= 0; ++depth) {
+      if (depth >= maxLikeDepth) {
+        throw std::runtime_error(context + ": circular LIKE n BUT definition");
+      }
+      RawCell const &model = rawCells[cellIndex(like, context)];
+      if (!cell.hasUniverse && model.hasUniverse) {
+        cell.universe = model.universe;
+        cell.hasUniverse = true;
+      }
+      if (!cell.hasFill && !cell.fillArray) {
+        cell.fill = model.fill;
+        cell.fillTR = model.fillTR;
+        cell.fillEntries = model.fillEntries;
+        cell.fillDegrees = model.fillDegrees;
+        cell.hasFill = model.hasFill;
+        cell.fillArray = model.fillArray;
+      }
+      cell.lattice = cell.lattice || model.lattice;
+      if (!cell.hasTrcl && model.hasTrcl) {
+        cell.hasTrcl = true;
+        cell.trclTR = model.trclTR;
+        cell.trclEntries = model.trclEntries;
+        cell.trclDegrees = model.trclDegrees;
+      }
+      cell.program = model.program;
+      like = model.likeOf;
+    }
+  }
+
+  // TRCL: the cell is moved, as if its surfaces had the transformation
+  std::vector<bool> moved(rawCells.size(), false);
+  std::vector<SurfaceTransform> trcl(rawCells.size());
+  for (long index = 0; index < long(rawCells.size()); ++index) {
+    RawCell const &raw = rawCells[index];
+    std::string const context = "MCNP cell " + std::to_string(raw.number);
+    if (raw.hasTrcl && raw.trclTR > 0) {
+      auto const it = transforms.find(raw.trclTR);
+      if (it == transforms.end()) {
+        throw std::runtime_error(context + ": unknown transformation TR" + std::to_string(raw.trclTR));
+      }
+      moved[index] = true;
+      trcl[index] = it->second;
+    } else if (raw.hasTrcl && !raw.trclEntries.empty()) {
+      moved[index] = true;
+      trcl[index] = makeTransform(raw.trclEntries, raw.trclDegrees, context);
+    }
+  }
+  // the surfaces of the moved cells, by cell index and surface number
+  std::map<std::pair<long, long>, MCNPSurface> movedSurfaces;
+
+  // resolve the surfaces and inline the complemented cells; cells using an
+  // unsupported surface get a reason and no program
+  std::vector<std::vector<Instruction>> resolved(rawCells.size());
+  std::vector<std::string> reasons(rawCells.size());
+  std::vector<int> state(rawCells.size(), 0);
+  std::function<void(long)> lower = [&](long index) {
+    std::string const context = "MCNP cell " + std::to_string(rawCells[index].number);
+    if (state[index] == 2) {
+      return;
+    }
+    if (state[index] == 1) {
+      throw std::runtime_error(context + ": circular # complement");
+    }
+    state[index] = 1;
+    std::vector<Instruction> program;
+    for (auto const &raw : rawCells[index].program) {
+      switch (raw.op) {
+      case RawInstruction::SURFACE: {
+        auto const unsupported = unsupportedSurfaces.find(raw.number);
+        if (unsupported != unsupportedSurfaces.end()) {
+          reasons[index] = unsupported->second;
+          break;
+        }
+        auto const it = mcnpSurfaces.find(raw.number);
+        if (it == mcnpSurfaces.end()) {
+          throw std::runtime_error(context + ": unknown surface " + std::to_string(raw.number));
+        }
+        MCNPSurface const *surface = &it->second;
+        if (moved[index]) {
+          MCNPSurface &copy = movedSurfaces[std::make_pair(index, raw.number)];
+          if (copy.inside.empty()) {
+            // numbered 1000 * cell + surface, as MCNP does
+            MCNPSurfaceCard const &card = surfaceCards.at(raw.number);
+            SurfaceTransform const transform = card.hasTransform ? compose(trcl[index], card.transform) : trcl[index];
+            copy = addMCNPSurface(surfaces, 1000 * rawCells[index].number + raw.number, card.mnemonic, card.params,
+                                  &transform);
+          }
+          surface = &copy;
+        }
+        std::vector<std::pair<long, int>> inside = surface->inside;
+        if (raw.facet > 0) {
+          auto const facet = std::find(surface->facets.begin(), surface->facets.end(), raw.facet);
+          if (facet == surface->facets.end()) {
+            throw std::runtime_error(context + ": surface " + std::to_string(raw.number) + " has no facet "
+                                     + std::to_string(raw.facet));
+          }
+          inside = {inside[facet - surface->facets.begin()]};
+        }
+        if (inside.size() == 1) {
+          int const side = raw.sign < 0 ? inside[0].second : -inside[0].second;
+          program.push_back({OpCode::HALFSPACE, int32_t(inside[0].first), side});
+          break;
+        }
+        for (size_t i = 0; i < inside.size(); ++i) {
+          program.push_back({OpCode::HALFSPACE, int32_t(inside[i].first), inside[i].second});
+          if (i > 0) {
+            program.push_back({OpCode::AND, 0, 0});
+          }
+        }
+        if (raw.sign > 0) {
+          program.push_back({OpCode::NOT, 0, 0});
+        }
+        break;
+      }
+      case RawInstruction::CELL: {
+        long const other = cellIndex(raw.number, context);
+        lower(other);
+        if (!reasons[other].empty()) {
+          reasons[index] = "complement of cell " + std::to_string(raw.number) + ": " + reasons[other];
+        }
+        program.insert(program.end(), resolved[other].begin(), resolved[other].end());
+        break;
+      }
+      case RawInstruction::NOT:
+        program.push_back({OpCode::NOT, 0, 0});
+        break;
+      case RawInstruction::AND:
+        program.push_back({OpCode::AND, 0, 0});
+        break;
+      case RawInstruction::OR:
+        program.push_back({OpCode::OR, 0, 0});
+        break;
+      }
+    }
+    resolved[index] = std::move(program);
+    state[index] = 2;
+  };
+
+  for (long index = 0; index < long(rawCells.size()); ++index) {
+    lower(index);
+    RawCell const &raw = rawCells[index];
+    std::string const context = "MCNP cell " + std::to_string(raw.number);
+    if (raw.fillArray && !raw.lattice) {
+      throw std::runtime_error(context + ": a FILL array requires LAT");
+    }
+    std::string reason = reasons[index];
+    if (reason.empty() && raw.lattice) {
+      reason = "lattices are not supported";
+    }
+    if (!reason.empty()) {
+      // the cell contains no point, and its universe is kept for the FILL checks
+      skippedCells.emplace_back(raw.number, reason);
+      bounds.push_back(emptyBox());
+      cells.push_back(Cell{raw.number, raw.universe, -1, -1, long(code.size()), long(code.size())});
+      cellsOfUniverse[raw.universe];
+      continue;
+    }
+
+    // check the stack depth and compute the bounding box
+    std::vector<BoundingBox> boxes;
+    for (auto const &instruction : resolved[index]) {
+      switch (instruction.op) {
+      case OpCode::HALFSPACE:
+        boxes.push_back(surfaces.halfSpaceBounds(instruction.a, instruction.b));
+        if (boxes.size() > size_t(maxStackDepth)) {
+          throw std::runtime_error(context + ": geometry nested too deeply");
+        }
+        break;
+      case OpCode::NOT:
+        boxes.back() = infiniteBox();
+        break;
+      case OpCode::AND:
+        boxes[boxes.size() - 2] = intersectBoxes(boxes[boxes.size() - 2], boxes.back());
+        boxes.pop_back();
+        break;
+      case OpCode::OR:
+        boxes[boxes.size() - 2] = uniteBoxes(boxes[boxes.size() - 2], boxes.back());
+        boxes.pop_back();
+        break;
+      }
+    }
+    bounds.push_back(boxes.at(0));
+
+    long fillTransform = -1;
+    bool hasFillTransform = false;
+    SurfaceTransform transform;
+    if (raw.hasFill && raw.fillTR > 0) {
+      auto const it = transforms.find(raw.fillTR);
+      if (it == transforms.end()) {
+        throw std::runtime_error(context + ": unknown transformation TR" + std::to_string(raw.fillTR));
+      }
+      hasFillTransform = true;
+      transform = it->second;
+    } else if (raw.hasFill && !raw.fillEntries.empty()) {
+      hasFillTransform = true;
+      transform = makeTransform(raw.fillEntries, raw.fillDegrees, context);
+    }
+    if (raw.hasFill && moved[index]) {
+      // the filling universe moves with the cell
+      transform = hasFillTransform ? compose(trcl[index], transform) : trcl[index];
+      hasFillTransform = true;
+    }
+    if (hasFillTransform) {
+      fillTransform = fillTransforms.size();
+      fillTransforms.push_back(transform);
+    }
+
+    long const begin = code.size();
+    code.insert(code.end(), resolved[index].begin(), resolved[index].end());
+    cells.push_back(Cell{raw.number, raw.universe, raw.hasFill ? raw.fill : -1, fillTransform, begin, long(code.size())});
+    cellsOfUniverse[raw.universe].push_back(index);
+  }
+
+  // every filling universe must exist, and a universe may not fill itself
+  std::unordered_map<long, int> universeState;
+  std::function<void(long)> visit = [&](long universe) {
+    int &visited = universeState[universe];
+    if (visited == 2) {
+      return;
+    }
+    if (visited == 1) {
+      throw std::runtime_error("universe " + std::to_string(universe) + " fills itself");
+    }
+    visited = 1;
+    for (long index : cellsOfUniverse[universe]) {
+      long const fill = cells[index].fill;
+      if (fill < 0) {
+        continue;
+      }
+      if (!cellsOfUniverse.count(fill)) {
+        throw std::runtime_error("MCNP cell " + std::to_string(cells[index].number) + ": unknown universe "
+                                 + std::to_string(fill));
+      }
+      visit(fill);
+    }
+    universeState[universe] = 2;
+  };
+  std::vector<long> universes;
+  for (auto const &entry : cellsOfUniverse) {
+    universes.push_back(entry.first);
+  }
+  for (long universe : universes) {
+    visit(universe);
+  }
+}
+
+bool MCNPCellEvaluator::onSide(long surface, int sign, double x, double y, double z) const
+{
+  double const value = surfaces.evaluate(surface, x, y, z);
+  return sign > 0 ? value >= 0. : value < 0.;
+}
+
+bool MCNPCellEvaluator::contains(long index, double x, double y, double z) const
+{
+  bool stack[maxStackDepth];
+  int top = 0;
+  Cell const &cell = cells[index];
+  for (long pc = cell.begin; pc < cell.end; ++pc) {
+    Instruction const &instruction = code[pc];
+    switch (instruction.op) {
+    case OpCode::HALFSPACE:
+      stack[top++] = onSide(instruction.a, instruction.b, x, y, z);
+      break;
+    case OpCode::NOT:
+      stack[top - 1] = !stack[top - 1];
+      break;
+    case OpCode::AND:
+      --top;
+      stack[top - 1] = stack[top - 1] && stack[top];
+      break;
+    case OpCode::OR:
+      --top;
+      stack[top - 1] = stack[top - 1] || stack[top];
+      break;
+    }
+  }
+  return top > 0 && stack[0];
+}
+
+long MCNPCellEvaluator::whichCell(std::vector<double> const &point) const
+{
+  double x = point[0], y = point[1], z = point[2];
+  long universe = 0;
+  for (int depth = 0; depth < maxFillDepth; ++depth) {
+    auto const it = cellsOfUniverse.find(universe);
+    if (it == cellsOfUniverse.end()) {
+      return -1;
+    }
+    long found = -1;
+    for (long index : it->second) {
+      if (inBox(bounds[index], x, y, z) && contains(index, x, y, z)) {
+        found = index;
+        break;
+      }
+    }
+    if (found < 0) {
+      return -1;
+    }
+    Cell const &cell = cells[found];
+    if (cell.fill < 0) {
+      return cell.number;
+    }
+    if (cell.fillTransform >= 0) {
+      // coordinates in the frame of the filling universe: R^T (p - t)
+      SurfaceTransform const &transform = fillTransforms[cell.fillTransform];
+      double const d[3] = {x - transform.translation[0], y - transform.translation[1], z - transform.translation[2]};
+      auto const &r = transform.rotation;
+      x = r[0] * d[0] + r[3] * d[1] + r[6] * d[2];
+      y = r[1] * d[0] + r[4] * d[1] + r[7] * d[2];
+      z = r[2] * d[0] + r[5] * d[1] + r[8] * d[2];
+    }
+    universe = cell.fill;
+  }
+  return -1;
+}
+
+long MCNPCellEvaluator::getNbCells() const
+{
+  return cells.size();
+}
+
+long MCNPCellEvaluator::getCellNumber(long index) const
+{
+  return cells[index].number;
+}
+
+long MCNPCellEvaluator::getCellIndex(long number) const
+{
+  auto const it = indexOfCell.find(number);
+  return it == indexOfCell.end() ? -1 : it->second;
+}
+
+long MCNPCellEvaluator::getUniverse(long index) const
+{
+  return cells[index].universe;
+}
+
+long MCNPCellEvaluator::getFill(long index) const
+{
+  return cells[index].fill;
+}
+
+BoundingBox const &MCNPCellEvaluator::getBoundingBox(long index) const
+{
+  return bounds[index];
+}
+
+std::vector<MCNPCellEvaluator::Instruction> MCNPCellEvaluator::getProgram(long index) const
+{
+  return std::vector<Instruction>(code.begin() + cells[index].begin, code.begin() + cells[index].end);
+}
+
+SurfaceTable const &MCNPCellEvaluator::getSurfaces() const
+{
+  return surfaces;
+}
+
+std::vector<std::pair<long, std::string>> const &MCNPCellEvaluator::getSkippedCells() const
+{
+  return skippedCells;
+}
@@ -9,19 +9,23 @@
 */
 
 #include "MCNPGeometry.hh"
-#include "help.hh"
+#include "FailureSink.hh"
+#include "Log.hh"
 #include <algorithm>
 #include <cassert>
 #include <cctype>
+#include <limits>
+#include <stdexcept>
 #include <unistd.h>
 
+using namespace std;
+
 MCNPGeometry::MCNPGeometry(const std::string &inputPath) : nps(-1),
                                                       inputPath(inputPath),
                                                       inputFile(inputPath)
 {
   if (inputFile.fail()) {
-    std::cerr << "INP file not found." << endl;
-    exit(EXIT_FAILURE);
+    throw std::runtime_error("INP file " + inputPath + " not found");
   }
 }
 
@@ -77,10 +81,7 @@ void MCNPGeometry::associateCell2Density()
       double fdensity;
       istest >> fdensity;
       if (istest.fail()) {
-        std::cerr << "WRONG DENSITY / CELL Definition" << endl;
-        std::cerr << density << endl;
-        std::cerr << currentLine << endl;
-        exit(EXIT_FAILURE);
+        throw std::runtime_error("wrong density or cell definition '" + density + "' in: " + currentLine);
       }
       auto last_non_zero = density.find_last_not_of('0');
       if(last_non_zero == std::string::npos) {
@@ -128,8 +129,8 @@ void MCNPGeometry::addCell2Density(unsigned long key, const std::pair<unsigned l
   if (cell2Density.find(key) == cell2Density.end()) {
     cell2Density[key] = value;
   } else {
-    std::cerr << "This cellID " << key << " already appeared in the MCNP input file." << endl;
-    std::cerr << "Check MCNP input file for errors..." << endl;
+    ORACLE_LOG(ERROR) << "This cellID " << key << " already appeared in the MCNP input file.\n"
+                      << "Check MCNP input file for errors...";
   }
 }
 
@@ -172,8 +173,32 @@ void MCNPGeometry::parseINP()
         break;
       }
     }
-    std::cout << "...read " << cell2Density.size() << " MCNP cells and their densities" << std::endl;
+    ORACLE_LOG(INFO) << "...read " << cell2Density.size() << " MCNP cells and their densities";
+  }
+}
+
+void MCNPGeometry::parseCells()
+{
+  try {
+    cells.reset(new MCNPCellEvaluator(inputPath));
+  } catch (std::exception const &error) {
+    throw std::runtime_error(std::string("cannot read the MCNP geometry: ") + error.what());
   }
+  ORACLE_LOG(INFO) << "...read the geometry of " << cells->getNbCells() << " MCNP cells";
+  for (auto const &skipped : cells->getSkippedCells()) {
+    ORACLE_LOG(WARNING) << "Warning: MCNP cell " << skipped.first << " is skipped (" << skipped.second
+                        << "); the points inside are not located";
+  }
+}
+
+long MCNPGeometry::whichCell(std::vector<double> const &point) const
+{
+  return cells->whichCell(point);
+}
+
+MCNPCellEvaluator const *MCNPGeometry::getCells() const
+{
+  return cells.get();
 }
 
 bool MCNPGeometry::isLineAComment(std::string const &lineContent) const
@@ -202,6 +227,15 @@ bool MCNPGeometry::isLineEmpty(std::string const &lineContent) const
   return pos == std::string::npos;
 }
 
+std::vector<unsigned long> MCNPGeometry::getCellIDs() const
+{
+  std::vector<unsigned long> result;
+  for (auto const &cell : cell2Density) {
+    result.push_back(cell.first);
+  }
+  return result;
+}
+
 std::string MCNPGeometry::getCellDensity(unsigned long cellID) const
 {
   auto const &value = cell2Density.at(cellID);
@@ -209,6 +243,11 @@ std::string MCNPGeometry::getCellDensity(unsigned long cellID) const
   return value_str;
 }
 
+unsigned long MCNPGeometry::getCellMaterial(unsigned long cellID) const
+{
+  return cell2Density.at(cellID).first;
+}
+
 const std::string &MCNPGeometry::getInputPath()
 {
   return inputPath;
@@ -254,6 +293,40 @@ PTRACRecord const &MCNPPTRAC::getPTRACRecord() const
   return record;
 }
 
+namespace
+{
+/// the byte offset of the next record in a PTRAC file, or -1 at its end
+long streamPosition(std::ifstream &file)
+{
+  if (!file || file.peek() == EOF) {
+    return -1;
+  }
+  return long(file.tellg());
+}
+
+/// moves a PTRAC file to an offset returned by streamPosition()
+void seekStream(std::ifstream &file, long offset)
+{
+  file.clear();
+  if (offset < 0) {
+    file.seekg(0, std::ios_base::end);
+  } else {
+    file.seekg(offset);
+  }
+  if (!file) {
+    throw std::runtime_error("cannot move to offset " + std::to_string(offset) + " in the PTRAC file");
+  }
+}
+
+/// checks the size of a reader position
+void checkPosition(std::vector<long> const &position, size_t size)
+{
+  if (position.size() != size) {
+    throw std::runtime_error("malformed PTRAC reader position");
+  }
+}
+} // namespace
+
 /*****************************************
 *                                       *
 *  methods of the MCNPPTRACASCII class  *
@@ -261,34 +334,44 @@ PTRACRecord const &MCNPPTRAC::getPTRACRecord() const
 *****************************************/
 
 MCNPPTRACASCII::MCNPPTRACASCII(std::string const &ptracPath) : MCNPPTRAC(),
-                                                               nbDataCellMaterialLine(0),
                                                                ptracFile(ptracPath)
 {
   if (ptracFile.fail()) {
-    std::cerr << "PTRAC file " << ptracPath << " not found." << endl;
-    exit(EXIT_FAILURE);
+    throw std::runtime_error("PTRAC file " + ptracPath + " not found");
   }
   // The number of header lines must be 8!!
   goThroughHeaderPTRAC(8);
 }
 
-std::pair<int, int> MCNPPTRACASCII::readPointEvent()
+std::pair<int64_t, long> MCNPPTRACASCII::readPointEvent()
 {
   std::istringstream iss(currentLine);
-  int pointID, eventID;
+  int64_t pointID;
+  long eventID;
   iss >> pointID >> eventID;
   return {pointID, eventID};
 }
 
-std::pair<int, int> MCNPPTRACASCII::readCellMaterial()
+std::tuple<long, long, long> MCNPPTRACASCII::readEventData(long eventType)
 {
+  auto const found = layouts.find(eventType / 1000);
+  if (found == layouts.end()) {
+    throw std::runtime_error("unexpected event type " + std::to_string(eventType) + " in the PTRAC file");
+  }
+  PTRACEventLayout const &layout = found->second;
   std::istringstream iss(currentLine);
-  int dummy, volumeID, materialID;
-  for (int ii = 1; ii <= nbDataCellMaterialLine - 2; ii++) {
-    iss >> dummy;
+  long nextEvent = -1, cell = -1, mat = -1;
+  long value;
+  for (int ii = 0; iss >> value; ii++) {
+    if (ii == layout.event) {
+      nextEvent = value;
+    } else if (ii == layout.cell) {
+      cell = value;
+    } else if (ii == layout.mat) {
+      mat = value;
+    }
   }
-  iss >> volumeID >> materialID;
-  return {volumeID, materialID};
+  return std::make_tuple(nextEvent, cell, mat);
 }
 
 std::vector<double> MCNPPTRACASCII::readPoint()
@@ -301,18 +384,26 @@ std::vector<double> MCNPPTRACASCII::readPoint()
 
 bool MCNPPTRACASCII::readNextPtracData(long maxReadPoint)
 {
+  constexpr long lastEvent = 9000;
   if ((ptracFile && !ptracFile.eof()) && (getNbPointsRead() <= maxReadPoint)) {
     getline(ptracFile, currentLine);
     if (!currentLine.empty()) {
       auto const pointEvent = readPointEvent();
-      getline(ptracFile, currentLine);
-      auto const cellMaterial = readCellMaterial();
-      getline(ptracFile, currentLine);
-      auto const point = readPoint();
+      history.clear();
+      long event = pointEvent.second;
+      while (event != lastEvent) {
+        getline(ptracFile, currentLine);
+        long nextEvent, cell, mat;
+        std::tie(nextEvent, cell, mat) = readEventData(event);
+        getline(ptracFile, currentLine);
+        if (!ptracFile) {
+          throw std::runtime_error("truncated history " + std::to_string(pointEvent.first) + " in the PTRAC file");
+        }
+        history.push_back({pointEvent.first, event, cell, mat, readPoint()});
+        event = nextEvent;
+      }
       incrementNbPointsRead();
-      record = {pointEvent.first, pointEvent.second,
-                cellMaterial.first, cellMaterial.second,
-                point};
+      record = history.front();
       return true;
     } else {
       return false;
@@ -322,43 +413,75 @@ bool MCNPPTRACASCII::readNextPtracData(long maxReadPoint)
   }
 }
 
+std::vector<long> MCNPPTRACASCII::getPosition()
+{
+  return {streamPosition(ptracFile), nbPointsRead};
+}
+
+void MCNPPTRACASCII::setPosition(std::vector<long> const &position)
+{
+  checkPosition(position, 2);
+  seekStream(ptracFile, position[0]);
+  nbPointsRead = position[1];
+}
+
+std::vector<PTRACRecord> const &MCNPPTRACASCII::getHistory() const
+{
+  return history;
+}
+
 void MCNPPTRACASCII::goThroughHeaderPTRAC(int nHeaderLines)
 {
-  std::string line5, line6;
+  std::string line5, variableIDs;
   for (int ii = 0; ii < nHeaderLines; ii++) {
     getline(ptracFile, currentLine);
     if (ii == 5) {
       line5 = currentLine;
     }
-    if (ii == 6) {
-      line6 = currentLine;
+    if (ii == 6 || ii == 7) {
+      variableIDs += currentLine + " ";
     }
   }
-  int nbData = getDataFromLine5Ptrac(line5);
-  checkDataFromLine6Ptrac(line6, nbData);
+  parseEventLayouts(line5, variableIDs);
 }
 
-int MCNPPTRACASCII::getDataFromLine5Ptrac(const std::string &line5)
+void MCNPPTRACASCII::parseEventLayouts(const std::string &line5, const std::string &variableIDs)
 {
-  int nbDataPointEventLine;
-  std::istringstream iss(line5);
-  iss >> nbDataPointEventLine >> nbDataCellMaterialLine;
-  int nbData = nbDataPointEventLine + nbDataCellMaterialLine;
-  return nbData;
-}
-
-void MCNPPTRACASCII::checkDataFromLine6Ptrac(const std::string &line6, int nbData)
-{
-  vector<int> data(nbData);
+  constexpr int nbEventTypes = 5;
+  constexpr int eventPtracCode = 7;
   constexpr int cellIDPtracCode = 17;
   constexpr int materialIDPtracCode = 18;
-  std::istringstream iss(line6);
-  for (int jj = 0; jj < nbData; jj++) {
-    iss >> data[jj];
+  std::istringstream counts(line5);
+  std::istringstream ids(variableIDs);
+  int nbDataPointEventLine = 0, id;
+  counts >> nbDataPointEventLine;
+  for (int jj = 0; jj < nbDataPointEventLine; jj++) {
+    ids >> id;
   }
-  if ((data[nbData - 2] != cellIDPtracCode) && (data[nbData - 1] != materialIDPtracCode)) {
-    std::cerr << "PTRAC file format not suitable. Please see Oracle/data/slapb file for example..." << endl;
-    exit(EXIT_FAILURE);
+  for (int type = 1; type <= nbEventTypes; type++) {
+    int nbLong = 0, nbDouble = 0;
+    counts >> nbLong >> nbDouble;
+    PTRACEventLayout layout = {-1, -1, -1};
+    for (int jj = 0; jj < nbLong; jj++) {
+      ids >> id;
+      if (id == eventPtracCode) {
+        layout.event = jj;
+      } else if (id == cellIDPtracCode) {
+        layout.cell = jj;
+      } else if (id == materialIDPtracCode) {
+        layout.mat = jj;
+      }
+    }
+    for (int jj = 0; jj < nbDouble; jj++) {
+      ids >> id;
+    }
+    if (counts && ids && nbLong > 0) {
+      layouts[type] = layout;
+    }
+  }
+  auto const source = layouts.find(1);
+  if (source == layouts.end() || source->second.cell < 0 || source->second.mat < 0) {
+    throw std::runtime_error("PTRAC file format not suitable. Please see Oracle/data/slapb file for example...");
   }
 }
 
@@ -371,8 +494,7 @@ void MCNPPTRACASCII::checkDataFromLine6Ptrac(const std::string &line6, int nbDat
 MCNPPTRACBinary::MCNPPTRACBinary(std::string const &ptracPath) : ptracFile(ptracPath, std::ios_base::binary)
 {
   if (ptracFile.fail()) {
-    std::cerr << "PTRAC file " << ptracPath << " not found." << endl;
-    exit(EXIT_FAILURE);
+    throw std::runtime_error("PTRAC file " + ptracPath + " not found");
   }
   parseHeader();
 }
@@ -387,6 +509,18 @@ bool MCNPPTRACBinary::readNextPtracData(long maxReadPoint)
   return false;
 }
 
+std::vector<long> MCNPPTRACBinary::getPosition()
+{
+  return {streamPosition(ptracFile), nbPointsRead};
+}
+
+void MCNPPTRACBinary::setPosition(std::vector<long> const &position)
+{
+  checkPosition(position, 2);
+  seekStream(ptracFile, position[0]);
+  nbPointsRead = position[1];
+}
+
 void MCNPPTRACBinary::parseHeader()
 {
   skipHeader();
@@ -536,3 +670,259 @@ void MCNPPTRACBinary::parsePTRACRecord()
     }
   }
 }
+
+/*******************************************
+*                                          *
+*  methods of the MCNPSampledPoints class  *
+*                                          *
+*******************************************/
+
+namespace
+{
+/// number of consecutive undefined points after which the sampling stops
+constexpr unsigned long maxConsecutiveUndefined = 1000000;
+
+/// the van der Corput radical inverse of i in the given base
+double radicalInverse(unsigned long i, unsigned long base)
+{
+  double const invBase = 1. / base;
+  double factor = invBase;
+  double result = 0.;
+  while (i > 0) {
+    result += factor * (i % base);
+    i /= base;
+    factor *= invBase;
+  }
+  return result;
+}
+} // namespace
+
+MCNPSampledPoints::MCNPSampledPoints(MCNPGeometry const &geometry, std::array<double, 6> const &box) : geometry(geometry),
+                                                                                                     box(box),
+                                                                                                     index(0),
+                                                                                                     nbUndefined(0)
+{
+  if (!geometry.getCells()) {
+    throw std::logic_error("the MCNP cells must be parsed before sampling points");
+  }
+}
+
+bool MCNPSampledPoints::readNextPtracData(long maxReadPoint)
+{
+  if (nbPointsRead >= maxReadPoint) {
+    return false;
+  }
+  unsigned long consecutiveUndefined = 0;
+  while (consecutiveUndefined < maxConsecutiveUndefined) {
+    // skip index 0, which is the corner of the box
+    ++index;
+    std::vector<double> const point = {box[0] + (box[1] - box[0]) * radicalInverse(index, 2),
+                                       box[2] + (box[3] - box[2]) * radicalInverse(index, 3),
+                                       box[4] + (box[5] - box[4]) * radicalInverse(index, 5)};
+    long const cell = geometry.whichCell(point);
+    if (cell < 0) {
+      ++nbUndefined;
+      ++consecutiveUndefined;
+      continue;
+    }
+    record = PTRACRecord{long(index), 0, cell, long(geometry.getCellMaterial(cell)), point};
+    incrementNbPointsRead();
+    return true;
+  }
+  ORACLE_LOG(ERROR) << "No MCNP cell found for " << maxConsecutiveUndefined
+                    << " consecutive sampled points; check the sampling box.";
+  return false;
+}
+
+std::vector<long> MCNPSampledPoints::getPosition()
+{
+  return {long(index), nbPointsRead, long(nbUndefined)};
+}
+
+void MCNPSampledPoints::setPosition(std::vector<long> const &position)
+{
+  checkPosition(position, 3);
+  index = position[0];
+  nbPointsRead = position[1];
+  nbUndefined = position[2];
+}
+
+unsigned long MCNPSampledPoints::getNbUndefined() const
+{
+  return nbUndefined;
+}
+
+constexpr size_t MCNPPTRACMulti::chunkSize;
+constexpr size_t MCNPPTRACMulti::maxQueuedChunks;
+
+MCNPPTRACMulti::MCNPPTRACMulti(std::vector<std::unique_ptr<MCNPPTRAC>> readers) : stopping(false),
+                                                                                turn(0),
+                                                                                currentChannel(0),
+                                                                                currentPos(0)
+{
+  for (auto &reader : readers) {
+    std::vector<long> const start = reader->getPosition();
+    channels.push_back(Channel{std::move(reader), {}, false, start});
+  }
+  startThreads();
+}
+
+MCNPPTRACMulti::~MCNPPTRACMulti()
+{
+  stopThreads();
+}
+
+void MCNPPTRACMulti::startThreads()
+{
+  stopping = false;
+  error = nullptr;
+  active.clear();
+  for (size_t index = 0; index < channels.size(); ++index) {
+    active.push_back(index);
+  }
+  turn = 0;
+  for (size_t index = 0; index < channels.size(); ++index) {
+    threads.emplace_back(&MCNPPTRACMulti::produce, this, index);
+  }
+}
+
+void MCNPPTRACMulti::stopThreads()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  consumed.notify_all();
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  threads.clear();
+}
+
+void MCNPPTRACMulti::produce(size_t index)
+{
+  Channel &channel = channels[index];
+  long const nbFiles = channels.size();
+  bool finished = false;
+  while (!finished) {
+    Chunk chunk;
+    chunk.records.reserve(chunkSize);
+    try {
+      chunk.start = channel.reader->getPosition();
+      while (chunk.records.size() < chunkSize && channel.reader->readNextPtracData(std::numeric_limits<long>::max())) {
+        chunk.records.push_back(channel.reader->getPTRACRecord());
+        int64_t const pointID = chunk.records.back().pointID;
+        if (pointID > (maxExactPointID - int64_t(index)) / nbFiles) {
+          throw std::runtime_error("point ID " + std::to_string(pointID) + " too large to merge "
+                                   + std::to_string(nbFiles) + " PTRAC files");
+        }
+        chunk.records.back().pointID = pointID * nbFiles + int64_t(index);
+      }
+      chunk.end = channel.reader->getPosition();
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (!error) {
+        error = std::current_exception();
+      }
+      chunk.records.clear();
+    }
+    finished = chunk.records.size() < chunkSize;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    consumed.wait(lock, [this, &channel]() { return stopping || channel.chunks.size() < maxQueuedChunks; });
+    if (stopping) {
+      return;
+    }
+    if (!chunk.records.empty()) {
+      channel.chunks.push_back(std::move(chunk));
+    }
+    channel.finished = finished;
+    lock.unlock();
+    produced.notify_all();
+  }
+}
+
+bool MCNPPTRACMulti::readNextPtracData(long maxReadPoint)
+{
+  if (nbPointsRead >= maxReadPoint) {
+    return false;
+  }
+  while (currentPos >= current.records.size()) {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (active.empty()) {
+      return false;
+    }
+    turn %= active.size();
+    Channel &channel = channels[active[turn]];
+    produced.wait(lock, [this, &channel]() { return error || !channel.chunks.empty() || channel.finished; });
+    if (error) {
+      std::rethrow_exception(error);
+    }
+    if (channel.chunks.empty()) {
+      // this file is exhausted
+      active.erase(active.begin() + turn);
+      continue;
+    }
+    if (!current.end.empty()) {
+      channels[currentChannel].next = current.end;
+    }
+    current = std::move(channel.chunks.front());
+    channel.chunks.pop_front();
+    currentChannel = active[turn];
+    currentPos = 0;
+    ++turn;
+    lock.unlock();
+    consumed.notify_all();
+  }
+  record = current.records[currentPos++];
+  incrementNbPointsRead();
+  return true;
+}
+
+std::vector<long> MCNPPTRACMulti::getPosition()
+{
+  // nbPointsRead, the number of files, then for each file the number of
+  // records to skip, the size of the position of its reader and the position
+  std::vector<long> position = {nbPointsRead, long(channels.size())};
+  for (size_t index = 0; index < channels.size(); ++index) {
+    bool const inCurrent = index == currentChannel && !current.start.empty();
+    std::vector<long> const &start = inCurrent ? current.start : channels[index].next;
+    position.push_back(inCurrent ? long(currentPos) : 0);
+    position.push_back(start.size());
+    position.insert(position.end(), start.begin(), start.end());
+  }
+  return position;
+}
+
+void MCNPPTRACMulti::setPosition(std::vector<long> const &position)
+{
+  if (position.size() < 2 || position[1] != long(channels.size())) {
+    throw std::runtime_error("malformed PTRAC reader position");
+  }
+  stopThreads();
+  size_t pos = 2;
+  for (auto &channel : channels) {
+    if (pos + 2 > position.size() || pos + 2 + position[pos + 1] > position.size()) {
+      throw std::runtime_error("malformed PTRAC reader position");
+    }
+    long const skip = position[pos];
+    std::vector<long> const start(position.begin() + pos + 2, position.begin() + pos + 2 + position[pos + 1]);
+    pos += 2 + position[pos + 1];
+    channel.reader->setPosition(start);
+    for (long i = 0; i < skip && channel.reader->readNextPtracData(std::numeric_limits<long>::max()); ++i) {
+    }
+    channel.chunks.clear();
+    channel.finished = false;
+    channel.next = channel.reader->getPosition();
+  }
+  nbPointsRead = position[0];
+  current = Chunk();
+  currentChannel = 0;
+  currentPos = 0;
+  startThreads();
+}
+
+size_t MCNPPTRACMulti::getNbFiles() const
+{
+  return channels.size();
+}
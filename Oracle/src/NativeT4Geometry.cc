@@ -0,0 +1,504 @@
+/**
+ * @file NativeT4Geometry.cc
+ *
+ *
+ * @brief NativeT4Geometry class
+ *
+ * @version 1.0
+ */
+
+#include "NativeT4Geometry.hh"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace
+{
+/// distance returned when no surface is found along a ray
+constexpr double noSurfaceDist = 1.0e+10;
+
+/// maximum number of surface crossings examined along a ray
+constexpr int maxRayCrossings = 1000;
+
+const std::string noCompo = "No compo";
+
+std::string toUpper(std::string word)
+{
+  std::transform(word.begin(), word.end(), word.begin(),
+                 [](unsigned char c) { return std::toupper(c); });
+  return word;
+}
+
+/**
+ * Splits the input file in whitespace-separated tokens, dropping // and
+ * C-style comments.
+ */
+std::vector<std::string> tokenize(std::istream &stream)
+{
+  std::vector<std::string> tokens;
+  std::string line;
+  bool inBlockComment = false;
+  while (std::getline(stream, line)) {
+    std::string cleaned;
+    for (size_t i = 0; i < line.size(); ++i) {
+      if (inBlockComment) {
+        if (line.compare(i, 2, "*/") == 0) {
+          inBlockComment = false;
+          ++i;
+        }
+      } else if (line.compare(i, 2, "/*") == 0) {
+        inBlockComment = true;
+        ++i;
+        cleaned.push_back(' ');
+      } else if (line.compare(i, 2, "//") == 0) {
+        break;
+      } else {
+        cleaned.push_back(line[i]);
+      }
+    }
+    std::istringstream iss(cleaned);
+    std::string token;
+    while (iss >> token) {
+      tokens.push_back(token);
+    }
+  }
+  return tokens;
+}
+
+class TokenReader
+{
+  std::vector<std::string> const &tokens;
+  size_t &pos;
+
+public:
+  TokenReader(std::vector<std::string> const &tokens, size_t &pos) : tokens(tokens), pos(pos) {}
+
+  bool atEnd() const
+  {
+    return pos >= tokens.size();
+  }
+
+  std::string const &next()
+  {
+    if (atEnd()) {
+      throw std::runtime_error("unexpected end of the T4 input file");
+    }
+    return tokens[pos++];
+  }
+
+  std::string peekKeyword() const
+  {
+    return atEnd() ? std::string() : toUpper(tokens[pos]);
+  }
+
+  double nextDouble()
+  {
+    std::string const &token = next();
+    char *end = nullptr;
+    double const value = std::strtod(token.c_str(), &end);
+    if (end == token.c_str() || *end != '\0') {
+      throw std::runtime_error("expected a number, got '" + token + "'");
+    }
+    return value;
+  }
+
+  long nextLong()
+  {
+    std::string const &token = next();
+    char *end = nullptr;
+    long const value = std::strtol(token.c_str(), &end, 10);
+    if (end == token.c_str() || *end != '\0') {
+      throw std::runtime_error("expected an integer, got '" + token + "'");
+    }
+    return value;
+  }
+
+  std::vector<long> nextLongs()
+  {
+    long const n = nextLong();
+    std::vector<long> values;
+    for (long i = 0; i < n; ++i) {
+      values.push_back(nextLong());
+    }
+    return values;
+  }
+};
+
+/**
+ * Reads the TRANSFORM or SURF card starting after its keyword.
+ */
+void readSurfaceCard(TokenReader &reader, std::string const &keyword, SurfaceTable &surfaces,
+                     std::map<long, SurfaceTransform> &transforms)
+{
+  if (keyword == "TRANSFORM") {
+    long const number = reader.nextLong();
+    if (toUpper(reader.next()) != "MATRIX") {
+      throw std::runtime_error("only TRANSFORM ... MATRIX is supported (transform " + std::to_string(number) + ")");
+    }
+    SurfaceTransform transform;
+    for (auto &component : transform.translation) {
+      component = reader.nextDouble();
+    }
+    for (auto &component : transform.rotation) {
+      component = reader.nextDouble();
+    }
+    transforms[number] = transform;
+    return;
+  }
+  long const number = reader.nextLong();
+  SurfaceTransform const *transform = nullptr;
+  std::string typeKeyword = toUpper(reader.next());
+  if (typeKeyword == "TRANSFORM") {
+    long const transformNumber = reader.nextLong();
+    auto const it = transforms.find(transformNumber);
+    if (it == transforms.end()) {
+      throw std::runtime_error("unknown transform " + std::to_string(transformNumber) + " in surface " + std::to_string(number));
+    }
+    transform = &it->second;
+    typeKeyword = toUpper(reader.next());
+  }
+  SurfaceType type;
+  if (!surfaceTypeFromKeyword(typeKeyword, type)) {
+    throw std::runtime_error("unsupported surface type " + typeKeyword + " for surface " + std::to_string(number));
+  }
+  std::vector<double> params(nbSurfaceParameters(type));
+  for (auto &param : params) {
+    param = reader.nextDouble();
+  }
+  surfaces.addSurface(number, type, params, transform);
+}
+
+} // namespace
+
+NativeT4Geometry::NativeT4Geometry(std::string const &filename) : filename(filename)
+{
+  read();
+}
+
+void NativeT4Geometry::read()
+{
+  std::ifstream file(filename);
+  if (!file) {
+    throw std::runtime_error("cannot open T4 file " + filename);
+  }
+  std::vector<std::string> const tokens = tokenize(file);
+  size_t pos = 0;
+  bool foundGeometry = false;
+  while (pos < tokens.size()) {
+    std::string const keyword = toUpper(tokens[pos++]);
+    if (keyword == "GEOMETRY") {
+      readGeometryBlock(tokens, pos);
+      foundGeometry = true;
+    } else if (keyword == "GEOMCOMP") {
+      readGeomCompBlock(tokens, pos);
+    }
+  }
+  if (!foundGeometry) {
+    throw std::runtime_error("no GEOMETRY block found in " + filename);
+  }
+  compile();
+}
+
+SurfaceTable NativeT4Geometry::readSurfaces(std::string const &filename)
+{
+  std::ifstream file(filename);
+  if (!file) {
+    throw std::runtime_error("cannot open T4 file " + filename);
+  }
+  std::vector<std::string> const tokens = tokenize(file);
+  size_t pos = 0;
+  while (pos < tokens.size() && toUpper(tokens[pos]) != "GEOMETRY") {
+    ++pos;
+  }
+  if (pos == tokens.size()) {
+    throw std::runtime_error("no GEOMETRY block found in " + filename);
+  }
+  ++pos;
+  SurfaceTable surfaces;
+  std::map<long, SurfaceTransform> transforms;
+  TokenReader reader(tokens, pos);
+  // the other cards are skipped word by word: the numbers of a card are
+  // never taken for a keyword
+  while (true) {
+    std::string const keyword = toUpper(reader.next());
+    if (keyword == "ENDG") {
+      break;
+    } else if (keyword == "TITLE") {
+      reader.next();
+    } else if (keyword == "TRANSFORM" || keyword == "SURF") {
+      readSurfaceCard(reader, keyword, surfaces, transforms);
+    }
+  }
+  return surfaces;
+}
+
+void NativeT4Geometry::readGeometryBlock(std::vector<std::string> const &tokens, size_t &pos)
+{
+  struct VolumeCard {
+    long number;
+    std::vector<long> pluses, minuses, operandNumbers;
+    Operator op;
+    bool fictive;
+  };
+  std::vector<VolumeCard> cards;
+  std::map<long, SurfaceTransform> transforms;
+  TokenReader reader(tokens, pos);
+
+  while (true) {
+    std::string const keyword = toUpper(reader.next());
+    if (keyword == "ENDG") {
+      break;
+    } else if (keyword == "TITLE") {
+      reader.next();
+    } else if (keyword == "HASH_TABLE") {
+      continue;
+    } else if (keyword == "TRANSFORM" || keyword == "SURF") {
+      readSurfaceCard(reader, keyword, surfaces, transforms);
+    } else if (keyword == "VOLU") {
+      VolumeCard card{reader.nextLong(), {}, {}, {}, Operator::NONE, false};
+      if (toUpper(reader.next()) != "EQUA") {
+        throw std::runtime_error("only EQUA volumes are supported (volume " + std::to_string(card.number) + ")");
+      }
+      while (true) {
+        std::string const volKeyword = toUpper(reader.next());
+        if (volKeyword == "ENDV") {
+          break;
+        } else if (volKeyword == "PLUS") {
+          card.pluses = reader.nextLongs();
+        } else if (volKeyword == "MINUS") {
+          card.minuses = reader.nextLongs();
+        } else if (volKeyword == "UNION" || volKeyword == "INTE") {
+          card.op = volKeyword == "UNION" ? Operator::UNION : Operator::INTE;
+          card.operandNumbers = reader.nextLongs();
+        } else if (volKeyword == "FICTIVE") {
+          card.fictive = true;
+        } else {
+          throw std::runtime_error("unsupported keyword " + volKeyword + " in volume " + std::to_string(card.number));
+        }
+      }
+      if (rankOfNumber.count(card.number)) {
+        throw std::runtime_error("volume " + std::to_string(card.number) + " defined twice");
+      }
+      rankOfNumber[card.number] = cards.size();
+      cards.push_back(card);
+    } else {
+      throw std::runtime_error("unsupported keyword " + keyword + " in the GEOMETRY block");
+    }
+  }
+
+  // flatten the volumes in rank order
+  for (auto const &card : cards) {
+    Volume volume{card.number, card.fictive, card.op, 0, 0, 0, 0};
+    volume.halfBegin = halfSurfaces.size();
+    auto addSigned = [&](std::vector<long> const &numbers, int sign) {
+      for (long number : numbers) {
+        long const index = surfaces.indexOf(number);
+        if (index < 0) {
+          throw std::runtime_error("unknown surface " + std::to_string(number) + " in volume " + std::to_string(card.number));
+        }
+        halfSurfaces.push_back(index);
+        halfSigns.push_back(sign);
+      }
+    };
+    addSigned(card.pluses, 1);
+    addSigned(card.minuses, -1);
+    volume.halfEnd = halfSurfaces.size();
+    volume.operandBegin = operands.size();
+    for (long number : card.operandNumbers) {
+      long const rank = getRank(number);
+      if (rank < 0) {
+        throw std::runtime_error("unknown volume " + std::to_string(number) + " in volume " + std::to_string(card.number));
+      }
+      operands.push_back(rank);
+    }
+    volume.operandEnd = operands.size();
+    volumes.push_back(volume);
+  }
+  compoOfRank.assign(volumes.size(), noCompo);
+}
+
+void NativeT4Geometry::readGeomCompBlock(std::vector<std::string> const &tokens, size_t &pos)
+{
+  TokenReader reader(tokens, pos);
+  while (reader.peekKeyword() != "END_GEOMCOMP") {
+    std::string const name = reader.next();
+    std::vector<long> const numbers = reader.nextLongs();
+    if (std::find(compoNames.begin(), compoNames.end(), name) == compoNames.end()) {
+      compoNames.push_back(name);
+    }
+    for (long number : numbers) {
+      long const rank = getRank(number);
+      if (rank < 0) {
+        throw std::runtime_error("unknown volume " + std::to_string(number) + " in GEOMCOMP");
+      }
+      compoOfRank[rank] = name;
+    }
+  }
+  reader.next();
+}
+
+void NativeT4Geometry::compile()
+{
+  bytecode.reset(new CSGBytecode(surfaces));
+  for (Volume const &volume : volumes) {
+    bytecode->beginVolume(volume.number, volume.fictive);
+    for (long i = volume.halfBegin; i < volume.halfEnd; ++i) {
+      bytecode->addHalfSpace(surfaces.getNumber(halfSurfaces[i]), halfSigns[i]);
+    }
+    for (long i = volume.operandBegin; i < volume.operandEnd; ++i) {
+      bytecode->addOperand(volume.op, operands[i]);
+    }
+    bytecode->endVolume();
+  }
+  try {
+    bytecode->finalize();
+  } catch (std::invalid_argument const &e) {
+    throw std::runtime_error(e.what());
+  }
+}
+
+bool NativeT4Geometry::contains(long rank, double x, double y, double z) const
+{
+  return bytecode->contains(rank, x, y, z);
+}
+
+long NativeT4Geometry::whichVolume(std::vector<double> const &point) const
+{
+  return bytecode->whichVolume(point);
+}
+
+std::pair<double, long> NativeT4Geometry::nextSurfaceInDirection(long rank, std::vector<double> const &point,
+                                                                 std::vector<double> const &dir) const
+{
+  std::vector<long> const candidates = getVolumeSurfaces(rank);
+  std::array<double, 3> const d = {dir[0], dir[1], dir[2]};
+  bool const initiallyInside = contains(rank, point[0], point[1], point[2]);
+
+  // walk along the ray from crossing to crossing until the volume is left
+  double travelled = 0.;
+  for (int iCrossing = 0; iCrossing < maxRayCrossings; ++iCrossing) {
+    std::array<double, 3> const origin = {point[0] + travelled * d[0],
+                                          point[1] + travelled * d[1],
+                                          point[2] + travelled * d[2]};
+    double nearest = -1.;
+    long nearestSurface = -1;
+    for (long index : candidates) {
+      double const dist = surfaces.intersectRay(index, origin, d, noSurfaceDist - travelled);
+      if (dist >= 0. && (nearest < 0. || dist < nearest)) {
+        nearest = dist;
+        nearestSurface = index;
+      }
+    }
+    if (nearest < 0.) {
+      break;
+    }
+    double const crossing = travelled + nearest;
+    double const eps = 1e-10 * (1. + crossing);
+    double const beyond = crossing + eps;
+    if (contains(rank, point[0] + beyond * d[0], point[1] + beyond * d[1], point[2] + beyond * d[2]) != initiallyInside) {
+      return {crossing, surfaces.getNumber(nearestSurface)};
+    }
+    travelled = beyond;
+  }
+  return {noSurfaceDist, -1};
+}
+
+std::vector<long> NativeT4Geometry::getVolumeSurfaces(long rank) const
+{
+  std::vector<long> result;
+  std::vector<char> visited(volumes.size(), 0);
+  std::vector<long> toVisit = {rank};
+  while (!toVisit.empty()) {
+    long const current = toVisit.back();
+    toVisit.pop_back();
+    if (visited[current]) {
+      continue;
+    }
+    visited[current] = 1;
+    Volume const &volume = volumes[current];
+    result.insert(result.end(), halfSurfaces.begin() + volume.halfBegin, halfSurfaces.begin() + volume.halfEnd);
+    toVisit.insert(toVisit.end(), operands.begin() + volume.operandBegin, operands.begin() + volume.operandEnd);
+  }
+  std::sort(result.begin(), result.end());
+  result.erase(std::unique(result.begin(), result.end()), result.end());
+  return result;
+}
+
+std::string const &NativeT4Geometry::getCompoName(long rank) const
+{
+  if (rank < 0 || rank >= getNbVolumes()) {
+    return noCompo;
+  }
+  return compoOfRank[rank];
+}
+
+std::vector<std::string> const &NativeT4Geometry::getCompoNames() const
+{
+  return compoNames;
+}
+
+long NativeT4Geometry::getNbVolumes() const
+{
+  return volumes.size();
+}
+
+long NativeT4Geometry::getVolumeNumber(long rank) const
+{
+  return volumes[rank].number;
+}
+
+long NativeT4Geometry::getRank(long number) const
+{
+  auto const it = rankOfNumber.find(number);
+  return it == rankOfNumber.end() ? -1 : it->second;
+}
+
+bool NativeT4Geometry::isFictive(long rank) const
+{
+  return volumes[rank].fictive;
+}
+
+NativeT4Geometry::Operator NativeT4Geometry::getOperator(long rank) const
+{
+  return volumes[rank].op;
+}
+
+std::vector<long> NativeT4Geometry::getOperands(long rank) const
+{
+  Volume const &volume = volumes[rank];
+  return std::vector<long>(operands.begin() + volume.operandBegin, operands.begin() + volume.operandEnd);
+}
+
+std::vector<long> NativeT4Geometry::getHalfSpaces(long rank) const
+{
+  Volume const &volume = volumes[rank];
+  std::vector<long> result;
+  for (long i = volume.halfBegin; i < volume.halfEnd; ++i) {
+    result.push_back(halfSigns[i] * surfaces.getNumber(halfSurfaces[i]));
+  }
+  return result;
+}
+
+BoundingBox const &NativeT4Geometry::getBoundingBox(long rank) const
+{
+  return bytecode->getBoundingBox(rank);
+}
+
+SurfaceTable const &NativeT4Geometry::getSurfaces() const
+{
+  return surfaces;
+}
+
+CSGBytecode const &NativeT4Geometry::getBytecode() const
+{
+  return *bytecode;
+}
+
+std::string const &NativeT4Geometry::getFilename() const
+{
+  return filename;
+}
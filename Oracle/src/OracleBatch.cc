@@ -0,0 +1,195 @@
+/**
+ * @file OracleBatch.cc
+ *
+ *
+ * @brief OracleBatch class
+ *
+ * @version 1.0
+ */
+
+#include "OracleBatch.hh"
+#include "Log.hh"
+#include "compare_geoms.hh"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <thread>
+
+using namespace std;
+
+namespace
+{
+/// held while a case uses the T4 libraries, whose geometry is global
+mutex t4Library;
+
+/// creates a directory, if it does not exist yet
+void makeDirectory(string const &path)
+{
+  if (mkdir(path.c_str(), 0777) != 0 && errno != EEXIST) {
+    throw runtime_error("cannot create the directory " + path);
+  }
+}
+} // namespace
+
+OracleBatch::OracleBatch(string const &manifestPath, string const &outputDir) : manifestPath(manifestPath),
+                                                                                outputDir(outputDir)
+{
+  ifstream manifest(manifestPath);
+  if (!manifest) {
+    throw runtime_error("cannot read the manifest " + manifestPath);
+  }
+  string line;
+  long lineNumber = 0;
+  while (getline(manifest, line)) {
+    ++lineNumber;
+    size_t const first = line.find_first_not_of(" \t\r");
+    if (first == string::npos || line[first] == '#') {
+      continue;
+    }
+    cases.push_back({lineNumber, OptionsCompare(), string()});
+    Case &batchCase = cases.back();
+    try {
+      vector<string> arguments = splitArguments(line);
+      // the options are read as if they were given to the oracle
+      arguments.insert(arguments.begin(), "oracle");
+      vector<char *> argv;
+      for (auto &argument : arguments) {
+        argv.push_back(&argument[0]);
+      }
+      batchCase.options.get_opts(static_cast<int>(argv.size()), argv.data());
+      if (batchCase.options.help) {
+        throw OptionsError("expected [options] jdd.t4 jdd.inp ptrac [ptrac2 ...]");
+      }
+    } catch (runtime_error const &error) {
+      batchCase.error = error.what();
+      continue;
+    }
+    if (!outputDir.empty() && batchCase.options.outputDir.empty()) {
+      batchCase.options.outputDir = outputDir + "/case" + to_string(lineNumber);
+    }
+  }
+}
+
+vector<string> OracleBatch::splitArguments(string const &line)
+{
+  vector<string> words;
+  string word;
+  bool inWord = false;
+  bool quoted = false;
+  for (char c : line) {
+    if (c == '"') {
+      quoted = !quoted;
+      inWord = true;
+    } else if (!quoted && isspace(static_cast<unsigned char>(c))) {
+      if (inWord) {
+        words.push_back(word);
+        word.clear();
+        inWord = false;
+      }
+    } else {
+      word += c;
+      inWord = true;
+    }
+  }
+  if (quoted) {
+    throw runtime_error("unbalanced quotes");
+  }
+  if (inWord) {
+    words.push_back(word);
+  }
+  return words;
+}
+
+vector<OracleBatch::Case> const &OracleBatch::getCases() const
+{
+  return cases;
+}
+
+long OracleBatch::run(int nbThreads, EventLog &results, bool report)
+{
+  atomic<size_t> next(0);
+  atomic<long> nbErrors(0);
+  for (auto const &batchCase : cases) {
+    if (!batchCase.error.empty()) {
+      results.write(EventRecord("error").add("case", batchCase.line).add("message", batchCase.error));
+      ORACLE_LOG(ERROR) << manifestPath << ":" << batchCase.line << ": Error: " << batchCase.error;
+      ++nbErrors;
+    }
+  }
+  if (!outputDir.empty()) {
+    makeDirectory(outputDir);
+  }
+  auto worker = [this, &next, &nbErrors, &results, report]() {
+    while (!interruptSignal) {
+      size_t const index = next++;
+      if (index >= cases.size()) {
+        return;
+      }
+      if (cases[index].error.empty() && !runCase(cases[index], results, report)) {
+        ++nbErrors;
+      }
+    }
+  };
+  vector<thread> threads;
+  for (int i = 0; i < std::max(1, nbThreads); ++i) {
+    threads.emplace_back(worker);
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  // the cases not started when the batch was interrupted
+  for (size_t index = next; index < cases.size(); ++index) {
+    if (!cases[index].error.empty()) {
+      continue;
+    }
+    results.write(EventRecord("skipped")
+                    .add("case", cases[index].line)
+                    .add("t4_file", cases[index].options.filenames[0])
+                    .add("inp_file", cases[index].options.filenames[1]));
+  }
+  return nbErrors;
+}
+
+bool OracleBatch::runCase(Case const &batchCase, EventLog &results, bool report)
+{
+  OptionsCompare const &options = batchCase.options;
+  auto const start = chrono::system_clock::now();
+  unique_lock<mutex> lock(t4Library, defer_lock);
+  if (options.backend == T4Backend::T4LIB) {
+    lock.lock();
+  }
+  try {
+    if (!options.outputDir.empty()) {
+      makeDirectory(options.outputDir);
+    }
+    vector<Statistics> statistics = run_oracle(options, report);
+    double const elapsed = chrono::duration<double>(chrono::system_clock::now() - start).count();
+    vector<string> const t4Filenames = getT4Filenames(options);
+    for (size_t i = 0; i < statistics.size(); ++i) {
+      results.write(statistics[i].getSummaryEvent(t4Filenames[i])
+                      .add("case", batchCase.line)
+                      .add("inp_file", options.filenames[1])
+                      .add("status", interruptSignal ? "interrupted" : "ok")
+                      .add("elapsed", elapsed));
+    }
+    ORACLE_LOG(INFO) << manifestPath << ":" << batchCase.line << ": " << statistics[0].getNbFailure() << " failed, "
+                     << statistics[0].getNbSuccess() << " successful points in " << elapsed << "s";
+    return true;
+  } catch (exception const &error) {
+    double const elapsed = chrono::duration<double>(chrono::system_clock::now() - start).count();
+    results.write(EventRecord("error")
+                    .add("case", batchCase.line)
+                    .add("t4_file", options.filenames[0])
+                    .add("inp_file", options.filenames[1])
+                    .add("message", error.what())
+                    .add("elapsed", elapsed));
+    ORACLE_LOG(ERROR) << manifestPath << ":" << batchCase.line << ": Error: " << error.what();
+    return false;
+  }
+}
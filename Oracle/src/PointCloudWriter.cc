@@ -0,0 +1,206 @@
+/**
+ * @file PointCloudWriter.cc
+ *
+ *
+ * @brief PointCloudWriter class
+ *
+ * @version 1.0
+ */
+
+#include "PointCloudWriter.hh"
+#include "VTKFormat.hh"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <stdexcept>
+#include <unistd.h>
+
+using namespace std;
+
+namespace
+{
+struct Column {
+  char const *name;
+  char const *type;
+  /// the size of one point, in bytes
+  size_t size;
+};
+
+/// the arrays read from the temporary files, in the order of the appended data
+Column const pointColumns[] = {{"Points", "Float64", 3 * sizeof(double)},
+                               {"pointID", "Int64", sizeof(int64_t)},
+                               {"cellID", "Int32", sizeof(int32_t)},
+                               {"materialID", "Int32", sizeof(int32_t)},
+                               {"rank", "Int32", sizeof(int32_t)},
+                               {"distance", "Float32", sizeof(float)},
+                               {"verdict", "UInt8", sizeof(uint8_t)}};
+constexpr size_t nbColumns = sizeof(pointColumns) / sizeof(pointColumns[0]);
+
+/// the number of vertex indices written at once
+constexpr long vertexChunk = 65536;
+
+template <typename T>
+void writeValue(ofstream &stream, T value)
+{
+  stream.write(reinterpret_cast<char const *>(&value), sizeof(T));
+}
+
+/// writes the connectivity (0, 1, ...) or the end offsets (1, 2, ...) of the vertices
+void writeVertexIndices(ofstream &file, long nbPoints, int64_t first)
+{
+  vector<int64_t> chunk;
+  for (long begin = 0; begin < nbPoints; begin += vertexChunk) {
+    long const end = min(nbPoints, begin + vertexChunk);
+    chunk.resize(end - begin);
+    for (long i = begin; i < end; ++i) {
+      chunk[i - begin] = first + i;
+    }
+    file.write(reinterpret_cast<char const *>(chunk.data()), chunk.size() * sizeof(int64_t));
+  }
+}
+} // namespace
+
+PointCloudWriter::PointCloudWriter(string const &path, bool resume) : path(path),
+                                                                      nbPoints(0)
+{
+  for (auto const &column : pointColumns) {
+    columnPaths.push_back(path + "." + column.name + ".tmp");
+    columns.emplace_back(new ofstream(columnPaths.back(), resume ? ios_base::binary | ios_base::app : ios_base::binary));
+    if (!*columns.back()) {
+      throw runtime_error("cannot write the temporary file " + columnPaths.back());
+    }
+  }
+}
+
+PointCloudWriter::~PointCloudWriter()
+{
+  try {
+    close();
+  } catch (runtime_error const &) {
+  }
+}
+
+void PointCloudWriter::add(array<double, 3> const &position, int64_t pointID, long cellID, long materialID, long rank,
+                           double dist, ResultStore::Verdict verdict)
+{
+  columns[0]->write(reinterpret_cast<char const *>(position.data()), 3 * sizeof(double));
+  writeValue(*columns[1], int64_t(pointID));
+  writeValue(*columns[2], int32_t(cellID));
+  writeValue(*columns[3], int32_t(materialID));
+  writeValue(*columns[4], int32_t(rank));
+  writeValue(*columns[5], float(dist));
+  writeValue(*columns[6], uint8_t(verdict));
+  ++nbPoints;
+}
+
+void PointCloudWriter::close(bool keepColumns)
+{
+  if (columns.empty()) {
+    return;
+  }
+  bool failed = false;
+  for (auto &column : columns) {
+    column->close();
+    failed = failed || column->fail();
+  }
+  columns.clear();
+
+  ofstream file(path, ios_base::binary);
+  failed = failed || !file;
+  vector<uint64_t> nbBytes;
+  for (auto const &column : pointColumns) {
+    nbBytes.push_back(nbPoints * column.size);
+  }
+  // the connectivity and the offsets of the vertices
+  nbBytes.push_back(nbPoints * sizeof(int64_t));
+  nbBytes.push_back(nbPoints * sizeof(int64_t));
+  vector<uint64_t> offsets(nbBytes.size(), 0);
+  for (size_t i = 1; i < nbBytes.size(); ++i) {
+    offsets[i] = offsets[i - 1] + sizeof(uint64_t) + nbBytes[i - 1];
+  }
+
+  file << "<?xml version=\"1.0\"?>\n"
+       << "<VTKFile type=\"PolyData\" version=\"1.0\" byte_order=\"" << vtkByteOrder()
+       << "\" header_type=\"UInt64\">\n"
+       << "  <PolyData>\n"
+       << "    <Piece NumberOfPoints=\"" << nbPoints << "\" NumberOfVerts=\"" << nbPoints
+       << "\" NumberOfLines=\"0\" NumberOfStrips=\"0\" NumberOfPolys=\"0\">\n"
+       << "      <PointData Scalars=\"verdict\">\n";
+  for (size_t i = 1; i < nbColumns; ++i) {
+    file << "        <DataArray type=\"" << pointColumns[i].type << "\" Name=\"" << pointColumns[i].name
+         << "\" format=\"appended\" offset=\"" << offsets[i] << "\"/>\n";
+  }
+  file << "      </PointData>\n"
+       << "      <Points>\n"
+       << "        <DataArray type=\"Float64\" NumberOfComponents=\"3\" format=\"appended\" offset=\"" << offsets[0]
+       << "\"/>\n"
+       << "      </Points>\n"
+       << "      <Verts>\n"
+       << "        <DataArray type=\"Int64\" Name=\"connectivity\" format=\"appended\" offset=\"" << offsets[nbColumns]
+       << "\"/>\n"
+       << "        <DataArray type=\"Int64\" Name=\"offsets\" format=\"appended\" offset=\"" << offsets[nbColumns + 1]
+       << "\"/>\n"
+       << "      </Verts>\n"
+       << "    </Piece>\n"
+       << "  </PolyData>\n"
+       << "  <AppendedData encoding=\"raw\">\n"
+       << "_";
+  for (size_t i = 0; i < nbColumns; ++i) {
+    writeValue(file, nbBytes[i]);
+    ifstream column(columnPaths[i], ios_base::binary);
+    // streaming an empty buffer sets the failbit
+    if (nbBytes[i] > 0) {
+      file << column.rdbuf();
+    }
+    if (!keepColumns) {
+      std::remove(columnPaths[i].c_str());
+    }
+  }
+  writeValue(file, nbBytes[nbColumns]);
+  writeVertexIndices(file, nbPoints, 0);
+  writeValue(file, nbBytes[nbColumns + 1]);
+  writeVertexIndices(file, nbPoints, 1);
+  file << "\n  </AppendedData>\n"
+       << "</VTKFile>\n";
+  file.close();
+  if (failed || file.fail()) {
+    throw runtime_error("cannot write the points to " + path);
+  }
+}
+
+void PointCloudWriter::saveState(ostream &stream)
+{
+  for (auto &column : columns) {
+    column->flush();
+  }
+  stream << "points " << nbPoints << "\n";
+}
+
+void PointCloudWriter::restoreState(istream &stream)
+{
+  string word;
+  long savedPoints = 0;
+  stream >> word >> savedPoints;
+  if (!stream || word != "points" || savedPoints < 0) {
+    throw runtime_error("malformed point file state");
+  }
+  for (size_t i = 0; i < columns.size(); ++i) {
+    columns[i]->flush();
+    int64_t const size = savedPoints * pointColumns[i].size;
+    ifstream saved(columnPaths[i], ios_base::binary | ios_base::ate);
+    if (!saved || int64_t(saved.tellg()) < size || ::truncate(columnPaths[i].c_str(), size) != 0) {
+      throw runtime_error(columnPaths[i] + " is shorter than at the checkpoint");
+    }
+  }
+  nbPoints = savedPoints;
+}
+
+string const &PointCloudWriter::getPath() const
+{
+  return path;
+}
+
+long PointCloudWriter::getNbPoints() const
+{
+  return nbPoints;
+}
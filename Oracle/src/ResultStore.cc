@@ -0,0 +1,179 @@
+/**
+ * @file ResultStore.cc
+ *
+ *
+ * @brief ResultStore and GeometryDiff classes
+ *
+ * @version 1.0
+ */
+
+#include "ResultStore.hh"
+#include <fstream>
+#include <iomanip>
+#include <stdexcept>
+
+using namespace std;
+
+namespace
+{
+char const *const resultsMagic = "ORACLERESULTS";
+int const resultsVersion = 1;
+} // namespace
+
+ResultStore::ResultStore(vector<uint64_t> const &signatures, vector<string> const &compoNames,
+                         DistanceMethod distanceMethod) : signatures(signatures),
+                                                          compoNames(compoNames),
+                                                          distanceMethod(distanceMethod),
+                                                          cursor(0)
+{
+}
+
+ResultStore::ResultStore(string const &path) : distanceMethod(DistanceMethod::RAYS),
+                                               cursor(0)
+{
+  ifstream fin(path);
+  if (!fin) {
+    throw runtime_error("cannot read the result store " + path);
+  }
+  read(fin, path);
+}
+
+ResultStore::ResultStore(istream &fin, string const &path) : distanceMethod(DistanceMethod::RAYS),
+                                                             cursor(0)
+{
+  read(fin, path);
+}
+
+void ResultStore::read(istream &fin, string const &path)
+{
+  string word;
+  int version = 0;
+  fin >> word >> version;
+  if (word != resultsMagic || version != resultsVersion) {
+    throw runtime_error(path + " is not a result store");
+  }
+  int method = 0;
+  size_t nbVolumes = 0, nbCompos = 0, nbEntries = 0;
+  fin >> word >> method;
+  distanceMethod = static_cast<DistanceMethod>(method);
+  fin >> word >> nbVolumes;
+  signatures.resize(nbVolumes);
+  for (auto &signature : signatures) {
+    fin >> hex >> signature >> dec;
+  }
+  fin >> word >> nbCompos;
+  compoNames.resize(nbCompos);
+  for (auto &name : compoNames) {
+    fin >> name;
+  }
+  fin >> word >> nbEntries;
+  if (!fin) {
+    throw runtime_error("malformed result store " + path);
+  }
+  entries.resize(nbEntries);
+  long previousIndex = 0;
+  for (auto &entry : entries) {
+    int verdict = 0;
+    fin >> entry.index >> entry.pointID >> entry.rank >> entry.compo >> verdict >> entry.distance;
+    entry.verdict = static_cast<Verdict>(verdict);
+    if (!fin || entry.index <= previousIndex || entry.rank >= long(nbVolumes) || entry.compo >= long(nbCompos)) {
+      throw runtime_error("malformed result store " + path);
+    }
+    previousIndex = entry.index;
+  }
+}
+
+void ResultStore::add(Entry const &entry)
+{
+  if (!entries.empty() && entry.index <= entries.back().index) {
+    throw invalid_argument("the results must be added in increasing index order");
+  }
+  entries.push_back(entry);
+}
+
+ResultStore::Entry const *ResultStore::find(long index)
+{
+  while (cursor < entries.size() && entries[cursor].index < index) {
+    ++cursor;
+  }
+  if (cursor < entries.size() && entries[cursor].index == index) {
+    return &entries[cursor];
+  }
+  return nullptr;
+}
+
+void ResultStore::save(string const &path) const
+{
+  ofstream fout(path);
+  if (!fout) {
+    throw runtime_error("cannot write the result store " + path);
+  }
+  save(fout);
+  if (!fout) {
+    throw runtime_error("cannot write the result store " + path);
+  }
+}
+
+void ResultStore::save(ostream &fout) const
+{
+  fout << resultsMagic << " " << resultsVersion << "\n";
+  fout << "distance " << int(distanceMethod) << "\n";
+  fout << "volumes " << signatures.size() << "\n";
+  fout << hex << setfill('0');
+  for (uint64_t signature : signatures) {
+    fout << setw(16) << signature << "\n";
+  }
+  fout << dec << setfill(' ');
+  fout << "compos " << compoNames.size() << "\n";
+  for (auto const &name : compoNames) {
+    fout << name << "\n";
+  }
+  fout << "points " << entries.size() << "\n";
+  fout << setprecision(17);
+  for (auto const &entry : entries) {
+    fout << entry.index << " " << entry.pointID << " " << entry.rank << " " << entry.compo << " "
+         << int(entry.verdict) << " " << entry.distance << "\n";
+  }
+}
+
+vector<uint64_t> const &ResultStore::getSignatures() const
+{
+  return signatures;
+}
+
+vector<string> const &ResultStore::getCompoNames() const
+{
+  return compoNames;
+}
+
+DistanceMethod ResultStore::getDistanceMethod() const
+{
+  return distanceMethod;
+}
+
+long ResultStore::getNbEntries() const
+{
+  return entries.size();
+}
+
+GeometryDiff::GeometryDiff(vector<uint64_t> const &previous, vector<uint64_t> const &current,
+                           vector<bool> const &fictive) : unchanged(previous.size(), false)
+{
+  for (size_t rank = 0; rank < current.size(); ++rank) {
+    if (rank < previous.size() && previous[rank] == current[rank]) {
+      unchanged[rank] = true;
+    } else if (!fictive[rank]) {
+      changedRanks.push_back(rank);
+    }
+  }
+}
+
+bool GeometryDiff::isUnchanged(long rank) const
+{
+  return rank >= 0 && rank < long(unchanged.size()) && unchanged[rank];
+}
+
+vector<long> const &GeometryDiff::getChangedRanks() const
+{
+  return changedRanks;
+}
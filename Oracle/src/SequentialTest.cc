@@ -0,0 +1,216 @@
+/**
+ * @file SequentialTest.cc
+ *
+ *
+ * @brief SequentialTest class
+ *
+ * @version 1.0
+ */
+
+#include "SequentialTest.hh"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <stdexcept>
+
+namespace
+{
+constexpr double pi = 3.14159265358979323846;
+
+/// ratio between the numbers of tested points at successive looks
+constexpr double lookRatio = 1.2;
+
+constexpr int maxContinuedFractionTerms = 10000;
+constexpr int nbBisections = 200;
+
+/// continued fraction of the incomplete beta function (modified Lentz method)
+double betaContinuedFraction(double a, double b, double x)
+{
+  double const tiny = 1.0e-300;
+  double const epsilon = 1.0e-15;
+  double c = 1.;
+  double d = 1. - (a + b) * x / (a + 1.);
+  if (std::fabs(d) < tiny) {
+    d = tiny;
+  }
+  d = 1. / d;
+  double result = d;
+  for (int m = 1; m <= maxContinuedFractionTerms; ++m) {
+    // even step
+    double numerator = m * (b - m) * x / ((a + 2. * m - 1.) * (a + 2. * m));
+    d = 1. + numerator * d;
+    d = std::fabs(d) < tiny ? 1. / tiny : 1. / d;
+    c = 1. + numerator / c;
+    if (std::fabs(c) < tiny) {
+      c = tiny;
+    }
+    result *= d * c;
+    // odd step
+    numerator = -(a + m) * (a + b + m) * x / ((a + 2. * m) * (a + 2. * m + 1.));
+    d = 1. + numerator * d;
+    d = std::fabs(d) < tiny ? 1. / tiny : 1. / d;
+    c = 1. + numerator / c;
+    if (std::fabs(c) < tiny) {
+      c = tiny;
+    }
+    double const delta = d * c;
+    result *= delta;
+    if (std::fabs(delta - 1.) < epsilon) {
+      break;
+    }
+  }
+  return result;
+}
+
+/// the regularised incomplete beta function I_x(a, b)
+double regularizedBeta(double a, double b, double x)
+{
+  if (x <= 0.) {
+    return 0.;
+  }
+  if (x >= 1.) {
+    return 1.;
+  }
+  double const logFront = std::lgamma(a + b) - std::lgamma(a) - std::lgamma(b)
+                          + a * std::log(x) + b * std::log1p(-x);
+  if (x < (a + 1.) / (a + b + 2.)) {
+    return std::exp(logFront) * betaContinuedFraction(a, b, x) / a;
+  }
+  return 1. - std::exp(logFront) * betaContinuedFraction(b, a, 1. - x) / b;
+}
+
+/// the quantile of the beta distribution, by bisection
+double betaQuantile(double a, double b, double probability)
+{
+  double low = 0., high = 1.;
+  for (int i = 0; i < nbBisections && high > low; ++i) {
+    double const middle = 0.5 * (low + high);
+    if (middle <= low || middle >= high) {
+      break;
+    }
+    if (regularizedBeta(a, b, middle) < probability) {
+      low = middle;
+    } else {
+      high = middle;
+    }
+  }
+  return 0.5 * (low + high);
+}
+} // namespace
+
+double clopperPearsonLower(long nbFailures, long nbTrials, double alpha)
+{
+  if (nbFailures <= 0) {
+    return 0.;
+  }
+  return betaQuantile(double(nbFailures), double(nbTrials - nbFailures + 1), alpha);
+}
+
+double clopperPearsonUpper(long nbFailures, long nbTrials, double alpha)
+{
+  if (nbFailures >= nbTrials) {
+    return 1.;
+  }
+  if (nbFailures == 0) {
+    // closed form, accurate for the tiny bounds of clean geometries
+    return -std::expm1(std::log(alpha) / nbTrials);
+  }
+  return betaQuantile(double(nbFailures + 1), double(nbTrials - nbFailures), 1. - alpha);
+}
+
+SequentialTest::SequentialTest(double maxFailureProbability, double confidence, long firstLook) : maxFailureProbability(maxFailureProbability),
+                                                                                                  confidence(confidence),
+                                                                                                  nextLook(double(firstLook)),
+                                                                                                  nbLooks(0),
+                                                                                                  nbTrials(0),
+                                                                                                  nbFailures(0),
+                                                                                                  lowerBound(0.),
+                                                                                                  upperBound(1.),
+                                                                                                  verdict(Verdict::CONTINUE)
+{
+  if (!(maxFailureProbability > 0. && maxFailureProbability < 1.)) {
+    throw std::invalid_argument("the maximum failure probability must be in (0, 1)");
+  }
+  if (!(confidence > 0. && confidence < 1.)) {
+    throw std::invalid_argument("the confidence must be in (0, 1)");
+  }
+  if (firstLook <= 0) {
+    throw std::invalid_argument("the first look must be positive");
+  }
+}
+
+SequentialTest::Verdict SequentialTest::update(long trials, long failures)
+{
+  if (verdict != Verdict::CONTINUE || double(trials) < nextLook) {
+    return verdict;
+  }
+  double const alpha = 6. * (1. - confidence) / (pi * pi * (nbLooks + 1.) * (nbLooks + 1.));
+  ++nbLooks;
+  nextLook = std::max(nextLook * lookRatio, double(trials + 1));
+  nbTrials = trials;
+  nbFailures = failures;
+  lowerBound = clopperPearsonLower(failures, trials, alpha);
+  upperBound = clopperPearsonUpper(failures, trials, alpha);
+  if (upperBound < maxFailureProbability) {
+    verdict = Verdict::ACCEPTED;
+  } else if (lowerBound > maxFailureProbability) {
+    verdict = Verdict::REJECTED;
+  }
+  return verdict;
+}
+
+SequentialTest::Verdict SequentialTest::getVerdict() const
+{
+  return verdict;
+}
+
+long SequentialTest::getNbTrials() const
+{
+  return nbTrials;
+}
+
+long SequentialTest::getNbFailures() const
+{
+  return nbFailures;
+}
+
+double SequentialTest::getLowerBound() const
+{
+  return lowerBound;
+}
+
+double SequentialTest::getUpperBound() const
+{
+  return upperBound;
+}
+
+double SequentialTest::getMaxFailureProbability() const
+{
+  return maxFailureProbability;
+}
+
+double SequentialTest::getConfidence() const
+{
+  return confidence;
+}
+
+int SequentialTest::getNbLooks() const
+{
+  return nbLooks;
+}
+
+void SequentialTest::saveState(std::ostream &stream) const
+{
+  stream << std::setprecision(17) << nextLook << " " << nbLooks << " " << nbTrials << " " << nbFailures << " "
+         << lowerBound << " " << upperBound << " " << int(verdict) << "\n";
+}
+
+void SequentialTest::restoreState(std::istream &stream)
+{
+  int state = 0;
+  stream >> nextLook >> nbLooks >> nbTrials >> nbFailures >> lowerBound >> upperBound >> state;
+  if (!stream) {
+    throw std::runtime_error("malformed sequential test state");
+  }
+  verdict = static_cast<Verdict>(state);
+}
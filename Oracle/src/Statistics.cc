@@ -9,21 +9,47 @@
 */
 
 #include "Statistics.hh"
+#include "Log.hh"
+#ifdef ORACLE_WITH_T4
 #include "errorCC.hh"
 #include "t4storeevent.hh"
+#endif
 #include <algorithm>
 #include <cstdlib>
 #include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <utility>
 
 using namespace std;
 
+namespace
+{
+/// first word of the statistics files
+const string statisticsMagic = "ORACLESTATS";
+constexpr int statisticsVersion = 3;
+
+/// number of off-diagonal entries of the confusion matrix printed by report()
+constexpr size_t maxReportedConfusions = 10;
+
+/// prints the quantiles of the distances of a class of points
+void reportDistances(string const &status, DistanceSummary const &distances)
+{
+  ORACLE_LOG(INFO) << "Distance to surface for " << status << " points: p50 = " << distances.quantile(0.5)
+                   << ", p90 = " << distances.quantile(0.9) << ", p99 = " << distances.quantile(0.99)
+                   << ", standard deviation = " << distances.getMoments().getStandardDeviation();
+}
+} // namespace
+
 Statistics::Statistics()
 {
   nbSuccess = 0;
   nbFailure = 0;
   nbIgnored = 0;
   nbOutside = 0;
+  nbSkipped = 0;
   nbT4Volumes = 0;
 }
 
@@ -42,16 +68,72 @@ void Statistics::incrementIgnore()
   ++nbIgnored;
 }
 
+void Statistics::incrementIgnore(double dist)
+{
+  ++nbIgnored;
+  ignoredDistances.add(dist);
+}
+
 void Statistics::incrementOutside()
 {
   ++nbOutside;
 }
 
+void Statistics::incrementSkipped()
+{
+  ++nbSkipped;
+}
+
+long Statistics::getNbSkipped()
+{
+  return nbSkipped;
+}
+
 int Statistics::getTotalPts()
 {
   return nbSuccess + nbFailure + nbIgnored + nbOutside;
 }
 
+int Statistics::getNbTested()
+{
+  return nbSuccess + nbFailure + nbIgnored;
+}
+
+int Statistics::getNbFailure()
+{
+  return nbFailure;
+}
+
+int Statistics::getNbSuccess()
+{
+  return nbSuccess;
+}
+
+int Statistics::getNbIgnored()
+{
+  return nbIgnored;
+}
+
+int Statistics::getNbOutside()
+{
+  return nbOutside;
+}
+
+long Statistics::getNbCovered()
+{
+  return coveredRanks.size();
+}
+
+long Statistics::getNbT4Volumes()
+{
+  return nbT4Volumes;
+}
+
+void Statistics::recordSequentialTest(SequentialTest const &test)
+{
+  sequentialTest.reset(new SequentialTest(test));
+}
+
 void Statistics::recordCoveredRank(long rank)
 {
   coveredRanks.insert(rank);
@@ -62,7 +144,12 @@ void Statistics::setNbT4Volumes(long nbVolumes)
   nbT4Volumes = nbVolumes;
 }
 
-void Statistics::recordFailure(vector<double> position, long rank, int pointID, int cellID, int materialID, double dist)
+void Statistics::recordLocation(long cellID, long volume)
+{
+  confusionMatrix.add(cellID, volume);
+}
+
+void Statistics::recordFailure(vector<double> position, long rank, int64_t pointID, int cellID, int materialID, double dist)
 {
   failedPoint failed{{position[0], position[1], position[2]},
                      double(pointID),
@@ -70,7 +157,73 @@ void Statistics::recordFailure(vector<double> position, long rank, int pointID,
                      double(materialID),
                      dist,
                      double(rank)};
-  failures.push_back(failed);
+  failureDistances.add(dist);
+  if (failureSink) {
+    failureSink->add(failed);
+  } else {
+    failures.push_back(failed);
+  }
+}
+
+void Statistics::streamFailures(string const &path, bool resume)
+{
+  failureSink.reset(new FailureSink(path, 65536, resume));
+}
+
+FailureSink *Statistics::getFailureSink()
+{
+  return failureSink.get();
+}
+
+void Statistics::closeFailureSink()
+{
+  if (failureSink) {
+    failureSink->close();
+  }
+}
+
+DistanceSummary const &Statistics::getFailureDistances() const
+{
+  return failureDistances;
+}
+
+DistanceSummary const &Statistics::getIgnoredDistances() const
+{
+  return ignoredDistances;
+}
+
+ConfusionMatrix const &Statistics::getConfusionMatrix() const
+{
+  return confusionMatrix;
+}
+
+EventRecord Statistics::getSummaryEvent(std::string const &t4Filename)
+{
+  EventRecord record("summary");
+  record.add("t4_file", t4Filename)
+    .add("total", getTotalPts())
+    .add("tested", getNbTested())
+    .add("successful", getNbSuccess())
+    .add("failed", getNbFailure())
+    .add("ignored", getNbIgnored())
+    .add("outside", getNbOutside())
+    .add("skipped", getNbSkipped())
+    .add("covered_volumes", getNbCovered())
+    .add("t4_volumes", getNbT4Volumes());
+  for (auto const &item : {std::make_pair("failed", &failureDistances), std::make_pair("ignored", &ignoredDistances)}) {
+    std::string const prefix = std::string(item.first) + "_distance_";
+    DistanceSummary const &summary = *item.second;
+    bool const empty = summary.getMoments().getCount() == 0;
+    double const none = std::numeric_limits<double>::quiet_NaN();
+    // written as null when there is no point
+    record.add(prefix + "mean", empty ? none : summary.getMoments().getMean())
+      .add(prefix + "max", empty ? none : summary.getMoments().getMax())
+      .add(prefix + "p50", empty ? none : summary.quantile(0.5))
+      .add(prefix + "p90", empty ? none : summary.quantile(0.9))
+      .add(prefix + "p99", empty ? none : summary.quantile(0.99));
+  }
+  record.add("cells_in_several_volumes", confusionMatrix.getNbSplitCells());
+  return record;
 }
 
 vector<failedPoint> Statistics::getFailures()
@@ -78,45 +231,227 @@ vector<failedPoint> Statistics::getFailures()
   return failures;
 }
 
-void Statistics::report()
+vector<failedPoint> Statistics::takeFailures()
+{
+  vector<failedPoint> taken = std::move(failures);
+  failures.clear();
+  return taken;
+}
+
+vector<long> Statistics::getUncoveredRanks() const
+{
+  vector<long> result;
+  for (long rank = 0; rank < nbT4Volumes; ++rank) {
+    if (coveredRanks.count(rank) == 0) {
+      result.push_back(rank);
+    }
+  }
+  return result;
+}
+
+void Statistics::save(string const &path) const
+{
+  ofstream fout(path);
+  if (!fout) {
+    throw runtime_error("cannot write the statistics file " + path);
+  }
+  save(fout);
+}
+
+void Statistics::save(ostream &fout) const
+{
+  fout << statisticsMagic << " " << statisticsVersion << "\n";
+  fout << "counts " << nbSuccess << " " << nbFailure << " " << nbIgnored << " " << nbOutside << " "
+       << nbSkipped << "\n";
+  fout << "volumes " << nbT4Volumes << "\n";
+  fout << "covered " << coveredRanks.size();
+  for (long rank : coveredRanks) {
+    fout << " " << rank;
+  }
+  fout << "\n";
+  fout << "failuredistances ";
+  failureDistances.save(fout);
+  fout << "ignoreddistances ";
+  ignoredDistances.save(fout);
+  fout << "confusion ";
+  confusionMatrix.save(fout);
+  fout << "failures " << failures.size() << "\n";
+  fout << setprecision(17);
+  for (auto const &failed : failures) {
+    fout << failed.position[0] << " " << failed.position[1] << " " << failed.position[2] << " "
+         << failed.mcnpParticleID << " " << failed.mcnpCellID << " " << failed.mcnpMaterialID << " "
+         << failed.dist << " " << failed.rank << "\n";
+  }
+}
+
+void Statistics::merge(string const &path)
+{
+  ifstream fin(path);
+  if (!fin) {
+    throw runtime_error("cannot read the statistics file " + path);
+  }
+  merge(fin, path);
+}
+
+void Statistics::merge(istream &fin, string const &path)
 {
-  cout << "\n---------------------------" << endl;
-  cout << "Reporting on MCNP/T4 geometry comparison" << endl;
-  cout << "-----------------------------" << endl;
+  string word;
+  int version = 0;
+  fin >> word >> version;
+  // the files of version 1 have no distance summaries, the ones of version 2 no confusion matrix
+  if (word != statisticsMagic || version < 1 || version > statisticsVersion) {
+    throw runtime_error(path + " is not a statistics file");
+  }
+  int success = 0, failure = 0, ignored = 0, outside = 0;
+  long skipped = 0, volumes = 0;
+  size_t nbCovered = 0, nbFailed = 0;
+  fin >> word >> success >> failure >> ignored >> outside >> skipped;
+  fin >> word >> volumes;
+  if (!fin) {
+    throw runtime_error("malformed statistics file " + path);
+  }
+  if (nbT4Volumes != 0 && volumes != nbT4Volumes) {
+    throw runtime_error(path + " was written for a geometry with " + to_string(volumes)
+                        + " volumes, not " + to_string(nbT4Volumes));
+  }
+  fin >> word >> nbCovered;
+  set<long> covered;
+  for (size_t i = 0; i < nbCovered; ++i) {
+    long rank;
+    fin >> rank;
+    covered.insert(rank);
+  }
+  DistanceSummary failedDistances, ignoredDistancesRead;
+  if (version >= 2) {
+    fin >> word;
+    failedDistances.read(fin, path);
+    fin >> word;
+    ignoredDistancesRead.read(fin, path);
+  }
+  ConfusionMatrix confusion;
+  if (version >= 3) {
+    fin >> word;
+    confusion.read(fin, path);
+  }
+  fin >> word >> nbFailed;
+  vector<failedPoint> failed(nbFailed);
+  for (auto &point : failed) {
+    fin >> point.position[0] >> point.position[1] >> point.position[2] >> point.mcnpParticleID
+        >> point.mcnpCellID >> point.mcnpMaterialID >> point.dist >> point.rank;
+  }
+  // with --stream-failures, the failed points are in the failures file instead
+  bool const streamed = failureSink && failed.empty();
+  if (!fin || (failed.size() != size_t(failure) && !streamed)) {
+    throw runtime_error("malformed statistics file " + path);
+  }
 
-  double maxDist = 0.;
-  double averageDist = 0.;
-  for(auto const &failedPoint: failures) {
-    averageDist += failedPoint.dist;
-    maxDist = std::max(maxDist, failedPoint.dist);
+  nbSuccess += success;
+  nbFailure += failure;
+  nbIgnored += ignored;
+  nbOutside += outside;
+  nbSkipped += skipped;
+  nbT4Volumes = volumes;
+  coveredRanks.insert(covered.begin(), covered.end());
+  if (version < 2) {
+    for (auto const &point : failed) {
+      failedDistances.add(point.dist);
+    }
   }
-  averageDist /= failures.size();
+  failureDistances.merge(failedDistances);
+  ignoredDistances.merge(ignoredDistancesRead);
+  confusionMatrix.merge(confusion);
+  failures.insert(failures.end(), failed.begin(), failed.end());
+}
+
+void Statistics::restore(istream &stream, string const &name)
+{
+  unique_ptr<FailureSink> sink = std::move(failureSink);
+  *this = Statistics();
+  failureSink = std::move(sink);
+  merge(stream, name);
+}
+
+void Statistics::report()
+{
+  // the report is printed in one piece
+  LogGroup group;
+  ORACLE_LOG(INFO) << "\n---------------------------";
+  ORACLE_LOG(INFO) << "Reporting on MCNP/T4 geometry comparison";
+  ORACLE_LOG(INFO) << "-----------------------------";
 
   int totalPt = getTotalPts();
-  cout << "Number of SAMPLED points : " << totalPt << endl;
+  ORACLE_LOG(INFO) << "Number of SAMPLED points : " << totalPt;
   reportOn("SUCCESSFUL", nbSuccess, totalPt);
   reportOn("FAILED    ", nbFailure, totalPt);
   reportOn("IGNORED   ", nbIgnored, totalPt);
   reportOn("OUTSIDE   ", nbOutside, totalPt);
-  cout << "Number of COVERED volumes: " << coveredRanks.size() << endl;
-  cout << "Number of INPUT   volumes: " << nbT4Volumes << endl;
-  cout << "Average distance to surface for FAILED points: " << averageDist << endl;
-  cout << "Maximum distance to surface for FAILED points: " << maxDist << endl;
+  if (nbSkipped > 0) {
+    ORACLE_LOG(INFO) << "Number of SKIPPED points (not compared): " << nbSkipped;
+  }
+  ORACLE_LOG(INFO) << "Number of COVERED volumes: " << coveredRanks.size();
+  ORACLE_LOG(INFO) << "Number of INPUT   volumes: " << nbT4Volumes;
+  // kept online: the failed points may have been streamed to a file
+  ORACLE_LOG(INFO) << "Average distance to surface for FAILED points: " << failureDistances.getMoments().getMean();
+  ORACLE_LOG(INFO) << "Maximum distance to surface for FAILED points: " << failureDistances.getMoments().getMax();
+  if (failureDistances.getMoments().getCount() > 0) {
+    reportDistances("FAILED ", failureDistances);
+  }
+  if (ignoredDistances.getMoments().getCount() > 0) {
+    reportDistances("IGNORED", ignoredDistances);
+  }
+  if (confusionMatrix.getNbEntries() > 0) {
+    confusionMatrix.report(LogMessage(LogLevel::INFO).stream(), maxReportedConfusions);
+  }
+
+  if (sequentialTest) {
+    char const *verdict = "UNDECIDED";
+    switch (sequentialTest->getVerdict()) {
+    case SequentialTest::Verdict::ACCEPTED:
+      verdict = "ACCEPTED";
+      break;
+    case SequentialTest::Verdict::REJECTED:
+      verdict = "REJECTED";
+      break;
+    case SequentialTest::Verdict::CONTINUE:
+      break;
+    }
+    ORACLE_LOG(INFO) << "Sequential test (failure probability " << sequentialTest->getMaxFailureProbability()
+                     << ", confidence " << sequentialTest->getConfidence() << "): " << verdict << " after "
+                     << sequentialTest->getNbTrials() << " tested points (" << sequentialTest->getNbLooks()
+                     << " looks)";
+    ORACLE_LOG(INFO) << "Clopper-Pearson bounds on the failure probability: ["
+                     << sequentialTest->getLowerBound() << ", " << sequentialTest->getUpperBound() << "]";
+  }
 }
 
 void Statistics::reportOn(const string &status, int data, int total)
 {
-  cout << "Number of " << status << "     : " << data
-       << " -> "
-       << 100. * float(data) / float(total)
-       << "%" << endl;
+  ORACLE_LOG(INFO) << "Number of " << status << "     : " << data << " -> " << 100. * float(data) / float(total) << "%";
 }
 
-void Statistics::writeOutForVisu(string &fname)
+void Statistics::writeOutForVisu(string &rawname)
+{
+  if (failureSink) {
+    ORACLE_LOG(INFO) << "Failed points streamed to " << failureSink->getPath()
+                     << "; convert them with failuresToVisu for the T4 visualiser";
+    return;
+  }
+  size_t next = 0;
+  writeFailedPoints(rawname, [this, &next](failedPoint &point) {
+    if (next >= failures.size()) {
+      return false;
+    }
+    point = failures[next++];
+    return true;
+  });
+}
+
+void Statistics::writeFailedPoints(string &rawname, function<bool(failedPoint &)> const &next)
 {
-  T4_event_storing<failedPoint> t4_store;
-  string rawname = getRawFileName(fname);
   string datFile = rawname + ".failedpoints.dat";
+  failedPoint point;
+#ifdef ORACLE_WITH_T4
+  T4_event_storing<failedPoint> t4_store;
   t4_store.initialize(const_cast<char *>(datFile.c_str()),
                       T4_OUTPUT,
                       ASCII,
@@ -130,12 +465,22 @@ void Statistics::writeOutForVisu(string &fname)
                       T4_TYPE_DOUBLE, "rank",
                       T4_NO_TYPE);
 
-  for (int iFail = 0; iFail < nbFailure; iFail++) {
-    t4_store.store(&failures[iFail]);
+  while (next(point)) {
+    t4_store.store(&point);
   }
   t4_store.write_header_dx();
   writePointsFile(rawname);
   t4_store.finalize();
+#else
+  // same columns as the T4 event file, without the OpenDX header
+  ofstream fout(datFile);
+  fout << scientific << setprecision(12);
+  while (next(point)) {
+    fout << point.position[0] << " " << point.position[1] << " " << point.position[2] << " "
+         << int64_t(point.mcnpParticleID) << " " << point.mcnpCellID << " " << point.mcnpMaterialID << " "
+         << point.dist << " " << point.rank << "\n";
+  }
+#endif
 }
 
 string Statistics::getRawFileName(string &fname)
@@ -0,0 +1,619 @@
+/**
+ * @file SurfaceTable.cc
+ *
+ *
+ * @brief SurfaceTable class
+ *
+ * @version 1.0
+ */
+
+#include "SurfaceTable.hh"
+#include <cmath>
+#include <vector>
+#include <stdexcept>
+
+namespace
+{
+constexpr double pi = 3.14159265358979323846;
+
+/// number of sampling intervals used to bracket the roots of a torus along a ray
+constexpr int nbTorusRaySamples = 256;
+constexpr int nbBisections = 64;
+
+/**
+ * A quadric in matrix form: f(p) = p^T A p + b.p + c, with A symmetric and
+ * stored in row-major order.
+ */
+struct QuadricMatrix {
+  std::array<double, 9> a;
+  std::array<double, 3> b;
+  double c;
+};
+
+/// the quadric (p-p0)^T M (p-p0) + k
+QuadricMatrix centredQuadric(std::array<double, 9> const &m, std::array<double, 3> const &p0, double k)
+{
+  QuadricMatrix q{m, {0., 0., 0.}, k};
+  for (int i = 0; i < 3; ++i) {
+    for (int j = 0; j < 3; ++j) {
+      q.b[i] -= 2. * m[3 * i + j] * p0[j];
+      q.c += p0[i] * m[3 * i + j] * p0[j];
+    }
+  }
+  return q;
+}
+
+/// the linear function n.p + d
+QuadricMatrix linearQuadric(std::array<double, 3> const &n, double d)
+{
+  return QuadricMatrix{{0., 0., 0., 0., 0., 0., 0., 0., 0.}, n, d};
+}
+
+/// the matrix I - factor * u u^T, with u normalised
+std::array<double, 9> axialMatrix(std::array<double, 3> u, double factor)
+{
+  double const norm = std::sqrt(u[0] * u[0] + u[1] * u[1] + u[2] * u[2]);
+  if (norm == 0.) {
+    throw std::runtime_error("null axis vector in surface definition");
+  }
+  for (auto &component : u) {
+    component /= norm;
+  }
+  std::array<double, 9> m;
+  for (int i = 0; i < 3; ++i) {
+    for (int j = 0; j < 3; ++j) {
+      m[3 * i + j] = (i == j ? 1. : 0.) - factor * u[i] * u[j];
+    }
+  }
+  return m;
+}
+
+std::array<double, 3> unitAxis(int axis)
+{
+  std::array<double, 3> u = {0., 0., 0.};
+  u[axis] = 1.;
+  return u;
+}
+
+/// applies local = R^T (global - t) to a quadric defined in local coordinates
+QuadricMatrix transformQuadric(QuadricMatrix const &local, SurfaceTransform const &transform)
+{
+  auto const &r = transform.rotation;
+  auto const &t = transform.translation;
+  QuadricMatrix global{{0., 0., 0., 0., 0., 0., 0., 0., 0.}, {0., 0., 0.}, local.c};
+  // A' = R A R^T
+  for (int i = 0; i < 3; ++i) {
+    for (int j = 0; j < 3; ++j) {
+      double sum = 0.;
+      for (int k = 0; k < 3; ++k) {
+        for (int l = 0; l < 3; ++l) {
+          sum += r[3 * i + k] * local.a[3 * k + l] * r[3 * j + l];
+        }
+      }
+      global.a[3 * i + j] = sum;
+    }
+  }
+  // b'' = R b
+  std::array<double, 3> rb = {0., 0., 0.};
+  for (int i = 0; i < 3; ++i) {
+    for (int k = 0; k < 3; ++k) {
+      rb[i] += r[3 * i + k] * local.b[k];
+    }
+  }
+  // linear part: b'' - 2 A' t; constant part: t^T A' t - b''.t + c
+  for (int i = 0; i < 3; ++i) {
+    global.b[i] = rb[i];
+    global.c -= rb[i] * t[i];
+    for (int j = 0; j < 3; ++j) {
+      global.b[i] -= 2. * global.a[3 * i + j] * t[j];
+      global.c += t[i] * global.a[3 * i + j] * t[j];
+    }
+  }
+  return global;
+}
+
+std::array<double, SurfaceTable::NB_COEFFICIENTS> toCoefficients(QuadricMatrix const &q)
+{
+  return {{q.a[0], q.a[4], q.a[8],
+           2. * q.a[1], 2. * q.a[5], 2. * q.a[2],
+           q.b[0], q.b[1], q.b[2], q.c}};
+}
+
+QuadricMatrix fromCoefficients(std::vector<double> const &p)
+{
+  // A B C D E F G H J K: Ax^2 + By^2 + Cz^2 + Dxy + Eyz + Fzx + Gx + Hy + Jz + K
+  return QuadricMatrix{{p[0], 0.5 * p[3], 0.5 * p[5],
+                        0.5 * p[3], p[1], 0.5 * p[4],
+                        0.5 * p[5], 0.5 * p[4], p[2]},
+                       {p[6], p[7], p[8]},
+                       p[9]};
+}
+
+int axisOfType(SurfaceType type)
+{
+  switch (type) {
+  case SurfaceType::PLANEX:
+  case SurfaceType::CYLX:
+  case SurfaceType::CONEX:
+  case SurfaceType::TORUSX:
+    return 0;
+  case SurfaceType::PLANEY:
+  case SurfaceType::CYLY:
+  case SurfaceType::CONEY:
+  case SurfaceType::TORUSY:
+    return 1;
+  default:
+    return 2;
+  }
+}
+
+/// smallest non-negative root of a s^2 + b s + c within [0, maxDist], or -1
+double smallestRoot(double a, double b, double c, double maxDist)
+{
+  if (c == 0.) {
+    return 0.;
+  }
+  double root = -1.;
+  auto consider = [&](double s) {
+    if (s >= 0. && s <= maxDist && (root < 0. || s < root)) {
+      root = s;
+    }
+  };
+  double const scale = std::fabs(b) + std::fabs(c);
+  if (std::fabs(a) <= 1e-14 * scale) {
+    if (b != 0.) {
+      consider(-c / b);
+    }
+    return root;
+  }
+  double const disc = b * b - 4. * a * c;
+  if (disc < 0.) {
+    return root;
+  }
+  double const q = -0.5 * (b + std::copysign(std::sqrt(disc), b));
+  consider(q / a);
+  if (q != 0.) {
+    consider(c / q);
+  }
+  return root;
+}
+/// the bounds implied by a quadric half-space, or an infinite box
+BoundingBox quadricBounds(std::array<double, SurfaceTable::NB_COEFFICIENTS> const &q, int sign)
+{
+  BoundingBox box = infiniteBox();
+  std::array<double, 9> const a = {q[SurfaceTable::XX], 0.5 * q[SurfaceTable::XY], 0.5 * q[SurfaceTable::ZX],
+                                   0.5 * q[SurfaceTable::XY], q[SurfaceTable::YY], 0.5 * q[SurfaceTable::YZ],
+                                   0.5 * q[SurfaceTable::ZX], 0.5 * q[SurfaceTable::YZ], q[SurfaceTable::ZZ]};
+  std::array<double, 3> const b = {q[SurfaceTable::X], q[SurfaceTable::Y], q[SurfaceTable::Z]};
+  std::vector<int> axes;
+  bool quadratic = false;
+  for (int i = 0; i < 3; ++i) {
+    bool const rowUsed = a[3 * i] != 0. || a[3 * i + 1] != 0. || a[3 * i + 2] != 0.;
+    quadratic = quadratic || rowUsed;
+    if (rowUsed || b[i] != 0.) {
+      axes.push_back(i);
+    }
+  }
+
+  if (!quadratic) {
+    // planes perpendicular to an axis
+    if (axes.size() == 1) {
+      int const i = axes[0];
+      double const position = -q[SurfaceTable::C] / b[i];
+      bool const upper = (b[i] > 0.) == (sign > 0);
+      box[2 * i + (upper ? 0 : 1)] = position;
+    }
+    return box;
+  }
+
+  // only the inside of an ellipsoidal (or elliptic cylindrical) quadric is bounded
+  if (sign > 0) {
+    return box;
+  }
+  int const n = axes.size();
+  // restrict A to the used axes and invert it by Gauss-Jordan elimination
+  std::vector<double> m(n * 2 * n, 0.);
+  for (int i = 0; i < n; ++i) {
+    for (int j = 0; j < n; ++j) {
+      m[i * 2 * n + j] = a[3 * axes[i] + axes[j]];
+    }
+    m[i * 2 * n + n + i] = 1.;
+  }
+  for (int col = 0; col < n; ++col) {
+    double const pivot = m[col * 2 * n + col];
+    // positive pivots without row exchanges <=> positive-definite matrix
+    if (!(pivot > 0.)) {
+      return box;
+    }
+    for (int j = 0; j < 2 * n; ++j) {
+      m[col * 2 * n + j] /= pivot;
+    }
+    for (int i = 0; i < n; ++i) {
+      if (i != col) {
+        double const factor = m[i * 2 * n + col];
+        for (int j = 0; j < 2 * n; ++j) {
+          m[i * 2 * n + j] -= factor * m[col * 2 * n + j];
+        }
+      }
+    }
+  }
+  auto inverse = [&](int i, int j) { return m[i * 2 * n + n + j]; };
+  // centre: c = -A^-1 b / 2; f = (p-c)^T A (p-c) + k with k = C - c^T A c
+  std::vector<double> centre(n, 0.);
+  for (int i = 0; i < n; ++i) {
+    for (int j = 0; j < n; ++j) {
+      centre[i] -= 0.5 * inverse(i, j) * b[axes[j]];
+    }
+  }
+  double k = q[SurfaceTable::C];
+  for (int i = 0; i < n; ++i) {
+    for (int j = 0; j < n; ++j) {
+      k -= centre[i] * a[3 * axes[i] + axes[j]] * centre[j];
+    }
+  }
+  if (k >= 0.) {
+    // empty inside
+    return emptyBox();
+  }
+  for (int i = 0; i < n; ++i) {
+    double const halfWidth = std::sqrt(-k * inverse(i, i));
+    box[2 * axes[i]] = centre[i] - halfWidth;
+    box[2 * axes[i] + 1] = centre[i] + halfWidth;
+  }
+  return box;
+}
+} // namespace
+
+bool surfaceTypeFromKeyword(std::string const &keyword, SurfaceType &type)
+{
+  static const std::unordered_map<std::string, SurfaceType> keywords = {
+      {"PLANEX", SurfaceType::PLANEX}, {"PLANEY", SurfaceType::PLANEY}, {"PLANEZ", SurfaceType::PLANEZ}, {"PLANE", SurfaceType::PLANE}, {"SPHERE", SurfaceType::SPHERE}, {"CYLX", SurfaceType::CYLX}, {"CYLY", SurfaceType::CYLY}, {"CYLZ", SurfaceType::CYLZ}, {"CYL", SurfaceType::CYL}, {"CONEX", SurfaceType::CONEX}, {"CONEY", SurfaceType::CONEY}, {"CONEZ", SurfaceType::CONEZ}, {"CONE", SurfaceType::CONE}, {"QUAD", SurfaceType::QUAD}, {"TORUSX", SurfaceType::TORUSX}, {"TORUSY", SurfaceType::TORUSY}, {"TORUSZ", SurfaceType::TORUSZ}};
+  auto const it = keywords.find(keyword);
+  if (it == keywords.end()) {
+    return false;
+  }
+  type = it->second;
+  return true;
+}
+
+int nbSurfaceParameters(SurfaceType type)
+{
+  switch (type) {
+  case SurfaceType::PLANEX:
+  case SurfaceType::PLANEY:
+  case SurfaceType::PLANEZ:
+    return 1;
+  case SurfaceType::CYLX:
+  case SurfaceType::CYLY:
+  case SurfaceType::CYLZ:
+    return 3;
+  case SurfaceType::PLANE:
+  case SurfaceType::SPHERE:
+  case SurfaceType::CONEX:
+  case SurfaceType::CONEY:
+  case SurfaceType::CONEZ:
+    return 4;
+  case SurfaceType::TORUSX:
+  case SurfaceType::TORUSY:
+  case SurfaceType::TORUSZ:
+    return 6;
+  case SurfaceType::CYL:
+  case SurfaceType::CONE:
+    return 7;
+  case SurfaceType::QUAD:
+    return 10;
+  }
+  return 0;
+}
+
+long SurfaceTable::addSurface(long number, SurfaceType type, std::vector<double> const &params,
+                              SurfaceTransform const *transform)
+{
+  if (int(params.size()) != nbSurfaceParameters(type)) {
+    throw std::runtime_error("wrong number of parameters for surface " + std::to_string(number));
+  }
+
+  std::array<double, 9> const identity = {1., 0., 0., 0., 1., 0., 0., 0., 1.};
+  QuadricMatrix local;
+  switch (type) {
+  case SurfaceType::PLANEX:
+  case SurfaceType::PLANEY:
+  case SurfaceType::PLANEZ:
+    local = linearQuadric(unitAxis(axisOfType(type)), -params[0]);
+    break;
+  case SurfaceType::PLANE:
+    local = linearQuadric({params[0], params[1], params[2]}, params[3]);
+    break;
+  case SurfaceType::SPHERE:
+    local = centredQuadric(identity, {params[0], params[1], params[2]}, -params[3] * params[3]);
+    break;
+  case SurfaceType::CYLX:
+  case SurfaceType::CYLY:
+  case SurfaceType::CYLZ: {
+    int const axis = axisOfType(type);
+    std::array<double, 3> centre = {0., 0., 0.};
+    // the two coordinates of the axis, in x, y, z order
+    centre[axis == 0 ? 1 : 0] = params[0];
+    centre[axis == 2 ? 1 : 2] = params[1];
+    local = centredQuadric(axialMatrix(unitAxis(axis), 1.), centre, -params[2] * params[2]);
+    break;
+  }
+  case SurfaceType::CYL:
+    local = centredQuadric(axialMatrix({params[4], params[5], params[6]}, 1.),
+                           {params[0], params[1], params[2]}, -params[3] * params[3]);
+    break;
+  case SurfaceType::CONEX:
+  case SurfaceType::CONEY:
+  case SurfaceType::CONEZ:
+  case SurfaceType::CONE: {
+    double const tanTheta = std::tan(params[3] * pi / 180.);
+    std::array<double, 3> const axis = type == SurfaceType::CONE ? std::array<double, 3>{{params[4], params[5], params[6]}} : unitAxis(axisOfType(type));
+    local = centredQuadric(axialMatrix(axis, 1. + tanTheta * tanTheta),
+                           {params[0], params[1], params[2]}, 0.);
+    break;
+  }
+  case SurfaceType::QUAD:
+    local = fromCoefficients(params);
+    break;
+  case SurfaceType::TORUSX:
+  case SurfaceType::TORUSY:
+  case SurfaceType::TORUSZ: {
+    long const slot = torusCentres.size();
+    torusCentres.push_back({{params[0], params[1], params[2]}});
+    torusRadii.push_back({{params[3], params[4], params[5]}});
+    torusRotations.push_back(transform ? transform->rotation : identity);
+    torusTranslations.push_back(transform ? transform->translation : std::array<double, 3>{{0., 0., 0.}});
+    torusAxes.push_back(axisOfType(type));
+    if (params[4] == 0. || params[5] == 0.) {
+      throw std::runtime_error("degenerate torus " + std::to_string(number));
+    }
+    long const index = numbers.size();
+    numbers.push_back(number);
+    types.push_back(type);
+    slots.push_back(-slot - 1);
+    indexOfNumber[number] = index;
+    return index;
+  }
+  }
+
+  QuadricMatrix const global = transform ? transformQuadric(local, *transform) : local;
+  return addQuadric(number, type, toCoefficients(global));
+}
+
+long SurfaceTable::addQuadric(long number, SurfaceType type, std::array<double, NB_COEFFICIENTS> const &coefficients)
+{
+  long const index = numbers.size();
+  numbers.push_back(number);
+  types.push_back(type);
+  slots.push_back(quadrics[0].size());
+  for (int i = 0; i < NB_COEFFICIENTS; ++i) {
+    quadrics[i].push_back(coefficients[i]);
+  }
+  indexOfNumber[number] = index;
+  return index;
+}
+
+long SurfaceTable::size() const
+{
+  return numbers.size();
+}
+
+long SurfaceTable::indexOf(long number) const
+{
+  auto const it = indexOfNumber.find(number);
+  return it == indexOfNumber.end() ? -1 : it->second;
+}
+
+long SurfaceTable::getNumber(long index) const
+{
+  return numbers[index];
+}
+
+SurfaceType SurfaceTable::getType(long index) const
+{
+  return types[index];
+}
+
+bool SurfaceTable::isTorus(long index) const
+{
+  return slots[index] < 0;
+}
+
+std::array<double, SurfaceTable::NB_COEFFICIENTS> SurfaceTable::getQuadric(long index) const
+{
+  long const slot = slots[index];
+  std::array<double, NB_COEFFICIENTS> coefficients;
+  for (int i = 0; i < NB_COEFFICIENTS; ++i) {
+    coefficients[i] = quadrics[i][slot];
+  }
+  return coefficients;
+}
+
+std::vector<double> SurfaceTable::getParameters(long index) const
+{
+  if (!isTorus(index)) {
+    auto const coefficients = getQuadric(index);
+    return std::vector<double>(coefficients.begin(), coefficients.end());
+  }
+  long const torus = -slots[index] - 1;
+  std::vector<double> parameters;
+  parameters.insert(parameters.end(), torusCentres[torus].begin(), torusCentres[torus].end());
+  parameters.insert(parameters.end(), torusRadii[torus].begin(), torusRadii[torus].end());
+  parameters.insert(parameters.end(), torusRotations[torus].begin(), torusRotations[torus].end());
+  parameters.insert(parameters.end(), torusTranslations[torus].begin(), torusTranslations[torus].end());
+  return parameters;
+}
+
+double SurfaceTable::evaluate(long index, double x, double y, double z) const
+{
+  long const slot = slots[index];
+  if (slot < 0) {
+    return evaluateTorus(-slot - 1, x, y, z);
+  }
+  return quadrics[XX][slot] * x * x + quadrics[YY][slot] * y * y + quadrics[ZZ][slot] * z * z
+         + quadrics[XY][slot] * x * y + quadrics[YZ][slot] * y * z + quadrics[ZX][slot] * z * x
+         + quadrics[X][slot] * x + quadrics[Y][slot] * y + quadrics[Z][slot] * z + quadrics[C][slot];
+}
+
+std::array<double, 3> SurfaceTable::gradient(long index, double x, double y, double z) const
+{
+  long const slot = slots[index];
+  if (slot >= 0) {
+    return {{2. * quadrics[XX][slot] * x + quadrics[XY][slot] * y + quadrics[ZX][slot] * z + quadrics[X][slot],
+             2. * quadrics[YY][slot] * y + quadrics[XY][slot] * x + quadrics[YZ][slot] * z + quadrics[Y][slot],
+             2. * quadrics[ZZ][slot] * z + quadrics[YZ][slot] * y + quadrics[ZX][slot] * x + quadrics[Z][slot]}};
+  }
+
+  long const torus = -slot - 1;
+  std::array<double, 3> const d = toTorusFrame(torus, x, y, z);
+  auto const &radii = torusRadii[torus];
+  int const axis = torusAxes[torus];
+  double const rho = std::sqrt(d[(axis + 1) % 3] * d[(axis + 1) % 3] + d[(axis + 2) % 3] * d[(axis + 2) % 3]);
+  double const dfdrho = 2. * (rho - radii[0]) / (radii[2] * radii[2]);
+  std::array<double, 3> localGrad;
+  for (int i = 0; i < 3; ++i) {
+    if (i == axis) {
+      localGrad[i] = 2. * d[i] / (radii[1] * radii[1]);
+    } else {
+      localGrad[i] = rho > 0. ? dfdrho * d[i] / rho : 0.;
+    }
+  }
+  // back to the global frame: grad_global = R grad_local
+  auto const &r = torusRotations[torus];
+  return {{r[0] * localGrad[0] + r[1] * localGrad[1] + r[2] * localGrad[2],
+           r[3] * localGrad[0] + r[4] * localGrad[1] + r[5] * localGrad[2],
+           r[6] * localGrad[0] + r[7] * localGrad[1] + r[8] * localGrad[2]}};
+}
+
+void SurfaceTable::evaluateQuadrics(double x, double y, double z, double *values) const
+{
+  double const xx = x * x, yy = y * y, zz = z * z;
+  double const xy = x * y, yz = y * z, zx = z * x;
+  double const *cxx = quadrics[XX].data(), *cyy = quadrics[YY].data(), *czz = quadrics[ZZ].data();
+  double const *cxy = quadrics[XY].data(), *cyz = quadrics[YZ].data(), *czx = quadrics[ZX].data();
+  double const *cx = quadrics[X].data(), *cy = quadrics[Y].data(), *cz = quadrics[Z].data();
+  double const *cc = quadrics[C].data();
+  long const n = getNbQuadrics();
+  for (long i = 0; i < n; ++i) {
+    values[i] = cxx[i] * xx + cyy[i] * yy + czz[i] * zz
+                + cxy[i] * xy + cyz[i] * yz + czx[i] * zx
+                + cx[i] * x + cy[i] * y + cz[i] * z + cc[i];
+  }
+}
+
+long SurfaceTable::getNbQuadrics() const
+{
+  return quadrics[0].size();
+}
+
+double SurfaceTable::intersectRay(long index, std::array<double, 3> const &point,
+                                  std::array<double, 3> const &dir, double maxDist) const
+{
+  long const slot = slots[index];
+  double const x = point[0], y = point[1], z = point[2];
+  if (slot >= 0) {
+    double const a = quadrics[XX][slot] * dir[0] * dir[0] + quadrics[YY][slot] * dir[1] * dir[1] + quadrics[ZZ][slot] * dir[2] * dir[2]
+                     + quadrics[XY][slot] * dir[0] * dir[1] + quadrics[YZ][slot] * dir[1] * dir[2] + quadrics[ZX][slot] * dir[2] * dir[0];
+    auto const grad = gradient(index, x, y, z);
+    double const b = grad[0] * dir[0] + grad[1] * dir[1] + grad[2] * dir[2];
+    double const c = evaluate(index, x, y, z);
+    return smallestRoot(a, b, c, maxDist);
+  }
+
+  // tori: bracket the first sign change inside the bounding sphere, then bisect
+  auto along = [&](double s) { return evaluate(index, x + s * dir[0], y + s * dir[1], z + s * dir[2]); };
+  double const f0 = along(0.);
+  if (f0 == 0.) {
+    return 0.;
+  }
+  auto const sphere = torusBoundingSphere(index);
+  std::array<double, 3> const oc = {x - sphere.first[0], y - sphere.first[1], z - sphere.first[2]};
+  double const b = oc[0] * dir[0] + oc[1] * dir[1] + oc[2] * dir[2];
+  double const c = oc[0] * oc[0] + oc[1] * oc[1] + oc[2] * oc[2] - sphere.second * sphere.second;
+  double const disc = b * b - c;
+  if (disc < 0.) {
+    return -1.;
+  }
+  double const sEnter = std::max(0., -b - std::sqrt(disc));
+  double const sExit = std::min(maxDist, -b + std::sqrt(disc));
+  if (sExit < sEnter) {
+    return -1.;
+  }
+  double sLow = sEnter;
+  double fLow = along(sLow);
+  for (int i = 1; i <= nbTorusRaySamples; ++i) {
+    double const sHigh = sEnter + (sExit - sEnter) * i / nbTorusRaySamples;
+    double const fHigh = along(sHigh);
+    if (fLow == 0.) {
+      return sLow;
+    }
+    if ((fLow < 0.) != (fHigh < 0.)) {
+      double lo = sLow, hi = sHigh;
+      for (int iter = 0; iter < nbBisections; ++iter) {
+        double const mid = 0.5 * (lo + hi);
+        if ((along(mid) < 0.) == (fLow < 0.)) {
+          lo = mid;
+        } else {
+          hi = mid;
+        }
+      }
+      return hi;
+    }
+    sLow = sHigh;
+    fLow = fHigh;
+  }
+  return -1.;
+}
+
+std::pair<std::array<double, 3>, double> SurfaceTable::torusBoundingSphere(long index) const
+{
+  long const torus = -slots[index] - 1;
+  auto const &c = torusCentres[torus];
+  auto const &r = torusRotations[torus];
+  auto const &t = torusTranslations[torus];
+  auto const &radii = torusRadii[torus];
+  std::array<double, 3> centre;
+  for (int i = 0; i < 3; ++i) {
+    centre[i] = r[3 * i] * c[0] + r[3 * i + 1] * c[1] + r[3 * i + 2] * c[2] + t[i];
+  }
+  double const radial = std::fabs(radii[0]) + std::fabs(radii[2]);
+  return {centre, std::sqrt(radial * radial + radii[1] * radii[1])};
+}
+
+BoundingBox SurfaceTable::halfSpaceBounds(long index, int sign) const
+{
+  if (!isTorus(index)) {
+    return quadricBounds(getQuadric(index), sign);
+  }
+  if (sign > 0) {
+    return infiniteBox();
+  }
+  auto const sphere = torusBoundingSphere(index);
+  auto const &c = sphere.first;
+  double const r = sphere.second;
+  return {{c[0] - r, c[0] + r, c[1] - r, c[1] + r, c[2] - r, c[2] + r}};
+}
+
+std::array<double, 3> SurfaceTable::toTorusFrame(long slot, double x, double y, double z) const
+{
+  auto const &r = torusRotations[slot];
+  auto const &t = torusTranslations[slot];
+  auto const &c = torusCentres[slot];
+  double const gx = x - t[0], gy = y - t[1], gz = z - t[2];
+  // local = R^T (global - t), relative to the torus centre
+  return {{r[0] * gx + r[3] * gy + r[6] * gz - c[0],
+           r[1] * gx + r[4] * gy + r[7] * gz - c[1],
+           r[2] * gx + r[5] * gy + r[8] * gz - c[2]}};
+}
+
+double SurfaceTable::evaluateTorus(long slot, double x, double y, double z) const
+{
+  std::array<double, 3> const d = toTorusFrame(slot, x, y, z);
+  auto const &radii = torusRadii[slot];
+  int const axis = torusAxes[slot];
+  double const h = d[axis];
+  double const rho = std::sqrt(d[(axis + 1) % 3] * d[(axis + 1) % 3] + d[(axis + 2) % 3] * d[(axis + 2) % 3]);
+  double const axial = h / radii[1];
+  double const radial = (rho - radii[0]) / radii[2];
+  return axial * axial + radial * radial - 1.;
+}
@@ -9,6 +9,23 @@
  */
 
 #include "T4Geometry.hh"
+#include "Log.hh"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <stdexcept>
+#ifdef ORACLE_WITH_T4
+extern "C" {
+#include "geom.h"
+#include "geutil.h"
+#include "geread.h"
+#include "geextlib.h"
+#include "geintlib.h"
+}
+#endif
 
 using namespace std;
 
@@ -19,7 +36,9 @@ const vector<vector<double>> T4Geometry::directions = {{0.0, 0.0, 1.0},
                                                        {1.0, 0.0, 0.0},
                                                        {-1.0, 0.0, 0.0}};
 
-T4Geometry::T4Geometry(const string &t4Filename) : t4Filename(t4Filename)
+T4Geometry::T4Geometry(const string &t4Filename, T4Backend backend) : backend(backend),
+                                                                      distanceMethod(DistanceMethod::RAYS),
+                                                                      t4Filename(t4Filename)
 {
   readT4input();
 }
@@ -28,8 +47,19 @@ T4Geometry::~T4Geometry() {}
 
 void T4Geometry::readT4input()
 {
-  std::cout << "\n--- Reading : " << t4Filename << std::endl;
+  ORACLE_LOG(INFO) << "\n--- Reading : " << t4Filename;
+
+  if (backend == T4Backend::NATIVE) {
+    ORACLE_LOG(INFO) << "# Reading geometry with the native evaluator";
+    try {
+      native.reset(new NativeT4Geometry(t4Filename));
+    } catch (std::exception const &e) {
+      throw std::runtime_error(std::string("cannot read the T4 geometry: ") + e.what());
+    }
+    return;
+  }
 
+#ifdef ORACLE_WITH_T4
   std::string c_tmpfilename;
 
   const GeometryType geom_type = detect_geometry(t4Filename);
@@ -38,32 +68,29 @@ void T4Geometry::readT4input()
   case T4_GEOMETRY_TYPE:
     c_tmpfilename = preprocess(t4Filename, "GEOMCOMP");
     if (c_tmpfilename.size() > 0) {
-      std::cout << "# Compositions - preprocessing file: " << c_tmpfilename << endl;
+      ORACLE_LOG(INFO) << "# Compositions - preprocessing file: " << c_tmpfilename;
     } else {
-      std::cerr << "\n---------------------------" << endl;
-      std::cerr << "T4 geometry detected, but" << endl;
-      std::cerr << "GEOMCOMP is missing from the" << endl;
-      std::cerr << "input file." << endl;
-      std::cerr << "-----------------------------" << endl;
-      exit(EXIT_FAILURE);
+      throw std::runtime_error("T4 geometry detected, but GEOMCOMP is missing from " + t4Filename);
     }
     break;
 
   default:
-    std::cerr << "\n---------------------------" << endl;
-    std::cerr << "Unrecognized geometry: " << geom_type << endl;
-    std::cerr << "-----------------------------" << endl;
-    exit(EXIT_FAILURE);
+    throw std::runtime_error("unrecognized geometry type " + std::to_string(static_cast<int>(geom_type)) + " in "
+                             + t4Filename);
   }
 
   this->volumes = new AnyVolumes(geom_type, c_tmpfilename);
   this->compos = new ComposFromGeom();
-  std::cout << "# Reading Volumes data" << endl;
+  ORACLE_LOG(INFO) << "# Reading Volumes data";
   this->volumes->read(t4Filename);
   // Compos
-  std::cout << "# Reading Compos data" << endl;
+  ORACLE_LOG(INFO) << "# Reading Compos data";
   this->compos->set_volumes(volumes);
   this->compos->read(c_tmpfilename);
+#else
+  throw std::runtime_error("this executable was built without the T4 libraries; "
+                           "only the native geometry backend is available");
+#endif
 }
 
 bool T4Geometry::materialInMap(const string &matDens)
@@ -76,11 +103,20 @@ void T4Geometry::addEquivalence(const string &matDens, const string &compo)
   equivalenceMap.insert(std::pair<string, string>(matDens, compo));
 }
 
+map<string, string> const &T4Geometry::getEquivalences() const
+{
+  return equivalenceMap;
+}
+
+void T4Geometry::clearEquivalences()
+{
+  equivalenceMap.clear();
+}
+
 bool T4Geometry::weakEquivalence(const string &matDens, const string &compo)
 {
   if (!materialInMap(matDens)) {
-    cerr << "ERROR: Testing weak equivalence on non-registered material: "
-      << matDens << endl;
+    ORACLE_LOG(ERROR) << "ERROR: Testing weak equivalence on non-registered material: " << matDens;
     return false;
   }
   return (equivalenceMap[matDens] == compo);
@@ -91,6 +127,29 @@ string T4Geometry::getFilename()
   return t4Filename;
 }
 
+string T4Geometry::getFileHash()
+{
+  // 64-bit FNV-1a
+  uint64_t hash = 14695981039346656037ULL;
+  ifstream file(t4Filename, ios_base::binary);
+  char buffer[65536];
+  while (file.read(buffer, sizeof(buffer)) || file.gcount() > 0) {
+    for (streamsize i = 0; i < file.gcount(); ++i) {
+      hash ^= static_cast<unsigned char>(buffer[i]);
+      hash *= 1099511628211ULL;
+    }
+  }
+  ostringstream oss;
+  oss << hex << setw(16) << setfill('0') << hash;
+  return oss.str();
+}
+
+T4Backend T4Geometry::getBackend() const
+{
+  return backend;
+}
+
+#ifdef ORACLE_WITH_T4
 Volumes *const &T4Geometry::getVolumes()
 {
   return volumes;
@@ -100,14 +159,287 @@ Compos *const &T4Geometry::getCompos()
 {
   return compos;
 }
+#endif
+
+NativeT4Geometry const *T4Geometry::getNative() const
+{
+  return native.get();
+}
+
+long T4Geometry::getNbVolumes()
+{
+#ifdef ORACLE_WITH_T4
+  if (backend == T4Backend::T4LIB) {
+    return volumes->get_nb_vol();
+  }
+#endif
+  return native->getNbVolumes();
+}
+
+string T4Geometry::getCompoName(long rank)
+{
+#ifdef ORACLE_WITH_T4
+  if (backend == T4Backend::T4LIB) {
+    return compos->get_name_from_volume(rank);
+  }
+#endif
+  return native->getCompoName(rank);
+}
+
+long T4Geometry::getVolumeNumber(long rank)
+{
+#ifdef ORACLE_WITH_T4
+  if (backend == T4Backend::T4LIB) {
+    return ge_volu_tab_info.ge_volu[rank]->numvol;
+  }
+#endif
+  return native->getVolumeNumber(rank);
+}
+
+vector<string> T4Geometry::getCompoNames()
+{
+#ifdef ORACLE_WITH_T4
+  if (backend == T4Backend::T4LIB) {
+    vector<string> names;
+    for (auto const &compo : compos->get_compo_map()) {
+      if (compo.second != "No compo" && find(names.begin(), names.end(), compo.second) == names.end()) {
+        names.push_back(compo.second);
+      }
+    }
+    return names;
+  }
+#endif
+  return native->getCompoNames();
+}
+
+pair<double, long> T4Geometry::nextSurfaceInDirection(long rank, const vector<double> &point,
+                                                      const vector<double> &dir)
+{
+#ifdef ORACLE_WITH_T4
+  if (backend == T4Backend::T4LIB) {
+    return volumes->next_surface_in_direction(rank, point, dir);
+  }
+#endif
+  return native->nextSurfaceInDirection(rank, point, dir);
+}
 
 double T4Geometry::distanceFromSurface(const vector<double> &point, long rank)
 {
+  CSGBytecode const *compiled = getBytecode();
+  if (distanceMethod == DistanceMethod::ANALYTIC && compiled) {
+    return compiled->distanceBound(rank, point[0], point[1], point[2]);
+  }
   double shortestDist = 1.0e+10;
   pair<double, long> result;
   for (auto const &idir : T4Geometry::directions) {
-    result = volumes->next_surface_in_direction(rank, point, idir);
+    result = nextSurfaceInDirection(rank, point, idir);
     shortestDist = min(result.first, shortestDist);
   }
   return shortestDist;
 }
+
+double T4Geometry::quickDistanceFromSurface(const vector<double> &point, long rank)
+{
+  CSGBytecode const *compiled = getBytecode();
+  if (compiled) {
+    return compiled->distanceBound(rank, point[0], point[1], point[2]);
+  }
+  // without a bytecode, distanceFromSurface() always casts rays
+  return distanceFromSurface(point, rank);
+}
+
+double T4Geometry::voxelDepth(const vector<double> &point) const
+{
+  if (!voxelCache) {
+    return -1.;
+  }
+  return voxelCache->depth(point);
+}
+
+void T4Geometry::setDistanceMethod(DistanceMethod method)
+{
+  distanceMethod = method;
+}
+
+DistanceMethod T4Geometry::getDistanceMethod() const
+{
+  return distanceMethod;
+}
+
+void T4Geometry::setupVoxelCache(array<double, 6> const &box, array<long, 3> const &dims,
+                                 int refineLevels, int nThreads, string const &cachePath)
+{
+  voxelCache.reset();
+  if (!getBytecode()) {
+    throw std::runtime_error("the voxel cache needs the bytecode of the geometry (--bytecode)");
+  }
+  unique_ptr<VoxelCache> cache(new VoxelCache(box, dims, refineLevels));
+  string const hash = getFileHash();
+  if (!cachePath.empty() && cache->load(cachePath, hash, getNbVolumes())) {
+    ORACLE_LOG(INFO) << "# Voxel cache read from " << cachePath;
+  } else {
+    ORACLE_LOG(INFO) << "# Building voxel cache (" << dims[0] << "x" << dims[1] << "x" << dims[2]
+                     << " voxels, " << refineLevels << " refinement levels)";
+    cache->build(*this, nThreads);
+    if (!cachePath.empty()) {
+      if (cache->save(cachePath, hash)) {
+        ORACLE_LOG(INFO) << "# Voxel cache written to " << cachePath;
+      } else {
+        ORACLE_LOG(ERROR) << "Error: cannot write the voxel cache file " << cachePath;
+      }
+    }
+  }
+  ORACLE_LOG(INFO) << "# Voxel cache: " << cache->getNbLabelled() << " labelled voxels";
+  voxelCache = std::move(cache);
+}
+
+long T4Geometry::whichVolume(const vector<double> &point)
+{
+  if (voxelCache) {
+    long const rank = voxelCache->lookup(point);
+    if (rank != VoxelCache::mixed) {
+      return rank;
+    }
+  }
+  return whichVolumeUncached(point);
+}
+
+long T4Geometry::whichVolumeUncached(const vector<double> &point)
+{
+  if (bytecode) {
+    return bytecode->whichVolume(point);
+  }
+  return whichVolumeReference(point);
+}
+
+long T4Geometry::whichVolumeReference(const vector<double> &point)
+{
+#ifdef ORACLE_WITH_T4
+  if (backend == T4Backend::T4LIB) {
+    return volumes->which_volume(point);
+  }
+#endif
+  return native->whichVolume(point);
+}
+
+#ifdef ORACLE_WITH_T4
+namespace
+{
+/// number of points where the sides of each surface are compared with the library
+constexpr int nbSurfaceProbes = 64;
+
+/// the surfaces of the EQUA parts of the volumes of the library
+vector<Ge_surf *> librarySurfaces()
+{
+  vector<Ge_surf *> result;
+  for (int rank = 0; rank < ge_volu_tab_info.ge_nbvolu; ++rank) {
+    Ge_volu const *volu = ge_volu_tab_info.ge_volu[rank];
+    if (volu->volu_type != GE_VOLU_EQUA) {
+      continue;
+    }
+    auto const &data = volu->volu_descr.volu_equa.equa_data;
+    result.insert(result.end(), data.surface_plus_tab, data.surface_plus_tab + data.nb_plus);
+    result.insert(result.end(), data.surface_moins_tab, data.surface_moins_tab + data.nb_moins);
+  }
+  sort(result.begin(), result.end());
+  result.erase(unique(result.begin(), result.end()), result.end());
+  return result;
+}
+} // namespace
+
+void T4Geometry::checkLibrarySurfaces(SurfaceTable const &surfaces) const
+{
+  // fixed pseudo-random probes, spread over several length scales
+  vector<array<double, 3>> probes;
+  uint64_t state = 88172645463325252ULL;
+  auto uniform = [&state]() {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return double(state >> 11) / double(1ULL << 53);
+  };
+  for (int i = 0; i < nbSurfaceProbes; ++i) {
+    double const scale = std::pow(10., i % 4);
+    probes.push_back({{scale * (2. * uniform() - 1.), scale * (2. * uniform() - 1.), scale * (2. * uniform() - 1.)}});
+  }
+  for (Ge_surf *surf : librarySurfaces()) {
+    long const index = surfaces.indexOf(surf->numsurf);
+    if (index < 0) {
+      throw runtime_error("surface " + to_string(surf->numsurf) + " of the T4 library has no SURF card");
+    }
+    for (auto const &probe : probes) {
+      double const value = surfaces.evaluate(index, probe[0], probe[1], probe[2]);
+      if (std::fabs(value) < 1e-6) {
+        continue;
+      }
+      bool const plus = ge_surf_pos(surf, probe[0], probe[1], probe[2]) == GE_SURF_PLUS;
+      if (plus != (value >= 0.)) {
+        throw runtime_error("surface " + to_string(surf->numsurf) + " differs from the T4 library at ("
+                            + to_string(probe[0]) + ", " + to_string(probe[1]) + ", " + to_string(probe[2]) + ")");
+      }
+    }
+  }
+}
+#endif
+
+void T4Geometry::compileBytecode()
+{
+  if (backend == T4Backend::NATIVE) {
+    return;
+  }
+#ifdef ORACLE_WITH_T4
+  ORACLE_LOG(INFO) << "# Compiling the geometry to bytecode";
+  try {
+    // the library does not expose the surface coefficients: they are read
+    // from the SURF cards, then checked against the library
+    SurfaceTable const surfaces = NativeT4Geometry::readSurfaces(t4Filename);
+    checkLibrarySurfaces(surfaces);
+    unique_ptr<CSGBytecode> compiled(new CSGBytecode(surfaces));
+    for (int rank = 0; rank < ge_volu_tab_info.ge_nbvolu; ++rank) {
+      Ge_volu const *volu = ge_volu_tab_info.ge_volu[rank];
+      if (volu->volu_type != GE_VOLU_EQUA) {
+        throw invalid_argument("volume " + to_string(volu->numvol) + " is not an EQUA volume");
+      }
+      compiled->beginVolume(volu->numvol, volu->fictif);
+      auto const &data = volu->volu_descr.volu_equa.equa_data;
+      for (int iplus = 0; iplus < data.nb_plus; ++iplus) {
+        compiled->addHalfSpace(data.surface_plus_tab[iplus]->numsurf, 1);
+      }
+      for (int iminus = 0; iminus < data.nb_moins; ++iminus) {
+        compiled->addHalfSpace(data.surface_moins_tab[iminus]->numsurf, -1);
+      }
+      for (int idef = 0; idef < volu->nb_def; ++idef) {
+        auto const &op = volu->def_operator[idef];
+        if (op.oper_type == GE_OPERATOR_UNION) {
+          auto const &reunion_arg = op.operator_arg.reunion_arg;
+          for (int iarg = 0; iarg < reunion_arg.nb_arg; ++iarg) {
+            compiled->addOperand(CSGOperator::UNION, reunion_arg.reunion[iarg]->rankvol);
+          }
+        } else if (op.oper_type == GE_OPERATOR_INTER) {
+          auto const &inter_arg = op.operator_arg.inter_arg;
+          for (int iarg = 0; iarg < inter_arg.nb_arg; ++iarg) {
+            compiled->addOperand(CSGOperator::INTE, inter_arg.inter[iarg]->rankvol);
+          }
+        } else {
+          throw invalid_argument("volume " + to_string(volu->numvol) + " uses an unsupported operator");
+        }
+      }
+      compiled->endVolume();
+    }
+    compiled->finalize();
+    ORACLE_LOG(INFO) << "# Bytecode: " << compiled->getNbVolumes() << " volumes, "
+                     << compiled->getNbInstructions() << " instructions";
+    bytecode = std::move(compiled);
+  } catch (std::exception const &e) {
+    throw std::runtime_error(std::string("cannot compile the T4 geometry: ") + e.what());
+  }
+#endif
+}
+
+CSGBytecode const *T4Geometry::getBytecode() const
+{
+  if (backend == T4Backend::NATIVE) {
+    return &native->getBytecode();
+  }
+  return bytecode.get();
+}
@@ -0,0 +1,130 @@
+/**
+ * @file TimeBudget.cc
+ *
+ *
+ * @brief TimeBudget class
+ *
+ * @version 1.0
+ */
+
+#include "TimeBudget.hh"
+#include <algorithm>
+#include <stdexcept>
+
+namespace
+{
+/// fraction of the remaining time planned for the remaining points
+constexpr double safetyFactor = 0.9;
+
+/// the splitmix64 finaliser
+uint64_t mix(uint64_t value)
+{
+  value += 0x9e3779b97f4a7c15ull;
+  value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ull;
+  value = (value ^ (value >> 27)) * 0x94d049bb133111ebull;
+  return value ^ (value >> 31);
+}
+} // namespace
+
+constexpr long TimeBudget::updateInterval;
+
+TimeBudget::TimeBudget(double seconds, long nbPoints, uint64_t seed) : budget(seconds),
+                                                                       nbPoints(nbPoints),
+                                                                       seed(seed),
+                                                                       start(Clock::now()),
+                                                                       last(start),
+                                                                       lastSelected(false),
+                                                                       selectedTime(0.),
+                                                                       skippedTime(0.),
+                                                                       nbSelected(0),
+                                                                       nbSkipped(0),
+                                                                       nbCalls(0),
+                                                                       keepFraction(1.),
+                                                                       exhausted(false)
+{
+  if (!(seconds > 0.)) {
+    throw std::invalid_argument("the time budget must be positive");
+  }
+}
+
+bool TimeBudget::select(unsigned long index)
+{
+  if (exhausted) {
+    return false;
+  }
+  Clock::time_point const now = Clock::now();
+  double const elapsed = std::chrono::duration<double>(now - start).count();
+  if (elapsed >= budget) {
+    exhausted = true;
+    return false;
+  }
+  // the time since the previous call was spent on the previous point
+  double const spent = std::chrono::duration<double>(now - last).count();
+  last = now;
+  if (nbCalls > 0) {
+    if (lastSelected) {
+      selectedTime += spent;
+    } else {
+      skippedTime += spent;
+    }
+  }
+  ++nbCalls;
+  if (nbCalls % updateInterval == 0 && nbSelected > 0) {
+    double const skipCost = nbSkipped > 0 ? skippedTime / nbSkipped : 0.;
+    double const compareCost = selectedTime / nbSelected;
+    keepFraction = computeKeepFraction(safetyFactor * (budget - elapsed), nbPoints - nbCalls, skipCost, compareCost);
+  }
+  lastSelected = sampled(seed, index, keepFraction);
+  if (lastSelected) {
+    ++nbSelected;
+  } else {
+    ++nbSkipped;
+  }
+  return lastSelected;
+}
+
+bool TimeBudget::isExhausted() const
+{
+  return exhausted;
+}
+
+double TimeBudget::getBudget() const
+{
+  return budget;
+}
+
+long TimeBudget::getNbSelected() const
+{
+  return nbSelected;
+}
+
+double TimeBudget::getKeepFraction() const
+{
+  return keepFraction;
+}
+
+double TimeBudget::computeKeepFraction(double remainingTime, long remainingPoints, double skipCost,
+                                       double compareCost)
+{
+  if (remainingPoints <= 0 || compareCost <= skipCost) {
+    return 1.;
+  }
+  if (remainingTime <= remainingPoints * skipCost) {
+    // reading alone does not fit in the budget: the end of the file cannot
+    // be reached, so compare every point that can be read
+    return 1.;
+  }
+  double const fraction = (remainingTime / remainingPoints - skipCost) / (compareCost - skipCost);
+  // never stop sampling entirely, the estimates of the costs may be off
+  return std::min(1., std::max(1e-6, fraction));
+}
+
+bool TimeBudget::sampled(uint64_t seed, unsigned long index, double fraction)
+{
+  if (fraction >= 1.) {
+    return true;
+  }
+  // the top 53 bits of the hash, as a uniform number in [0, 1)
+  double const uniform = double(mix(mix(seed) ^ uint64_t(index)) >> 11) / 9007199254740992.;
+  return uniform < fraction;
+}
@@ -0,0 +1,311 @@
+/**
+ * @file VoxelCache.cc
+ *
+ *
+ * @brief VoxelCache class
+ *
+ * @version 1.0
+ */
+
+#include "VoxelCache.hh"
+#include "T4Geometry.hh"
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <limits>
+#include <thread>
+
+namespace
+{
+/// magic string at the start of the cache files
+const std::string voxelCacheMagic = "ORACLEVOXELS2";
+
+/// refined nodes store the index of their first child as -(index + 3)
+constexpr int32_t firstChildOffset = 3;
+
+bool isRefined(int32_t node)
+{
+  return node <= -firstChildOffset;
+}
+
+long firstChild(int32_t node)
+{
+  return -long(node) - firstChildOffset;
+}
+
+int32_t encodeFirstChild(long index)
+{
+  return int32_t(-index - firstChildOffset);
+}
+
+template <typename T>
+void writeValue(std::ostream &stream, T const &value)
+{
+  stream.write(reinterpret_cast<char const *>(&value), sizeof(T));
+}
+
+template <typename T>
+T readValue(std::istream &stream)
+{
+  T value{};
+  stream.read(reinterpret_cast<char *>(&value), sizeof(T));
+  return value;
+}
+} // namespace
+
+constexpr long VoxelCache::mixed;
+
+VoxelCache::VoxelCache(std::array<double, 6> const &box, std::array<long, 3> const &dims, int refineLevels) : box(box),
+                                                                                                            dims(dims),
+                                                                                                            refineLevels(refineLevels)
+{
+  for (int i = 0; i < 3; ++i) {
+    step[i] = (box[2 * i + 1] - box[2 * i]) / dims[i];
+  }
+}
+
+void VoxelCache::build(T4Geometry &t4Geom, int nThreads)
+{
+  long const nbTop = getNbVoxels();
+  nodes.assign(nbTop, int32_t(mixed));
+  CSGBytecode const *bytecode = t4Geom.getBytecode();
+  if (!bytecode) {
+    return;
+  }
+  nThreads = std::max(nThreads, 1);
+
+  // each thread collects the children of the voxels it refines in its own
+  // vector; the child indices are relocated when the vectors are merged
+  std::vector<std::vector<int32_t>> threadChildren(nThreads);
+  std::vector<std::vector<long>> threadRefined(nThreads);
+  std::atomic<long> nextVoxel(0);
+
+  auto worker = [&](int iThread) {
+    auto &children = threadChildren[iThread];
+    auto &refined = threadRefined[iThread];
+    long iVoxel;
+    while ((iVoxel = nextVoxel++) < nbTop) {
+      long const ix = iVoxel % dims[0];
+      long const iy = (iVoxel / dims[0]) % dims[1];
+      long const iz = iVoxel / (dims[0] * dims[1]);
+      std::array<double, 3> const lo = {box[0] + ix * step[0], box[2] + iy * step[1], box[4] + iz * step[2]};
+      std::array<double, 3> const hi = {lo[0] + step[0], lo[1] + step[1], lo[2] + step[2]};
+      int32_t const node = classifyVoxel(*bytecode, lo, hi, 0, children);
+      nodes[iVoxel] = node;
+      if (isRefined(node)) {
+        refined.push_back(iVoxel);
+      }
+    }
+  };
+
+  if (nThreads == 1) {
+    worker(0);
+  } else {
+    std::vector<std::thread> threads;
+    for (int iThread = 0; iThread < nThreads; ++iThread) {
+      threads.emplace_back(worker, iThread);
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+  }
+
+  for (int iThread = 0; iThread < nThreads; ++iThread) {
+    long const base = nodes.size();
+    for (long iVoxel : threadRefined[iThread]) {
+      nodes[iVoxel] = encodeFirstChild(firstChild(nodes[iVoxel]) + base);
+    }
+    for (int32_t child : threadChildren[iThread]) {
+      nodes.push_back(isRefined(child) ? encodeFirstChild(firstChild(child) + base) : child);
+    }
+  }
+}
+
+int32_t VoxelCache::classifyVoxel(CSGBytecode const &bytecode, std::array<double, 3> const &lo,
+                                  std::array<double, 3> const &hi, int level,
+                                  std::vector<int32_t> &children) const
+{
+  // the voxels which may hold points of several volumes are not labelled
+  long const rank = bytecode.whichVolumeOfBox(BoundingBox{{lo[0], hi[0], lo[1], hi[1], lo[2], hi[2]}});
+  if (rank >= 0) {
+    return int32_t(rank);
+  }
+
+  if (level >= refineLevels) {
+    return int32_t(mixed);
+  }
+
+  long const first = children.size();
+  children.resize(first + 8, int32_t(mixed));
+  for (int octant = 0; octant < 8; ++octant) {
+    std::array<double, 3> childLo, childHi;
+    for (int i = 0; i < 3; ++i) {
+      double const mid = 0.5 * (lo[i] + hi[i]);
+      bool const upper = (octant >> i) & 1;
+      childLo[i] = upper ? mid : lo[i];
+      childHi[i] = upper ? hi[i] : mid;
+    }
+    // children may grow the vector, so do not keep references into it
+    int32_t const child = classifyVoxel(bytecode, childLo, childHi, level + 1, children);
+    children[first + octant] = child;
+  }
+  return encodeFirstChild(first);
+}
+
+long VoxelCache::lookup(std::vector<double> const &point) const
+{
+  std::array<long, 3> index;
+  std::array<double, 3> frac;
+  for (int i = 0; i < 3; ++i) {
+    double const u = (point[i] - box[2 * i]) / step[i];
+    if (!(u >= 0.) || u >= dims[i]) {
+      return mixed;
+    }
+    index[i] = long(u);
+    frac[i] = u - index[i];
+  }
+  int32_t node = nodes[index[0] + dims[0] * (index[1] + dims[1] * index[2])];
+  while (isRefined(node)) {
+    int octant = 0;
+    for (int i = 0; i < 3; ++i) {
+      frac[i] *= 2.;
+      if (frac[i] >= 1.) {
+        octant |= 1 << i;
+        frac[i] -= 1.;
+      }
+    }
+    node = nodes[firstChild(node) + octant];
+  }
+  return node;
+}
+
+double VoxelCache::depth(std::vector<double> const &point) const
+{
+  std::array<long, 3> index;
+  std::array<double, 3> frac;
+  std::array<double, 3> size = step;
+  for (int i = 0; i < 3; ++i) {
+    double const u = (point[i] - box[2 * i]) / step[i];
+    if (!(u >= 0.) || u >= dims[i]) {
+      return -1.;
+    }
+    index[i] = long(u);
+    frac[i] = u - index[i];
+  }
+  int32_t node = nodes[index[0] + dims[0] * (index[1] + dims[1] * index[2])];
+  while (isRefined(node)) {
+    int octant = 0;
+    for (int i = 0; i < 3; ++i) {
+      frac[i] *= 2.;
+      size[i] *= 0.5;
+      if (frac[i] >= 1.) {
+        octant |= 1 << i;
+        frac[i] -= 1.;
+      }
+    }
+    node = nodes[firstChild(node) + octant];
+  }
+  if (node == mixed) {
+    return -1.;
+  }
+  double result = std::numeric_limits<double>::max();
+  for (int i = 0; i < 3; ++i) {
+    result = std::min(result, std::min(frac[i], 1. - frac[i]) * size[i]);
+  }
+  return result;
+}
+
+bool VoxelCache::save(std::string const &path, std::string const &t4Hash) const
+{
+  std::ofstream file(path, std::ios_base::binary);
+  if (!file) {
+    return false;
+  }
+  file.write(voxelCacheMagic.data(), voxelCacheMagic.size());
+  writeValue(file, uint64_t(t4Hash.size()));
+  file.write(t4Hash.data(), t4Hash.size());
+  for (double bound : box) {
+    writeValue(file, bound);
+  }
+  for (long dim : dims) {
+    writeValue(file, int64_t(dim));
+  }
+  writeValue(file, int32_t(refineLevels));
+  writeValue(file, uint64_t(nodes.size()));
+  file.write(reinterpret_cast<char const *>(nodes.data()), nodes.size() * sizeof(int32_t));
+  file.close();
+  return bool(file);
+}
+
+bool VoxelCache::load(std::string const &path, std::string const &t4Hash, long nbVolumes)
+{
+  std::ifstream file(path, std::ios_base::binary);
+  if (!file) {
+    return false;
+  }
+  std::string magic(voxelCacheMagic.size(), '\0');
+  file.read(&magic[0], magic.size());
+  if (!file || magic != voxelCacheMagic) {
+    return false;
+  }
+  uint64_t const hashSize = readValue<uint64_t>(file);
+  if (!file || hashSize != t4Hash.size()) {
+    return false;
+  }
+  std::string hash(hashSize, '\0');
+  file.read(&hash[0], hash.size());
+  if (!file || hash != t4Hash) {
+    return false;
+  }
+  for (double bound : box) {
+    if (readValue<double>(file) != bound) {
+      return false;
+    }
+  }
+  for (long dim : dims) {
+    if (readValue<int64_t>(file) != dim) {
+      return false;
+    }
+  }
+  if (readValue<int32_t>(file) != refineLevels) {
+    return false;
+  }
+  uint64_t const nbNodes = readValue<uint64_t>(file);
+  if (!file || nbNodes < uint64_t(getNbVoxels())) {
+    return false;
+  }
+  std::vector<int32_t> fileNodes(nbNodes);
+  file.read(reinterpret_cast<char *>(fileNodes.data()), fileNodes.size() * sizeof(int32_t));
+  if (!file) {
+    return false;
+  }
+  // the children of a node follow it, so that lookup() always ends
+  for (uint64_t i = 0; i < nbNodes; ++i) {
+    int32_t const node = fileNodes[i];
+    if (isRefined(node)) {
+      uint64_t const first = uint64_t(firstChild(node));
+      if (first <= i || first < uint64_t(getNbVoxels()) || first + 8 > nbNodes) {
+        return false;
+      }
+    } else if (node != mixed && (node < 0 || node >= nbVolumes)) {
+      return false;
+    }
+  }
+  nodes.swap(fileNodes);
+  return true;
+}
+
+long VoxelCache::getNbVoxels() const
+{
+  return dims[0] * dims[1] * dims[2];
+}
+
+long VoxelCache::getNbNodes() const
+{
+  return nodes.size();
+}
+
+long VoxelCache::getNbLabelled() const
+{
+  return std::count_if(nodes.begin(), nodes.end(), [](int32_t node) { return node >= 0; });
+}
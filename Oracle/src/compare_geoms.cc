@@ -0,0 +1,443 @@
+/**
+ * @file compare_geoms.cc
+ *
+ *
+ * @brief The comparison run by the oracle, shared with oracle-batch
+ *
+ * @version 1.0
+ */
+
+#include "compare_geoms.hh"
+#include "GeometryComparison.hh"
+#include "Log.hh"
+#include "MCNPGeometry.hh"
+#include "TimeBudget.hh"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+volatile std::sig_atomic_t interruptSignal = 0;
+
+void onInterrupt(int signal)
+{
+  interruptSignal = signal;
+  std::signal(signal, SIG_DFL);
+}
+
+std::vector<std::string> getT4Filenames(OptionsCompare const &options)
+{
+  std::vector<std::string> t4Filenames = {options.filenames[0]};
+  t4Filenames.insert(t4Filenames.end(), options.otherT4Files.begin(), options.otherT4Files.end());
+  return t4Filenames;
+}
+
+namespace
+{
+/// number of points sampled with --sample-box when --npts is not given
+constexpr long defaultNbSampledPoints = 1000000;
+
+/**
+ * Opens a PTRAC file with the reader of the given format.
+ */
+std::unique_ptr<MCNPPTRAC> openPTRAC(std::string const &path, PTRACFormat format)
+{
+  if (format == PTRACFormat::ASCII) {
+    return std::unique_ptr<MCNPPTRAC>(new MCNPPTRACASCII(path));
+  } else if (format == PTRACFormat::BINARY) {
+    return std::unique_ptr<MCNPPTRAC>(new MCNPPTRACBinary(path));
+  }
+  throw std::invalid_argument("Unrecognized PTRAC format");
+}
+
+/// number of points compared by each thread between synchronisations, with several T4 files
+constexpr size_t batchSize = 4096;
+
+constexpr char const *checkpointMagic = "ORACLECHECKPOINT";
+constexpr int checkpointVersion = 2;
+
+/**
+ * Writes the state of the comparison to the --checkpoint file. The state is
+ * first written to a temporary file, which then replaces the checkpoint, so
+ * that an interrupted write leaves the previous checkpoint intact.
+ */
+void writeCheckpoint(OptionsCompare const &options, MCNPPTRAC &ptrac, EventLog *events,
+                     std::vector<std::unique_ptr<GeometryComparison>> &comparisons,
+                     unsigned long countPoints, unsigned long nbCellMismatches)
+{
+  std::string const temporary = options.checkpoint + ".tmp";
+  {
+    std::ofstream fout(temporary);
+    fout << checkpointMagic << " " << checkpointVersion << "\n";
+    fout << "files " << options.filenames.size() + options.otherT4Files.size();
+    for (auto const &name : options.filenames) {
+      fout << " " << name;
+    }
+    for (auto const &name : options.otherT4Files) {
+      fout << " " << name;
+    }
+    fout << "\n";
+    fout << "points " << countPoints << " " << nbCellMismatches << "\n";
+    std::vector<long> const position = ptrac.getPosition();
+    fout << "reader " << position.size();
+    for (long value : position) {
+      fout << " " << value;
+    }
+    fout << "\n";
+    fout << "eventlog " << bool(events) << "\n";
+    if (events) {
+      events->saveState(fout);
+    }
+    for (auto &comparison : comparisons) {
+      comparison->saveState(fout);
+    }
+    if (!fout) {
+      throw std::runtime_error("cannot write the checkpoint " + temporary);
+    }
+  }
+  if (std::rename(temporary.c_str(), options.checkpoint.c_str()) != 0) {
+    throw std::runtime_error("cannot replace the checkpoint " + options.checkpoint);
+  }
+}
+
+/**
+ * Restores the state saved by writeCheckpoint(), for the same input files.
+ */
+void readCheckpoint(OptionsCompare const &options, MCNPPTRAC &ptrac, EventLog *events,
+                    std::vector<std::unique_ptr<GeometryComparison>> &comparisons,
+                    unsigned long &countPoints, unsigned long &nbCellMismatches)
+{
+  std::ifstream fin(options.checkpoint);
+  std::string word;
+  int version = 0;
+  fin >> word >> version;
+  if (!fin || word != checkpointMagic || version != checkpointVersion) {
+    throw std::runtime_error(options.checkpoint + " is not a checkpoint");
+  }
+  std::vector<std::string> files = options.filenames;
+  files.insert(files.end(), options.otherT4Files.begin(), options.otherT4Files.end());
+  size_t nbFiles = 0;
+  fin >> word >> nbFiles;
+  std::vector<std::string> savedFiles(nbFiles);
+  for (auto &name : savedFiles) {
+    fin >> name;
+  }
+  if (!fin || savedFiles != files) {
+    throw std::runtime_error(options.checkpoint + " was written for other input files");
+  }
+  fin >> word >> countPoints >> nbCellMismatches;
+  size_t positionSize = 0;
+  fin >> word >> positionSize;
+  std::vector<long> position(positionSize);
+  for (auto &value : position) {
+    fin >> value;
+  }
+  if (!fin) {
+    throw std::runtime_error("malformed checkpoint " + options.checkpoint);
+  }
+  ptrac.setPosition(position);
+  bool saved = false;
+  fin >> word >> saved;
+  if (!fin || saved != bool(events)) {
+    throw std::runtime_error("the checkpoint was written with different --events options");
+  }
+  if (events) {
+    events->restoreState(fin);
+  }
+  for (auto &comparison : comparisons) {
+    comparison->restoreState(fin);
+  }
+}
+
+} // namespace
+
+std::vector<Statistics> compare_geoms(OptionsCompare const &options, EventLog *events, T4Geometry *t4Geom)
+{
+  MCNPGeometry mcnpGeom(options.filenames[1]);
+  mcnpGeom.parseINP();
+  if (options.sampleBox || options.checkCells) {
+    mcnpGeom.parseCells();
+  }
+
+  std::vector<std::unique_ptr<GeometryComparison>> comparisons;
+  for (auto const &t4Filename : getT4Filenames(options)) {
+    // the geometry given is the one of the main T4 file
+    comparisons.emplace_back(
+      new GeometryComparison(t4Filename, options, mcnpGeom, events, comparisons.empty() ? t4Geom : nullptr));
+  }
+
+  unsigned long nbCellMismatches = 0;
+  std::unique_ptr<MCNPPTRAC> mcnpPtrac;
+  MCNPSampledPoints *sampledPoints = nullptr;
+  if (options.sampleBox) {
+    sampledPoints = new MCNPSampledPoints(mcnpGeom, *options.sampleBox);
+    mcnpPtrac.reset(sampledPoints);
+  } else {
+    std::vector<std::unique_ptr<MCNPPTRAC>> readers;
+    for (size_t i = 2; i < options.filenames.size(); ++i) {
+      readers.push_back(openPTRAC(options.filenames[i], options.ptracFormat));
+    }
+    if (readers.size() == 1) {
+      mcnpPtrac = std::move(readers[0]);
+    } else {
+      ORACLE_LOG(INFO) << "Reading " << readers.size() << " PTRAC files";
+      mcnpPtrac.reset(new MCNPPTRACMulti(std::move(readers)));
+    }
+  }
+
+  long maxSampledPts;
+  if (options.sampleBox) {
+    maxSampledPts = options.npoints ? *options.npoints : defaultNbSampledPoints;
+  } else if (options.filenames.size() > 3) {
+    // the files may come from independent runs, each of NPS histories
+    maxSampledPts = options.npoints ? *options.npoints : mcnpGeom.getNPS();
+  } else {
+    maxSampledPts = options.npoints ? min(*options.npoints, mcnpGeom.getNPS()) : mcnpGeom.getNPS();
+  }
+
+  unsigned long countPoints = 0;
+  if (options.resume) {
+    readCheckpoint(options, *mcnpPtrac, events, comparisons, countPoints, nbCellMismatches);
+    ORACLE_LOG(INFO) << "Resuming from " << options.checkpoint << " after " << countPoints << " points";
+  }
+
+  ORACLE_LOG(INFO) << "Starting comparison on " << maxSampledPts << " points...";
+  ORACLE_LOG(VERBOSE) << "delta is " << options.delta;
+  if (events) {
+    EventRecord start("start");
+    start.add("total", maxSampledPts).add("delta", options.delta);
+    if (options.resume) {
+      start.add("resumed_after", countPoints);
+    }
+    events->write(start);
+  }
+
+  std::unique_ptr<TimeBudget> timeBudget;
+  if (options.timeBudget) {
+    timeBudget.reset(new TimeBudget(*options.timeBudget, maxSampledPts, options.seed));
+  }
+
+  // with several geometries, the points are compared in batches, one thread
+  // per geometry; verbose output is kept in order by staying sequential
+  bool const parallel = comparisons.size() > 1 && options.verbosity == 0;
+  size_t const pointsPerBatch = comparisons.size() > 1 ? batchSize : 1;
+  std::vector<PTRACRecord> batch;
+  // with --tracks, the whole histories are compared
+  MCNPPTRACASCII *const trackReader = options.tracks ? static_cast<MCNPPTRACASCII *>(mcnpPtrac.get()) : nullptr;
+  std::vector<std::vector<PTRACRecord>> trackBatch;
+  auto compareAll = [&batch, &trackBatch, trackReader](GeometryComparison &comparison) {
+    if (trackReader) {
+      for (auto const &history : trackBatch) {
+        comparison.compareTrack(history);
+      }
+    } else {
+      for (auto const &record : batch) {
+        comparison.compare(record);
+      }
+    }
+  };
+  auto compareBatch = [&]() {
+    if (parallel) {
+      std::vector<std::thread> threads;
+      for (auto &comparison : comparisons) {
+        GeometryComparison *const target = comparison.get();
+        threads.emplace_back([target, &compareAll]() { compareAll(*target); });
+      }
+      for (auto &thread : threads) {
+        thread.join();
+      }
+    } else {
+      for (auto &comparison : comparisons) {
+        compareAll(*comparison);
+      }
+    }
+    batch.clear();
+    trackBatch.clear();
+  };
+  auto allDone = [&]() {
+    return std::all_of(comparisons.begin(), comparisons.end(),
+                       [](std::unique_ptr<GeometryComparison> const &comparison) { return comparison->isDone(); });
+  };
+
+  auto current = std::chrono::system_clock::now();
+  auto const started = current;
+  auto previous = current;
+  auto lastCheckpoint = current;
+  while (!interruptSignal && mcnpPtrac->readNextPtracData(maxSampledPts)) {
+
+    ++countPoints;
+
+    current = std::chrono::system_clock::now();
+    auto print_seconds = current - previous;
+    if(print_seconds > 5s) {
+      ORACLE_LOG(INFO) << "Progress: " << countPoints << " / " << maxSampledPts;
+      if (events) {
+        events->write(EventRecord("progress")
+                        .add("points", countPoints)
+                        .add("total", maxSampledPts)
+                        .add("elapsed", std::chrono::duration<double>(current - started).count()));
+      }
+      previous = current;
+    }
+
+    if (timeBudget && !timeBudget->select(countPoints)) {
+      if (timeBudget->isExhausted()) {
+        ORACLE_LOG(INFO) << "Time budget spent after reading " << countPoints << " points";
+        break;
+      }
+      for (auto &comparison : comparisons) {
+        comparison->skip();
+      }
+      continue;
+    }
+
+    auto const &record = mcnpPtrac->getPTRACRecord();
+    auto const &point = record.point;
+
+    if (options.checkCells) {
+      long const evaluatedCell = mcnpGeom.whichCell(point);
+      if (evaluatedCell != record.cellID) {
+        ++nbCellMismatches;
+        ORACLE_LOG(VERBOSE) << "MCNP cell mismatch at position: (" << point[0] << ", " << point[1] << ", " << point[2]
+                            << "); PTRAC cell: " << record.cellID << "   evaluated cell: " << evaluatedCell;
+      }
+    }
+
+    if (trackReader) {
+      trackBatch.push_back(trackReader->getHistory());
+    } else {
+      batch.push_back(record);
+    }
+    if (batch.size() + trackBatch.size() >= pointsPerBatch) {
+      compareBatch();
+      if (allDone()) {
+        break;
+      }
+      if (!options.checkpoint.empty()
+          && std::chrono::duration<double>(current - lastCheckpoint).count() >= options.checkpointInterval) {
+        writeCheckpoint(options, *mcnpPtrac, events, comparisons, countPoints, nbCellMismatches);
+        lastCheckpoint = current;
+      }
+    }
+  }
+  compareBatch();
+  if (interruptSignal) {
+    ORACLE_LOG(INFO) << "Interrupted by signal " << interruptSignal << " after " << countPoints
+                     << " points; the report below is partial";
+    if (!options.checkpoint.empty()) {
+      writeCheckpoint(options, *mcnpPtrac, events, comparisons, countPoints, nbCellMismatches);
+      ORACLE_LOG(INFO) << "Checkpoint written to " << options.checkpoint << "; continue with --resume";
+    }
+  }
+
+  std::vector<Statistics> results;
+  for (auto &comparison : comparisons) {
+    if (comparisons.size() > 1) {
+      ORACLE_LOG(INFO) << "\n--- " << comparison->getFilename() << " ---";
+    }
+    comparison->finish(interruptSignal && !options.checkpoint.empty());
+    results.push_back(std::move(comparison->getStatistics()));
+  }
+  if (sampledPoints) {
+    ORACLE_LOG(INFO) << "Number of sampled points outside all the MCNP cells (skipped): "
+                     << sampledPoints->getNbUndefined();
+  }
+  if (timeBudget) {
+    ORACLE_LOG(INFO) << "Time budget of " << timeBudget->getBudget() << "s: " << timeBudget->getNbSelected()
+                     << " points selected for comparison out of " << countPoints << " read (final keep fraction "
+                     << timeBudget->getKeepFraction() << ")";
+  }
+  if (options.checkCells) {
+    ORACLE_LOG(INFO) << "Number of points whose PTRAC cell differs from the built-in MCNP evaluator: "
+                     << nbCellMismatches;
+  }
+  return results;
+}
+
+namespace
+{
+/**
+ * Prints one line per T4 geometry with its main counts, to compare several
+ * candidates at a glance.
+ */
+void reportSideBySide(std::vector<std::string> const &t4Filenames, std::vector<Statistics> &results)
+{
+  LogGroup group;
+  size_t width = 8;
+  for (auto const &name : t4Filenames) {
+    width = std::max(width, name.size());
+  }
+  ORACLE_LOG(INFO) << "\n---------------------------";
+  ORACLE_LOG(INFO) << "Side-by-side summary";
+  ORACLE_LOG(INFO) << "-----------------------------";
+  ORACLE_LOG(INFO) << std::left << std::setw(width) << "T4 file" << std::right
+                   << std::setw(12) << "SUCCESSFUL" << std::setw(10) << "FAILED" << std::setw(10) << "IGNORED"
+                   << std::setw(10) << "OUTSIDE" << std::setw(10) << "SKIPPED" << std::setw(16) << "COVERED/INPUT";
+  for (size_t i = 0; i < results.size(); ++i) {
+    Statistics &stats = results[i];
+    ORACLE_LOG(INFO) << std::left << std::setw(width) << t4Filenames[i] << std::right
+                     << std::setw(12) << stats.getNbSuccess() << std::setw(10) << stats.getNbFailure()
+                     << std::setw(10) << stats.getNbIgnored() << std::setw(10) << stats.getNbOutside()
+                     << std::setw(10) << stats.getNbSkipped()
+                     << std::setw(16)
+                     << (std::to_string(stats.getNbCovered()) + "/" + std::to_string(stats.getNbT4Volumes()));
+  }
+}
+} // namespace
+
+std::vector<Statistics> run_oracle(OptionsCompare const &options, bool report, T4Geometry *t4Geom)
+{
+  auto const start = std::chrono::system_clock::now();
+  std::unique_ptr<EventLog> events;
+  if (!options.events.empty()) {
+    events.reset(new EventLog(options.events, options.resume));
+  }
+  std::vector<Statistics> results = compare_geoms(options, events.get(), t4Geom);
+  Statistics &stats = results[0];
+  for (auto const &path : options.mergeStats) {
+    stats.merge(path);
+  }
+  if (!options.saveStats.empty()) {
+    stats.save(options.saveStats);
+  }
+  if (!options.saveConfusion.empty()) {
+    stats.getConfusionMatrix().writeCSV(options.saveConfusion);
+  }
+  std::vector<std::string> t4Filenames = getT4Filenames(options);
+  for (size_t i = 0; i < results.size(); ++i) {
+    if (report) {
+      LogGroup group;
+      if (results.size() > 1) {
+        ORACLE_LOG(INFO) << "\n=== Results for " << t4Filenames[i] << " ===";
+      }
+      results[i].report();
+    }
+    std::string rawname = GeometryComparison::getOutputRawName(options, t4Filenames[i]);
+    results[i].writeOutForVisu(rawname);
+  }
+  if (report && results.size() > 1) {
+    reportSideBySide(t4Filenames, results);
+  }
+
+  if (events) {
+    // the statistics include the --merge-stats files
+    std::chrono::duration<double> const elapsed = std::chrono::system_clock::now() - start;
+    for (size_t i = 0; i < results.size(); ++i) {
+      events->write(results[i].getSummaryEvent(t4Filenames[i])
+                      .add("interrupted", interruptSignal != 0)
+                      .add("elapsed", elapsed.count()));
+    }
+    events->close();
+    ORACLE_LOG(INFO) << events->getNbRecords() << " events written to " << options.events;
+  }
+  return results;
+}
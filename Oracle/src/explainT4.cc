@@ -1,7 +1,9 @@
 #include <chrono>
 #include <iostream>
 #include <fstream>
+#include <stdexcept>
 #include "t4coreglob.hh"
+#include "Log.hh"
 #include "T4Geometry.hh"
 #include "options_explainT4.hh"
 //
@@ -33,11 +35,11 @@ void containedInVolumes(Ge_float const x, Ge_float const y, Ge_float const z)
       numvols.push_back(volu->numvol);
     }
   }
-  std::cout << "Point contained in the following volumes:";
+  LogMessage message(LogLevel::INFO);
+  message.stream() << "Point contained in the following volumes:";
   for(auto const &numvol: numvols) {
-    std::cout << ' ' << numvol;
+    message.stream() << ' ' << numvol;
   }
-  std::cout << std::endl;
 }
 
 
@@ -48,7 +50,7 @@ bool explainVolume(Ge_float const x, Ge_float const y, Ge_float const z, int con
 
   if(rankvol >= 0) {
     Ge_volu *volu = ge_volu_tab_info.ge_volu[rankvol];
-    std::cout << prefix << "* volume info: num      = " << volu->numvol
+    ORACLE_LOG(INFO) << prefix << "* volume info: num      = " << volu->numvol
       << '\n' << prefix << "|              rank     = " << volu->rankvol
       << '\n' << prefix << "|              type     = " << volu->volu_type
       << '\n' << prefix << "|              fictive  = " << volu->fictif
@@ -59,7 +61,7 @@ bool explainVolume(Ge_float const x, Ge_float const y, Ge_float const z, int con
       auto const data = volu->volu_descr.volu_equa.equa_data;
       int const nb_plus = data.nb_plus;
       int const nb_moins = data.nb_moins;
-      std::cout << prefix << "|              nb_surf+ = " << nb_plus
+      ORACLE_LOG(INFO) << prefix << "|              nb_surf+ = " << nb_plus
         << '\n' << prefix << "|              nb_surf- = " << nb_moins
         << '\n';
       std::string moreprefix = prefix + "| ";
@@ -68,7 +70,7 @@ bool explainVolume(Ge_float const x, Ge_float const y, Ge_float const z, int con
         auto surf_sign = ge_surf_pos(surf, x, y, z);
         bool const thisSurfSuccess = surf_sign == GE_SURF_PLUS;
         success = success && thisSurfSuccess;
-        std::cout << moreprefix << "+ surf: num  = " << surf->numsurf
+        ORACLE_LOG(INFO) << moreprefix << "+ surf: num  = " << surf->numsurf
           << '\n' << moreprefix << "+       rank = " << surf->ranksurf
           << '\n' << moreprefix << "+       type = " << surf->surf_type
           << '\n' << moreprefix << "+       transform = " << surf->transform
@@ -81,7 +83,7 @@ bool explainVolume(Ge_float const x, Ge_float const y, Ge_float const z, int con
         auto surf_sign = ge_surf_pos(surf, x, y, z);
         bool const thisSurfSuccess = surf_sign == GE_SURF_MOINS;
         success = success && thisSurfSuccess;
-        std::cout << moreprefix << "- surf: num  = " << surf->numsurf
+        ORACLE_LOG(INFO) << moreprefix << "- surf: num  = " << surf->numsurf
           << '\n' << moreprefix << "-       rank = " << surf->ranksurf
           << '\n' << moreprefix << "-       type = " << surf->surf_type
           << '\n' << moreprefix << "-       transform = " << surf->transform
@@ -98,32 +100,32 @@ bool explainVolume(Ge_float const x, Ge_float const y, Ge_float const z, int con
         case GE_OPERATOR_UNION:
           {
             auto const &reunion_arg = op.operator_arg.reunion_arg;
-            std::cout << prefix << "* operator UNION, " << reunion_arg.nb_arg << " args\n";
+            ORACLE_LOG(INFO) << prefix << "* operator UNION, " << reunion_arg.nb_arg << " args\n";
             bool unionSuccess = false;
             for(int iarg=0; iarg<reunion_arg.nb_arg; ++iarg) {
               Ge_volu *volu_union = reunion_arg.reunion[iarg];
               int const subnumvol = volu_union->numvol;
-              std::cout << prefix << "(U)recursing into subvolume " << subnumvol << '\n';
+              ORACLE_LOG(INFO) << prefix << "(U)recursing into subvolume " << subnumvol << '\n';
               bool const subVolumeSuccess = explainVolume(x, y, z, subnumvol, prefix + "| ");
               unionSuccess = unionSuccess || subVolumeSuccess;
             }
-            std::cout << prefix << "* operator UNION success = " << (unionSuccess ? "OK" : "FAILED") << '\n';
+            ORACLE_LOG(INFO) << prefix << "* operator UNION success = " << (unionSuccess ? "OK" : "FAILED") << '\n';
             success = success || unionSuccess;
           }
           break;
         case GE_OPERATOR_INTER:
           {
             auto const &inter_arg = op.operator_arg.inter_arg;
-            std::cout << prefix << "* operator INTE, " << inter_arg.nb_arg << " args\n";
+            ORACLE_LOG(INFO) << prefix << "* operator INTE, " << inter_arg.nb_arg << " args\n";
             bool interSuccess = true;
             for(int iarg=0; iarg<inter_arg.nb_arg; ++iarg) {
               Ge_volu *volu_inter = inter_arg.inter[iarg];
               int const subnumvol = volu_inter->numvol;
-              std::cout << prefix << "(I)recursing into subvolume " << subnumvol << '\n';
+              ORACLE_LOG(INFO) << prefix << "(I)recursing into subvolume " << subnumvol << '\n';
               bool const subVolumeSuccess = explainVolume(x, y, z, subnumvol, prefix + "| ");
               interSuccess = interSuccess && subVolumeSuccess;
             }
-            std::cout << prefix << "* operator INTE success = " << (interSuccess ? "OK" : "FAILED") << '\n';
+            ORACLE_LOG(INFO) << prefix << "* operator INTE success = " << (interSuccess ? "OK" : "FAILED") << '\n';
             success = success && interSuccess;
           }
           break;
@@ -132,17 +134,41 @@ bool explainVolume(Ge_float const x, Ge_float const y, Ge_float const z, int con
       }
     }
 
-    std::cout << prefix << "* volume " << numvol << ": " << (success ? "OK" : "FAILED") << '\n';
+    ORACLE_LOG(INFO) << prefix << "* volume " << numvol << ": " << (success ? "OK" : "FAILED") << '\n';
   } else {
-    std::cout << prefix << "* volume not found\n";
+    ORACLE_LOG(INFO) << prefix << "* volume not found\n";
   }
 
   return success;
 }
 
+void explainBytecode(CSGBytecode const &bytecode, Ge_float const x, Ge_float const y, Ge_float const z, int const numvol)
+{
+  {
+    LogMessage message(LogLevel::INFO);
+    message.stream() << "Bytecode: point contained in the following volumes:";
+    for(long rank=0; rank<bytecode.getNbVolumes(); ++rank) {
+      if(!bytecode.isFictive(rank) && bytecode.contains(rank, x, y, z)) {
+        message.stream() << ' ' << bytecode.getVolumeNumber(rank);
+      }
+    }
+  }
+
+  int const rankvol = numvol_to_rankvol(numvol);
+  if(rankvol < 0 || rankvol >= bytecode.getNbVolumes()) {
+    return;
+  }
+  bytecode.disassemble(rankvol, LogMessage(LogLevel::INFO).stream());
+  ORACLE_LOG(INFO) << "Bytecode: volume " << numvol << ": "
+    << (bytecode.contains(rankvol, x, y, z) ? "OK" : "FAILED") << '\n';
+}
+
 void explain(OptionsExplainT4 const &options)
 {
   T4Geometry t4Geom(options.filenames[0]);
+  if(options.bytecode) {
+    t4Geom.compileBytecode();
+  }
   std::ifstream iFile(options.filenames[1]);
 
   Ge_float x, y, z;
@@ -152,11 +178,16 @@ void explain(OptionsExplainT4 const &options)
     if(!iFile) {
       break;
     }
-    std::cout << "Inspecting point (" << x << ", " << y << ", " << z
+    // the explanation of a point is printed in one piece
+    LogGroup group;
+    ORACLE_LOG(INFO) << "Inspecting point (" << x << ", " << y << ", " << z
       << "), volume " << volID << "?\n";
     containedInVolumes(x, y, z);
     explainVolume(x, y, z, volID, "");
-    std::cout << std::endl;
+    if(options.bytecode) {
+      explainBytecode(*t4Geom.getBytecode(), x, y, z, volID);
+    }
+    ORACLE_LOG(INFO) << '\n';
   }
 }
 
@@ -164,7 +195,7 @@ int main(int argc, char **argv)
 {
   auto start = std::chrono::system_clock::now();
   std::cout << "*** Tripoli-4 geometry query ***" << endl;
-  t4_output_stream = &cout;
+  t4_output_stream = &Log::infoStream();
   t4_language = T4_ENGLISH;
 
   // ---- Read options ----
@@ -174,11 +205,19 @@ int main(int argc, char **argv)
     help();
     exit(EXIT_SUCCESS);
   }
+  if (options.verbosity > 0) {
+    Log::setLevel(LogLevel::VERBOSE);
+  }
 
-  explain(options);
+  try {
+    explain(options);
+  } catch (std::runtime_error const &error) {
+    ORACLE_LOG(ERROR) << "Error: " << error.what();
+    exit(EXIT_FAILURE);
+  }
 
   auto end = std::chrono::system_clock::now();
   std::chrono::duration<double> elapsed_seconds = end - start;
-  std::cout << "Elapsed time: " << elapsed_seconds.count() << "s\n";
+  ORACLE_LOG(INFO) << "Elapsed time: " << elapsed_seconds.count() << "s";
   return 0;
 }
@@ -0,0 +1,92 @@
+/**
+ * @file failuresToVisu.cc
+ * Converts the failed points streamed by oracle --stream-failures to the
+ * files read by the T4 visualiser.
+ *
+ * @brief contains the main function of the failuresToVisu program
+ *
+ * @version 1.0
+ */
+
+#include "FailureSink.hh"
+#include "Log.hh"
+#include "PointCloudWriter.hh"
+#include "Statistics.hh"
+#include "help_compat.hh"
+#ifdef ORACLE_WITH_T4
+#include "t4coreglob.hh"
+#endif
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+#ifdef ORACLE_WITH_T4
+int strictness_level = 3; //Global variable required by T4 libraries
+#endif
+
+/** \brief Display the command line help
+ */
+void help()
+{
+  std::cout << endl
+            << "failuresToVisu\n"
+            << "\n  Convert the failed points written by oracle --stream-failures to the"
+            << "\n  .failedpoints.dat and .points files of the T4 visualiser, or to a"
+            << "\n  binary VTK PolyData file for ParaView."
+            << "\n\nUSAGE"
+            << "\n\tfailuresToVisu [--vtp] jdd.failures [jdd2.failures ...]" << endl
+            << endl;
+
+  std::cout << "INPUT FILES" << endl;
+  edit_help_option("jdd.failures", "A failed points file written by oracle; jdd.failedpoints.dat is written in the current directory.");
+
+  std::cout << endl
+            << "OPTIONS" << endl;
+  edit_help_option("--vtp", "Write jdd.failedpoints.vtp instead of the files of the T4 visualiser.");
+  std::cout << endl;
+}
+
+int main(int argc, char **argv)
+{
+  if (argc < 2 || string(argv[1]) == "-h" || string(argv[1]) == "--help") {
+    help();
+    exit(argc < 2 ? EXIT_FAILURE : EXIT_SUCCESS);
+  }
+#ifdef ORACLE_WITH_T4
+  t4_output_stream = &Log::infoStream();
+  t4_language = (T4_language)0;
+#endif
+
+  bool const vtp = string(argv[1]) == "--vtp";
+  for (int i = vtp ? 2 : 1; i < argc; ++i) {
+    string path(argv[i]);
+    try {
+      FailureReader reader(path);
+      string rawname = Statistics::getRawFileName(path);
+      if (vtp) {
+        PointCloudWriter cloud(rawname + ".failedpoints.vtp");
+        failedPoint point;
+        while (reader.read(point)) {
+          cloud.add(point.position, int64_t(point.mcnpParticleID), long(point.mcnpCellID), long(point.mcnpMaterialID),
+                    long(point.rank), point.dist, ResultStore::Verdict::FAILURE);
+        }
+        cloud.close();
+        ORACLE_LOG(INFO) << path << ": " << cloud.getNbPoints() << " failed points written to " << cloud.getPath();
+        continue;
+      }
+      long nbPoints = 0;
+      Statistics::writeFailedPoints(rawname, [&reader, &nbPoints](failedPoint &point) {
+        bool const read = reader.read(point);
+        nbPoints += read;
+        return read;
+      });
+      ORACLE_LOG(INFO) << path << ": " << nbPoints << " failed points written to " << rawname << ".failedpoints.dat";
+    } catch (std::runtime_error const &error) {
+      ORACLE_LOG(ERROR) << "Error: " << error.what();
+      exit(EXIT_FAILURE);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,135 @@
+/**
+ * @file gapSource.cc
+ * Generates MCNP source points in the T4 volumes that a comparison missed.
+ *
+ * @brief contains the main function of the gapSource program
+ *
+ * @version 1.0
+ */
+
+#include "GapSource.hh"
+#include "Log.hh"
+#include "Statistics.hh"
+#include "T4Geometry.hh"
+#include "options_gapSource.hh"
+#ifdef ORACLE_WITH_T4
+#include "t4coreglob.hh"
+#endif
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+#ifdef ORACLE_WITH_T4
+int strictness_level = 3; //Global variable required by T4 libraries
+#endif
+
+void generate(OptionsGapSource const &options)
+{
+  T4Geometry t4Geom(options.filenames[0], options.backend);
+  // the bytecode provides the bounding boxes of the volumes
+  t4Geom.compileBytecode();
+  CSGBytecode const &bytecode = *t4Geom.getBytecode();
+
+  Statistics stats;
+  stats.setNbT4Volumes(t4Geom.getNbVolumes());
+  for (size_t i = 1; i < options.filenames.size(); ++i) {
+    try {
+      stats.merge(options.filenames[i]);
+    } catch (std::runtime_error const &error) {
+      ORACLE_LOG(ERROR) << "Error: " << error.what();
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  GapSource source(t4Geom, options.seed);
+  vector<array<double, 3>> points;
+  vector<string> comments = {"source points in the T4 volumes never hit by the oracle",
+                             "generated by gapSource from " + options.filenames[0],
+                             "add the particle type and energy of the original source to sdef"};
+  long nbUncovered = 0, nbSampled = 0;
+  for (long rank : stats.getUncoveredRanks()) {
+    if (bytecode.isFictive(rank)) {
+      continue;
+    }
+    ++nbUncovered;
+    long const number = bytecode.getVolumeNumber(rank);
+    BoundingBox box = bytecode.getBoundingBox(rank);
+    if (options.box) {
+      box = intersectBoxes(box, *options.box);
+    }
+    bool const finite = std::isfinite(box[0]) && std::isfinite(box[1]) && std::isfinite(box[2])
+                        && std::isfinite(box[3]) && std::isfinite(box[4]) && std::isfinite(box[5]);
+    if (!finite) {
+      ORACLE_LOG(INFO) << "Volume " << number << " is unbounded: use --box to sample it";
+      continue;
+    }
+    vector<array<double, 3>> const volumePoints = source.sample(rank, box, options.nbPointsPerVolume);
+    if (volumePoints.empty()) {
+      ORACLE_LOG(INFO) << "Volume " << number << ": no point found";
+      continue;
+    }
+    ORACLE_LOG(VERBOSE) << "Volume " << number << " (rank " << rank << "): " << volumePoints.size() << " points";
+    ++nbSampled;
+    comments.push_back("volume " + to_string(number) + ": " + to_string(volumePoints.size()) + " points");
+    points.insert(points.end(), volumePoints.begin(), volumePoints.end());
+  }
+  ORACLE_LOG(INFO) << "Number of uncovered volumes: " << nbUncovered;
+  ORACLE_LOG(INFO) << "Number of volumes with source points: " << nbSampled;
+  if (points.empty()) {
+    ORACLE_LOG(INFO) << "No source point written";
+    return;
+  }
+
+  string output = options.output;
+  if (output.empty()) {
+    string t4Filename = options.filenames[0];
+    output = stats.getRawFileName(t4Filename) + ".gaps.sdef";
+  }
+  ofstream fout(output);
+  if (!fout) {
+    ORACLE_LOG(ERROR) << "Error: cannot write " << output;
+    exit(EXIT_FAILURE);
+  }
+  GapSource::writeSDEF(fout, points, comments);
+  ORACLE_LOG(INFO) << "Wrote " << points.size() << " source points to " << output;
+}
+
+int main(int argc, char **argv)
+{
+  auto start = std::chrono::system_clock::now();
+  // printed directly, like the help and the errors in the options, before any message is logged
+  std::cout << "*** Coverage-gap source generator ***" << endl;
+#ifdef ORACLE_WITH_T4
+  t4_output_stream = &Log::infoStream();
+  t4_language = (T4_language)0;
+#endif
+
+  // ---- Read options ----
+  OptionsGapSource options;
+  options.get_opts(argc, argv);
+  if (options.help) {
+    help();
+    exit(EXIT_SUCCESS);
+  }
+  if (options.verbosity > 0) {
+    Log::setLevel(LogLevel::VERBOSE);
+  }
+
+  try {
+    generate(options);
+  } catch (std::runtime_error const &error) {
+    ORACLE_LOG(ERROR) << "Error: " << error.what();
+    exit(EXIT_FAILURE);
+  }
+
+  auto end = std::chrono::system_clock::now();
+  std::chrono::duration<double> elapsed_seconds = end - start;
+  ORACLE_LOG(INFO) << "Elapsed time: " << elapsed_seconds.count() << "s";
+  return 0;
+}
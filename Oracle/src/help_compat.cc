@@ -0,0 +1,41 @@
+/**
+ * @file help_compat.cc
+ *
+ *
+ * @brief Command-line help helpers for builds without the T4 libraries
+ *
+ * @version 1.0
+ */
+
+#include "help_compat.hh"
+
+#ifndef ORACLE_WITH_T4
+#include <cstdlib>
+#include <iostream>
+
+namespace
+{
+/// column where the option descriptions start
+constexpr size_t helpDescriptionColumn = 32;
+} // namespace
+
+void edit_help_option(std::string const &option, std::string const &description)
+{
+  std::string line = "  " + option + " ";
+  if (line.size() < helpDescriptionColumn) {
+    line.append(helpDescriptionColumn - line.size(), '.');
+  }
+  std::cout << line << " " << description << std::endl;
+}
+
+long int_of_string(std::string const &value)
+{
+  char *end = nullptr;
+  long const result = std::strtol(value.c_str(), &end, 10);
+  if (value.empty() || *end != '\0') {
+    std::cerr << "\nError: '" << value << "' is not an integer.\n" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  return result;
+}
+#endif
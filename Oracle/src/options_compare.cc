@@ -1,11 +1,29 @@
 #include "options_compare.hh"
-#include "help.hh"
+#include "help_compat.hh"
+#include <algorithm>
 #include <cstdio>
 #include <cstdlib>
+#include <glob.h>
+#include <iostream>
+#include <sstream>
 #include <unistd.h>
 
 using namespace std;
 
+namespace
+{
+/// converts an option value to an integer, unlike int_of_string() without exiting
+long parseInteger(string const &value)
+{
+  char *end = nullptr;
+  long const result = strtol(value.c_str(), &end, 10);
+  if (value.empty() || *end != '\0') {
+    throw OptionsError("'" + value + "' is not an integer");
+  }
+  return result;
+}
+} // namespace
+
 /** \brief Display the command line help
  */
 void help()
@@ -16,13 +34,15 @@ void help()
             << "\n  A point is assumed to match by checking the name of the composition at"
             << "\n  that point in each geometry."
             << "\n\nUSAGE"
-            << "\n\toracle [options] jdd.t4 jdd.inp ptrac" << endl
+            << "\n\toracle [options] jdd.t4 jdd.inp ptrac [ptrac2 ...]"
+            << "\n\toracle [options] --sample-box XMIN XMAX YMIN YMAX ZMIN ZMAX jdd.t4 jdd.inp"
+            << "\n\toracle [options] --backend native --t4 variant.t4 jdd.t4 jdd.inp ptrac" << endl
             << endl;
 
   std::cout << "INPUT FILES" << endl;
   edit_help_option("jdd.t4", "A TRIPOLI-4 input file converted from MCNP INP file.");
   edit_help_option("jdd.inp", "The MCNP INP file that was used for the conversion.");
-  edit_help_option("ptrac", "The MCNP PTRAC file corresponding to the INP file.");
+  edit_help_option("ptrac", "The MCNP PTRAC file(s) corresponding to the INP file; several files or a quoted glob are read concurrently.");
 
   std::cout << endl
             << "OPTIONS" << endl;
@@ -30,8 +50,44 @@ void help()
   edit_help_option("-h, --help", "Displays this help message.");
   edit_help_option("-n, --npts", "Maximum number of tested points.");
   edit_help_option("-d, --delta", "Distance to the nearest surface below which a failed test is ignored.");
+  edit_help_option("--distance rays|analytic", "Estimate the distance to the nearest surface with six ray casts (default) or from the surface equations.");
   edit_help_option("-g, --guess-material-assocs", "guess the materials correspondence based on the first few points");
   edit_help_option("--binary,---ascii", "Specify the format of the MCNP PTRAC file");
+  edit_help_option("--sequential P CONFIDENCE", "Stop as soon as the failure probability is shown to be below or above P with the given confidence.");
+  edit_help_option("--shell WIDTH", "Only compare the points whose estimated distance to the nearest T4 surface is at most WIDTH. Requires --bytecode with --backend t4; with --voxel-grid, the interior points are skipped before being located.");
+  edit_help_option("--shell-interior N", "With --shell, still compare one interior point out of N (default: 100; 0: none).");
+  edit_help_option("--cell-quota K", "Skip the points of the MCNP cells which already have K successful comparisons.");
+  edit_help_option("--time-budget SECONDS", "Stop after SECONDS of comparison, comparing a random fraction of the points spread over the whole PTRAC file.");
+  edit_help_option("--seed N", "Seed of the point selection of --time-budget (default: 0).");
+  edit_help_option("--save-stats FILE", "Save the statistics of the run, for gapSource or --merge-stats.");
+  edit_help_option("--merge-stats FILE", "Add the statistics saved by a previous run to the report (repeatable).");
+  edit_help_option("--save-confusion FILE", "Save the number of points per MCNP cell and T4 volume to FILE, as CSV.");
+  edit_help_option("--stream-failures", "Write the failed points to jdd.failures as they are found, in a compact binary format, instead of keeping them in memory.");
+  edit_help_option("--cluster-failures SIZE", "Group the failed points by cells, material and composition, then into connected regions of voxels of edge SIZE; report the largest clusters and write them to jdd.clusters, with representative points for explainT4 in jdd.representatives.");
+  edit_help_option("--cluster-representatives N", "Number of representative points kept per cluster (default: 4).");
+  edit_help_option("--heat-map NX NY NZ", "Count the compared, failed and ignored points on a mesh of NX x NY x NZ cells and write them to jdd.heatmap.vti (VTK ImageData).");
+  edit_help_option("--heat-map-box XMIN XMAX YMIN YMAX ZMIN ZMAX", "Bounds of the --heat-map mesh (default: the box enclosing the bounded T4 volumes).");
+  edit_help_option("--vtp", "Write the failed points to jdd.failedpoints.vtp (binary VTK PolyData, for ParaView).");
+  edit_help_option("--vtp-all", "Also write all the compared points to jdd.sampledpoints.vtp.");
+  edit_help_option("--output-dir DIR", "Write the files named after the T4 file (jdd.failedpoints.dat, jdd.failures, jdd.clusters, ...) to DIR instead of the current directory.");
+  edit_help_option("--events FILE", "Write the failures, the material associations, the progress and a final summary to FILE as newline-delimited JSON.");
+  edit_help_option("--save-results FILE", "Save the T4 rank and the verdict of every compared point, for --reuse-results.");
+  edit_help_option("--reuse-results FILE", "Reuse the results saved by a run on an earlier version of the T4 file; only the points which the changed volumes may affect are located again.");
+  edit_help_option("--checkpoint FILE", "Save the state of the comparison to FILE periodically, and when interrupted by SIGINT or SIGTERM.");
+  edit_help_option("--checkpoint-interval SECONDS", "Time between two checkpoints (default: 600).");
+  edit_help_option("--resume", "Continue the comparison from the state saved in the --checkpoint file.");
+  edit_help_option("--t4 FILE", "Also compare the T4 file FILE with the same MCNP points (repeatable; requires --backend native).");
+  edit_help_option("--voxel-grid NX NY NZ", "Cache the T4 volumes on a voxel grid with the given number of voxels.");
+  edit_help_option("--voxel-box XMIN XMAX YMIN YMAX ZMIN ZMAX", "Bounds of the voxel grid (required by --voxel-grid).");
+  edit_help_option("--voxel-refine N", "Number of adaptive refinement levels of mixed voxels (default: 0).");
+  edit_help_option("--voxel-threads N", "Number of threads used to build the voxel grid (default: 1).");
+  edit_help_option("--voxel-cache FILE", "Read the voxel grid from FILE if it matches the T4 file, write it otherwise.");
+  edit_help_option("--backend t4|native", "Evaluate the T4 geometry with the T4 libraries or with the native evaluator.");
+  edit_help_option("--cross-check", "Compare the volumes found by the T4 libraries with the native evaluator.");
+  edit_help_option("--bytecode", "Locate points with a bytecode compiled from the T4 libraries; failed points are checked with the libraries.");
+  edit_help_option("--sample-box XMIN XMAX YMIN YMAX ZMIN ZMAX", "Sample quasi-random points in the box and locate them with the built-in MCNP evaluator instead of reading a PTRAC file.");
+  edit_help_option("--tracks", "Walk the segments between the successive events of each history through the T4 geometry and compare every volume crossed (requires --ascii).");
+  edit_help_option("--check-cells", "Compare the PTRAC cells with the cells found by the built-in MCNP evaluator.");
 
   std::cout << endl;
 }
@@ -41,8 +97,24 @@ void help()
 OptionsCompare::OptionsCompare() : help(false),
                                    verbosity(0),
                                    delta(1.0E-7),
+                                   distanceMethod(DistanceMethod::RAYS),
                                    guessMaterialAssocs(false),
-                                   ptracFormat(PTRACFormat::BINARY)
+                                   ptracFormat(PTRACFormat::BINARY),
+                                   voxelRefine(0),
+                                   voxelThreads(1),
+                                   backend(defaultT4Backend),
+                                   crossCheck(false),
+                                   bytecode(false),
+                                   checkCells(false),
+                                   tracks(false),
+                                   shellInterior(100),
+                                   seed(0),
+                                   streamFailures(false),
+                                   clusterRepresentatives(4),
+                                   vtpFailures(false),
+                                   vtpAll(false),
+                                   checkpointInterval(600.),
+                                   resume(false)
 {
 }
 
@@ -71,7 +143,7 @@ void OptionsCompare::get_opts(int argc, char **argv)
       } else if (opt == "--npts" || opt == "-n") {
         int nv = 1;
         check_argv(argc, i + nv);
-        long const npoints_arg = int_of_string(argv[i + 1]);
+        long const npoints_arg = parseInteger(argv[i + 1]);
         if(npoints_arg <= 0) {
           std::cout << "Warning: npoints<=0. Ignored." << std::endl;
         } else {
@@ -88,24 +160,366 @@ void OptionsCompare::get_opts(int argc, char **argv)
           delta = 1.0e-7;
         }
         i += nv;
+      } else if (opt == "--distance") {
+        int nv = 1;
+        check_argv(argc, i + nv);
+        string const methodName(argv[i + 1]);
+        if (methodName == "rays") {
+          distanceMethod = DistanceMethod::RAYS;
+        } else if (methodName == "analytic") {
+          distanceMethod = DistanceMethod::ANALYTIC;
+        } else {
+          throw OptionsError("unknown distance method '" + methodName + "' (expected rays or analytic)");
+        }
+        i += nv;
       } else if (opt == "--binary") {
         ptracFormat = PTRACFormat::BINARY;
       } else if (opt == "--ascii") {
         ptracFormat = PTRACFormat::ASCII;
+      } else if (opt == "--voxel-grid") {
+        int nv = 3;
+        check_argv(argc, i + nv);
+        voxelGrid = std::make_unique<std::array<long, 3>>();
+        for (int j = 0; j < nv; ++j) {
+          (*voxelGrid)[j] = parseInteger(argv[i + 1 + j]);
+          if ((*voxelGrid)[j] <= 0) {
+            throw OptionsError("the number of voxels must be positive");
+          }
+        }
+        i += nv;
+      } else if (opt == "--voxel-box") {
+        int nv = 6;
+        check_argv(argc, i + nv);
+        voxelBox = std::make_unique<std::array<double, 6>>();
+        for (int j = 0; j < nv; ++j) {
+          istringstream os(argv[i + 1 + j]);
+          if (!(os >> (*voxelBox)[j]) || !(os >> std::ws).eof()) {
+            throw OptionsError("'" + string(argv[i + 1 + j]) + "' is not a number");
+          }
+        }
+        if (!((*voxelBox)[0] < (*voxelBox)[1] && (*voxelBox)[2] < (*voxelBox)[3] && (*voxelBox)[4] < (*voxelBox)[5])) {
+          throw OptionsError("the bounds of the voxel box must be increasing");
+        }
+        i += nv;
+      } else if (opt == "--voxel-refine") {
+        int nv = 1;
+        check_argv(argc, i + nv);
+        voxelRefine = std::max(0, int(parseInteger(argv[i + 1])));
+        i += nv;
+      } else if (opt == "--voxel-threads") {
+        int nv = 1;
+        check_argv(argc, i + nv);
+        voxelThreads = std::max(1, int(parseInteger(argv[i + 1])));
+        i += nv;
+      } else if (opt == "--voxel-cache") {
+        int nv = 1;
+        check_argv(argc, i + nv);
+        voxelCachePath = argv[i + 1];
+        i += nv;
+      } else if (opt == "--backend") {
+        int nv = 1;
+        check_argv(argc, i + nv);
+        string const backendName(argv[i + 1]);
+        if (backendName == "t4") {
+          backend = T4Backend::T4LIB;
+        } else if (backendName == "native") {
+          backend = T4Backend::NATIVE;
+        } else {
+          throw OptionsError("unknown backend '" + backendName + "' (expected t4 or native)");
+        }
+        i += nv;
+      } else if (opt == "--cross-check") {
+        crossCheck = true;
+      } else if (opt == "--bytecode") {
+        bytecode = true;
+      } else if (opt == "--sample-box") {
+        int nv = 6;
+        check_argv(argc, i + nv);
+        sampleBox = std::make_unique<std::array<double, 6>>();
+        for (int j = 0; j < nv; ++j) {
+          istringstream os(argv[i + 1 + j]);
+          os >> (*sampleBox)[j];
+        }
+        if (!((*sampleBox)[0] < (*sampleBox)[1] && (*sampleBox)[2] < (*sampleBox)[3] && (*sampleBox)[4] < (*sampleBox)[5])) {
+          throw OptionsError("the bounds of the sampling box must be increasing");
+        }
+        i += nv;
+      } else if (opt == "--sequential") {
+        int nv = 2;
+        check_argv(argc, i + nv);
+        sequential = std::make_unique<std::array<double, 2>>();
+        for (int j = 0; j < nv; ++j) {
+          istringstream os(argv[i + 1 + j]);
+          os >> (*sequential)[j];
+        }
+        if (!((*sequential)[0] > 0. && (*sequential)[0] < 1. && (*sequential)[1] > 0. && (*sequential)[1] < 1.)) {
+          throw OptionsError("the failure probability and the confidence of --sequential must be in (0, 1)");
+        }
+        i += nv;
+      } else if (opt == "--shell") {
+        int nv = 1;
+        check_argv(argc, i + nv);
+        shell = std::make_unique<double>(0.);
+        istringstream os(argv[i + 1]);
+        os >> *shell;
+        if (!(*shell > 0.)) {
+          throw OptionsError("the width of the surface shell must be positive");
+        }
+        i += nv;
+      } else if (opt == "--shell-interior") {
+        int nv = 1;
+        check_argv(argc, i + nv);
+        shellInterior = std::max(0l, long(parseInteger(argv[i + 1])));
+        i += nv;
+      } else if (opt == "--cell-quota") {
+        int nv = 1;
+        check_argv(argc, i + nv);
+        long const quota = parseInteger(argv[i + 1]);
+        if (quota <= 0) {
+          throw OptionsError("the cell quota must be positive");
+        }
+        cellQuota = std::make_unique<long>(quota);
+        i += nv;
+      } else if (opt == "--time-budget") {
+        int nv = 1;
+        check_argv(argc, i + nv);
+        timeBudget = std::make_unique<double>(0.);
+        istringstream os(argv[i + 1]);
+        os >> *timeBudget;
+        if (!(*timeBudget > 0.)) {
+          throw OptionsError("the time budget must be positive");
+        }
+        i += nv;
+      } else if (opt == "--seed") {
+        int nv = 1;
+        check_argv(argc, i + nv);
+        seed = std::max(0l, long(parseInteger(argv[i + 1])));
+        i += nv;
+      } else if (opt == "--save-stats") {
+        int nv = 1;
+        check_argv(argc, i + nv);
+        saveStats = argv[i + 1];
+        i += nv;
+      } else if (opt == "--merge-stats") {
+        int nv = 1;
+        check_argv(argc, i + nv);
+        mergeStats.push_back(argv[i + 1]);
+        i += nv;
+      } else if (opt == "--save-confusion") {
+        int nv = 1;
+        check_argv(argc, i + nv);
+        saveConfusion = argv[i + 1];
+        i += nv;
+      } else if (opt == "--events") {
+        int nv = 1;
+        check_argv(argc, i + nv);
+        events = argv[i + 1];
+        i += nv;
+      } else if (opt == "--output-dir") {
+        int nv = 1;
+        check_argv(argc, i + nv);
+        outputDir = argv[i + 1];
+        i += nv;
+      } else if (opt == "--stream-failures") {
+        streamFailures = true;
+      } else if (opt == "--cluster-failures") {
+        int nv = 1;
+        check_argv(argc, i + nv);
+        clusterSize = std::make_unique<double>(0.);
+        istringstream os(argv[i + 1]);
+        os >> *clusterSize;
+        if (!(*clusterSize > 0.)) {
+          throw OptionsError("the voxel size of the failure clusters must be positive");
+        }
+        i += nv;
+      } else if (opt == "--cluster-representatives") {
+        int nv = 1;
+        check_argv(argc, i + nv);
+        clusterRepresentatives = std::max(0l, long(parseInteger(argv[i + 1])));
+        i += nv;
+      } else if (opt == "--heat-map") {
+        int nv = 3;
+        check_argv(argc, i + nv);
+        heatMapGrid = std::make_unique<std::array<long, 3>>();
+        for (int j = 0; j < nv; ++j) {
+          (*heatMapGrid)[j] = parseInteger(argv[i + 1 + j]);
+          if ((*heatMapGrid)[j] <= 0) {
+            throw OptionsError("the number of cells of the heat map must be positive");
+          }
+        }
+        i += nv;
+      } else if (opt == "--heat-map-box") {
+        int nv = 6;
+        check_argv(argc, i + nv);
+        heatMapBox = std::make_unique<std::array<double, 6>>();
+        for (int j = 0; j < nv; ++j) {
+          istringstream os(argv[i + 1 + j]);
+          os >> (*heatMapBox)[j];
+        }
+        i += nv;
+      } else if (opt == "--vtp") {
+        vtpFailures = true;
+      } else if (opt == "--vtp-all") {
+        vtpFailures = true;
+        vtpAll = true;
+      } else if (opt == "--save-results") {
+        int nv = 1;
+        check_argv(argc, i + nv);
+        saveResults = argv[i + 1];
+        i += nv;
+      } else if (opt == "--reuse-results") {
+        int nv = 1;
+        check_argv(argc, i + nv);
+        reuseResults = argv[i + 1];
+        i += nv;
+      } else if (opt == "--checkpoint") {
+        int nv = 1;
+        check_argv(argc, i + nv);
+        checkpoint = argv[i + 1];
+        i += nv;
+      } else if (opt == "--checkpoint-interval") {
+        int nv = 1;
+        check_argv(argc, i + nv);
+        istringstream os(argv[i + 1]);
+        os >> checkpointInterval;
+        if (!(checkpointInterval > 0.)) {
+          throw OptionsError("the checkpoint interval must be positive");
+        }
+        i += nv;
+      } else if (opt == "--resume") {
+        resume = true;
+      } else if (opt == "--t4") {
+        int nv = 1;
+        check_argv(argc, i + nv);
+        otherT4Files.push_back(argv[i + 1]);
+        i += nv;
+      } else if (opt == "--check-cells") {
+        checkCells = true;
+      } else if (opt == "--tracks") {
+        tracks = true;
+      } else if (filenames.size() >= 2 && opt.find_first_of("*?[") != string::npos) {
+        // a glob of PTRAC files, for shells which did not expand it
+        glob_t matches;
+        if (glob(opt.c_str(), 0, nullptr, &matches) == 0) {
+          for (size_t j = 0; j < matches.gl_pathc; ++j) {
+            filenames.push_back(matches.gl_pathv[j]);
+          }
+        } else {
+          filenames.push_back(opt);
+        }
+        globfree(&matches);
       } else {
         filenames.push_back(opt);
       }
     }
   }
 
+#ifndef ORACLE_WITH_T4
+  if (backend == T4Backend::T4LIB || crossCheck || bytecode) {
+    throw OptionsError("the oracle was built without the T4 libraries");
+  }
+#endif
+
+  if (crossCheck && backend == T4Backend::NATIVE) {
+    throw OptionsError("--cross-check requires --backend t4");
+  }
+
+  if (bytecode && backend == T4Backend::NATIVE) {
+    throw OptionsError("--bytecode requires --backend t4 (the native backend always uses a bytecode)");
+  }
+
+  if (distanceMethod == DistanceMethod::ANALYTIC && backend == T4Backend::T4LIB && !bytecode) {
+    throw OptionsError("--distance analytic requires --bytecode with --backend t4");
+  }
+
+  if (!otherT4Files.empty() && backend == T4Backend::T4LIB) {
+    // the T4 libraries hold a single geometry in global variables
+    throw OptionsError("--t4 requires --backend native");
+  }
+
+  if (!otherT4Files.empty() && (!saveStats.empty() || !mergeStats.empty() || !saveConfusion.empty())) {
+    throw OptionsError("--save-stats, --merge-stats and --save-confusion cannot be used with --t4");
+  }
+
+  if ((!saveResults.empty() || !reuseResults.empty()) && backend == T4Backend::T4LIB && !bytecode) {
+    // the geometries are diffed on the bytecode
+    throw OptionsError("--save-results and --reuse-results require --bytecode with --backend t4");
+  }
+
+  if (!otherT4Files.empty() && (!saveResults.empty() || !reuseResults.empty())) {
+    throw OptionsError("--save-results and --reuse-results cannot be used with --t4");
+  }
+
+  if (streamFailures && !saveStats.empty()) {
+    // the statistics file holds the failed points
+    throw OptionsError("--save-stats cannot be used with --stream-failures");
+  }
+
+  if (resume && checkpoint.empty()) {
+    throw OptionsError("--resume requires --checkpoint");
+  }
+
+  if (!checkpoint.empty() && timeBudget) {
+    // the keep fraction adapts to the timing of a single run
+    throw OptionsError("--checkpoint cannot be used with --time-budget");
+  }
+
+  if (sampleBox && checkCells) {
+    throw OptionsError("--check-cells requires a PTRAC file and cannot be used with --sample-box");
+  }
+
+  if (tracks && (sampleBox || ptracFormat != PTRACFormat::ASCII || filenames.size() != 3)) {
+    // the binary reader only keeps the source event of each history
+    throw OptionsError("--tracks requires a single ASCII PTRAC file (--ascii)");
+  }
+
+  if (tracks && (shell || !saveResults.empty() || !reuseResults.empty())) {
+    throw OptionsError("--shell, --save-results and --reuse-results compare points and cannot be used with --tracks");
+  }
+
+  if (sampleBox && filenames.size() != 2) {
+    throw OptionsError("expected 2 input files, got " + to_string(filenames.size()));
+  }
+  if (!sampleBox && filenames.size() < 3) {
+    throw OptionsError("expected at least 3 input files, got " + to_string(filenames.size()));
+  }
+
+  if (voxelGrid && !voxelBox) {
+    throw OptionsError("--voxel-grid requires --voxel-box");
+  }
+
+  if (voxelGrid && backend == T4Backend::T4LIB && !bytecode) {
+    // the voxels are labelled with the safe distances of the bytecode
+    throw OptionsError("--voxel-grid requires --bytecode with --backend t4");
+  }
+
+  if (shell && backend == T4Backend::T4LIB && !bytecode) {
+    // without the bytecode, the distance of every point would be found by casting rays
+    throw OptionsError("--shell requires --bytecode with --backend t4");
+  }
+
+  if (heatMapBox && !heatMapGrid) {
+    throw OptionsError("--heat-map-box requires --heat-map");
+  }
+
+  if (!outputDir.empty() && access(outputDir.c_str(), W_OK) == -1) {
+    throw OptionsError("'" + outputDir + "': unreachable output directory");
+  }
+
   // check that all the input files exist
-  for (vector<string>::const_iterator fname = filenames.begin(), efname = filenames.end();
+  vector<string> inputFiles = filenames;
+  inputFiles.insert(inputFiles.end(), mergeStats.begin(), mergeStats.end());
+  inputFiles.insert(inputFiles.end(), otherT4Files.begin(), otherT4Files.end());
+  if (!reuseResults.empty()) {
+    inputFiles.push_back(reuseResults);
+  }
+  if (resume) {
+    inputFiles.push_back(checkpoint);
+  }
+  for (vector<string>::const_iterator fname = inputFiles.begin(), efname = inputFiles.end();
        fname != efname; ++fname) {
     if (access(fname->c_str(), R_OK) == -1) {
-      cout << "'" << *fname << "': unknown option or unreachable file." << endl;
-      cout << "Try '" << argv[0] << " --help for more information.\n"
-           << endl;
-      exit(EXIT_FAILURE);
+      throw OptionsError("'" + *fname + "': unknown option or unreachable file");
     }
   }
 }
@@ -119,8 +533,6 @@ void OptionsCompare::get_opts(int argc, char **argv)
 void OptionsCompare::check_argv(int argc, int ip)
 {
   if (ip >= argc) {
-    cout << "\nError in command line.\n"
-         << endl;
-    exit(EXIT_FAILURE);
+    throw OptionsError("missing value in the command line");
   }
 }
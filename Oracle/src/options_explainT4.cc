@@ -25,6 +25,7 @@ void help()
             << "OPTIONS" << endl;
   edit_help_option("-V, --verbose", "Increase output verbosity.");
   edit_help_option("-h, --help", "Displays this help message.");
+  edit_help_option("--bytecode", "Also evaluate the point with the compiled bytecode and list its program.");
 
   std::cout << endl;
 }
@@ -32,7 +33,8 @@ void help()
 /** \brief Constructor of the class
 */
 OptionsExplainT4::OptionsExplainT4() : help(false),
-                                   verbosity(0)
+                                   verbosity(0),
+                                   bytecode(false)
 {
 }
 
@@ -56,6 +58,8 @@ void OptionsExplainT4::get_opts(int argc, char **argv)
       return;
     } else if (opt.compare("--verbose") == 0 || opt.compare("-V") == 0) {
       ++verbosity;
+    } else if (opt.compare("--bytecode") == 0) {
+      bytecode = true;
     } else {
       filenames.push_back(opt);
     }
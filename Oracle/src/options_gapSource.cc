@@ -0,0 +1,162 @@
+#include "options_gapSource.hh"
+#include "help_compat.hh"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <unistd.h>
+
+using namespace std;
+
+/** \brief Display the command line help
+ */
+void help()
+{
+  std::cout << endl
+            << "gapSource\n"
+            << "\n  Sample source points in the T4 volumes that an oracle run never hit, and"
+            << "\n  write them as an MCNP source distribution for a targeted rerun."
+            << "\n\nUSAGE"
+            << "\n\tgapSource [options] jdd.t4 run.stats [run2.stats ...]" << endl
+            << endl;
+
+  std::cout << "INPUT FILES" << endl;
+  edit_help_option("jdd.t4", "The TRIPOLI-4 input file of the comparison.");
+  edit_help_option("run.stats", "Statistics files written by oracle --save-stats.");
+
+  std::cout << endl
+            << "OPTIONS" << endl;
+  edit_help_option("-V, --verbose", "Increase output verbosity.");
+  edit_help_option("-h, --help", "Displays this help message.");
+  edit_help_option("-n, --npts N", "Number of source points per uncovered volume (default: 10).");
+  edit_help_option("-o, --output FILE", "The file of MCNP source cards (default: jdd.gaps.sdef).");
+  edit_help_option("--seed N", "Seed of the random sampling (default: 0).");
+  edit_help_option("--box XMIN XMAX YMIN YMAX ZMIN ZMAX", "Bounds the sampling of unbounded volumes.");
+  edit_help_option("--backend t4|native", "Evaluate the T4 geometry with the T4 libraries or with the native evaluator.");
+
+  std::cout << endl;
+}
+
+/** \brief Constructor of the class
+*/
+OptionsGapSource::OptionsGapSource() : help(false),
+                                       verbosity(0),
+                                       nbPointsPerVolume(10),
+                                       seed(0),
+                                       backend(defaultT4Backend)
+{
+}
+
+/** \brief Get the options set in the command line
+ * @param[in] argc The number of arguments in the command line
+ * @param[in] argv The splitted command line
+ */
+void OptionsGapSource::get_opts(int argc, char **argv)
+{
+
+  if (argc <= 2) {
+    help = true;
+    return;
+  }
+
+  for (int i = 1; i < argc; i++) {
+    string opt(argv[i]);
+
+    if (opt == "--help" || opt == "-h") {
+      help = true;
+      return;
+    } else if (opt == "--verbose" || opt == "-V") {
+      ++verbosity;
+    } else if (opt == "--npts" || opt == "-n") {
+      int nv = 1;
+      check_argv(argc, i + nv);
+      nbPointsPerVolume = int_of_string(argv[i + 1]);
+      if (nbPointsPerVolume <= 0) {
+        cout << "\nError: the number of points per volume must be positive.\n"
+             << endl;
+        exit(EXIT_FAILURE);
+      }
+      i += nv;
+    } else if (opt == "--output" || opt == "-o") {
+      int nv = 1;
+      check_argv(argc, i + nv);
+      output = argv[i + 1];
+      i += nv;
+    } else if (opt == "--seed") {
+      int nv = 1;
+      check_argv(argc, i + nv);
+      seed = std::max(0l, long(int_of_string(argv[i + 1])));
+      i += nv;
+    } else if (opt == "--box") {
+      int nv = 6;
+      check_argv(argc, i + nv);
+      box = std::make_unique<std::array<double, 6>>();
+      for (int j = 0; j < nv; ++j) {
+        istringstream os(argv[i + 1 + j]);
+        os >> (*box)[j];
+      }
+      if (!((*box)[0] < (*box)[1] && (*box)[2] < (*box)[3] && (*box)[4] < (*box)[5])) {
+        cout << "\nError: the bounds of the sampling box must be increasing.\n"
+             << endl;
+        exit(EXIT_FAILURE);
+      }
+      i += nv;
+    } else if (opt == "--backend") {
+      int nv = 1;
+      check_argv(argc, i + nv);
+      string const backendName(argv[i + 1]);
+      if (backendName == "t4") {
+        backend = T4Backend::T4LIB;
+      } else if (backendName == "native") {
+        backend = T4Backend::NATIVE;
+      } else {
+        cout << "\nError: unknown backend '" << backendName << "' (expected t4 or native).\n"
+             << endl;
+        exit(EXIT_FAILURE);
+      }
+      i += nv;
+    } else {
+      filenames.push_back(opt);
+    }
+  }
+
+#ifndef ORACLE_WITH_T4
+  if (backend == T4Backend::T4LIB) {
+    cout << "\nError: gapSource was built without the T4 libraries.\n"
+         << endl;
+    exit(EXIT_FAILURE);
+  }
+#endif
+
+  if (filenames.size() < 2) {
+    cout << "\nError: expected a T4 file and at least one statistics file.\n"
+         << endl;
+    exit(EXIT_FAILURE);
+  }
+
+  // check that all the input files exist
+  for (auto const &fname : filenames) {
+    if (access(fname.c_str(), R_OK) == -1) {
+      cout << "'" << fname << "': unknown option or unreachable file." << endl;
+      cout << "Try '" << argv[0] << " --help for more information.\n"
+           << endl;
+      exit(EXIT_FAILURE);
+    }
+  }
+}
+
+/** \brief Check if the position of the last value for an option is compatible
+ * with the line command line.
+ * \param argc The number of arguments in the line command.
+ * \param ip   The expected position of the last value of the option in the
+ * commmand line.
+ */
+void OptionsGapSource::check_argv(int argc, int ip)
+{
+  if (ip >= argc) {
+    cout << "\nError in command line.\n"
+         << endl;
+    exit(EXIT_FAILURE);
+  }
+}
@@ -0,0 +1,125 @@
+#include "options_oracleBatch.hh"
+#include "help_compat.hh"
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <unistd.h>
+
+using namespace std;
+
+/** \brief Display the command line help
+ */
+void helpBatch()
+{
+  std::cout << endl
+            << "oracle-batch\n"
+            << "\n  Run the oracle on all the cases of a manifest, concurrently and in a single"
+            << "\n  process, and write one result per case as newline-delimited JSON."
+            << "\n\nUSAGE"
+            << "\n\toracle-batch [options] manifest" << endl
+            << endl;
+
+  std::cout << "INPUT FILES" << endl;
+  edit_help_option("manifest", "One case per line: the arguments of an oracle run, [options] jdd.t4 jdd.inp ptrac [ptrac2 ...]; '#' starts a comment line.");
+
+  std::cout << endl
+            << "OPTIONS" << endl;
+  edit_help_option("-V, --verbose", "Print the report of each case; twice, also the details about each point.");
+  edit_help_option("-h, --help", "Displays this help message.");
+  edit_help_option("-j, --jobs N", "Number of cases run concurrently (default: the number of hardware threads).");
+  edit_help_option("-o, --results FILE", "The file of the results (default: manifest.results.ndjson).");
+  edit_help_option("-d, --output-dir DIR", "Write the files of each case named after its T4 file to DIR/case<line>, unless the case gives --output-dir (default: manifest.outputs).");
+
+  std::cout << endl;
+}
+
+/** \brief Constructor of the class
+*/
+OptionsOracleBatch::OptionsOracleBatch() : help(false),
+                                           verbosity(0),
+                                           jobs(std::max(1u, std::thread::hardware_concurrency()))
+{
+}
+
+/** \brief Get the options set in the command line
+ * @param[in] argc The number of arguments in the command line
+ * @param[in] argv The splitted command line
+ */
+void OptionsOracleBatch::get_opts(int argc, char **argv)
+{
+
+  if (argc <= 1) {
+    help = true;
+    return;
+  }
+
+  for (int i = 1; i < argc; i++) {
+    string opt(argv[i]);
+
+    if (opt == "--help" || opt == "-h") {
+      help = true;
+      return;
+    } else if (opt == "--verbose" || opt == "-V") {
+      ++verbosity;
+    } else if (opt == "--jobs" || opt == "-j") {
+      int nv = 1;
+      check_argv(argc, i + nv);
+      long const nbJobs = int_of_string(argv[i + 1]);
+      if (nbJobs <= 0) {
+        cout << "\nError: the number of jobs must be positive.\n"
+             << endl;
+        exit(EXIT_FAILURE);
+      }
+      jobs = static_cast<int>(nbJobs);
+      i += nv;
+    } else if (opt == "--results" || opt == "-o") {
+      int nv = 1;
+      check_argv(argc, i + nv);
+      results = argv[i + 1];
+      i += nv;
+    } else if (opt == "--output-dir" || opt == "-d") {
+      int nv = 1;
+      check_argv(argc, i + nv);
+      outputDir = argv[i + 1];
+      i += nv;
+    } else {
+      filenames.push_back(opt);
+    }
+  }
+
+  if (filenames.size() != 1) {
+    cout << "\nError: expected a single manifest.\n"
+         << endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (access(filenames[0].c_str(), R_OK) == -1) {
+    cout << "'" << filenames[0] << "': unknown option or unreachable file." << endl;
+    cout << "Try '" << argv[0] << " --help for more information.\n"
+         << endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (results.empty()) {
+    results = filenames[0] + ".results.ndjson";
+  }
+  if (outputDir.empty()) {
+    outputDir = filenames[0] + ".outputs";
+  }
+}
+
+/** \brief Check if the position of the last value for an option is compatible
+ * with the line command line.
+ * \param argc The number of arguments in the line command.
+ * \param ip   The expected position of the last value of the option in the
+ * commmand line.
+ */
+void OptionsOracleBatch::check_argv(int argc, int ip)
+{
+  if (ip >= argc) {
+    cout << "\nError in command line.\n"
+         << endl;
+    exit(EXIT_FAILURE);
+  }
+}
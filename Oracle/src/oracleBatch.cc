@@ -0,0 +1,86 @@
+/**
+ * @file oracleBatch.cc
+ * Runs the oracle on all the cases of a manifest in a single process.
+ *
+ * @brief contains the main function of the oracle-batch program
+ *
+ * @version 1.0
+ */
+
+#include "EventLog.hh"
+#include "Log.hh"
+#include "OracleBatch.hh"
+#include "compare_geoms.hh"
+#include "options_oracleBatch.hh"
+#ifdef ORACLE_WITH_T4
+#include "t4coreglob.hh"
+#endif
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+
+using namespace std;
+#ifdef ORACLE_WITH_T4
+int strictness_level = 3; //Global variable required by T4 libraries
+#endif
+
+int main(int argc, char **argv)
+{
+  auto start = std::chrono::system_clock::now();
+  // printed directly, like the help and the errors in the options, before any message is logged
+  std::cout << "*** MCNP / Tripoli-4 batch geometry comparison ***" << endl;
+#ifdef ORACLE_WITH_T4
+  t4_output_stream = &Log::infoStream();
+  t4_language = (T4_language)0;
+#endif
+
+  // ---- Read options ----
+  OptionsOracleBatch options;
+  options.get_opts(argc, argv);
+  if (options.help) {
+    helpBatch();
+    exit(EXIT_SUCCESS);
+  }
+  if (options.verbosity > 1) {
+    Log::setLevel(LogLevel::VERBOSE);
+  }
+
+  std::unique_ptr<OracleBatch> batch;
+  std::unique_ptr<EventLog> results;
+  try {
+    batch.reset(new OracleBatch(options.filenames[0], options.outputDir));
+    results.reset(new EventLog(options.results));
+  } catch (std::runtime_error const &error) {
+    ORACLE_LOG(ERROR) << "Error: " << error.what();
+    exit(EXIT_FAILURE);
+  }
+
+  std::signal(SIGINT, onInterrupt);
+  std::signal(SIGTERM, onInterrupt);
+  size_t const nbCases = batch->getCases().size();
+  ORACLE_LOG(INFO) << "Running " << nbCases << " cases on " << options.jobs << " threads...";
+  long const nbErrors = batch->run(options.jobs, *results, options.verbosity > 0);
+
+  auto end = std::chrono::system_clock::now();
+  std::chrono::duration<double> elapsed_seconds = end - start;
+  results->write(EventRecord("batch")
+                   .add("cases", nbCases)
+                   .add("errors", nbErrors)
+                   .add("interrupted", interruptSignal != 0)
+                   .add("elapsed", elapsed_seconds.count()));
+  try {
+    results->close();
+  } catch (std::runtime_error const &error) {
+    ORACLE_LOG(ERROR) << "Error: " << error.what();
+    exit(EXIT_FAILURE);
+  }
+  ORACLE_LOG(INFO) << nbCases << " cases, " << nbErrors << " errors; results written to " << options.results;
+  ORACLE_LOG(INFO) << "Elapsed time: " << elapsed_seconds.count() << "s";
+  if (interruptSignal) {
+    return 128 + interruptSignal;
+  }
+  return nbErrors > 0 ? EXIT_FAILURE : 0;
+}
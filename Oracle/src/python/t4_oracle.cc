@@ -0,0 +1,194 @@
+/**
+ * @file t4_oracle.cc
+ *
+ *
+ * @brief The t4_oracle Python extension module
+ *
+ * @version 1.0
+ */
+
+#include "ConfusionMatrix.hh"
+#include "Log.hh"
+#include "MCNPGeometry.hh"
+#include "Statistics.hh"
+#include "T4Geometry.hh"
+#include "compare_geoms.hh"
+#include "options_compare.hh"
+#ifdef ORACLE_WITH_T4
+#include "t4coreglob.hh"
+#endif
+#include <pybind11/numpy.h>
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace py = pybind11;
+
+#ifdef ORACLE_WITH_T4
+int strictness_level = 3; //Global variable required by T4 libraries
+#endif
+
+namespace
+{
+static_assert(sizeof(failedPoint) == 8 * sizeof(double), "failedPoint is read as 8 doubles");
+static_assert(sizeof(ConfusionMatrix::Entry) == 5 * sizeof(long), "ConfusionMatrix::Entry is read as 5 longs");
+
+/**
+ * Hands a vector over to NumPy without copying it: the array views the
+ * elements of the vector, which is destroyed with the array.
+ */
+template <typename T, typename Element>
+py::array_t<T> toArray(std::vector<Element> &&values, std::vector<py::ssize_t> const &shape)
+{
+  auto *owner = new std::vector<Element>(std::move(values));
+  py::capsule base(owner, [](void *vector) { delete static_cast<std::vector<Element> *>(vector); });
+  return py::array_t<T>(shape, reinterpret_cast<T const *>(owner->data()), base);
+}
+
+/// reads the points of a PTRAC file, as the oracle does
+py::dict readPTRAC(std::string const &path, bool ascii, long maxPoints)
+{
+  std::vector<double> points;
+  std::vector<long> cells, materials;
+  {
+    py::gil_scoped_release release;
+    std::unique_ptr<MCNPPTRAC> ptrac;
+    if (ascii) {
+      ptrac.reset(new MCNPPTRACASCII(path));
+    } else {
+      ptrac.reset(new MCNPPTRACBinary(path));
+    }
+    while (ptrac->readNextPtracData(maxPoints)) {
+      PTRACRecord const &record = ptrac->getPTRACRecord();
+      points.insert(points.end(), record.point.begin(), record.point.end());
+      cells.push_back(record.cellID);
+      materials.push_back(record.materialID);
+    }
+  }
+  py::ssize_t const nbPoints = static_cast<py::ssize_t>(cells.size());
+  py::dict result;
+  result["points"] = toArray<double>(std::move(points), {nbPoints, 3});
+  result["cells"] = toArray<long>(std::move(cells), {nbPoints});
+  result["materials"] = toArray<long>(std::move(materials), {nbPoints});
+  return result;
+}
+
+/// runs the oracle with the given command-line arguments, on the geometry given if any
+std::vector<Statistics> compare(std::vector<std::string> arguments, T4Geometry *geometry)
+{
+  arguments.insert(arguments.begin(), "oracle");
+  std::vector<char *> argv;
+  for (auto &argument : arguments) {
+    argv.push_back(&argument[0]);
+  }
+  OptionsCompare options;
+  try {
+    options.get_opts(static_cast<int>(argv.size()), argv.data());
+  } catch (OptionsError const &error) {
+    throw std::invalid_argument(error.what());
+  }
+  if (options.help) {
+    throw std::invalid_argument("expected [options] jdd.t4 jdd.inp ptrac [ptrac2 ...]");
+  }
+  if (geometry && geometry->getFilename() != options.filenames[0]) {
+    throw std::invalid_argument("the geometry was read from " + geometry->getFilename() + ", not from " +
+                                options.filenames[0]);
+  }
+  py::gil_scoped_release release;
+  return run_oracle(options, false, geometry);
+}
+} // namespace
+
+PYBIND11_MODULE(t4_oracle, module)
+{
+  module.doc() = "The comparison of MCNP and TRIPOLI-4 geometries of the oracle, without a subprocess.";
+#ifdef ORACLE_WITH_T4
+  t4_output_stream = &Log::infoStream();
+  t4_language = (T4_language)0;
+#endif
+
+  py::class_<T4Geometry>(module, "T4Geometry", "A TRIPOLI-4 geometry, kept in memory between queries.")
+    .def(py::init([](std::string const &path, std::string const &backend) {
+           if (backend != "native" && backend != "t4") {
+             throw std::invalid_argument("unknown backend '" + backend + "' (expected t4 or native)");
+           }
+           py::gil_scoped_release release;
+           return std::unique_ptr<T4Geometry>(
+             new T4Geometry(path, backend == "native" ? T4Backend::NATIVE : T4Backend::T4LIB));
+         }),
+         py::arg("path"), py::arg("backend") = "native")
+    .def_property_readonly("filename", &T4Geometry::getFilename)
+    .def_property_readonly("nb_volumes", &T4Geometry::getNbVolumes)
+    .def("volume_number", &T4Geometry::getVolumeNumber, py::arg("rank"))
+    .def("composition", &T4Geometry::getCompoName, py::arg("rank"))
+    .def(
+      "locate",
+      [](T4Geometry &geometry, py::array_t<double, py::array::c_style | py::array::forcecast> points) {
+        if (points.ndim() != 2 || points.shape(1) != 3) {
+          throw std::invalid_argument("expected an array of shape (N, 3)");
+        }
+        py::ssize_t const nbPoints = points.shape(0);
+        double const *coordinates = points.data();
+        std::vector<long> ranks(nbPoints);
+        {
+          py::gil_scoped_release release;
+          std::vector<double> point(3);
+          for (py::ssize_t i = 0; i < nbPoints; ++i) {
+            point.assign(coordinates + 3 * i, coordinates + 3 * i + 3);
+            ranks[i] = geometry.whichVolume(point);
+          }
+        }
+        return toArray<long>(std::move(ranks), {nbPoints});
+      },
+      py::arg("points"), "The ranks of the volumes containing the points (-1 outside the geometry).");
+
+  py::class_<Statistics>(module, "Statistics", "The results of the comparison of one T4 file.")
+    .def_property_readonly("total", &Statistics::getTotalPts)
+    .def_property_readonly("tested", &Statistics::getNbTested)
+    .def_property_readonly("successful", &Statistics::getNbSuccess)
+    .def_property_readonly("failed", &Statistics::getNbFailure)
+    .def_property_readonly("ignored", &Statistics::getNbIgnored)
+    .def_property_readonly("outside", &Statistics::getNbOutside)
+    .def_property_readonly("skipped", &Statistics::getNbSkipped)
+    .def_property_readonly("covered_volumes", &Statistics::getNbCovered)
+    .def_property_readonly("t4_volumes", &Statistics::getNbT4Volumes)
+    .def(
+      "failed_points",
+      [](Statistics &stats) {
+        std::vector<failedPoint> failures = stats.takeFailures();
+        py::ssize_t const nbFailures = static_cast<py::ssize_t>(failures.size());
+        return toArray<double>(std::move(failures), {nbFailures, 8});
+      },
+      "The failed points, one row per point: x, y, z, PTRAC point, MCNP cell, MCNP material, "
+      "distance to the nearest surface and T4 rank. The points are moved into the array: a second call "
+      "returns no rows.")
+    .def(
+      "confusion",
+      [](Statistics &stats) {
+        std::vector<ConfusionMatrix::Entry> entries = stats.getConfusionMatrix().getEntries();
+        py::ssize_t const nbEntries = static_cast<py::ssize_t>(entries.size());
+        return toArray<long>(std::move(entries), {nbEntries, 5});
+      },
+      "The number of points per MCNP cell and T4 volume, one row per entry: MCNP cell, T4 volume (-1 "
+      "outside), count, number of points of the cell and volume holding most of them.")
+    .def(
+      "summary",
+      [](Statistics &stats, std::string const &t4Filename) { return stats.getSummaryEvent(t4Filename).str(); },
+      py::arg("t4_file"), "The summary record of --events, as a JSON string.");
+
+  module.def("read_ptrac", &readPTRAC, py::arg("path"), py::arg("ascii") = false,
+             py::arg("max_points") = std::numeric_limits<long>::max() - 1,
+             "Reads the points of a PTRAC file: a dict of the points (N, 3), cells and materials.");
+  module.def("compare", &compare, py::arg("arguments"), py::arg("geometry") = nullptr,
+             "Runs the oracle with its command-line arguments, [options] jdd.t4 jdd.inp ptrac [ptrac2 ...], "
+             "and returns the Statistics of each T4 file. The T4Geometry of jdd.t4, if given, is used instead "
+             "of reading the file again. Raises a ValueError if the arguments are invalid.");
+  module.def(
+    "set_verbose", [](bool verbose) { Log::setLevel(verbose ? LogLevel::VERBOSE : LogLevel::INFO); },
+    py::arg("verbose") = true, "Logs the details about each point.");
+}
@@ -0,0 +1,97 @@
+'''Tests for the :mod:`t4_oracle` extension module.
+
+They run in the build directory, which holds the module and the test data.
+'''
+
+import shutil
+
+import numpy as np
+import pytest
+
+import t4_oracle
+
+
+ARGS = ['--ascii', '--backend', 'native', 'slab.t4', 'input_slab', 'slabp']
+
+
+def swapped_slab(tmp_path):
+    '''A copy of slab.t4 where the compositions of volumes 1001 and 2001 are
+    swapped.'''
+    with open('slab.t4') as slab:
+        text = slab.read()
+    text = text.replace('m347_-2.7 1 1001', 'm346_-2.7 1 1001', 1)
+    text = text.replace('m346_-2.7 1 2001', 'm347_-2.7 1 2001', 1)
+    path = tmp_path / 'slab_swapped.t4'
+    path.write_text(text)
+    return str(path)
+
+
+def test_read_ptrac():
+    '''The points, cells and materials of a PTRAC file.'''
+    ptrac = t4_oracle.read_ptrac('slabp', ascii=True)
+    nb_points = len(ptrac['cells'])
+    assert nb_points > 0
+    assert ptrac['points'].shape == (nb_points, 3)
+    assert ptrac['materials'].shape == (nb_points,)
+
+
+def test_locate():
+    '''The ranks of the volumes containing the PTRAC points.'''
+    geometry = t4_oracle.T4Geometry('slab.t4')
+    ptrac = t4_oracle.read_ptrac('slabp', ascii=True)
+    ranks = geometry.locate(ptrac['points'])
+    assert ranks.shape == ptrac['cells'].shape
+    assert np.all(ranks >= -1)
+    assert np.all(ranks < geometry.nb_volumes)
+    with pytest.raises(ValueError):
+        geometry.locate(np.zeros((2, 2)))
+
+
+def test_compare(tmp_path):
+    '''The statistics of a comparison, as the oracle computes them.'''
+    stats, = t4_oracle.compare(['--output-dir', str(tmp_path)] + ARGS)
+    assert stats.tested > 0
+    assert stats.failed == 0
+    assert stats.failed_points().shape == (0, 8)
+    assert '"t4_file":"slab.t4"' in stats.summary('slab.t4')
+
+
+def test_invalid_options():
+    '''Invalid arguments raise a ValueError instead of ending the process.'''
+    with pytest.raises(ValueError, match='cell quota'):
+        t4_oracle.compare(['--cell-quota', '0'] + ARGS)
+    with pytest.raises(ValueError):
+        t4_oracle.compare(['--no-such-option'] + ARGS)
+    with pytest.raises(ValueError):
+        t4_oracle.compare(['--help'])
+
+
+def test_failed_points(tmp_path):
+    '''The failed points are moved into the array.'''
+    swapped = swapped_slab(tmp_path)
+    stats, = t4_oracle.compare(['--ascii', '--backend', 'native', '--output-dir', str(tmp_path),
+                                swapped, 'input_slab', 'slabp'])
+    assert stats.failed > 0
+    failed = stats.failed_points()
+    assert failed.shape == (stats.failed, 8)
+    # only the two swapped volumes fail
+    assert set(failed[:, 7]) <= {0., 1.}
+    assert stats.failed_points().shape == (0, 8)
+
+
+def test_given_geometry(tmp_path):
+    '''A geometry read once gives the same results as reading it again.'''
+    swapped = swapped_slab(tmp_path)
+    args = ['--ascii', '--backend', 'native', '--output-dir', str(tmp_path),
+            swapped, 'input_slab', 'slabp']
+    expected, = t4_oracle.compare(args)
+    geometry = t4_oracle.T4Geometry(swapped)
+    for _ in range(2):
+        stats, = t4_oracle.compare(args, geometry)
+        assert stats.failed == expected.failed
+        assert stats.successful == expected.successful
+
+    other = str(tmp_path / 'slab_copy.t4')
+    shutil.copy('slab.t4', other)
+    with pytest.raises(ValueError, match='geometry was read from'):
+        t4_oracle.compare(args, t4_oracle.T4Geometry(other))
@@ -1,8 +1,12 @@
+#ifdef ORACLE_WITH_T4
 #include "geometrytype.hh"
+#endif
 #include "gtest/gtest.h"
 
 using namespace std;
+#ifdef ORACLE_WITH_T4
 int strictness_level = 3;
+#endif
 
 int main(int argc, char **argv)
 {
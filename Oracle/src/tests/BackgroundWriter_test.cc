@@ -0,0 +1,63 @@
+/**
+ * @file BackgroundWriter_test.cc
+ *
+ *
+ * @brief unit testing for the BackgroundWriter class template
+ *
+ * @version 1.0
+ */
+
+#include "BackgroundWriter.hh"
+#include "gtest/gtest.h"
+#include <atomic>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+TEST(BackgroundWriter, KeepsTheOrder)
+{
+  vector<int> written;
+  int nbIdle = 0;
+  {
+    BackgroundWriter<int> writer([&written](int &item) { written.push_back(item); }, 2, [&nbIdle]() { ++nbIdle; });
+    for (int i = 0; i < 1000; ++i) {
+      writer.push(i);
+    }
+    writer.drain();
+    ASSERT_EQ(written.size(), 1000u);
+    for (int i = 0; i < 1000; ++i) {
+      ASSERT_EQ(written[i], i);
+    }
+    ASSERT_GE(nbIdle, 1);
+    writer.push(1000);
+    writer.close();
+    // closing twice is harmless
+    writer.close();
+  }
+  ASSERT_EQ(written.size(), 1001u);
+  ASSERT_EQ(written.back(), 1000);
+}
+
+TEST(BackgroundWriter, BoundsThePendingWeight)
+{
+  atomic<size_t> pendingWeight(0);
+  size_t maxPendingWeight = 0;
+  {
+    BackgroundWriter<string> writer(
+        [&](string &item) {
+          maxPendingWeight = max(maxPendingWeight, size_t(pendingWeight));
+          pendingWeight -= item.size();
+        },
+        10, nullptr, [](string const &item) { return item.size(); });
+    for (int i = 0; i < 500; ++i) {
+      string const item(1 + i % 4, 'x');
+      // counted before the push, so that the writer never sees a negative weight
+      pendingWeight += item.size();
+      writer.push(item);
+    }
+  }
+  ASSERT_EQ(pendingWeight, 0u);
+  // the queue waits from 10 bytes on, and an item weighs at most 4 bytes
+  ASSERT_LE(maxPendingWeight, 10u + 4u + 4u);
+}
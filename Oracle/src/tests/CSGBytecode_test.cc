@@ -0,0 +1,133 @@
+/**
+ * @file CSGBytecode_test.cc
+ *
+ *
+ * @brief unit testing for the CSGBytecode class
+ *
+ * @version 1.0
+ */
+
+#include "CSGBytecode.hh"
+#include "gtest/gtest.h"
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+
+using namespace std;
+
+class CSGBytecodeTest : public ::testing::Test
+{
+
+protected:
+  SurfaceTable surfaces;
+
+  void SetUp()
+  {
+    surfaces.addSurface(1, SurfaceType::SPHERE, {0., 0., 0., 10.}, nullptr);
+    surfaces.addSurface(2, SurfaceType::PLANEZ, {0.}, nullptr);
+    surfaces.addSurface(3, SurfaceType::TORUSZ, {0., 0., 0., 5., 1., 1.}, nullptr);
+  }
+};
+
+TEST_F(CSGBytecodeTest, Programs)
+{
+  CSGBytecode bytecode(surfaces);
+  // rank 0: upper half-ball, fictive
+  bytecode.beginVolume(10, true);
+  bytecode.addHalfSpace(1, -1);
+  bytecode.addHalfSpace(2, 1);
+  bytecode.endVolume();
+  // rank 1: torus
+  bytecode.beginVolume(20, false);
+  bytecode.addHalfSpace(3, -1);
+  bytecode.endVolume();
+  // rank 2: upper half-ball outside the torus
+  bytecode.beginVolume(30, false);
+  bytecode.addHalfSpace(3, 1);
+  bytecode.addOperand(CSGOperator::INTE, 0);
+  bytecode.endVolume();
+  // rank 3: union of the half-ball and of the torus
+  bytecode.beginVolume(40, false);
+  bytecode.addOperand(CSGOperator::UNION, 0);
+  bytecode.addOperand(CSGOperator::UNION, 1);
+  bytecode.endVolume();
+  bytecode.finalize();
+
+  ASSERT_EQ(bytecode.getNbVolumes(), 4);
+  ASSERT_EQ(bytecode.getNbInstructions(), 9);
+
+  ASSERT_TRUE(bytecode.contains(0, 0., 0., 5.));
+  ASSERT_FALSE(bytecode.contains(0, 0., 0., -5.));
+  ASSERT_TRUE(bytecode.contains(2, 0., 0., 5.));
+  ASSERT_FALSE(bytecode.contains(2, 5., 0., 0.5));
+  // an empty EQUA part is always satisfied, so the union is everything
+  ASSERT_TRUE(bytecode.contains(3, 50., 50., -50.));
+
+  ASSERT_EQ(bytecode.whichVolume({5., 0., 0.5}), 1);
+  ASSERT_EQ(bytecode.whichVolume({0., 0., 5.}), 2);
+  ASSERT_EQ(bytecode.whichVolume({0., 0., -5.}), 3);
+
+  BoundingBox const &torusBox = bytecode.getBoundingBox(1);
+  ASSERT_TRUE(torusBox[1] >= 6. && torusBox[1] < 7.);
+  ASSERT_TRUE(torusBox[4] <= -1. && torusBox[4] > -7.);
+  BoundingBox const &halfBall = bytecode.getBoundingBox(2);
+  ASSERT_DOUBLE_EQ(halfBall[4], 0.);
+  ASSERT_DOUBLE_EQ(halfBall[5], 10.);
+
+  ostringstream listing;
+  bytecode.disassemble(2, listing);
+  ASSERT_EQ(listing.str(), "volume 30 (rank 2):\n"
+                           "  3  LOAD_HALFSPACES\n"
+                           "  4  AND_TORUS +3\n"
+                           "  5  AND_VOLUME volume 10\n");
+}
+
+TEST_F(CSGBytecodeTest, InvalidDefinitions)
+{
+  CSGBytecode unknownSurface(surfaces);
+  unknownSurface.beginVolume(1, false);
+  ASSERT_THROW(unknownSurface.addHalfSpace(99, 1), std::invalid_argument);
+
+  CSGBytecode mixedOperators(surfaces);
+  mixedOperators.beginVolume(1, false);
+  mixedOperators.addOperand(CSGOperator::UNION, 0);
+  ASSERT_THROW(mixedOperators.addOperand(CSGOperator::INTE, 0), std::invalid_argument);
+
+  CSGBytecode circular(surfaces);
+  circular.beginVolume(1, false);
+  circular.addOperand(CSGOperator::UNION, 1);
+  circular.endVolume();
+  circular.beginVolume(2, false);
+  circular.addOperand(CSGOperator::UNION, 0);
+  circular.endVolume();
+  ASSERT_THROW(circular.finalize(), std::invalid_argument);
+}
+
+TEST_F(CSGBytecodeTest, DistanceBounds)
+{
+  CSGBytecode bytecode(surfaces);
+  bytecode.beginVolume(10, false);
+  bytecode.addHalfSpace(1, -1);
+  bytecode.addHalfSpace(2, 1);
+  bytecode.endVolume();
+  bytecode.beginVolume(20, false);
+  bytecode.addHalfSpace(3, -1);
+  bytecode.endVolume();
+  bytecode.finalize();
+
+  // exact for spheres and planes
+  ASSERT_NEAR(bytecode.distanceBound(0, 0., 0., 9.), 1., 1e-12);
+  ASSERT_NEAR(bytecode.distanceBound(0, 6., 0., 0.5), 0.5, 1e-12);
+  ASSERT_NEAR(bytecode.distanceBound(0, 3., 4., 5.), 10. - std::sqrt(50.), 1e-12);
+  // first-order estimate |f| / |grad f| for tori
+  ASSERT_NEAR(bytecode.distanceBound(1, 5.5, 0., 0.), 0.75, 1e-12);
+
+  // the safe distances are the same for spheres and planes, and unknown for tori
+  ASSERT_NEAR(bytecode.safeDistance(0, 3., 4., 5.), 10. - std::sqrt(50.), 1e-12);
+  ASSERT_EQ(bytecode.safeDistance(1, 5.5, 0., 0.), 0.);
+
+  // boxes inside the upper half-ball, across its plane, and near the torus
+  ASSERT_EQ(bytecode.whichVolumeOfBox(BoundingBox{{-1., 1., -1., 1., 2., 4.}}), 0);
+  ASSERT_EQ(bytecode.whichVolumeOfBox(BoundingBox{{-1., 1., -1., 1., -1., 1.}}), -1);
+  ASSERT_EQ(bytecode.whichVolumeOfBox(BoundingBox{{4.9, 5.1, -0.1, 0.1, -0.1, 0.1}}), -1);
+}
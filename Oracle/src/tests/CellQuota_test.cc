@@ -0,0 +1,69 @@
+/**
+ * @file CellQuota_test.cc
+ *
+ *
+ * @brief unit testing for the CellQuota class
+ *
+ * @version 1.0
+ */
+
+#include "CellQuota.hh"
+#include "MCNPGeometry.hh"
+#include "gtest/gtest.h"
+#include <sstream>
+#include <stdexcept>
+
+using namespace std;
+
+TEST(CellQuota, Quota)
+{
+  CellQuota quota(2, {1, 2, 3});
+  ASSERT_FALSE(quota.isFull(1));
+  ASSERT_FALSE(quota.recordSuccess(1));
+  ASSERT_TRUE(quota.recordSuccess(1));
+  ASSERT_TRUE(quota.isFull(1));
+  ASSERT_FALSE(quota.recordSuccess(1));
+  ASSERT_FALSE(quota.allFull());
+  // undeclared cells are ignored
+  ASSERT_FALSE(quota.recordSuccess(7));
+  ASSERT_FALSE(quota.recordSuccess(7));
+  ASSERT_FALSE(quota.isFull(7));
+  ASSERT_EQ(quota.getUnderSampledCells(), (vector<long>{2, 3}));
+  quota.recordSuccess(2);
+  quota.recordSuccess(2);
+  quota.recordSuccess(3);
+  quota.recordSuccess(3);
+  ASSERT_TRUE(quota.allFull());
+  ASSERT_TRUE(quota.getUnderSampledCells().empty());
+  ASSERT_THROW(CellQuota(0, {1}), std::invalid_argument);
+}
+
+TEST(CellQuota, SlabCells)
+{
+  MCNPGeometry geometry("input_slab");
+  geometry.parseINP();
+  CellQuota quota(10, geometry.getCellIDs());
+  ASSERT_EQ(quota.getUnderSampledCells(), (vector<long>{1000, 1001, 2001, 3001}));
+}
+
+TEST(CellQuota, State)
+{
+  CellQuota quota(2, {1, 2, 3});
+  quota.recordSuccess(1);
+  quota.recordSuccess(1);
+  quota.recordSuccess(2);
+  stringstream state;
+  quota.saveState(state);
+
+  CellQuota restored(2, {1, 2, 3});
+  restored.restoreState(state);
+  ASSERT_TRUE(restored.isFull(1));
+  ASSERT_FALSE(restored.isFull(2));
+  ASSERT_TRUE(restored.recordSuccess(2));
+  ASSERT_EQ(restored.getUnderSampledCells(), (vector<long>{3}));
+
+  CellQuota otherCells(2, {1, 2});
+  state.clear();
+  state.seekg(0);
+  ASSERT_THROW(otherCells.restoreState(state), std::runtime_error);
+}
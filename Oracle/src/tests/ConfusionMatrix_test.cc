@@ -0,0 +1,95 @@
+/**
+ * @file ConfusionMatrix_test.cc
+ *
+ *
+ * @brief unit testing for the ConfusionMatrix class
+ *
+ * @version 1.0
+ */
+
+#include "ConfusionMatrix.hh"
+#include "gtest/gtest.h"
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+using namespace std;
+
+namespace
+{
+/// cell 10 mostly in volume 56, cell 20 split between volume 78 and the outside
+ConfusionMatrix makeMatrix()
+{
+  ConfusionMatrix matrix;
+  for (int i = 0; i < 999; ++i) {
+    matrix.add(10, 56);
+  }
+  matrix.add(10, 78);
+  for (int i = 0; i < 6; ++i) {
+    matrix.add(20, 78);
+  }
+  for (int i = 0; i < 3; ++i) {
+    matrix.add(20, -1);
+  }
+  return matrix;
+}
+} // namespace
+
+TEST(ConfusionMatrix, OffDiagonal)
+{
+  ConfusionMatrix const matrix = makeMatrix();
+  ASSERT_EQ(matrix.getNbEntries(), 4);
+  ASSERT_EQ(matrix.getCount(10, 56), 999);
+  ASSERT_EQ(matrix.getCount(20, -1), 3);
+  ASSERT_EQ(matrix.getCount(30, 56), 0);
+
+  auto const offDiagonal = matrix.getOffDiagonal();
+  ASSERT_EQ(offDiagonal.size(), 2u);
+  ASSERT_EQ(offDiagonal[0].cellID, 20);
+  ASSERT_EQ(offDiagonal[0].volume, -1);
+  ASSERT_EQ(offDiagonal[0].cellCount, 9);
+  ASSERT_EQ(offDiagonal[0].mainVolume, 78);
+  ASSERT_EQ(offDiagonal[1].cellID, 10);
+  ASSERT_EQ(offDiagonal[1].volume, 78);
+  ASSERT_EQ(offDiagonal[1].mainVolume, 56);
+
+  ostringstream report;
+  matrix.report(report, 1);
+  ASSERT_NE(report.str().find("several T4 volumes: 2"), string::npos);
+  ASSERT_NE(report.str().find("MCNP cell 20 -> outside: 3 points"), string::npos);
+  ASSERT_NE(report.str().find("... 1 smaller entries"), string::npos);
+}
+
+TEST(ConfusionMatrix, MergeSaveAndRead)
+{
+  ConfusionMatrix first = makeMatrix();
+  ConfusionMatrix second;
+  second.add(10, 78);
+  second.add(30, 90);
+  first.merge(second);
+  ASSERT_EQ(first.getCount(10, 78), 2);
+  ASSERT_EQ(first.getCount(30, 90), 1);
+
+  stringstream stream;
+  first.save(stream);
+  ConfusionMatrix copy;
+  copy.add(1, 1);
+  copy.read(stream, "test");
+  ASSERT_EQ(copy.getNbEntries(), first.getNbEntries());
+  ASSERT_EQ(copy.getCount(1, 1), 0);
+  ASSERT_EQ(copy.getCount(20, -1), 3);
+
+  stringstream malformed("2 10 56 4");
+  ASSERT_THROW(copy.read(malformed, "test"), std::runtime_error);
+
+  string const path = "confusion_matrix_test.csv";
+  first.writeCSV(path);
+  ifstream in(path);
+  string line;
+  getline(in, line);
+  ASSERT_EQ(line, "mcnp_cell,t4_volume,count");
+  getline(in, line);
+  ASSERT_EQ(line, "10,56,999");
+  std::remove(path.c_str());
+}
@@ -0,0 +1,112 @@
+/**
+ * @file DistanceSummary_test.cc
+ *
+ *
+ * @brief unit testing for the RunningMoments, QuantileSketch and DistanceSummary classes
+ *
+ * @version 1.0
+ */
+
+#include "DistanceSummary.hh"
+#include "gtest/gtest.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+using namespace std;
+
+TEST(DistanceSummary, Moments)
+{
+  RunningMoments empty;
+  ASSERT_EQ(empty.getMean(), 0.);
+  ASSERT_EQ(empty.getMax(), 0.);
+  ASSERT_EQ(empty.getStandardDeviation(), 0.);
+
+  vector<double> const values = {1e6 + 4., 1e6 + 7., 1e6 + 13., 1e6 + 16.};
+  RunningMoments all, first, second;
+  for (size_t i = 0; i < values.size(); ++i) {
+    all.add(values[i]);
+    (i < 1 ? first : second).add(values[i]);
+  }
+  ASSERT_NEAR(all.getMean(), 1e6 + 10., 1e-9);
+  // sample variance of 4, 7, 13, 16 is 30
+  ASSERT_NEAR(all.getStandardDeviation(), std::sqrt(30.), 1e-9);
+  ASSERT_EQ(all.getMin(), 1e6 + 4.);
+  ASSERT_EQ(all.getMax(), 1e6 + 16.);
+
+  first.merge(second);
+  ASSERT_EQ(first.getCount(), 4);
+  ASSERT_NEAR(first.getMean(), all.getMean(), 1e-9);
+  ASSERT_NEAR(first.getStandardDeviation(), all.getStandardDeviation(), 1e-9);
+  ASSERT_EQ(first.getMax(), all.getMax());
+}
+
+TEST(DistanceSummary, ExactQuantiles)
+{
+  QuantileSketch sketch;
+  ASSERT_EQ(sketch.quantile(0.5), 0.);
+  for (int i = 100; i >= 1; --i) {
+    sketch.add(i);
+  }
+  // no compaction yet
+  ASSERT_EQ(sketch.getSize(), 100);
+  ASSERT_EQ(sketch.quantile(0.), 1.);
+  ASSERT_EQ(sketch.quantile(0.5), 50.);
+  ASSERT_EQ(sketch.quantile(0.9), 90.);
+  ASSERT_EQ(sketch.quantile(1.), 100.);
+}
+
+TEST(DistanceSummary, ApproximateQuantiles)
+{
+  std::mt19937 generator(42);
+  std::exponential_distribution<double> distribution(1.);
+  long const nbValues = 200000;
+  vector<double> values(nbValues);
+  QuantileSketch whole, firstHalf, secondHalf;
+  for (long i = 0; i < nbValues; ++i) {
+    values[i] = distribution(generator);
+    whole.add(values[i]);
+    (i % 2 == 0 ? firstHalf : secondHalf).add(values[i]);
+  }
+  firstHalf.merge(secondHalf);
+  ASSERT_EQ(firstHalf.getCount(), nbValues);
+  // the memory does not grow with the number of values
+  ASSERT_LT(whole.getSize(), 2000);
+  ASSERT_LT(firstHalf.getSize(), 2000);
+
+  sort(values.begin(), values.end());
+  for (double q : {0.1, 0.5, 0.9, 0.99}) {
+    for (QuantileSketch const *sketch : {&whole, &firstHalf}) {
+      double const estimate = sketch->quantile(q);
+      double const rank = double(lower_bound(values.begin(), values.end(), estimate) - values.begin()) / nbValues;
+      ASSERT_NEAR(rank, q, 0.02) << "quantile " << q;
+    }
+  }
+}
+
+TEST(DistanceSummary, SaveAndRead)
+{
+  DistanceSummary summary;
+  for (int i = 0; i < 1000; ++i) {
+    summary.add(0.001 * i);
+  }
+  stringstream stream;
+  summary.save(stream);
+  DistanceSummary copy;
+  copy.read(stream, "test");
+  ASSERT_EQ(copy.getMoments().getCount(), 1000);
+  ASSERT_EQ(copy.getMoments().getMean(), summary.getMoments().getMean());
+  ASSERT_EQ(copy.quantile(0.9), summary.quantile(0.9));
+
+  // the copy keeps drawing the same coin flips
+  summary.add(2.);
+  copy.add(2.);
+  ASSERT_EQ(copy.quantile(0.5), summary.quantile(0.5));
+
+  stringstream malformed("3 0.5 0.1 0 1 200 4 0 1 5 1. 2. 3. 4. 5.");
+  DistanceSummary broken;
+  ASSERT_THROW(broken.read(malformed, "test"), std::runtime_error);
+}
@@ -0,0 +1,138 @@
+/**
+ * @file EventLog_test.cc
+ *
+ *
+ * @brief unit testing for the EventRecord and EventLog classes
+ *
+ * @version 1.0
+ */
+
+#include "EventLog.hh"
+#include "Statistics.hh"
+#include "gtest/gtest.h"
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+TEST(EventLog, Record)
+{
+  EventRecord record("failure");
+  record.add("x", 0.5)
+    .add("cell_id", 12)
+    .add("point_id", 7l)
+    .add("count", 3ul)
+    .add("guessed", false)
+    .add("composition", "c\"1\"\\\n")
+    .add("distance", numeric_limits<double>::infinity());
+  ASSERT_EQ(record.str(), "{\"event\":\"failure\",\"x\":0.5,\"cell_id\":12,\"point_id\":7,\"count\":3,"
+                          "\"guessed\":false,\"composition\":\"c\\\"1\\\"\\\\\\n\",\"distance\":null}");
+  // the doubles are written exactly
+  ASSERT_EQ(EventRecord("e").add("v", 0.1).str(), "{\"event\":\"e\",\"v\":0.10000000000000001}");
+  ASSERT_EQ(EventRecord("e").add("s", string(1, '\x01')).str(), "{\"event\":\"e\",\"s\":\"\\u0001\"}");
+}
+
+TEST(EventLog, WriteFromSeveralThreads)
+{
+  string const path = "event_log_test.ndjson";
+  int const nbThreads = 4;
+  int const nbRecords = 20000;
+  {
+    // several buffers are handed to the writer
+    EventLog events(path);
+    vector<thread> threads;
+    for (int t = 0; t < nbThreads; ++t) {
+      threads.emplace_back([&events, t]() {
+        for (int i = 0; i < nbRecords; ++i) {
+          events.write(EventRecord("progress").add("thread", t).add("points", i));
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    events.close();
+    ASSERT_EQ(events.getNbRecords(), nbThreads * nbRecords);
+  }
+
+  // each line is a whole record, and each thread's records are in order
+  ifstream in(path);
+  string line;
+  vector<int> next(nbThreads, 0);
+  long nbLines = 0;
+  while (getline(in, line)) {
+    int thread = -1, points = -1;
+    ASSERT_EQ(sscanf(line.c_str(), "{\"event\":\"progress\",\"thread\":%d,\"points\":%d}", &thread, &points), 2);
+    ASSERT_GE(thread, 0);
+    ASSERT_LT(thread, nbThreads);
+    ASSERT_EQ(points, next[thread]);
+    ++next[thread];
+    ++nbLines;
+  }
+  ASSERT_EQ(nbLines, nbThreads * nbRecords);
+  std::remove(path.c_str());
+
+  ASSERT_THROW(EventLog("no_such_directory/events.ndjson"), std::runtime_error);
+}
+
+TEST(EventLog, SaveAndRestoreState)
+{
+  string const path = "event_log_resume_test.ndjson";
+  stringstream state;
+  {
+    EventLog events(path);
+    events.write(EventRecord("before").add("i", 1));
+    events.saveState(state);
+    events.write(EventRecord("after").add("i", 2));
+    events.close();
+  }
+  {
+    EventLog events(path, true);
+    // written again by the resumed run before it reads the checkpoint
+    events.write(EventRecord("again"));
+    events.restoreState(state);
+    ASSERT_EQ(events.getNbRecords(), 1);
+    events.write(EventRecord("resumed"));
+    events.close();
+    ASSERT_EQ(events.getNbRecords(), 2);
+  }
+  ifstream in(path);
+  stringstream content;
+  content << in.rdbuf();
+  ASSERT_EQ(content.str(), "{\"event\":\"before\",\"i\":1}\n{\"event\":\"resumed\"}\n");
+
+  // the file is shorter than at the checkpoint
+  {
+    ofstream out(path);
+  }
+  EventLog events(path, true);
+  state.clear();
+  state.seekg(0);
+  ASSERT_THROW(events.restoreState(state), std::runtime_error);
+  std::remove(path.c_str());
+}
+
+TEST(EventLog, Summary)
+{
+  Statistics stats;
+  stats.setNbT4Volumes(3);
+  stats.incrementSuccess();
+  stats.incrementOutside();
+  stats.incrementFailure();
+  stats.recordFailure({1., 2., 3.}, 1, 5, 6, 7, 0.5);
+  stats.recordCoveredRank(1);
+  string const summary = stats.getSummaryEvent("slab.t4").str();
+  ASSERT_NE(summary.find("\"event\":\"summary\",\"t4_file\":\"slab.t4\",\"total\":3,\"tested\":2,"
+                         "\"successful\":1,\"failed\":1,\"ignored\":0,\"outside\":1,\"skipped\":0,"
+                         "\"covered_volumes\":1,\"t4_volumes\":3"),
+            string::npos);
+  ASSERT_NE(summary.find("\"failed_distance_max\":0.5"), string::npos);
+  // no ignored point
+  ASSERT_NE(summary.find("\"ignored_distance_mean\":null"), string::npos);
+}
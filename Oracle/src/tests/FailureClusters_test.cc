@@ -0,0 +1,97 @@
+/**
+ * @file FailureClusters_test.cc
+ *
+ *
+ * @brief unit testing for the FailureClusters class
+ *
+ * @version 1.0
+ */
+
+#include "FailureClusters.hh"
+#include "gtest/gtest.h"
+#include <cstdio>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+
+using namespace std;
+
+TEST(FailureClusters, ConnectedRegions)
+{
+  FailureClusters clusters(1., 3);
+  FailureClusters::Key const key = {10, 2, 7, "WATER"};
+  // a line of points along x, one per voxel, added out of order
+  for (int i : {0, 4, 2, 1, 3}) {
+    clusters.add(key, {i + 0.5, 0.5, 0.5}, i, 0.1 * i);
+  }
+  // a second point in the voxel of the first one
+  clusters.add(key, {0.25, 0.75, 0.5}, 5, 0.05);
+  // a blob far away
+  clusters.add(key, {20.5, 0.5, 0.5}, 6, 1.);
+  clusters.add(key, {21.5, 1.5, 1.5}, 7, 2.);
+  // the same place, but another composition
+  clusters.add({10, 2, 7, "STEEL"}, {0.5, 0.5, 0.5}, 8, 3.);
+
+  ASSERT_EQ(clusters.getNbPoints(), 9);
+  ASSERT_EQ(clusters.getNbGroups(), 2);
+  vector<FailureClusters::Cluster> const result = clusters.getClusters();
+  ASSERT_EQ(result.size(), 3u);
+
+  FailureClusters::Cluster const &line = result[0];
+  ASSERT_EQ(line.nbPoints, 6);
+  ASSERT_EQ(line.nbVoxels, 5);
+  ASSERT_EQ(line.key.compo, "WATER");
+  ASSERT_EQ(line.min[0], 0.25);
+  ASSERT_EQ(line.max[0], 4.5);
+  ASSERT_EQ(line.max[1], 0.75);
+  ASSERT_DOUBLE_EQ(line.getCentroid()[0], (0.5 + 1.5 + 2.5 + 3.5 + 4.5 + 0.25) / 6);
+  ASSERT_DOUBLE_EQ(line.maxDist, 0.4);
+  // bounded, and in distinct voxels
+  ASSERT_EQ(line.representatives.size(), 3u);
+  set<long> voxels;
+  for (auto const &representative : line.representatives) {
+    voxels.insert(long(representative.position[0]));
+  }
+  ASSERT_EQ(voxels.size(), 3u);
+
+  // diagonal neighbours are connected
+  FailureClusters::Cluster const &blob = result[1];
+  ASSERT_EQ(blob.nbPoints, 2);
+  ASSERT_EQ(blob.maxDist, 2.);
+  ASSERT_EQ(result[2].key.compo, "STEEL");
+
+  ASSERT_THROW(FailureClusters(0.), std::invalid_argument);
+}
+
+TEST(FailureClusters, Write)
+{
+  FailureClusters clusters(0.5);
+  clusters.add({1, 1, 3, "FUEL"}, {0.1, 0.2, 0.3}, 1, 0.5);
+  clusters.add({1, 1, 3, "FUEL"}, {0.4, 0.2, 0.3}, 2, 0.5);
+  clusters.add({2, 0, 4, "VOID"}, {-5., 0., 0.}, 3, 0.5);
+
+  ostringstream report;
+  clusters.report(report, 1);
+  ASSERT_NE(report.str().find("2 clusters of 3 failed points"), string::npos);
+  ASSERT_NE(report.str().find("... 1 smaller clusters"), string::npos);
+
+  string const rawname = "failure_clusters_test";
+  clusters.write(rawname);
+  // the representatives are read by explainT4: x y z volume
+  ifstream in(rawname + ".representatives");
+  double x, y, z;
+  long volume;
+  vector<long> volumes;
+  while (in >> x >> y >> z >> volume) {
+    volumes.push_back(volume);
+  }
+  ASSERT_EQ(volumes, vector<long>({3, 4}));
+  ifstream clustersIn(rawname + ".clusters");
+  stringstream content;
+  content << clustersIn.rdbuf();
+  ASSERT_NE(content.str().find("composition FUEL"), string::npos);
+  ASSERT_NE(content.str().find("representative: point 3"), string::npos);
+  std::remove((rawname + ".clusters").c_str());
+  std::remove((rawname + ".representatives").c_str());
+}
@@ -0,0 +1,120 @@
+/**
+ * @file FailureSink_test.cc
+ *
+ *
+ * @brief unit testing for the FailureSink and FailureReader classes
+ *
+ * @version 1.0
+ */
+
+#include "FailureSink.hh"
+#include "Statistics.hh"
+#include "gtest/gtest.h"
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+using namespace std;
+
+TEST(FailureSink, WriteAndRead)
+{
+  string const path = "failure_sink_test.failures";
+  {
+    // several full blocks and a partial one
+    FailureSink sink(path, 7);
+    for (int i = 0; i < 100; ++i) {
+      sink.add({{0.5 * i, -1. * i, 1e-3 * i}, double(i), double(1000 + i), double(i % 3), 0.25 * i, double(i % 5)});
+    }
+    ASSERT_EQ(sink.getNbPoints(), 100);
+    sink.close();
+  }
+
+  FailureReader reader(path);
+  failedPoint point;
+  int nbRead = 0;
+  while (reader.read(point)) {
+    ASSERT_EQ(point.position[0], 0.5 * nbRead);
+    ASSERT_EQ(point.position[1], -1. * nbRead);
+    ASSERT_EQ(point.position[2], 1e-3 * nbRead);
+    ASSERT_EQ(point.mcnpParticleID, nbRead);
+    ASSERT_EQ(point.mcnpCellID, 1000 + nbRead);
+    ASSERT_EQ(point.mcnpMaterialID, nbRead % 3);
+    // the distances are stored in single precision
+    ASSERT_FLOAT_EQ(point.dist, 0.25 * nbRead);
+    ASSERT_EQ(point.rank, nbRead % 5);
+    ++nbRead;
+  }
+  ASSERT_EQ(nbRead, 100);
+  std::remove(path.c_str());
+
+  ASSERT_THROW(FailureReader("no_such_file.failures"), std::runtime_error);
+  {
+    ofstream out(path);
+    out << "ORACLESTATS 1\n";
+  }
+  ASSERT_THROW(FailureReader reader(path), std::runtime_error);
+  std::remove(path.c_str());
+}
+
+TEST(FailureSink, StreamedStatistics)
+{
+  string const path = "streamed_stats_test.failures";
+  Statistics stats;
+  stats.streamFailures(path);
+  stats.incrementFailure();
+  stats.recordFailure({1., 2., 3.}, 4, 5, 6, 7, 0.5);
+  stats.incrementFailure();
+  stats.recordFailure({-1., -2., -3.}, 0, 8, 9, 10, 1.5);
+  stats.closeFailureSink();
+  // the points are not kept in memory
+  ASSERT_TRUE(stats.getFailures().empty());
+  ASSERT_EQ(stats.getNbFailure(), 2);
+
+  // the converter writes the same file as writeOutForVisu()
+  string rawname = "streamed_stats_test";
+  FailureReader reader(path);
+  Statistics::writeFailedPoints(rawname, [&reader](failedPoint &point) { return reader.read(point); });
+  ifstream in(rawname + ".failedpoints.dat");
+  stringstream content;
+  content << in.rdbuf();
+  Statistics inMemory;
+  inMemory.recordFailure({1., 2., 3.}, 4, 5, 6, 7, 0.5);
+  inMemory.recordFailure({-1., -2., -3.}, 0, 8, 9, 10, 1.5);
+  string inMemoryName = "in_memory_test";
+  inMemory.writeOutForVisu(inMemoryName);
+  ifstream expectedIn("in_memory_test.failedpoints.dat");
+  stringstream expected;
+  expected << expectedIn.rdbuf();
+  ASSERT_FALSE(expected.str().empty());
+  ASSERT_EQ(content.str(), expected.str());
+  std::remove(path.c_str());
+  std::remove((rawname + ".failedpoints.dat").c_str());
+  std::remove((rawname + ".points").c_str());
+  std::remove("in_memory_test.failedpoints.dat");
+  std::remove("in_memory_test.points");
+}
+
+TEST(FailureSink, WideHistoryIDs)
+{
+  // the IDs of merged PTRAC files, pointID * n + k, exceed 32 bits
+  int64_t const firstID = (int64_t(1) << 40) + 3;
+  string const path = "wide_ids_test.failures";
+  Statistics stats;
+  stats.streamFailures(path);
+  for (int i = 0; i < 3; ++i) {
+    stats.incrementFailure();
+    stats.recordFailure({1., 2., 3.}, 4, firstID + i, 6, 7, 0.5);
+  }
+  stats.closeFailureSink();
+
+  FailureReader reader(path);
+  failedPoint point;
+  int nbRead = 0;
+  while (reader.read(point)) {
+    ASSERT_EQ(int64_t(point.mcnpParticleID), firstID + nbRead);
+    ++nbRead;
+  }
+  ASSERT_EQ(nbRead, 3);
+  std::remove(path.c_str());
+}
@@ -0,0 +1,62 @@
+/**
+ * @file GapSource_test.cc
+ *
+ *
+ * @brief unit testing for the GapSource class
+ *
+ * @version 1.0
+ */
+
+#include "GapSource.hh"
+#include "T4Geometry.hh"
+#include "gtest/gtest.h"
+#include <sstream>
+#include <stdexcept>
+
+using namespace std;
+
+TEST(GapSource, SampleVolume)
+{
+  T4Geometry t4Geom("slab.t4", T4Backend::NATIVE);
+  GapSource source(t4Geom, 7);
+  long const rank = t4Geom.getNative()->getRank(2001);
+  BoundingBox const box = {{-10., 10., -10., 10., -2., 2.}};
+  auto const points = source.sample(rank, box, 20);
+  ASSERT_EQ(points.size(), 20u);
+  for (auto const &point : points) {
+    ASSERT_TRUE(inBox(box, point[0], point[1], point[2]));
+    ASSERT_EQ(t4Geom.whichVolume({point[0], point[1], point[2]}), rank);
+    ASSERT_TRUE(point[2] >= -0.5 && point[2] <= 0.5);
+  }
+  // the same seed gives the same points
+  GapSource again(t4Geom, 7);
+  ASSERT_EQ(again.sample(rank, box, 20), points);
+  // a box missing the volume
+  ASSERT_TRUE(source.sample(rank, {{-1., 1., -1., 1., 1., 2.}}, 5).empty());
+  ASSERT_THROW(source.sample(rank, infiniteBox(), 5), std::invalid_argument);
+}
+
+TEST(GapSource, WriteSDEF)
+{
+  vector<array<double, 3>> points(20, {{1.5, -2., 0.25}});
+  ostringstream out;
+  GapSource::writeSDEF(out, points, {"a comment"});
+  istringstream in(out.str());
+  string line;
+  getline(in, line);
+  ASSERT_EQ(line, "c a comment");
+  getline(in, line);
+  ASSERT_EQ(line, "sdef pos=d1");
+  getline(in, line);
+  ASSERT_EQ(line, "si1 l 1.5 -2 0.25");
+  for (int i = 1; i < 20; ++i) {
+    getline(in, line);
+    ASSERT_EQ(line, "     1.5 -2 0.25");
+  }
+  getline(in, line);
+  ASSERT_EQ(line.substr(0, 5), "sp1 1");
+  ASSERT_LE(line.size(), 80u);
+  getline(in, line);
+  ASSERT_EQ(line, "     1 1 1 1");
+  ASSERT_THROW(GapSource::writeSDEF(out, {}, {}), std::invalid_argument);
+}
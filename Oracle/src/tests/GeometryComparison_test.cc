@@ -0,0 +1,532 @@
+/**
+ * @file GeometryComparison_test.cc
+ *
+ *
+ * @brief unit testing for the GeometryComparison class
+ *
+ * @version 1.0
+ */
+
+#include "GeometryComparison.hh"
+#include "gtest/gtest.h"
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <set>
+#include <sstream>
+
+using namespace std;
+
+namespace
+{
+/// a copy of slab.t4 where the compositions of volumes 1001 and 2001 are swapped
+string writeSwappedSlab()
+{
+  ifstream in("slab.t4");
+  stringstream content;
+  content << in.rdbuf();
+  string text = content.str();
+  string const first = "m347_-2.7 1 1001";
+  string const second = "m346_-2.7 1 2001";
+  text.replace(text.find(first), first.size(), "m346_-2.7 1 1001");
+  text.replace(text.find(second), second.size(), "m347_-2.7 1 2001");
+  string const path = "slab_swapped.t4";
+  ofstream out(path);
+  out << text;
+  return path;
+}
+
+/// a copy of slab.t4 where the plane between volumes 1001 and 2001 is moved
+string writeMovedSlab()
+{
+  ifstream in("slab.t4");
+  stringstream content;
+  content << in.rdbuf();
+  string text = content.str();
+  string const plane = "SURF 3 PLANEZ -0.5";
+  text.replace(text.find(plane), plane.size(), "SURF 3 PLANEZ -0.4");
+  string const path = "slab_moved.t4";
+  ofstream out(path);
+  out << text;
+  return path;
+}
+
+/// compares all the points of slabp, with the given options
+Statistics compareSlab(string const &t4Filename, OptionsCompare const &options, unsigned long *nbReused = nullptr,
+                       EventLog *events = nullptr)
+{
+  MCNPGeometry mcnpGeom("input_slab");
+  mcnpGeom.parseINP();
+  GeometryComparison comparison(t4Filename, options, mcnpGeom, events);
+  MCNPPTRACASCII ptrac("slabp");
+  while (ptrac.readNextPtracData(1000)) {
+    comparison.compare(ptrac.getPTRACRecord());
+  }
+  comparison.finish();
+  if (nbReused) {
+    *nbReused = comparison.getNbReused();
+  }
+  return std::move(comparison.getStatistics());
+}
+
+/// walks all the tracks of slabtracks
+Statistics compareSlabTracks(string const &t4Filename)
+{
+  OptionsCompare options;
+  options.backend = T4Backend::NATIVE;
+  MCNPGeometry mcnpGeom("input_slab");
+  mcnpGeom.parseINP();
+  GeometryComparison comparison(t4Filename, options, mcnpGeom);
+  MCNPPTRACASCII ptrac("slabtracks");
+  while (ptrac.readNextPtracData(1000)) {
+    comparison.compareTrack(ptrac.getHistory());
+  }
+  comparison.finish();
+  return std::move(comparison.getStatistics());
+}
+
+void expectSameStatistics(Statistics &expected, Statistics &actual)
+{
+  ASSERT_EQ(actual.getNbSuccess(), expected.getNbSuccess());
+  ASSERT_EQ(actual.getNbFailure(), expected.getNbFailure());
+  ASSERT_EQ(actual.getNbIgnored(), expected.getNbIgnored());
+  ASSERT_EQ(actual.getNbOutside(), expected.getNbOutside());
+  ASSERT_EQ(actual.getNbCovered(), expected.getNbCovered());
+  auto const expectedFailures = expected.getFailures();
+  auto const actualFailures = actual.getFailures();
+  ASSERT_EQ(actualFailures.size(), expectedFailures.size());
+  for (size_t i = 0; i < expectedFailures.size(); ++i) {
+    ASSERT_EQ(actualFailures[i].position, expectedFailures[i].position);
+    ASSERT_EQ(actualFailures[i].rank, expectedFailures[i].rank);
+    ASSERT_EQ(actualFailures[i].dist, expectedFailures[i].dist);
+  }
+}
+} // namespace
+
+TEST(GeometryComparison, SeveralCandidates)
+{
+  OptionsCompare options;
+  options.backend = T4Backend::NATIVE;
+  MCNPGeometry mcnpGeom("input_slab");
+  mcnpGeom.parseINP();
+  string const swapped = writeSwappedSlab();
+
+  GeometryComparison good("slab.t4", options, mcnpGeom);
+  GeometryComparison bad(swapped, options, mcnpGeom);
+  MCNPPTRACASCII ptrac("slabp");
+  while (ptrac.readNextPtracData(1000)) {
+    good.compare(ptrac.getPTRACRecord());
+    bad.compare(ptrac.getPTRACRecord());
+  }
+  good.skip();
+
+  Statistics &goodStats = good.getStatistics();
+  Statistics &badStats = bad.getStatistics();
+  ASSERT_EQ(goodStats.getNbFailure(), 0);
+  ASSERT_EQ(goodStats.getNbSkipped(), 1);
+  ASSERT_EQ(goodStats.getNbCovered(), 3);
+  ASSERT_EQ(badStats.getTotalPts(), goodStats.getTotalPts());
+  ASSERT_GT(badStats.getNbFailure(), 0);
+  // only the two swapped volumes fail
+  for (auto const &failure : badStats.getFailures()) {
+    ASSERT_TRUE(failure.rank == 0. || failure.rank == 1.);
+    ASSERT_LE(failure.position[2], 0.5);
+  }
+  std::remove(swapped.c_str());
+}
+
+TEST(GeometryComparison, GivenGeometry)
+{
+  OptionsCompare options;
+  options.backend = T4Backend::NATIVE;
+  string const swapped = writeSwappedSlab();
+  Statistics expected = compareSlab(swapped, options);
+  ASSERT_GT(expected.getNbFailure(), 0);
+
+  // the geometry is read once and set up again by each comparison: the
+  // associations guessed by the first one do not hide the failures
+  T4Geometry geometry(swapped, T4Backend::NATIVE);
+  MCNPGeometry mcnpGeom("input_slab");
+  mcnpGeom.parseINP();
+  for (bool guess : {true, false}) {
+    options.guessMaterialAssocs = guess;
+    GeometryComparison comparison(swapped, options, mcnpGeom, nullptr, &geometry);
+    MCNPPTRACASCII ptrac("slabp");
+    while (ptrac.readNextPtracData(1000)) {
+      comparison.compare(ptrac.getPTRACRecord());
+    }
+    comparison.finish();
+    if (!guess) {
+      ASSERT_EQ(comparison.getStatistics().getNbFailure(), expected.getNbFailure());
+      ASSERT_EQ(comparison.getStatistics().getNbSuccess(), expected.getNbSuccess());
+    }
+  }
+
+  options.backend = T4Backend::T4LIB;
+  ASSERT_THROW(GeometryComparison(swapped, options, mcnpGeom, nullptr, &geometry), std::runtime_error);
+  std::remove(swapped.c_str());
+}
+
+TEST(GeometryComparison, SequentialStop)
+{
+  OptionsCompare options;
+  options.backend = T4Backend::NATIVE;
+  options.sequential.reset(new std::array<double, 2>{{0.05, 0.9}});
+  MCNPGeometry mcnpGeom("input_slab");
+  mcnpGeom.parseINP();
+  string const swapped = writeSwappedSlab();
+  GeometryComparison bad(swapped, options, mcnpGeom);
+  MCNPPTRACASCII ptrac("slabp");
+  while (ptrac.readNextPtracData(1000) && !bad.isDone()) {
+    bad.compare(ptrac.getPTRACRecord());
+  }
+  ASSERT_TRUE(bad.isDone());
+  long const total = bad.getStatistics().getTotalPts();
+  bad.compare(ptrac.getPTRACRecord());
+  ASSERT_EQ(bad.getStatistics().getTotalPts(), total);
+  std::remove(swapped.c_str());
+}
+
+TEST(GeometryComparison, ReuseResults)
+{
+  string const store = "slab.results";
+  OptionsCompare options;
+  options.backend = T4Backend::NATIVE;
+  options.saveResults = store;
+  compareSlab("slab.t4", options);
+
+  // swapping compositions changes no volume: every rank is reused
+  string const swapped = writeSwappedSlab();
+  OptionsCompare full;
+  full.backend = T4Backend::NATIVE;
+  Statistics expected = compareSlab(swapped, full);
+  OptionsCompare incremental;
+  incremental.backend = T4Backend::NATIVE;
+  incremental.reuseResults = store;
+  unsigned long nbReused = 0;
+  Statistics actual = compareSlab(swapped, incremental, &nbReused);
+  ASSERT_GT(expected.getNbFailure(), 0);
+  expectSameStatistics(expected, actual);
+  ASSERT_EQ(nbReused, (unsigned long)(expected.getTotalPts()));
+
+  // moving a plane only relocates the points which may be affected
+  string const moved = writeMovedSlab();
+  expected = compareSlab(moved, full);
+  actual = compareSlab(moved, incremental, &nbReused);
+  expectSameStatistics(expected, actual);
+  ASSERT_GT(nbReused, 0ul);
+  ASSERT_LT(nbReused, (unsigned long)(expected.getTotalPts()));
+
+  std::remove(store.c_str());
+  std::remove(swapped.c_str());
+  std::remove(moved.c_str());
+}
+
+TEST(GeometryComparison, ShellSkipsVoxelInterior)
+{
+  OptionsCompare options;
+  options.backend = T4Backend::NATIVE;
+  options.shell.reset(new double(0.01));
+  options.shellInterior = 0;
+  MCNPGeometry mcnpGeom("input_slab");
+  mcnpGeom.parseINP();
+  GeometryComparison plain("slab.t4", options, mcnpGeom);
+  options.voxelBox.reset(new std::array<double, 6>{{-2., 2., -2., 2., -1.5, 1.5}});
+  options.voxelGrid.reset(new std::array<long, 3>{{4, 4, 6}});
+  options.voxelRefine = 3;
+  GeometryComparison voxels("slab.t4", options, mcnpGeom);
+  MCNPPTRACASCII ptrac("slabp");
+  while (ptrac.readNextPtracData(1000)) {
+    plain.compare(ptrac.getPTRACRecord());
+    voxels.compare(ptrac.getPTRACRecord());
+  }
+  // without voxels, every point is located before its distance is estimated
+  long const total = plain.getStatistics().getTotalPts() + plain.getStatistics().getNbSkipped();
+  ASSERT_GT(plain.getStatistics().getNbSkipped(), 0);
+  ASSERT_EQ(plain.getNbLocated(), (unsigned long)(total));
+  // the points of the labelled voxels are skipped without being located
+  ASSERT_GE(voxels.getStatistics().getNbSkipped(), plain.getStatistics().getNbSkipped());
+  ASSERT_LT(voxels.getNbLocated(), plain.getNbLocated());
+}
+
+TEST(GeometryComparison, SaveAndRestoreState)
+{
+  OptionsCompare options;
+  options.backend = T4Backend::NATIVE;
+  options.guessMaterialAssocs = true;
+  options.sequential.reset(new std::array<double, 2>{{1e-6, 0.9}});
+  string const swapped = writeSwappedSlab();
+  Statistics expected = compareSlab(swapped, options);
+
+  MCNPGeometry mcnpGeom("input_slab");
+  mcnpGeom.parseINP();
+  stringstream state;
+  MCNPPTRACASCII ptrac("slabp");
+  {
+    GeometryComparison first(swapped, options, mcnpGeom);
+    for (int i = 0; i < 400 && ptrac.readNextPtracData(1000); ++i) {
+      first.compare(ptrac.getPTRACRecord());
+    }
+    first.saveState(state);
+  }
+  GeometryComparison second(swapped, options, mcnpGeom);
+  second.restoreState(state);
+  while (ptrac.readNextPtracData(1000)) {
+    second.compare(ptrac.getPTRACRecord());
+  }
+  second.finish();
+  expectSameStatistics(expected, second.getStatistics());
+
+  // the state of another T4 file is rejected
+  GeometryComparison other("slab.t4", options, mcnpGeom);
+  state.clear();
+  state.seekg(0);
+  ASSERT_THROW(other.restoreState(state), std::runtime_error);
+  std::remove(swapped.c_str());
+}
+
+TEST(GeometryComparison, Tracks)
+{
+  // nine segments, each inside one volume
+  Statistics good = compareSlabTracks("slab.t4");
+  ASSERT_EQ(good.getNbSuccess(), 9);
+  ASSERT_EQ(good.getNbFailure(), 0);
+  ASSERT_EQ(good.getNbOutside(), 0);
+  ASSERT_EQ(good.getNbCovered(), 3);
+
+  // all the segments in the two swapped volumes fail
+  string const swapped = writeSwappedSlab();
+  Statistics bad = compareSlabTracks(swapped);
+  ASSERT_EQ(bad.getNbSuccess(), 2);
+  ASSERT_EQ(bad.getNbFailure(), 7);
+
+  // the moved plane cuts two segments of volume 2001, which no event falls in
+  string const moved = writeMovedSlab();
+  Statistics shifted = compareSlabTracks(moved);
+  ASSERT_EQ(shifted.getNbSuccess(), 9);
+  ASSERT_EQ(shifted.getNbFailure(), 2);
+  for (auto const &failure : shifted.getFailures()) {
+    ASSERT_EQ(failure.rank, 0.);
+    ASSERT_NEAR(failure.position[2], -0.45, 1e-9);
+    ASSERT_NEAR(failure.dist, 0.05 * (failure.position[0] == 1. ? 1. : std::sqrt(1.04)), 1e-9);
+  }
+  std::remove(swapped.c_str());
+  std::remove(moved.c_str());
+}
+
+TEST(GeometryComparison, ClusterFailures)
+{
+  string const swapped = writeSwappedSlab();
+  OptionsCompare options;
+  options.backend = T4Backend::NATIVE;
+  // larger than the slab: one cluster per key
+  options.clusterSize.reset(new double(100.));
+  options.clusterRepresentatives = 2;
+  Statistics stats = compareSlab(swapped, options);
+  ASSERT_GT(stats.getNbFailure(), 0);
+
+  // the two swapped volumes, 1001 and 2001
+  ifstream in("slab_swapped.representatives");
+  double x, y, z;
+  long volume;
+  long nbRepresentatives = 0;
+  set<long> volumes;
+  while (in >> x >> y >> z >> volume) {
+    volumes.insert(volume);
+    ++nbRepresentatives;
+  }
+  ASSERT_EQ(volumes, set<long>({1001, 2001}));
+  ASSERT_LE(nbRepresentatives, 4);
+  ifstream clustersIn("slab_swapped.clusters");
+  string line;
+  getline(clustersIn, line);
+  ASSERT_NE(line.find("2 clusters of " + to_string(stats.getNbFailure()) + " failed points"), string::npos);
+  std::remove("slab_swapped.clusters");
+  std::remove("slab_swapped.representatives");
+  std::remove(swapped.c_str());
+}
+
+TEST(GeometryComparison, ConfusionMatrix)
+{
+  OptionsCompare options;
+  options.backend = T4Backend::NATIVE;
+  Statistics good = compareSlab("slab.t4", options);
+  ASSERT_EQ(good.getConfusionMatrix().getNbEntries(), 3);
+  ASSERT_TRUE(good.getConfusionMatrix().getOffDiagonal().empty());
+
+  // the slab of cell 2001 loses a layer to volume 1001
+  string const moved = writeMovedSlab();
+  Statistics bad = compareSlab(moved, options);
+  auto const offDiagonal = bad.getConfusionMatrix().getOffDiagonal();
+  ASSERT_EQ(offDiagonal.size(), 1u);
+  ASSERT_EQ(offDiagonal[0].cellID, 2001);
+  ASSERT_EQ(offDiagonal[0].volume, 1001);
+  ASSERT_EQ(offDiagonal[0].mainVolume, 2001);
+  ASSERT_EQ(offDiagonal[0].count, bad.getNbFailure() + bad.getNbIgnored());
+  std::remove(moved.c_str());
+}
+
+TEST(GeometryComparison, HeatMap)
+{
+  OptionsCompare options;
+  options.backend = T4Backend::NATIVE;
+  options.heatMapGrid.reset(new std::array<long, 3>{{4, 4, 3}});
+  string const moved = writeMovedSlab();
+  Statistics stats = compareSlab(moved, options);
+
+  ifstream in("slab_moved.heatmap.vti", ios_base::binary);
+  stringstream content;
+  content << in.rdbuf();
+  string const text = content.str();
+  // the mesh covers the bounded volumes: the cylinder of radius 100, from z = -1.5 to 1.5
+  ASSERT_NE(text.find("Origin=\"-100 -100 -1.5\""), string::npos);
+  ASSERT_NE(text.find("Spacing=\"50 50 1\""), string::npos);
+  size_t const start = text.find("_", text.find("<AppendedData")) + 1;
+  vector<uint32_t> sampled(48), failed(48);
+  text.copy(reinterpret_cast<char *>(sampled.data()), 48 * sizeof(uint32_t), start + sizeof(uint64_t));
+  text.copy(reinterpret_cast<char *>(failed.data()), 48 * sizeof(uint32_t),
+            start + 2 * sizeof(uint64_t) + 48 * sizeof(uint32_t));
+  long nbSampled = 0, nbFailed = 0;
+  for (int i = 0; i < 48; ++i) {
+    nbSampled += sampled[i];
+    nbFailed += failed[i];
+    // the plane moved inside the middle layer
+    if (failed[i] > 0) {
+      ASSERT_EQ(i / 16, 1);
+    }
+  }
+  ASSERT_EQ(nbSampled, stats.getTotalPts());
+  ASSERT_EQ(nbFailed, stats.getNbFailure());
+  ASSERT_GT(nbFailed, 0);
+  std::remove("slab_moved.heatmap.vti");
+  std::remove(moved.c_str());
+}
+
+TEST(GeometryComparison, PointCloud)
+{
+  OptionsCompare options;
+  options.backend = T4Backend::NATIVE;
+  options.vtpFailures = true;
+  options.vtpAll = true;
+  string const moved = writeMovedSlab();
+  Statistics stats = compareSlab(moved, options);
+  ASSERT_GT(stats.getNbFailure(), 0);
+
+  for (auto const &item : {make_pair(string("slab_moved.failedpoints.vtp"), stats.getNbFailure()),
+                           make_pair(string("slab_moved.sampledpoints.vtp"), stats.getTotalPts())}) {
+    ifstream in(item.first, ios_base::binary);
+    stringstream content;
+    content << in.rdbuf();
+    ASSERT_NE(content.str().find("NumberOfPoints=\"" + to_string(item.second) + "\""), string::npos) << item.first;
+    std::remove(item.first.c_str());
+  }
+  std::remove(moved.c_str());
+}
+
+TEST(GeometryComparison, Events)
+{
+  OptionsCompare options;
+  options.backend = T4Backend::NATIVE;
+  string const moved = writeMovedSlab();
+  string const path = "slab_moved.events";
+  Statistics stats;
+  {
+    EventLog events(path);
+    stats = compareSlab(moved, options, nullptr, &events);
+    events.close();
+  }
+  ASSERT_GT(stats.getNbFailure(), 0);
+
+  ifstream in(path);
+  string line;
+  int nbFailures = 0;
+  int nbAssociations = 0;
+  while (getline(in, line)) {
+    ASSERT_EQ(line.front(), '{');
+    ASSERT_EQ(line.back(), '}');
+    if (line.find("{\"event\":\"failure\",\"t4_file\":\"slab_moved.t4\"") == 0) {
+      ASSERT_NE(line.find("\"distance\":"), string::npos);
+      ++nbFailures;
+    } else if (line.find("{\"event\":\"association\"") == 0) {
+      // the associations read from the composition names
+      ASSERT_NE(line.find("\"guessed\":false"), string::npos);
+      ++nbAssociations;
+    }
+  }
+  ASSERT_EQ(nbFailures, stats.getNbFailure());
+  ASSERT_GT(nbAssociations, 0);
+  std::remove(path.c_str());
+  std::remove(moved.c_str());
+}
+
+TEST(GeometryComparison, ResumeOutputs)
+{
+  OptionsCompare options;
+  options.backend = T4Backend::NATIVE;
+  options.streamFailures = true;
+  options.clusterSize.reset(new double(0.5));
+  options.heatMapGrid.reset(new std::array<long, 3>{{4, 4, 3}});
+  options.vtpFailures = true;
+  options.vtpAll = true;
+  string const moved = writeMovedSlab();
+  vector<string> const outputs = {"slab_moved.clusters", "slab_moved.representatives", "slab_moved.heatmap.vti",
+                                  "slab_moved.failedpoints.vtp", "slab_moved.sampledpoints.vtp"};
+  auto readFile = [](string const &path) {
+    ifstream in(path, ios_base::binary);
+    stringstream content;
+    content << in.rdbuf();
+    return content.str();
+  };
+  auto readFailures = []() {
+    vector<double> positions;
+    FailureReader reader("slab_moved.failures");
+    failedPoint point;
+    while (reader.read(point)) {
+      positions.insert(positions.end(), point.position.begin(), point.position.end());
+    }
+    return positions;
+  };
+  Statistics expected = compareSlab(moved, options);
+  ASSERT_GT(expected.getNbFailure(), 0);
+  vector<string> expectedOutputs;
+  for (auto const &path : outputs) {
+    expectedOutputs.push_back(readFile(path));
+    ASSERT_FALSE(expectedOutputs.back().empty()) << path;
+  }
+  vector<double> const expectedFailures = readFailures();
+
+  MCNPGeometry mcnpGeom("input_slab");
+  mcnpGeom.parseINP();
+  stringstream state;
+  {
+    // interrupted some points after the checkpoint
+    GeometryComparison first(moved, options, mcnpGeom);
+    MCNPPTRACASCII ptrac("slabp");
+    for (int i = 0; i < 500 && ptrac.readNextPtracData(1000); ++i) {
+      first.compare(ptrac.getPTRACRecord());
+      if (i == 399) {
+        first.saveState(state);
+      }
+    }
+    first.finish(true);
+  }
+  options.resume = true;
+  GeometryComparison second(moved, options, mcnpGeom);
+  second.restoreState(state);
+  MCNPPTRACASCII ptrac("slabp");
+  for (int i = 0; ptrac.readNextPtracData(1000); ++i) {
+    if (i >= 400) {
+      second.compare(ptrac.getPTRACRecord());
+    }
+  }
+  second.finish();
+  ASSERT_EQ(second.getStatistics().getNbFailure(), expected.getNbFailure());
+  for (size_t i = 0; i < outputs.size(); ++i) {
+    ASSERT_EQ(readFile(outputs[i]), expectedOutputs[i]) << outputs[i];
+    std::remove(outputs[i].c_str());
+  }
+  // the blocks differ, not the points
+  ASSERT_EQ(readFailures(), expectedFailures);
+  std::remove("slab_moved.failures");
+  std::remove(moved.c_str());
+}
@@ -0,0 +1,76 @@
+/**
+ * @file HeatMap_test.cc
+ *
+ *
+ * @brief unit testing for the HeatMap class
+ *
+ * @version 1.0
+ */
+
+#include "HeatMap.hh"
+#include "gtest/gtest.h"
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+using namespace std;
+
+TEST(HeatMap, Counts)
+{
+  HeatMap heatMap({{0., 4., 0., 2., -1., 1.}}, {{4, 2, 1}});
+  ASSERT_EQ(heatMap.cellIndex({0.5, 0.5, 0.}), 0);
+  ASSERT_EQ(heatMap.cellIndex({3.5, 0.5, 0.}), 3);
+  ASSERT_EQ(heatMap.cellIndex({0.5, 1.5, 0.}), 4);
+  // the upper bounds belong to the last cells
+  ASSERT_EQ(heatMap.cellIndex({4., 2., 1.}), 7);
+  ASSERT_EQ(heatMap.cellIndex({4.5, 0.5, 0.}), -1);
+
+  heatMap.add({0.5, 0.5, 0.}, ResultStore::Verdict::SUCCESS);
+  heatMap.add({0.5, 0.5, 0.}, ResultStore::Verdict::FAILURE);
+  heatMap.add({0.5, 0.5, 0.}, ResultStore::Verdict::IGNORED);
+  heatMap.add({3.5, 1.5, 0.}, ResultStore::Verdict::OUTSIDE);
+  heatMap.add({10., 0., 0.}, ResultStore::Verdict::FAILURE);
+  ASSERT_EQ(heatMap.getSampled()[0], 3u);
+  ASSERT_EQ(heatMap.getFailed()[0], 1u);
+  ASSERT_EQ(heatMap.getIgnored()[0], 1u);
+  ASSERT_EQ(heatMap.getSampled()[7], 1u);
+  ASSERT_EQ(heatMap.getFailed()[7], 0u);
+  ASSERT_EQ(heatMap.getNbOutsideMesh(), 1);
+
+  ASSERT_THROW(HeatMap({{0., 0., 0., 1., 0., 1.}}, {{1, 1, 1}}), std::runtime_error);
+  ASSERT_THROW(HeatMap(infiniteBox(), {{1, 1, 1}}), std::runtime_error);
+}
+
+TEST(HeatMap, WriteImageData)
+{
+  HeatMap heatMap({{0., 3., 0., 1., 0., 1.}}, {{3, 1, 1}});
+  heatMap.add({2.5, 0.5, 0.5}, ResultStore::Verdict::FAILURE);
+  heatMap.add({2.5, 0.5, 0.5}, ResultStore::Verdict::SUCCESS);
+  heatMap.add({0.5, 0.5, 0.5}, ResultStore::Verdict::IGNORED);
+  string const path = "heat_map_test.vti";
+  heatMap.write(path);
+
+  ifstream in(path, ios_base::binary);
+  stringstream content;
+  content << in.rdbuf();
+  string const text = content.str();
+  ASSERT_NE(text.find("WholeExtent=\"0 3 0 1 0 1\""), string::npos);
+  ASSERT_NE(text.find("Spacing=\"1 1 1\""), string::npos);
+  ASSERT_NE(text.find("Name=\"failed\" format=\"appended\" offset=\"20\""), string::npos);
+
+  // the arrays follow the underscore, each one after its size in bytes
+  size_t const start = text.find("_", text.find("<AppendedData")) + 1;
+  uint64_t nbBytes = 0;
+  text.copy(reinterpret_cast<char *>(&nbBytes), sizeof(nbBytes), start);
+  ASSERT_EQ(nbBytes, 3 * sizeof(uint32_t));
+  uint32_t values[3];
+  text.copy(reinterpret_cast<char *>(values), sizeof(values), start + sizeof(uint64_t));
+  ASSERT_EQ(values[0], 1u);
+  ASSERT_EQ(values[1], 0u);
+  ASSERT_EQ(values[2], 2u);
+  text.copy(reinterpret_cast<char *>(values), sizeof(values), start + 2 * sizeof(uint64_t) + nbBytes);
+  ASSERT_EQ(values[2], 1u);
+  ASSERT_NE(text.find("</VTKFile>"), string::npos);
+  std::remove(path.c_str());
+}
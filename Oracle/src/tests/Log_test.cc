@@ -0,0 +1,104 @@
+/**
+ * @file Log_test.cc
+ *
+ *
+ * @brief unit testing for the Log, LogMessage and LogGroup classes
+ *
+ * @version 1.0
+ */
+
+#include "Log.hh"
+#include "gtest/gtest.h"
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+/// redirects std::cout to a string while it exists
+class CaptureCout
+{
+  stringstream captured;
+  streambuf *previous;
+
+public:
+  // the messages logged before are written to the previous stream
+  CaptureCout() : previous((Log::sync(), cout.rdbuf(captured.rdbuf())))
+  {
+  }
+
+  ~CaptureCout()
+  {
+    Log::sync();
+    cout.rdbuf(previous);
+  }
+
+  string str()
+  {
+    Log::sync();
+    return captured.str();
+  }
+};
+} // namespace
+
+TEST(Log, Levels)
+{
+  CaptureCout capture;
+  LogLevel const previous = Log::getLevel();
+  Log::setLevel(LogLevel::INFO);
+  int nbFormatted = 0;
+  auto formatted = [&nbFormatted]() { return ++nbFormatted; };
+  ORACLE_LOG(INFO) << "info " << formatted();
+  // the disabled messages are not formatted
+  ORACLE_LOG(VERBOSE) << "verbose " << formatted();
+  Log::setLevel(LogLevel::VERBOSE);
+  ORACLE_LOG(VERBOSE) << "verbose " << formatted() << "\n";
+  Log::infoStream() << "from a library\nand a partial";
+  Log::infoStream() << " line\n";
+  Log::setLevel(previous);
+  ASSERT_EQ(capture.str(), "info 1\nverbose 2\nfrom a library\nand a partial line\n");
+  ASSERT_EQ(nbFormatted, 2);
+}
+
+TEST(Log, GroupsFromSeveralThreads)
+{
+  CaptureCout capture;
+  int const nbThreads = 4;
+  int const nbGroups = 500;
+  int const groupSize = 5;
+  vector<thread> threads;
+  for (int t = 0; t < nbThreads; ++t) {
+    threads.emplace_back([t]() {
+      for (int g = 0; g < nbGroups; ++g) {
+        LogGroup group;
+        for (int line = 0; line < groupSize; ++line) {
+          ORACLE_LOG(INFO) << t << " " << g << " " << line;
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  // the lines of a group follow each other, and the groups of a thread are in order
+  istringstream lines(capture.str());
+  vector<int> nextGroup(nbThreads, 0);
+  int t, g, line;
+  int nbLines = 0;
+  while (lines >> t >> g >> line) {
+    ASSERT_EQ(line, nbLines % groupSize);
+    if (line == 0) {
+      ASSERT_EQ(g, nextGroup[t]);
+      ++nextGroup[t];
+    } else {
+      ASSERT_EQ(g, nextGroup[t] - 1);
+    }
+    ++nbLines;
+  }
+  ASSERT_EQ(nbLines, nbThreads * nbGroups * groupSize);
+}
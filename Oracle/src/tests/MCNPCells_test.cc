@@ -0,0 +1,299 @@
+/**
+ * @file MCNPCells_test.cc
+ *
+ *
+ * @brief unit testing for the MCNPCellEvaluator class and the sampled points
+ *
+ * @version 1.0
+ */
+
+#include "MCNPCells.hh"
+#include "MCNPGeometry.hh"
+#include "gtest/gtest.h"
+#include <sstream>
+#include <stdexcept>
+
+using namespace std;
+
+class MCNPCellsTest : public ::testing::Test
+{
+
+protected:
+  static void SetUpTestCase()
+  {
+    istringstream deck("evaluator test\n"
+                       "c cells\n"
+                       "1 1 -1.0 -1 imp:n=1\n"
+                       "2 2 -2.0 -2 #1 imp:n=1\n"
+                       "3 3 -3.0 -3.1 -3.2 -3.3 imp:n=1 $ inside the translated RCC\n"
+                       "4 4 -4.0 -4 imp:n=1\n"
+                       "5 5 -5.0 -5 -8 imp:n=1\n"
+                       "6 6 -6.0 12 -13 : -6 imp:n=1\n"
+                       "7 0 -9 -11 10 fill=1 (2) imp:n=1\n"
+                       "71 1 -1.0 -20 u=1 imp:n=1\n"
+                       "72 2 -2.0 20 u=1 imp:n=1\n"
+                       "9 0 -7 #1 #2 #3 #4 &\n"
+                       "      #(-5 -8) #6\n"
+                       "      #7 imp:n=1\n"
+                       "10 0 7 imp:n=0\n"
+                       "12 like 1 but u=5\n"
+                       "\n"
+                       "c surfaces\n"
+                       "1 sph 0 0 0 1\n"
+                       "2 rpp -2 2 -2 2 -2 2\n"
+                       "3 1 rcc 0 0 0 0 0 4 1\n"
+                       "4 box 20 -1 -1 2 0 0 0 2 0 0 0 2\n"
+                       "5 kz 30 1 1\n"
+                       "6 tz 0 0 -10 3 0.5 0.5\n"
+                       "7 so 100\n"
+                       "8 pz 50\n"
+                       "9 c/z 40 0 2\n"
+                       "10 pz -5\n"
+                       "11 pz 5\n"
+                       "12 px 60\n"
+                       "13 px 62\n"
+                       "20 px 0\n"
+                       "\n"
+                       "tr1 10 0 0\n"
+                       "c a rotation of 90 degrees around z\n"
+                       "*tr2 40 1 0 90 0 90 180 90 90 90 90 0\n"
+                       "nps 10\n");
+    evaluator = new MCNPCellEvaluator(deck);
+  }
+
+  static void TearDownTestCase()
+  {
+    delete evaluator;
+    evaluator = nullptr;
+  }
+
+  static MCNPCellEvaluator *evaluator;
+};
+
+MCNPCellEvaluator *MCNPCellsTest::evaluator = nullptr;
+
+TEST_F(MCNPCellsTest, Cells)
+{
+  ASSERT_EQ(evaluator->getNbCells(), 12);
+  // sphere and RPP macrobodies, cell complement
+  ASSERT_EQ(evaluator->whichCell({0., 0., 0.}), 1);
+  ASSERT_EQ(evaluator->whichCell({1.5, 1.5, 1.5}), 2);
+  // RCC facets, translated by TR1
+  ASSERT_EQ(evaluator->whichCell({10.5, 0., 2.}), 3);
+  ASSERT_EQ(evaluator->whichCell({10.5, 0., 4.5}), 9);
+  ASSERT_EQ(evaluator->whichCell({12., 0., 2.}), 9);
+  // BOX
+  ASSERT_EQ(evaluator->whichCell({21., 0., 0.}), 4);
+  ASSERT_EQ(evaluator->whichCell({21., 0., 1.5}), 9);
+  // one-sheet cone
+  ASSERT_EQ(evaluator->whichCell({3., 0., 35.}), 5);
+  ASSERT_EQ(evaluator->whichCell({3., 0., 25.}), 9);
+  ASSERT_EQ(evaluator->whichCell({6., 0., 35.}), 9);
+  // intersection binds tighter than union
+  ASSERT_EQ(evaluator->whichCell({3., 0., -10.}), 6);
+  ASSERT_EQ(evaluator->whichCell({61., 0., 0.}), 6);
+  ASSERT_EQ(evaluator->whichCell({0., 0., -10.}), 9);
+  // universe 1 seen through the rotation of TR2: local x = y - 1
+  ASSERT_EQ(evaluator->whichCell({40.5, 0.5, 0.}), 71);
+  ASSERT_EQ(evaluator->whichCell({40., -1., -4.}), 71);
+  ASSERT_EQ(evaluator->whichCell({40., 1.5, 0.}), 72);
+  // outside world
+  ASSERT_EQ(evaluator->whichCell({50., 50., 0.}), 9);
+  ASSERT_EQ(evaluator->whichCell({0., 0., 150.}), 10);
+}
+
+TEST_F(MCNPCellsTest, Parameters)
+{
+  long const like = evaluator->getCellIndex(12);
+  ASSERT_EQ(evaluator->getUniverse(like), 5);
+  ASSERT_EQ(evaluator->getProgram(like).size(), evaluator->getProgram(evaluator->getCellIndex(1)).size());
+  ASSERT_EQ(evaluator->getFill(evaluator->getCellIndex(7)), 1);
+  ASSERT_EQ(evaluator->getUniverse(evaluator->getCellIndex(71)), 1);
+  ASSERT_EQ(evaluator->getCellIndex(999), -1);
+
+  BoundingBox const &box = evaluator->getBoundingBox(evaluator->getCellIndex(3));
+  ASSERT_NEAR(box[0], 9., 1e-9);
+  ASSERT_NEAR(box[1], 11., 1e-9);
+  ASSERT_NEAR(box[4], 0., 1e-9);
+  ASSERT_NEAR(box[5], 4., 1e-9);
+}
+
+TEST(MCNPCells, Macrobodies)
+{
+  istringstream deck("macrobodies\n"
+                     "1 0 -1 imp:n=1\n"
+                     "2 0 -2 imp:n=1\n"
+                     "3 0 -3 imp:n=1\n"
+                     "4 0 -4 imp:n=1\n"
+                     "5 0 -5 imp:n=1\n"
+                     "6 0 -6 imp:n=1\n"
+                     "7 0 -7 imp:n=1\n"
+                     "8 0 -8 imp:n=1\n"
+                     "9 0 -9 imp:n=1\n"
+                     "10 0 1.7 -1.1 -1.2 -1.3 -1.4 -1.5 -1.6 imp:n=1\n"
+                     "\n"
+                     "1 rhp 0 0 0 0 0 2 1 0 0\n"
+                     "2 rec 10 0 0 0 0 2 2 0 0 0 1 0\n"
+                     "3 rec 20 0 0 0 0 2 2 0 0 1\n"
+                     "4 trc 30 0 0 0 0 2 2 1\n"
+                     "5 ell 38 0 0 42 0 0 3\n"
+                     "6 ell 50 0 0 0 0 2 -1\n"
+                     "7 wed 60 0 0 2 0 0 0 2 0 0 0 2\n"
+                     "8 arb 70 0 0 72 0 0 70 2 0 70 0 2 0 0 0 0 0 0 0 0 0 0 0 0 &\n"
+                     "      1230 1240 1340 2340 0 0\n"
+                     "9 hex 80 0 0 0 0 2 1 0 0 0.5 0.866 0 -0.5 0.866 0\n"
+                     "\n");
+  MCNPCellEvaluator const evaluator(deck);
+  // RHP: the apothem is 1 along x; the corners are at 2/sqrt(3) along y
+  ASSERT_EQ(evaluator.whichCell({0.9, 0., 1.}), 1);
+  ASSERT_EQ(evaluator.whichCell({0., 1.1, 1.}), 1);
+  ASSERT_EQ(evaluator.whichCell({1.1, 0., 1.}), -1);
+  ASSERT_EQ(evaluator.whichCell({0., 1.2, 1.}), -1);
+  ASSERT_EQ(evaluator.whichCell({0., 0., -0.1}), -1);
+  // REC with two axis vectors, and with a minor radius
+  ASSERT_EQ(evaluator.whichCell({11.9, 0., 1.}), 2);
+  ASSERT_EQ(evaluator.whichCell({10., 0.9, 1.}), 2);
+  ASSERT_EQ(evaluator.whichCell({10., 1.1, 1.}), -1);
+  ASSERT_EQ(evaluator.whichCell({21.9, 0., 1.}), 3);
+  ASSERT_EQ(evaluator.whichCell({20., 1.1, 1.}), -1);
+  ASSERT_EQ(evaluator.whichCell({21., 0., -0.1}), -1);
+  // TRC: radius 2 at z = 0, 1 at z = 2; no point beyond the apex at z = 4
+  ASSERT_EQ(evaluator.whichCell({31.9, 0., 0.1}), 4);
+  ASSERT_EQ(evaluator.whichCell({31.6, 0., 1.}), -1);
+  ASSERT_EQ(evaluator.whichCell({30., 0., 5.}), -1);
+  // ELL from the foci (semi-axes 3 and sqrt(5)), and from the centre
+  ASSERT_EQ(evaluator.whichCell({42.9, 0., 0.}), 5);
+  ASSERT_EQ(evaluator.whichCell({40., 0., 2.2}), 5);
+  ASSERT_EQ(evaluator.whichCell({43.1, 0., 0.}), -1);
+  ASSERT_EQ(evaluator.whichCell({40., 2.3, 0.}), -1);
+  ASSERT_EQ(evaluator.whichCell({50., 0., 1.9}), 6);
+  ASSERT_EQ(evaluator.whichCell({50.9, 0., 0.}), 6);
+  ASSERT_EQ(evaluator.whichCell({51.1, 0., 0.}), -1);
+  // WED: the triangle x + y < 2 in the plane z = 0, extruded to z = 2
+  ASSERT_EQ(evaluator.whichCell({60.9, 0.9, 1.}), 7);
+  ASSERT_EQ(evaluator.whichCell({61.1, 1.1, 1.}), -1);
+  ASSERT_EQ(evaluator.whichCell({60.5, -0.1, 1.}), -1);
+  ASSERT_EQ(evaluator.whichCell({60.5, 0.5, 2.1}), -1);
+  // ARB: a tetrahedron with four facets
+  ASSERT_EQ(evaluator.whichCell({70.5, 0.5, 0.5}), 8);
+  ASSERT_EQ(evaluator.whichCell({71., 1., 1.}), -1);
+  ASSERT_EQ(evaluator.whichCell({70.5, 0.5, -0.1}), -1);
+  // HEX with its three facet vectors
+  ASSERT_EQ(evaluator.whichCell({80.9, 0., 1.}), 9);
+  ASSERT_EQ(evaluator.whichCell({81.1, 0., 1.}), -1);
+  // facets of a macrobody: the hexagonal column above the RHP
+  ASSERT_EQ(evaluator.whichCell({0., 0., 3.}), 10);
+  ASSERT_EQ(evaluator.whichCell({1.5, 0., 3.}), -1);
+}
+
+TEST(MCNPCells, Trcl)
+{
+  istringstream deck("moved cells\n"
+                     "1 0 -1 trcl=1 imp:n=1\n"
+                     "2 0 -1 : -2 trcl (20 0 0) imp:n=1\n"
+                     "3 like 2 but *trcl=(30 0 0 90 0 90 180 90 90 90 90 0)\n"
+                     "4 0 -3 fill=1 trcl=2 imp:n=1\n"
+                     "41 0 4 u=1 imp:n=1\n"
+                     "\n"
+                     "1 so 1\n"
+                     "2 2 rpp 0 2 -1 1 -1 1\n"
+                     "3 rpp 40 50 -5 5 -5 5\n"
+                     "4 px 45\n"
+                     "\n"
+                     "tr1 10 0 0\n"
+                     "tr2 5 0 0\n");
+  MCNPCellEvaluator const evaluator(deck);
+  ASSERT_TRUE(evaluator.getSkippedCells().empty());
+  ASSERT_EQ(evaluator.whichCell({10.5, 0., 0.}), 1);
+  ASSERT_EQ(evaluator.whichCell({0.5, 0., 0.}), -1);
+  // the TR2 of surface 2 is applied before the TRCL of the cell
+  ASSERT_EQ(evaluator.whichCell({20.5, 0., 0.}), 2);
+  ASSERT_EQ(evaluator.whichCell({21.5, 0., 0.}), -1);
+  ASSERT_EQ(evaluator.whichCell({25.5, 0., 0.}), 2);
+  // the rotation of 90 degrees around z maps the x axis of the RPP on y
+  ASSERT_EQ(evaluator.whichCell({30., 5.5, 0.}), 3);
+  ASSERT_EQ(evaluator.whichCell({35.5, 0., 0.}), -1);
+  // the filling universe moves with the cell: its px 45 is at x = 50
+  ASSERT_EQ(evaluator.whichCell({40.5, 0., 0.}), -1);
+  ASSERT_EQ(evaluator.whichCell({46., 0., 0.}), -1);
+  ASSERT_EQ(evaluator.whichCell({50.5, 0., 0.}), 41);
+  ASSERT_EQ(evaluator.whichCell({54.5, 0., 0.}), 41);
+  ASSERT_EQ(evaluator.getSurfaces().getNumber(evaluator.getSurfaces().size() - 1), -(10 * 4003 + 6));
+}
+
+TEST(MCNPCells, SkippedCells)
+{
+  istringstream deck("skipped cells\n"
+                     "1 0 -1 imp:n=1\n"
+                     "2 0 -2 fill=1 imp:n=1\n"
+                     "3 0 -3 lat=1 u=1 fill=0:1 0:0 0:0 2 2 imp:n=1\n"
+                     "4 0 -4 imp:n=1\n"
+                     "5 0 #4 -5 imp:n=1\n"
+                     "\n"
+                     "1 -6 px 1\n"
+                     "2 rpp 10 20 -1 1 -1 1\n"
+                     "3 rpp 10 11 -1 1 -1 1\n"
+                     "4 xyz 1 2 3\n"
+                     "5 so 100\n"
+                     "6 -1 px 2\n"
+                     "\n");
+  MCNPCellEvaluator const evaluator(deck);
+  ASSERT_EQ(evaluator.getNbCells(), 5);
+  auto const &skipped = evaluator.getSkippedCells();
+  ASSERT_EQ(skipped.size(), 3u);
+  ASSERT_EQ(skipped[0].first, 3);
+  ASSERT_EQ(skipped[1].first, 4);
+  ASSERT_EQ(skipped[2].first, 5);
+  // periodic surfaces are ordinary planes
+  ASSERT_EQ(evaluator.whichCell({0., 0., 0.}), 1);
+  // the lattice is not located
+  ASSERT_EQ(evaluator.whichCell({10.5, 0., 0.}), -1);
+  ASSERT_EQ(evaluator.whichCell({50., 0., 0.}), -1);
+}
+
+TEST_F(MCNPCellsTest, UnsupportedInput)
+{
+  istringstream fillArray("fill array\n1 0 -1 fill=0:1 0:0 0:0 1 1\n\n1 so 1\n\n");
+  ASSERT_THROW(MCNPCellEvaluator evaluator(fillArray), std::runtime_error);
+  istringstream unknownSurface("unknown surface\n1 0 -2\n\n1 so 1\n\n");
+  ASSERT_THROW(MCNPCellEvaluator evaluator(unknownSurface), std::runtime_error);
+  istringstream circular("circular\n1 0 -1 #2\n2 0 -1 #1\n\n1 so 1\n\n");
+  ASSERT_THROW(MCNPCellEvaluator evaluator(circular), std::runtime_error);
+  istringstream unbalanced("unbalanced\n1 0 (-1 : 2\n\n1 so 1\n2 so 2\n\n");
+  ASSERT_THROW(MCNPCellEvaluator evaluator(unbalanced), std::runtime_error);
+}
+
+TEST(MCNPCellsSlab, MatchesPTRAC)
+{
+  MCNPCellEvaluator evaluator("input_slab");
+  MCNPPTRACASCII ptrac("slabp");
+  long nbPoints = 0;
+  while (ptrac.readNextPtracData(1000)) {
+    auto const &record = ptrac.getPTRACRecord();
+    ASSERT_EQ(evaluator.whichCell(record.point), record.cellID);
+    ++nbPoints;
+  }
+  ASSERT_EQ(nbPoints, 1000);
+  ASSERT_EQ(evaluator.whichCell({0., 0., 2.}), 1000);
+  ASSERT_EQ(evaluator.whichCell({200., 0., 0.}), 1000);
+}
+
+TEST(MCNPCellsSlab, SampledPoints)
+{
+  MCNPGeometry geometry("input_slab");
+  geometry.parseINP();
+  geometry.parseCells();
+  MCNPSampledPoints points(geometry, {-100., 100., -100., 100., -2., 2.});
+  long nbPoints = 0;
+  while (points.readNextPtracData(500)) {
+    auto const &record = points.getPTRACRecord();
+    ASSERT_EQ(record.pointID, nbPoints + 1);
+    ASSERT_EQ(geometry.whichCell(record.point), record.cellID);
+    ASSERT_EQ(record.materialID, long(geometry.getCellMaterial(record.cellID)));
+    ASSERT_TRUE(record.point[2] >= -2. && record.point[2] <= 2.);
+    ++nbPoints;
+  }
+  ASSERT_EQ(nbPoints, 500);
+  ASSERT_EQ(points.getNbPointsRead(), 500);
+  ASSERT_EQ(points.getNbUndefined(), 0u);
+}
@@ -8,6 +8,9 @@
 #include "MCNPGeometry.hh"
 #include "gtest/gtest.h"
 #include <fstream>
+#include <functional>
+#include <memory>
+#include <set>
 
 using namespace std;
 
@@ -115,3 +118,120 @@ TEST_F(MCNPtestPtracBinary, ReadAll)
 }
 
 
+TEST(MCNPtestPtracASCIIHistory, ReadAllEvents)
+{
+  MCNPPTRACASCII ptrac("slabtracks");
+  ASSERT_TRUE(ptrac.readNextPtracData(1000));
+  auto const &history = ptrac.getHistory();
+  ASSERT_EQ(history.size(), 6u);
+  vector<long> eventIDs, cellIDs;
+  for (auto const &event : history) {
+    ASSERT_EQ(event.pointID, 1);
+    eventIDs.push_back(event.eventID);
+    cellIDs.push_back(event.cellID);
+  }
+  ASSERT_EQ(eventIDs, (vector<long>{1000, 3000, 4000, 3000, 3000, 5000}));
+  ASSERT_EQ(cellIDs, (vector<long>{1001, 2001, 2001, 3001, 1000, 1000}));
+  ASSERT_DOUBLE_EQ(history[2].point[0], 0.1);
+  ASSERT_DOUBLE_EQ(history[4].point[2], 1.5);
+
+  // the record is the source event
+  auto const &record = ptrac.getPTRACRecord();
+  ASSERT_EQ(record.eventID, 1000);
+  ASSERT_EQ(record.cellID, 1001);
+  ASSERT_DOUBLE_EQ(record.point[2], -1.);
+
+  ASSERT_TRUE(ptrac.readNextPtracData(1000));
+  ASSERT_EQ(ptrac.getHistory()[3].eventID, 2032);
+  ASSERT_TRUE(ptrac.readNextPtracData(1000));
+  ASSERT_EQ(ptrac.getHistory().size(), 2u);
+  ASSERT_FALSE(ptrac.readNextPtracData(1000));
+  ASSERT_EQ(ptrac.getNbPointsRead(), 3);
+
+  MCNPPTRACASCII sources("slabp");
+  ASSERT_TRUE(sources.readNextPtracData(1000));
+  ASSERT_EQ(sources.getHistory().size(), 1u);
+}
+
+TEST(MCNPtestPtracMulti, ReadAll)
+{
+  std::vector<std::unique_ptr<MCNPPTRAC>> readers;
+  readers.emplace_back(new MCNPPTRACASCII("slabp"));
+  readers.emplace_back(new MCNPPTRACBinary("slabbinp"));
+  MCNPPTRACMulti ptrac(std::move(readers));
+  ASSERT_EQ(ptrac.getNbFiles(), 2u);
+
+  std::set<long> pointIDs;
+  long nbRead = 0;
+  while (ptrac.readNextPtracData(5000)) {
+    auto const &record = ptrac.getPTRACRecord();
+    // the first chunk holds the whole ASCII file
+    ASSERT_EQ(record.pointID % 2, nbRead < 1000 ? 0 : 1);
+    pointIDs.insert(record.pointID);
+    ++nbRead;
+  }
+  ASSERT_EQ(nbRead, 2000);
+  ASSERT_EQ(ptrac.getNbPointsRead(), 2000);
+  ASSERT_EQ(pointIDs.size(), 2000u);
+}
+
+TEST(MCNPtestPtracMulti, MaxPoints)
+{
+  std::vector<std::unique_ptr<MCNPPTRAC>> readers;
+  readers.emplace_back(new MCNPPTRACASCII("slabp"));
+  readers.emplace_back(new MCNPPTRACASCII("slabp"));
+  MCNPPTRACMulti ptrac(std::move(readers));
+  long nbRead = 0;
+  while (ptrac.readNextPtracData(1500)) {
+    ++nbRead;
+  }
+  ASSERT_EQ(nbRead, 1500);
+  auto const &record = ptrac.getPTRACRecord();
+  ASSERT_EQ(record.pointID, 500 * 2 + 1);
+}
+
+namespace
+{
+/// checks that a reader moved to the position of another one reads the same records
+void checkPosition(std::function<MCNPPTRAC *()> const &open, long nbSkipped)
+{
+  std::unique_ptr<MCNPPTRAC> first(open());
+  for (long i = 0; i < nbSkipped; ++i) {
+    ASSERT_TRUE(first->readNextPtracData(5000));
+  }
+  std::vector<long> const position = first->getPosition();
+  std::unique_ptr<MCNPPTRAC> second(open());
+  second->setPosition(position);
+  ASSERT_EQ(second->getNbPointsRead(), first->getNbPointsRead());
+  long nbRead = 0;
+  while (first->readNextPtracData(5000)) {
+    ASSERT_TRUE(second->readNextPtracData(5000));
+    ASSERT_EQ(second->getPTRACRecord().pointID, first->getPTRACRecord().pointID);
+    ASSERT_EQ(second->getPTRACRecord().cellID, first->getPTRACRecord().cellID);
+    ASSERT_EQ(second->getPTRACRecord().point, first->getPTRACRecord().point);
+    ++nbRead;
+  }
+  ASSERT_FALSE(second->readNextPtracData(5000));
+  ASSERT_GT(nbRead, 0);
+}
+} // namespace
+
+TEST(MCNPtestPtracPosition, SingleFiles)
+{
+  checkPosition([]() { return new MCNPPTRACASCII("slabp"); }, 0);
+  checkPosition([]() { return new MCNPPTRACASCII("slabp"); }, 321);
+  checkPosition([]() { return new MCNPPTRACBinary("slabbinp"); }, 321);
+  ASSERT_THROW(MCNPPTRACBinary("slabbinp").setPosition({0}), std::runtime_error);
+}
+
+TEST(MCNPtestPtracPosition, SeveralFiles)
+{
+  auto open = []() {
+    std::vector<std::unique_ptr<MCNPPTRAC>> readers;
+    readers.emplace_back(new MCNPPTRACASCII("slabp"));
+    readers.emplace_back(new MCNPPTRACBinary("slabbinp"));
+    return new MCNPPTRACMulti(std::move(readers));
+  };
+  checkPosition(open, 321);
+  checkPosition(open, 1500);
+}
@@ -0,0 +1,196 @@
+/**
+ * @file NativeT4Geometry_test.cc
+ *
+ *
+ * @brief unit testing for the NativeT4Geometry class
+ *
+ * @version 1.0
+ */
+
+#include "NativeT4Geometry.hh"
+#include "T4Geometry.hh"
+#include "gtest/gtest.h"
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+
+using namespace std;
+
+class NativeT4Test : public ::testing::Test
+{
+
+protected:
+  static void SetUpTestCase()
+  {
+    ofstream file(operatorsPath);
+    file << "GEOMETRY\n"
+            "TITLE operators\n"
+            "HASH_TABLE\n"
+            "SURF 1 SPHERE 0 0 0 10\n"
+            "SURF 2 PLANEX 0\n"
+            "/* a cylinder along x, centred on (y, z) = (0, 20) */\n"
+            "TRANSFORM 7 MATRIX 0 0 20  0 0 1  0 1 0  -1 0 0\n"
+            "SURF 3 TRANSFORM 7 CYLZ 0 0 1\n"
+            "SURF 4 TORUSZ 0 0 -20 5 1 1\n"
+            "SURF 5 SPHERE 0 0 0 100\n"
+            "SURF 100001 PLANEX 1 // aux plane for unions\n"
+            "SURF 100002 PLANEX -1 // aux plane for unions\n"
+            "VOLU 1 EQUA MINUS 2 1 2 FICTIVE ENDV\n"
+            "VOLU 2 EQUA PLUS 1 2 MINUS 1 1 FICTIVE ENDV\n"
+            "VOLU 3 EQUA PLUS 1 100001 MINUS 1 100002 UNION 2 1 2 ENDV\n"
+            "VOLU 4 EQUA MINUS 1 3 ENDV\n"
+            "VOLU 5 EQUA MINUS 1 4 ENDV\n"
+            "VOLU 6 EQUA MINUS 1 5 INTE 1 7 ENDV\n"
+            "VOLU 7 EQUA PLUS 1 1 FICTIVE ENDV\n"
+            "ENDG\n"
+            "GEOMCOMP\n"
+            "SPHERE_MAT 1 3\n"
+            "CYL_MAT 2 4 5\n"
+            "VOID 1 6\n"
+            "END_GEOMCOMP\n";
+    file.close();
+    operators = new NativeT4Geometry(operatorsPath);
+    slab = new NativeT4Geometry("slab.t4");
+  }
+
+  static void TearDownTestCase()
+  {
+    delete operators;
+    operators = nullptr;
+    delete slab;
+    slab = nullptr;
+    std::remove(operatorsPath.c_str());
+  }
+
+  long numberAt(NativeT4Geometry const &geom, vector<double> const &point)
+  {
+    long const rank = geom.whichVolume(point);
+    return rank < 0 ? -1 : geom.getVolumeNumber(rank);
+  }
+
+  static const std::string operatorsPath;
+  static NativeT4Geometry *operators;
+  static NativeT4Geometry *slab;
+};
+
+const std::string NativeT4Test::operatorsPath = "native_operators_test.t4";
+NativeT4Geometry *NativeT4Test::operators = nullptr;
+NativeT4Geometry *NativeT4Test::slab = nullptr;
+
+TEST_F(NativeT4Test, ReadSlab)
+{
+  ASSERT_EQ(slab->getNbVolumes(), 3);
+  ASSERT_EQ(slab->getVolumeNumber(1), 2001);
+  ASSERT_EQ(slab->getHalfSpaces(1), vector<long>({3, -1, -4}));
+  ASSERT_EQ(slab->getCompoNames(), vector<string>({"m347_-2.7", "m346_-2.7", "m345_-2.7"}));
+
+  vector<double> const point = {12.024, -72.882, 1.0883};
+  ASSERT_EQ(numberAt(*slab, point), 3001);
+  ASSERT_EQ(slab->getCompoName(slab->whichVolume(point)), "m345_-2.7");
+  ASSERT_EQ(slab->getCompoName(-1), "No compo");
+
+  ASSERT_EQ(numberAt(*slab, {0., 0., 1.6}), -1);
+  ASSERT_EQ(numberAt(*slab, {100.1, 0., 0.}), -1);
+}
+
+TEST_F(NativeT4Test, Operators)
+{
+  ASSERT_EQ(operators->getNbVolumes(), 7);
+  ASSERT_TRUE(operators->isFictive(0));
+  ASSERT_EQ(operators->getOperator(2), NativeT4Geometry::Operator::UNION);
+  ASSERT_EQ(operators->getOperands(2), vector<long>({0, 1}));
+  ASSERT_EQ(operators->getOperator(5), NativeT4Geometry::Operator::INTE);
+  ASSERT_EQ(operators->getOperands(5), vector<long>({6}));
+
+  // union of the two fictive half-spheres
+  ASSERT_EQ(numberAt(*operators, {-9., 0., 0.}), 3);
+  ASSERT_EQ(numberAt(*operators, {9., 1., 1.}), 3);
+  ASSERT_EQ(numberAt(*operators, {0., 0., 0.}), 3);
+  // transformed cylinder
+  ASSERT_EQ(numberAt(*operators, {50., 0., 20.5}), 4);
+  ASSERT_EQ(numberAt(*operators, {50., 0., 21.5}), 6);
+  // torus
+  ASSERT_EQ(numberAt(*operators, {0., 5., -20.}), 5);
+  ASSERT_EQ(numberAt(*operators, {0., 0., -20.}), 6);
+  ASSERT_EQ(numberAt(*operators, {5., 0., -18.9}), 6);
+  // intersection with a fictive volume defined later
+  ASSERT_EQ(numberAt(*operators, {0., 50., 0.}), 6);
+  ASSERT_EQ(numberAt(*operators, {0., 150., 0.}), -1);
+
+  ASSERT_EQ(operators->getCompoName(operators->getRank(4)), "CYL_MAT");
+  ASSERT_EQ(operators->getCompoName(operators->getRank(6)), "VOID");
+}
+
+TEST_F(NativeT4Test, BoundingBoxes)
+{
+  BoundingBox const &sphere = operators->getBoundingBox(operators->getRank(3));
+  for (int i = 0; i < 6; ++i) {
+    ASSERT_NEAR(sphere[i], i % 2 ? 10. : -10., 1e-9);
+  }
+
+  BoundingBox const &cylinder = operators->getBoundingBox(operators->getRank(4));
+  ASSERT_TRUE(std::isinf(cylinder[0]) && std::isinf(cylinder[1]));
+  ASSERT_NEAR(cylinder[2], -1., 1e-9);
+  ASSERT_NEAR(cylinder[3], 1., 1e-9);
+  ASSERT_NEAR(cylinder[4], 19., 1e-9);
+  ASSERT_NEAR(cylinder[5], 21., 1e-9);
+}
+
+TEST_F(NativeT4Test, GridMatchesLinearScan)
+{
+  std::mt19937 generator(12345);
+  std::uniform_real_distribution<double> coordinate(-120., 120.);
+  for (int i = 0; i < 20000; ++i) {
+    vector<double> const point = {coordinate(generator), coordinate(generator), coordinate(generator)};
+    long expected = -1;
+    for (long rank = 0; rank < operators->getNbVolumes() && expected < 0; ++rank) {
+      if (!operators->isFictive(rank) && operators->contains(rank, point[0], point[1], point[2])) {
+        expected = rank;
+      }
+    }
+    ASSERT_EQ(operators->whichVolume(point), expected);
+  }
+}
+
+TEST_F(NativeT4Test, DistanceToSurface)
+{
+  T4Geometry t4Geom("slab.t4", T4Backend::NATIVE);
+  vector<double> point1 = {3.0, -1.0, -0.5};           // on Surface between blue and green
+  vector<double> point1a = {3.0, -1.0, -0.5 + 2.0e-8}; // within margin of error
+  vector<double> point1b = {3.0, -1.0, -0.5 - 2.0e-8}; // within margin of error
+  vector<double> point2 = {3.0, -1.0, -1.44};          // in blue, far for Surface
+
+  ASSERT_TRUE(t4Geom.distanceFromSurface(point1, t4Geom.whichVolume(point1)) <= 1e-7);
+  ASSERT_TRUE(t4Geom.distanceFromSurface(point1a, t4Geom.whichVolume(point1a)) <= 1e-7);
+  ASSERT_TRUE(t4Geom.distanceFromSurface(point1b, t4Geom.whichVolume(point1b)) <= 1e-7);
+  ASSERT_NEAR(t4Geom.distanceFromSurface(point2, t4Geom.whichVolume(point2)), 0.06, 1e-9);
+
+  t4Geom.setDistanceMethod(DistanceMethod::ANALYTIC);
+  ASSERT_TRUE(t4Geom.distanceFromSurface(point1a, t4Geom.whichVolume(point1a)) <= 1e-7);
+  ASSERT_NEAR(t4Geom.distanceFromSurface(point2, t4Geom.whichVolume(point2)), 0.06, 1e-12);
+
+  // the auxiliary union planes are not boundaries of the sphere
+  pair<double, long> const exit = operators->nextSurfaceInDirection(operators->getRank(3), {-5., 0., 0.}, {1., 0., 0.});
+  ASSERT_NEAR(exit.first, 15., 1e-9);
+  ASSERT_EQ(exit.second, 1);
+  // ... but the plane between the two halves is seen by the analytic estimate
+  CSGBytecode const &bytecode = operators->getBytecode();
+  ASSERT_NEAR(bytecode.distanceBound(operators->getRank(3), -1.5, 0., 0.), 1.5, 1e-12);
+  ASSERT_NEAR(bytecode.distanceBound(operators->getRank(3), -7., 0., 0.), 3., 1e-12);
+}
+
+TEST_F(NativeT4Test, UnsupportedInput)
+{
+  std::string const path = "native_unsupported_test.t4";
+  ofstream file(path);
+  file << "GEOMETRY\nSURF 1 SPHERE 0 0 0 1\nVOLU 1 COMBI 1 1 ENDV\nENDG\n";
+  file.close();
+  ASSERT_THROW(NativeT4Geometry geom(path), std::runtime_error);
+  // the surfaces alone can still be read
+  SurfaceTable const surfaces = NativeT4Geometry::readSurfaces(path);
+  ASSERT_EQ(surfaces.size(), 1);
+  ASSERT_EQ(surfaces.getNumber(0), 1);
+  ASSERT_NEAR(surfaces.evaluate(0, 2., 0., 0.), 3., 1e-12);
+  std::remove(path.c_str());
+}
@@ -0,0 +1,106 @@
+/**
+ * @file OracleBatch_test.cc
+ *
+ *
+ * @brief unit testing for the OracleBatch class
+ *
+ * @version 1.0
+ */
+
+#include "OracleBatch.hh"
+#include "gtest/gtest.h"
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+/// a copy of slab.t4, which the cases write their output files after
+string copySlab(string const &path)
+{
+  ifstream in("slab.t4");
+  ofstream out(path);
+  out << in.rdbuf();
+  return path;
+}
+} // namespace
+
+TEST(OracleBatch, SplitArguments)
+{
+  vector<string> const expected = {"-n", "100", "my file.t4", "", "slabp"};
+  ASSERT_EQ(OracleBatch::splitArguments("  -n 100\t\"my file.t4\" \"\" slabp  "), expected);
+  ASSERT_TRUE(OracleBatch::splitArguments(" \t").empty());
+  ASSERT_THROW(OracleBatch::splitArguments("-n 100 \"slab.t4"), std::runtime_error);
+}
+
+TEST(OracleBatch, Run)
+{
+  string const first = copySlab("slab_batch1.t4");
+  string const unsupported = "slab_batch_unsupported.t4";
+  {
+    ofstream file(unsupported);
+    file << "GEOMETRY\nSURF 1 SPHERE 0 0 0 1\nVOLU 1 COMBI 1 1 ENDV\nENDG\n";
+  }
+  string const manifestPath = "batch_test.manifest";
+  {
+    ofstream manifest(manifestPath);
+    manifest << "# the slab, twice, a geometry which the native backend cannot read and invalid options\n"
+             << "--ascii --backend native " << first << " input_slab slabp\n"
+             << "\n"
+             << "  --ascii --backend native -n 100 " << first << " input_slab slabp\n"
+             << "--ascii --backend native " << unsupported << " input_slab slabp\n"
+             << "--ascii --backend native --cell-quota 0 " << first << " input_slab slabp\n"
+             << "--ascii \"" << first << "\n";
+  }
+  string const outputDir = "batch_test.outputs";
+  OracleBatch batch(manifestPath, outputDir);
+  ASSERT_EQ(batch.getCases().size(), 5u);
+  ASSERT_EQ(batch.getCases()[1].line, 4);
+  ASSERT_EQ(*batch.getCases()[1].options.npoints, 100);
+  ASSERT_EQ(batch.getCases()[1].options.outputDir, outputDir + "/case4");
+  ASSERT_EQ(batch.getCases()[3].error, "the cell quota must be positive");
+  ASSERT_EQ(batch.getCases()[4].error, "unbalanced quotes");
+
+  string const resultsPath = "batch_test.ndjson";
+  {
+    EventLog results(resultsPath);
+    ASSERT_EQ(batch.run(2, results, false), 3);
+    results.close();
+  }
+
+  // one record per case, in any order
+  ifstream in(resultsPath);
+  string line;
+  vector<string> records(8);
+  while (getline(in, line)) {
+    size_t const position = line.find("\"case\":");
+    ASSERT_NE(position, string::npos);
+    records.at(stoul(line.substr(position + 7))) = line;
+  }
+  ASSERT_EQ(records[2].find("{\"event\":\"summary\",\"t4_file\":\"slab_batch1.t4\""), 0u);
+  ASSERT_NE(records[2].find("\"failed\":0,"), string::npos);
+  ASSERT_NE(records[2].find("\"status\":\"ok\""), string::npos);
+  ASSERT_EQ(records[4].find("{\"event\":\"summary\",\"t4_file\":\"slab_batch1.t4\""), 0u);
+  ASSERT_NE(records[4].find("\"status\":\"ok\""), string::npos);
+  ASSERT_EQ(records[5].find("{\"event\":\"error\",\"case\":5,\"t4_file\":\"slab_batch_unsupported.t4\""), 0u);
+  ASSERT_NE(records[5].find("\"message\":\"cannot read the T4 geometry: "), string::npos);
+  ASSERT_EQ(records[6], "{\"event\":\"error\",\"case\":6,\"message\":\"the cell quota must be positive\"}");
+  ASSERT_EQ(records[7], "{\"event\":\"error\",\"case\":7,\"message\":\"unbalanced quotes\"}");
+
+  // each case writes its files to its own directory
+  for (string const &directory : {outputDir + "/case2", outputDir + "/case4"}) {
+    string const path = directory + "/slab_batch1.failedpoints.dat";
+    ASSERT_TRUE(ifstream(path).good()) << path;
+    std::remove(path.c_str());
+    std::remove(directory.c_str());
+  }
+  std::remove((outputDir + "/case5").c_str());
+  std::remove(outputDir.c_str());
+  for (auto const &path : {first, unsupported, manifestPath, resultsPath}) {
+    std::remove(path.c_str());
+  }
+}
@@ -0,0 +1,81 @@
+/**
+ * @file PointCloudWriter_test.cc
+ *
+ *
+ * @brief unit testing for the PointCloudWriter class
+ *
+ * @version 1.0
+ */
+
+#include "PointCloudWriter.hh"
+#include "gtest/gtest.h"
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+using namespace std;
+
+namespace
+{
+string readFile(string const &path)
+{
+  ifstream in(path, ios_base::binary);
+  stringstream content;
+  content << in.rdbuf();
+  return content.str();
+}
+
+/// the offset of an appended array, from its name
+size_t arrayOffset(string const &text, string const &name)
+{
+  size_t const found = text.find(name);
+  size_t const offset = text.find("offset=\"", found) + 8;
+  return stoul(text.substr(offset, text.find('"', offset) - offset));
+}
+
+template <typename T>
+T readAppended(string const &text, size_t offset, size_t index)
+{
+  size_t const start = text.find("_", text.find("<AppendedData")) + 1;
+  T value;
+  text.copy(reinterpret_cast<char *>(&value), sizeof(T), start + offset + sizeof(uint64_t) + index * sizeof(T));
+  return value;
+}
+} // namespace
+
+TEST(PointCloudWriter, Write)
+{
+  string const path = "point_cloud_test.vtp";
+  {
+    PointCloudWriter cloud(path);
+    cloud.add({{1., 2., 3.}}, 10, 100, 5, 0, -1., ResultStore::Verdict::SUCCESS);
+    cloud.add({{-1., -2., -3.}}, 11, 200, 6, 2, 0.5, ResultStore::Verdict::FAILURE);
+    cloud.add({{0., 0., 0.}}, 12, 300, 7, -1, -1., ResultStore::Verdict::OUTSIDE);
+    ASSERT_EQ(cloud.getNbPoints(), 3);
+    cloud.close();
+    // the temporary files are gone
+    ASSERT_FALSE(ifstream(path + ".cellID.tmp").good());
+  }
+
+  string const text = readFile(path);
+  ASSERT_NE(text.find("NumberOfPoints=\"3\" NumberOfVerts=\"3\""), string::npos);
+  size_t const points = arrayOffset(text, "NumberOfComponents=\"3\"");
+  ASSERT_EQ(points, 0u);
+  ASSERT_EQ(readAppended<double>(text, points, 3), -1.);
+  ASSERT_EQ(readAppended<double>(text, points, 5), -3.);
+  ASSERT_EQ(readAppended<int32_t>(text, arrayOffset(text, "Name=\"cellID\""), 1), 200);
+  ASSERT_EQ(readAppended<int32_t>(text, arrayOffset(text, "Name=\"rank\""), 2), -1);
+  ASSERT_EQ(readAppended<float>(text, arrayOffset(text, "Name=\"distance\""), 1), 0.5f);
+  ASSERT_EQ(readAppended<uint8_t>(text, arrayOffset(text, "Name=\"verdict\""), 2), 3);
+  ASSERT_EQ(readAppended<int64_t>(text, arrayOffset(text, "Name=\"connectivity\""), 2), 2);
+  ASSERT_EQ(readAppended<int64_t>(text, arrayOffset(text, "Name=\"offsets\""), 2), 3);
+  ASSERT_NE(text.find("</VTKFile>"), string::npos);
+  std::remove(path.c_str());
+
+  {
+    PointCloudWriter empty(path);
+  }
+  ASSERT_NE(readFile(path).find("NumberOfPoints=\"0\""), string::npos);
+  std::remove(path.c_str());
+}
@@ -0,0 +1,93 @@
+/**
+ * @file ResultStore_test.cc
+ *
+ *
+ * @brief unit testing for the ResultStore and GeometryDiff classes
+ *
+ * @version 1.0
+ */
+
+#include "NativeT4Geometry.hh"
+#include "ResultStore.hh"
+#include "gtest/gtest.h"
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+using namespace std;
+
+TEST(ResultStore, SaveAndLoad)
+{
+  ResultStore store({0x0123456789abcdefULL, 42}, {"m1", "m2"}, DistanceMethod::ANALYTIC);
+  store.add({1, 10, 0, 1, ResultStore::Verdict::SUCCESS, -1.});
+  store.add({3, 10, 1, 0, ResultStore::Verdict::FAILURE, 0.1});
+  store.add({4, 11, -1, -1, ResultStore::Verdict::OUTSIDE, -1.});
+  ASSERT_THROW(store.add({4, 11, 0, 0, ResultStore::Verdict::SUCCESS, -1.}), std::invalid_argument);
+  string const path = "result_store_test.results";
+  store.save(path);
+
+  ResultStore loaded(path);
+  ASSERT_EQ(loaded.getSignatures(), (vector<uint64_t>{0x0123456789abcdefULL, 42}));
+  ASSERT_EQ(loaded.getCompoNames(), (vector<string>{"m1", "m2"}));
+  ASSERT_EQ(loaded.getDistanceMethod(), DistanceMethod::ANALYTIC);
+  ASSERT_EQ(loaded.getNbEntries(), 3);
+  ASSERT_EQ(loaded.find(2), nullptr);
+  ResultStore::Entry const *entry = loaded.find(3);
+  ASSERT_NE(entry, nullptr);
+  ASSERT_EQ(entry->pointID, 10);
+  ASSERT_EQ(entry->rank, 1);
+  ASSERT_EQ(entry->verdict, ResultStore::Verdict::FAILURE);
+  ASSERT_EQ(entry->distance, 0.1);
+  ASSERT_EQ(loaded.find(4)->rank, -1);
+  ASSERT_EQ(loaded.find(5), nullptr);
+  std::remove(path.c_str());
+
+  ASSERT_THROW(ResultStore("no_such_file.results"), std::runtime_error);
+  {
+    ofstream out(path);
+    out << "ORACLERESULTS 1\ndistance 0\nvolumes 1\n0000000000000001\ncompos 0\npoints 1\n1 1 5 -1 0 -1\n";
+  }
+  // the rank is out of range
+  ASSERT_THROW(ResultStore store(path), std::runtime_error);
+  std::remove(path.c_str());
+}
+
+TEST(ResultStore, Diff)
+{
+  GeometryDiff diff({1, 2, 3, 4}, {1, 5, 3, 6, 7}, {false, false, false, true, false});
+  ASSERT_TRUE(diff.isUnchanged(0));
+  ASSERT_FALSE(diff.isUnchanged(1));
+  ASSERT_TRUE(diff.isUnchanged(2));
+  ASSERT_FALSE(diff.isUnchanged(3));
+  ASSERT_FALSE(diff.isUnchanged(4));
+  ASSERT_FALSE(diff.isUnchanged(-1));
+  // the fictive volume 3 is left out
+  ASSERT_EQ(diff.getChangedRanks(), (vector<long>{1, 4}));
+}
+
+TEST(ResultStore, SlabSignatures)
+{
+  ifstream in("slab.t4");
+  stringstream content;
+  content << in.rdbuf();
+  string text = content.str();
+  string const plane = "SURF 3 PLANEZ -0.5";
+  text.replace(text.find(plane), plane.size(), "SURF 3 PLANEZ -0.4");
+  string const path = "slab_moved.t4";
+  {
+    ofstream out(path);
+    out << text;
+  }
+  NativeT4Geometry slab("slab.t4");
+  NativeT4Geometry moved(path);
+  vector<uint64_t> const before = slab.getBytecode().getSignatures();
+  vector<uint64_t> const after = moved.getBytecode().getSignatures();
+  ASSERT_EQ(before.size(), 3u);
+  // the plane bounds the first two volumes only
+  ASSERT_NE(before[0], after[0]);
+  ASSERT_NE(before[1], after[1]);
+  ASSERT_EQ(before[2], after[2]);
+  ASSERT_EQ(before, NativeT4Geometry("slab.t4").getBytecode().getSignatures());
+  std::remove(path.c_str());
+}
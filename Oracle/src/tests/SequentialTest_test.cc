@@ -0,0 +1,50 @@
+/**
+ * @file SequentialTest_test.cc
+ *
+ *
+ * @brief unit testing for the SequentialTest class
+ *
+ * @version 1.0
+ */
+
+#include "SequentialTest.hh"
+#include "gtest/gtest.h"
+#include <cmath>
+#include <stdexcept>
+
+TEST(SequentialTest, ClopperPearsonBounds)
+{
+  // the usual two-sided 95% interval for 5 failures out of 100 trials
+  ASSERT_NEAR(clopperPearsonLower(5, 100, 0.025), 0.016431, 1e-5);
+  ASSERT_NEAR(clopperPearsonUpper(5, 100, 0.025), 0.112835, 1e-5);
+  ASSERT_NEAR(clopperPearsonUpper(0, 100, 0.05), 1. - std::pow(0.05, 0.01), 1e-12);
+  ASSERT_EQ(clopperPearsonLower(0, 100, 0.05), 0.);
+  ASSERT_EQ(clopperPearsonUpper(100, 100, 0.05), 1.);
+}
+
+TEST(SequentialTest, AcceptsCleanGeometry)
+{
+  SequentialTest test(1e-3, 0.99);
+  long n = 0;
+  while (test.update(n, 0) == SequentialTest::Verdict::CONTINUE && n < 1000000) {
+    ++n;
+  }
+  ASSERT_EQ(test.getVerdict(), SequentialTest::Verdict::ACCEPTED);
+  ASSERT_LT(test.getUpperBound(), 1e-3);
+  ASSERT_LT(test.getNbTrials(), 20000);
+  // the verdict is final
+  ASSERT_EQ(test.update(n + 100000, 1000), SequentialTest::Verdict::ACCEPTED);
+}
+
+TEST(SequentialTest, RejectsBrokenGeometry)
+{
+  SequentialTest test(1e-3, 0.99);
+  long n = 0;
+  while (test.update(n, n / 100) == SequentialTest::Verdict::CONTINUE && n < 1000000) {
+    ++n;
+  }
+  ASSERT_EQ(test.getVerdict(), SequentialTest::Verdict::REJECTED);
+  ASSERT_GT(test.getLowerBound(), 1e-3);
+  ASSERT_EQ(test.getNbTrials(), 1000);
+  ASSERT_THROW(SequentialTest(0., 0.99), std::invalid_argument);
+}
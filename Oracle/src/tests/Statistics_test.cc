@@ -5,8 +5,13 @@
  *      Author: jofausti
  */
 
+#include "Log.hh"
 #include "Statistics.hh"
 #include "gtest/gtest.h"
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
 
 using namespace std;
 
@@ -51,4 +56,90 @@ TEST_F(StatisticsTest, addFailed)
   ASSERT_EQ(failures[0].mcnpMaterialID, fail.mcnpMaterialID);
   ASSERT_EQ(failures[0].dist, fail.dist);
   ASSERT_EQ(failures[0].rank, fail.rank);
+
+  // the points are moved out, the counters stay
+  Stats->incrementFailure();
+  failures = Stats->takeFailures();
+  ASSERT_EQ(failures.size(), 1);
+  ASSERT_EQ(failures[0].mcnpCellID, fail.mcnpCellID);
+  ASSERT_TRUE(Stats->getFailures().empty());
+  ASSERT_EQ(Stats->getNbFailure(), 1);
+}
+
+TEST_F(StatisticsTest, SaveAndMerge)
+{
+  Stats->setNbT4Volumes(4);
+  Stats->recordCoveredRank(0);
+  Stats->recordCoveredRank(2);
+  Stats->incrementSuccess();
+  Stats->incrementSuccess();
+  Stats->incrementOutside();
+  Stats->incrementFailure();
+  Stats->recordFailure({1.0, 2.5, 4.0}, 2, 11, 12, 13, 0.125);
+  Stats->incrementIgnore(1e-8);
+  Stats->recordLocation(12, 30);
+  Stats->recordLocation(12, 40);
+  ASSERT_EQ(Stats->getUncoveredRanks(), (vector<long>{1, 3}));
+  std::string const path = "statistics_test.stats";
+  Stats->save(path);
+
+  Statistics followUp;
+  followUp.setNbT4Volumes(4);
+  followUp.recordCoveredRank(1);
+  followUp.incrementSuccess();
+  followUp.recordLocation(12, 30);
+  followUp.merge(path);
+  ASSERT_EQ(followUp.getUncoveredRanks(), (vector<long>{3}));
+  ASSERT_EQ(followUp.getNbTested(), 5);
+  ASSERT_EQ(followUp.getTotalPts(), 6);
+  ASSERT_EQ(followUp.getNbFailure(), 1);
+  ASSERT_EQ(followUp.getFailureDistances().getMoments().getMean(), 0.125);
+  ASSERT_EQ(followUp.getIgnoredDistances().getMoments().getCount(), 1);
+  ASSERT_EQ(followUp.getIgnoredDistances().quantile(0.5), 1e-8);
+  ASSERT_EQ(followUp.getConfusionMatrix().getCount(12, 30), 2);
+  ASSERT_EQ(followUp.getConfusionMatrix().getCount(12, 40), 1);
+  auto const failures = followUp.getFailures();
+  ASSERT_EQ(failures.size(), 1u);
+  ASSERT_EQ(failures[0].position[1], 2.5);
+  ASSERT_EQ(failures[0].dist, 0.125);
+  ASSERT_EQ(failures[0].mcnpCellID, 12.);
+
+  Statistics otherGeometry;
+  otherGeometry.setNbT4Volumes(5);
+  ASSERT_THROW(otherGeometry.merge(path), std::runtime_error);
+  ASSERT_THROW(otherGeometry.merge("no_such_file.stats"), std::runtime_error);
+  std::remove(path.c_str());
+}
+
+TEST_F(StatisticsTest, MergeVersion1)
+{
+  std::string const path = "statistics_test_v1.stats";
+  {
+    ofstream out(path);
+    out << "ORACLESTATS 1\ncounts 1 2 0 0 0\nvolumes 2\ncovered 1 0\nfailures 2\n"
+        << "0 0 0 1 1 1 0.25 0\n0 0 0 2 1 1 0.75 0\n";
+  }
+  Stats->setNbT4Volumes(2);
+  Stats->merge(path);
+  // the distance summary is rebuilt from the failed points
+  ASSERT_EQ(Stats->getFailureDistances().getMoments().getCount(), 2);
+  ASSERT_EQ(Stats->getFailureDistances().getMoments().getMean(), 0.5);
+  ASSERT_EQ(Stats->getFailureDistances().getMoments().getMax(), 0.75);
+  std::remove(path.c_str());
+}
+
+TEST_F(StatisticsTest, ReportWithoutFailures)
+{
+  Stats->incrementSuccess();
+  stringstream output;
+  // the report is printed by the writer thread of the log: the streams are
+  // only swapped when it has nothing left to write
+  Log::sync();
+  streambuf *const previous = cout.rdbuf(output.rdbuf());
+  Stats->report();
+  Log::sync();
+  cout.rdbuf(previous);
+  ASSERT_EQ(output.str().find("nan"), string::npos);
+  ASSERT_NE(output.str().find("Average distance to surface for FAILED points: 0"), string::npos);
+  ASSERT_EQ(output.str().find("p50"), string::npos);
 }
@@ -101,3 +101,18 @@ TEST_F(T4test, DistanceToSurface)
   rank = volumes->which_volume(point2);
   ASSERT_FALSE(t4Geom->distanceFromSurface(point2, rank) <= 1e-7);
 }
+
+TEST(T4GeometryBytecode, MatchesTheLibrary)
+{
+  T4Geometry geometry("slab.t4", T4Backend::T4LIB);
+  geometry.compileBytecode();
+  ASSERT_NE(geometry.getBytecode(), nullptr);
+  for (double x = -120.; x <= 120.; x += 7.3) {
+    for (double y = -120.; y <= 120.; y += 7.3) {
+      for (double z = -2.05; z <= 2.; z += 0.1) {
+        vector<double> const point = {x, y, z};
+        ASSERT_EQ(geometry.whichVolumeUncached(point), geometry.whichVolumeReference(point));
+      }
+    }
+  }
+}
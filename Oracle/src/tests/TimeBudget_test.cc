@@ -0,0 +1,63 @@
+/**
+ * @file TimeBudget_test.cc
+ *
+ *
+ * @brief unit testing for the TimeBudget class
+ *
+ * @version 1.0
+ */
+
+#include "TimeBudget.hh"
+#include "gtest/gtest.h"
+#include <stdexcept>
+
+TEST(TimeBudget, KeepFraction)
+{
+  // 1000 points in 1 s at 1 ms per comparison: all of them
+  ASSERT_DOUBLE_EQ(TimeBudget::computeKeepFraction(1., 1000, 0., 1e-3), 1.);
+  // 10000 points: one in ten
+  ASSERT_NEAR(TimeBudget::computeKeepFraction(1., 10000, 0., 1e-3), 0.1, 1e-12);
+  // reading costs half of the time left per point
+  ASSERT_NEAR(TimeBudget::computeKeepFraction(1., 10000, 5e-5, 1.05e-3), 0.05, 1e-12);
+  // hardly any time left
+  ASSERT_GT(TimeBudget::computeKeepFraction(1e-9, 10000, 0., 1e-3), 0.);
+  // not even enough time to read the points
+  ASSERT_DOUBLE_EQ(TimeBudget::computeKeepFraction(1., 10000, 2e-4, 1e-3), 1.);
+  ASSERT_DOUBLE_EQ(TimeBudget::computeKeepFraction(1., 0, 0., 1e-3), 1.);
+}
+
+TEST(TimeBudget, SeededSampling)
+{
+  long nbSampled = 0;
+  long nbSampledFirstHalf = 0;
+  long nbDifferent = 0;
+  for (unsigned long index = 0; index < 100000; ++index) {
+    bool const inSample = TimeBudget::sampled(42, index, 0.1);
+    ASSERT_EQ(inSample, TimeBudget::sampled(42, index, 0.1));
+    nbSampled += inSample;
+    nbSampledFirstHalf += inSample && index < 50000;
+    nbDifferent += inSample != TimeBudget::sampled(43, index, 0.1);
+  }
+  ASSERT_NEAR(nbSampled, 10000, 400);
+  ASSERT_NEAR(nbSampledFirstHalf, 5000, 300);
+  ASSERT_GT(nbDifferent, 1000);
+  ASSERT_TRUE(TimeBudget::sampled(42, 7, 1.));
+}
+
+TEST(TimeBudget, Budget)
+{
+  TimeBudget budget(60., 1000, 0);
+  long nbSelected = 0;
+  for (unsigned long index = 0; index < 1000; ++index) {
+    nbSelected += budget.select(index);
+  }
+  // the loop is much faster than the budget: all the points are compared
+  ASSERT_EQ(nbSelected, 1000);
+  ASSERT_EQ(budget.getNbSelected(), 1000);
+  ASSERT_FALSE(budget.isExhausted());
+
+  TimeBudget spent(1e-9, 1000, 0);
+  ASSERT_FALSE(spent.select(0));
+  ASSERT_TRUE(spent.isExhausted());
+  ASSERT_THROW(TimeBudget(0., 10, 0), std::invalid_argument);
+}
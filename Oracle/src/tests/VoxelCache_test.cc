@@ -0,0 +1,167 @@
+/**
+ * @file VoxelCache_test.cc
+ *
+ *
+ * @brief unit testing for the VoxelCache class
+ *
+ * @version 1.0
+ */
+
+#include "T4Geometry.hh"
+#include "VoxelCache.hh"
+#include "gtest/gtest.h"
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+using namespace std;
+
+class VoxelCacheTest : public ::testing::Test
+{
+
+protected:
+  static void SetUpTestCase()
+  {
+#ifdef ORACLE_WITH_T4
+    t4_output_stream = &cout;
+    t4_language = (T4_language)0;
+#endif
+    t4Geom = new T4Geometry("slab.t4");
+  }
+
+  static void TearDownTestCase()
+  {
+    delete t4Geom;
+    t4Geom = nullptr;
+  }
+  static T4Geometry *t4Geom;
+
+  const std::array<double, 6> box = {{-2., 2., -2., 2., -1.5, 1.5}};
+  const std::array<long, 3> dims = {{8, 8, 6}};
+};
+
+T4Geometry *VoxelCacheTest::t4Geom = nullptr;
+
+TEST_F(VoxelCacheTest, LookupMatchesGeometry)
+{
+  VoxelCache cache(box, dims, 2);
+  cache.build(*t4Geom, 2);
+  ASSERT_GT(cache.getNbLabelled(), 0);
+
+  for (double z = -1.95; z < 2.; z += 0.1) {
+    vector<double> const point = {1.23, -1.56, z};
+    long const rank = cache.lookup(point);
+    if (rank != VoxelCache::mixed) {
+      ASSERT_EQ(rank, t4Geom->whichVolumeUncached(point));
+    }
+  }
+
+  // outside the grid
+  vector<double> const outside = {0., 0., 5.};
+  ASSERT_EQ(cache.lookup(outside), VoxelCache::mixed);
+}
+
+TEST_F(VoxelCacheTest, SaveAndLoad)
+{
+  VoxelCache cache(box, dims, 1);
+  cache.build(*t4Geom, 1);
+  std::string const path = "slab_test.voxels";
+  ASSERT_TRUE(cache.save(path, "abcd"));
+
+  VoxelCache loaded(box, dims, 1);
+  ASSERT_FALSE(loaded.load(path, "dcba", t4Geom->getNbVolumes()));
+  ASSERT_TRUE(loaded.load(path, "abcd", t4Geom->getNbVolumes()));
+  ASSERT_EQ(loaded.getNbLabelled(), cache.getNbLabelled());
+
+  VoxelCache otherGrid(box, {{4, 4, 4}}, 1);
+  ASSERT_FALSE(otherGrid.load(path, "abcd", t4Geom->getNbVolumes()));
+  std::remove(path.c_str());
+}
+
+TEST_F(VoxelCacheTest, LoadRejectsCorruptFiles)
+{
+  VoxelCache cache(box, dims, 2);
+  cache.build(*t4Geom, 1);
+  std::string const path = "slab_corrupt.voxels";
+  ASSERT_TRUE(cache.save(path, "abcd"));
+  std::string contents;
+  {
+    ifstream file(path, std::ios_base::binary);
+    contents.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+  }
+  auto loads = [&](std::string const &bytes, long nbVolumes) {
+    {
+      ofstream file(path, std::ios_base::binary);
+      file << bytes;
+    }
+    VoxelCache loaded(box, dims, 2);
+    return loaded.load(path, "abcd", nbVolumes);
+  };
+  long const nbVolumes = t4Geom->getNbVolumes();
+  ASSERT_TRUE(loads(contents, nbVolumes));
+  // a label of a volume which does not exist
+  ASSERT_FALSE(loads(contents, 0));
+  // truncated node array
+  ASSERT_FALSE(loads(contents.substr(0, contents.size() - 4), nbVolumes));
+
+  // a refined node pointing past the end of the file
+  size_t const nodesOffset = contents.size() - cache.getNbNodes() * sizeof(int32_t);
+  std::string corrupt = contents;
+  int32_t const pastTheEnd = -int32_t(cache.getNbNodes()) - 3;
+  corrupt.replace(nodesOffset, sizeof(int32_t), reinterpret_cast<char const *>(&pastTheEnd), sizeof(int32_t));
+  ASSERT_FALSE(loads(corrupt, nbVolumes));
+  std::remove(path.c_str());
+}
+
+TEST_F(VoxelCacheTest, Depth)
+{
+  // voxels far enough from the slab planes to be labelled
+  VoxelCache cache({{-0.2, 0.2, -0.2, 0.2, -0.2, 0.2}}, {{2, 2, 2}}, 0);
+  cache.build(*t4Geom, 1);
+  vector<double> const point = {0.1, 0.1, 0.1};
+  ASSERT_NE(cache.lookup(point), VoxelCache::mixed);
+  ASSERT_NEAR(cache.depth(point), 0.1, 1e-12);
+  ASSERT_LE(cache.depth(point), t4Geom->distanceFromSurface(point, cache.lookup(point)));
+  vector<double> const nearFace = {0.12, 0.15, 0.1};
+  ASSERT_NEAR(cache.depth(nearFace), 0.05, 1e-12);
+  vector<double> const outside = {0., 0., 5.};
+  ASSERT_EQ(cache.depth(outside), -1.);
+}
+
+TEST(VoxelCache, ObliquePlaneAndSmallSphere)
+{
+  // a sphere much smaller than the voxels, across an oblique plane, in a cylinder
+  std::string const path = "voxel_oblique.t4";
+  {
+    ofstream file(path);
+    file << "GEOMETRY\n"
+            "SURF 1 PLANE 1 1 1 0.2\n"
+            "SURF 2 SPHERE 0.05 0 0 0.15\n"
+            "SURF 3 CYLZ 0 0 5\n"
+            "VOLU 1 EQUA MINUS 1 2 ENDV\n"
+            "VOLU 2 EQUA PLUS 1 1 MINUS 1 3 ENDV\n"
+            "VOLU 3 EQUA MINUS 2 1 3 ENDV\n"
+            "ENDG\n";
+  }
+  T4Geometry geometry(path, T4Backend::NATIVE);
+  VoxelCache cache({{-2., 2., -2., 2., -2., 2.}}, {{4, 4, 4}}, 3);
+  cache.build(geometry, 2);
+  ASSERT_NE(cache.lookup({1.5, 1.5, 1.5}), VoxelCache::mixed);
+  geometry.setupVoxelCache({{-2., 2., -2., 2., -2., 2.}}, {{4, 4, 4}}, 3, 2, "");
+
+  long nbCached = 0;
+  for (double x = -1.987; x < 2.; x += 0.05) {
+    for (double y = -1.987; y < 2.; y += 0.05) {
+      for (double z = -1.987; z < 2.; z += 0.05) {
+        vector<double> const point = {x, y, z};
+        ASSERT_EQ(geometry.whichVolume(point), geometry.whichVolumeUncached(point));
+        nbCached += cache.lookup(point) != VoxelCache::mixed;
+      }
+    }
+  }
+  ASSERT_GT(nbCached, 0);
+  // the small sphere is found in the cache or in the geometry
+  ASSERT_EQ(geometry.whichVolume({0.05, 0., 0.}), 0);
+  std::remove(path.c_str());
+}
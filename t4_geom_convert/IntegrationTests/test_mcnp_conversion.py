@@ -22,7 +22,7 @@
 import shlex
 import pytest
 from t4_geom_convert.main import conversion, parse_args
-from ..conftest import foreach_data, parse_outside_points
+from ..conftest import foreach_data, parse_events, parse_outside_points
 
 
 def get_options(mcnp_path, n_lines=50):
@@ -135,3 +135,14 @@ def test_parse_outside_points(datadir):
     oracle_stdout = datadir / 'oracle_stdout'
     n_outside = parse_outside_points(oracle_stdout)
     assert n_outside == 9619
+
+
+def test_parse_events(datadir):
+    '''Test that :func:`~.parse_events` returns the summary written by the
+    oracle with ``--events``.'''
+    summary = parse_events(datadir / 'oracle_events.ndjson')
+    assert summary['t4_file'] == 'slab.t4'
+    assert summary['failed'] == 2
+    assert summary['outside'] == 9619
+    assert summary['failed_distance_max'] == 0.25
+    assert summary['ignored_distance_max'] is None
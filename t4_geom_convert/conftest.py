@@ -20,6 +20,7 @@
 
 `pytest`_ configuration file.
 '''
+import json
 import pathlib
 import subprocess as sub
 import re
@@ -190,6 +191,19 @@ def parse_outside_points(stdout_path):
     return None
 
 
+def parse_events(events_path):
+    '''Read the newline-delimited JSON file written by the oracle with
+    ``--events`` and return the record of the final summary, as a
+    dictionary.'''
+    summary = None
+    with events_path.open() as events:
+        for line in events:
+            record = json.loads(line)
+            if record['event'] == 'summary':
+                summary = record
+    return summary
+
+
 class OracleRunner:  # pylint: disable=too-few-public-methods
     '''A helper class to run the test oracle.'''
 
@@ -212,7 +226,9 @@ class OracleRunner:  # pylint: disable=too-few-public-methods
         :param str mcnp_ptrac: absolute path to the MCNP PTRAC file
         :returns: the number of failed points in the comparison
         '''
-        cli = [str(self.path), str(t4_o), str(mcnp_i), str(mcnp_ptrac)]
+        events_fname = self.work_path / 'events.ndjson'
+        cli = [str(self.path), str(t4_o), str(mcnp_i), str(mcnp_ptrac),
+               '--events', str(events_fname)]
         if oracle_opts is not None:
             cli += oracle_opts
         stdout_fname = self.work_path / 'stdout'
@@ -226,9 +242,13 @@ class OracleRunner:  # pylint: disable=too-few-public-methods
                    + stdout_fname.read_text())
             raise ValueError(msg)
         print(stdout_fname.read_text() + '---8<---' * 9)
+        summary = parse_events(events_fname)
+        assert summary is not None, 'no summary in ' + str(events_fname)
+        n_points = summary['failed']
+        n_outside = summary['outside']
+        dist = summary['failed_distance_max'] or 0
         failed_path = self.work_path / (t4_o.stem + '.failedpoints.dat')
-        n_points, dist = check_failed_points(failed_path)
-        n_outside = parse_outside_points(stdout_fname)
+        assert check_failed_points(failed_path)[0] == n_points
         return n_points, n_outside, dist, stdout_fname
 
 